@@ -1461,6 +1461,12 @@ namespace video
 		//! Get the maximum texture size supported.
 		virtual core::dimension2du getMaxTextureSize() const =0;
 
+		//! Set a function which is called before the driver draws anything
+		/** Allows the application to draw geometry it collected with
+		its own OpenGL calls first, so that the drawing order is kept.
+		\param callback The function, or 0 to remove it. */
+		virtual void setBeforeDrawCallback(void (*callback)()) =0;
+
 		//! Convert the number of indices to the number of primitives
 		virtual u32 indiceToPrimitiveCount(scene::E_PRIMITIVE_TYPE pType, u32 count) const = 0;
 
@@ -642,6 +642,12 @@ namespace video
 		//! Enable the 2d override material
 		virtual void enableMaterial2D(bool enable=true);
 
+		//! Set a function which is called before the driver draws anything
+		virtual void setBeforeDrawCallback(void (*callback)())
+		{
+			BeforeDrawCallback = callback;
+		}
+
 		//! Only used by the engine internally.
 		virtual void setAllowZWriteOnTransparent(bool flag)
 		{ AllowZWriteOnTransparent=flag; }
@@ -845,6 +851,8 @@ namespace video
 		SMaterial InitMaterial2D;
 		bool OverrideMaterial2DEnabled;
 
+		void (*BeforeDrawCallback)();
+
 		E_FOG_TYPE FogType;
 		bool PixelFog;
 		bool RangeFog;
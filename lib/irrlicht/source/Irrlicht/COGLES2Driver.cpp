@@ -1950,6 +1950,9 @@ namespace video
 
 	void COGLES2Driver::setRenderStates3DMode()
 	{
+		if (BeforeDrawCallback)
+			BeforeDrawCallback();
+
 		if (CurrentRenderMode != ERM_3D)
 		{
 			// Reset Texture Stages
@@ -2217,6 +2220,9 @@ namespace video
 	//! sets the needed renderstates
 	void COGLES2Driver::setRenderStates2DMode(bool alpha, bool texture, bool alphaChannel)
 	{
+		if (BeforeDrawCallback)
+			BeforeDrawCallback();
+
 		if (CurrentRenderMode != ERM_2D)
 		{
 			// unset last 3d material
@@ -2675,6 +2675,9 @@ bool COpenGLDriver::testGLError()
 //! sets the needed renderstates
 void COpenGLDriver::setRenderStates3DMode()
 {
+	if (BeforeDrawCallback)
+		BeforeDrawCallback();
+
 	if (CurrentRenderMode != ERM_3D)
 	{
 		// Reset Texture Stages
@@ -3329,6 +3332,9 @@ void COpenGLDriver::enableMaterial2D(bool enable)
 //! sets the needed renderstates
 void COpenGLDriver::setRenderStates2DMode(bool alpha, bool texture, bool alphaChannel)
 {
+	if (BeforeDrawCallback)
+		BeforeDrawCallback();
+
 	if (CurrentRenderMode != ERM_2D || Transformation3DChanged)
 	{
 		// unset last 3d material
@@ -484,20 +484,43 @@ bool AddonsManager::install(const Addon &addon)
     std::string from      = file_manager->getAddonsFile("tmp/"+base_name);
     std::string to        = addon.getDataDir();
 	
-	bool success = extract_zip(from, to);
-    if (!success)
+    // Remove the archive of a previous version of this addon (if any)
+    std::string archive = file_manager->getAddonArchiveName(to);
+    file_manager->unmountArchive(to);
+    if (file_manager->fileExists(archive))
+        file_manager->removeFile(archive);
+
+    // Mount the archive instead of extracting it if possible
+    bool mounted = false;
+    if (UserConfigParams::m_mount_addon_archives &&
+        rename(from.c_str(), archive.c_str()) == 0)
     {
-        // TODO: show a message in the interface
-        logerror("addons", "Failed to unzip '%s' to '%s'.",
-                    from.c_str(), to.c_str());
-        logerror("addons", "Zip file will not be removed.");
-        return false;
+        mounted = file_manager->mountArchive(archive, to);
+        if (!mounted)
+        {
+            logwarn("addons", "Can not mount '%s', extracting it instead.",
+                    archive.c_str());
+            rename(archive.c_str(), from.c_str());
+        }
     }
 
-    if(!file_manager->removeFile(from))
+    if (!mounted)
     {
-        logerror("addons", "Problems removing temporary file '%s'.",
-                    from.c_str());
+        bool success = extract_zip(from, to);
+        if (!success)
+        {
+            // TODO: show a message in the interface
+            logerror("addons", "Failed to unzip '%s' to '%s'.",
+                        from.c_str(), to.c_str());
+            logerror("addons", "Zip file will not be removed.");
+            return false;
+        }
+
+        if(!file_manager->removeFile(from))
+        {
+            logerror("addons", "Problems removing temporary file '%s'.",
+                        from.c_str());
+        }
     }
 
     int index = getAddonIndex(addon.getId());
@@ -561,6 +584,7 @@ bool AddonsManager::uninstall(const Addon &addon)
     // because the kart/track was never added in the first place
     if (file_manager->fileExists(addon.getDataDir()))
     {
+        file_manager->unmountArchive(addon.getDataDir());
         error = !file_manager->removeDirectory(addon.getDataDir());
 
         // Even if an error happened when removing the data files
@@ -21,55 +21,162 @@
 #define HEADER_DUMMY_SFX_HPP
 
 #include "audio/sfx_base.hpp"
+#include "audio/sfx_buffer.hpp"
 
 
 /**
- * \brief Dummy sound when ogg or openal aren't available
+ * \brief Dummy sound when ogg or openal aren't available.
+ *  Nothing is played, but the state of the sfx (status, play time, position,
+ *  volume and if it has a real voice) is kept, and all commands are executed
+ *  immediately. This allows testing the voice handling of the SFXManager
+ *  without an audio device.
  * \ingroup audio
  */
 class DummySFX : public SFXBase
 {
+private:
+    SFXBuffer *m_buffer;
+    SFXStatus  m_status;
+    bool       m_positional;
+    bool       m_loop;
+    bool       m_owns_buffer;
+    /** True if this sfx has a real voice. */
+    bool       m_real;
+    float      m_default_gain;
+    /** Gain set with setVolume, or a negative value if it was not set. */
+    float      m_gain;
+    float      m_speed;
+    float      m_play_time;
+    Vec3       m_position;
+
 public:
                        DummySFX(SFXBuffer* buffer, bool positional,
-                                float gain) {}
-    virtual           ~DummySFX()                     {}
-
+                                float gain, bool owns_buffer = false)
+    {
+        m_buffer       = buffer;
+        m_status       = SFX_STOPPED;
+        m_positional   = positional;
+        m_loop         = false;
+        m_owns_buffer  = owns_buffer;
+        m_real         = false;
+        m_default_gain = gain;
+        m_gain         = -1.0f;
+        m_speed        = 1.0f;
+        m_play_time    = 0.0f;
+    }   // DummySFX
+    // ------------------------------------------------------------------------
+    virtual           ~DummySFX()
+    {
+        if (m_owns_buffer && m_buffer)
+        {
+            m_buffer->unload();
+            delete m_buffer;
+        }
+    }   // ~DummySFX
+    // ------------------------------------------------------------------------
+    /** Advances the play time, and stops the sfx if it has finished. */
+    virtual void       updatePlayingSFX(float dt)
+    {
+        m_play_time += dt*m_speed;
+        if (!m_loop && m_buffer && m_buffer->getDuration() >= 0 &&
+            m_play_time > m_buffer->getDuration())
+            reallyStopNow();
+    }   // updatePlayingSFX
+    // ------------------------------------------------------------------------
+    virtual float      getAudibility(const Vec3 &listener)
+    {
+        float gain = m_gain < 0.0f ? m_default_gain : m_gain;
+        return SFXManager::computeAudibility(gain, m_positional,
+                                    (m_position - listener).length(),
+                                    m_buffer ? m_buffer->getRolloff() : 0.1f,
+                                    m_buffer ? m_buffer->getMaxDist() : 300.0f);
+    }   // getAudibility
+    // ------------------------------------------------------------------------
+    virtual void       reallyStopNow()
+    {
+        m_status = SFX_STOPPED;
+        m_loop   = false;
+        m_real   = false;
+    }   // reallyStopNow
+    // ------------------------------------------------------------------------
+    virtual void       reallyPlayNow()
+    {
+        if (m_status == SFX_STOPPED) m_play_time = 0.0f;
+        m_status = SFX_PLAYING;
+    }   // reallyPlayNow
+    // ------------------------------------------------------------------------
+    virtual void       reallyPauseNow()
+    {
+        if (m_status != SFX_PLAYING) return;
+        m_status = SFX_PAUSED;
+        m_real   = false;
+    }   // reallyPauseNow
+    // ------------------------------------------------------------------------
+    virtual void       reallyResumeNow()
+    {
+        if (m_status == SFX_PAUSED) m_status = SFX_PLAYING;
+    }   // reallyResumeNow
+    // ------------------------------------------------------------------------
+    virtual bool       reallyMakeRealNow()
+    {
+        if (m_status != SFX_PLAYING) return false;
+        m_real = true;
+        return true;
+    }   // reallyMakeRealNow
+    // ------------------------------------------------------------------------
+    virtual void       reallyMakeVirtualNow()   { m_real = false;          }
+    virtual bool       isVirtual()
+    {
+        return m_status == SFX_PLAYING && !m_real;
+    }   // isVirtual
+    // ------------------------------------------------------------------------
     /** Late creation, if SFX was initially disabled */
-    virtual bool       init()                           { return true;  }
-    virtual bool       isLooped()                       { return false; }
-    virtual void       updatePlayingSFX(float dt)       {}
-    virtual void       setLoop(bool status)             {}
-    virtual void       reallySetLoop(bool status)       {}
-    virtual void       setPosition(const Vec3 &p)       {}
-    virtual void       reallySetPosition(const Vec3 &p) {}
+    virtual bool       init()                           { return true;    }
+    virtual bool       isLooped()                       { return m_loop;  }
+    virtual void       setLoop(bool status)             { m_loop = status;}
+    virtual void       reallySetLoop(bool status)       { m_loop = status;}
+    virtual void       setPosition(const Vec3 &p)       { m_position = p; }
+    virtual void       reallySetPosition(const Vec3 &p) { m_position = p; }
     virtual void       setSpeedPosition(float factor,
-                                        const Vec3 &p)  {}
+                                        const Vec3 &p)
+    {
+        reallySetSpeedPosition(factor, p);
+    }
     virtual void       reallySetSpeedPosition(float f,
-                                         const Vec3 &p) {}
-    virtual void       play()                           {}
-    virtual void       reallyPlayNow()                  {}
-    virtual void       play(const Vec3 &xyz)            {}
-    virtual void       reallyPlayNow(const Vec3 &xyz)   {}
-    virtual void       stop()                           {}
-    virtual void       reallyStopNow()                  {}
-    virtual void       pause()                          {}
-    virtual void       reallyPauseNow()                 {}
-    virtual void       resume()                         {}
-    virtual void       reallyResumeNow()                {}
-    virtual void       deleteSFX()                      { delete this; }
-    virtual void       setSpeed(float factor)           {}
-    virtual void       reallySetSpeed(float factor)     {}
-    virtual void       setVolume(float gain)            {}
-    virtual void       reallySetVolume(float gain)      {}
+                                         const Vec3 &p)
+    {
+        m_speed = f; m_position = p;
+    }
+    virtual void       play()                           { reallyPlayNow(); }
+    virtual void       play(const Vec3 &xyz)       { reallyPlayNow(xyz);  }
+    virtual void       reallyPlayNow(const Vec3 &xyz)
+    {
+        m_position = xyz;
+        reallyPlayNow();
+    }
+    virtual void       stop()                           { reallyStopNow(); }
+    virtual void       pause()                         { reallyPauseNow(); }
+    virtual void       resume()                       { reallyResumeNow(); }
+    virtual void       deleteSFX()
+    {
+        SFXManager::get()->queue(SFXManager::SFX_DELETE, this);
+    }
+    virtual void       setSpeed(float factor)           { m_speed = factor;}
+    virtual void       reallySetSpeed(float factor)     { m_speed = factor;}
+    virtual void       setVolume(float gain)  { reallySetVolume(gain);     }
+    virtual void       reallySetVolume(float gain)
+    {
+        m_gain = m_default_gain * gain;
+    }
     virtual void       setMasterVolume(float gain)      {}
     virtual void       reallySetMasterVolumeNow(float gain) {}
-    virtual SFXStatus  getStatus()                      { return SFX_STOPPED; }
+    virtual SFXStatus  getStatus()                      { return m_status; }
+    virtual float      getPlayTime()                 { return m_play_time; }
     virtual void       onSoundEnabledBack()             {}
     virtual void       setRolloff(float rolloff)        {}
-    virtual const SFXBuffer* getBuffer() const          { return NULL; }
+    virtual const SFXBuffer* getBuffer() const          { return m_buffer; }
 
 };   // DummySFX
 
 
 #endif // HEADER_SFX_HPP
-
@@ -29,8 +29,14 @@
 
 #include "audio/music_manager.hpp"
 #include "audio/sfx_manager.hpp"
+#include "audio/vorbis_read_file.hpp"
 #include "utils/constants.hpp"
 #include "utils/log.hpp"
+#include "utils/vs.hpp"
+
+#if defined(WIN32)
+#  include <windows.h>
+#endif
 
 MusicOggStream::MusicOggStream(float loop_start)
 {
@@ -40,6 +46,18 @@ MusicOggStream::MusicOggStream(float loop_start)
     m_pausedMusic     = true;
     m_playing         = false;
     m_loop_start      = loop_start;
+    m_decoder_running = false;
+    m_stop_decoder    = false;
+    m_decoder_failed  = false;
+    m_decoded_first   = 0;
+    m_decoded_count   = 0;
+    for (int i = 0; i < NUM_DECODED_BUFFERS; i++)
+    {
+        m_decoded[i].resize(m_buffer_size);
+        m_decoded_size[i] = 0;
+    }
+    pthread_mutex_init(&m_decoder_mutex, NULL);
+    pthread_cond_init(&m_decoder_cond, NULL);
 }   // MusicOggStream
 
 //-----------------------------------------------------------------------------
@@ -47,12 +65,15 @@ MusicOggStream::~MusicOggStream()
 {
     if(stopMusic() == false)
         logwarn("MusicOgg", "problems while stopping music.");
+    pthread_cond_destroy(&m_decoder_cond);
+    pthread_mutex_destroy(&m_decoder_mutex);
 }   // ~MusicOggStream
 
 //-----------------------------------------------------------------------------
 bool MusicOggStream::load(const std::string& filename)
 {
-    if (isPlaying()) stopMusic();
+    // Also releases a previously loaded, but not playing, music
+    stopMusic();
 
     m_error = true;
     m_fileName = filename;
@@ -60,23 +81,32 @@ bool MusicOggStream::load(const std::string& filename)
 
     m_oggFile = fopen(m_fileName.c_str(), "rb");
 
-    if(!m_oggFile)
+    int result;
+    if(m_oggFile)
     {
-        logerror("MusicOgg", "Loading Music: %s failed (fopen returned NULL)",
-                   m_fileName.c_str());
-        return false;
-    }
-
 #if defined( WIN32 ) || defined( WIN64 )
-    const int result = ov_open_callbacks((void *)m_oggFile, &m_oggStream, NULL,
-                                         0, OV_CALLBACKS_DEFAULT             );
+        result = ov_open_callbacks((void *)m_oggFile, &m_oggStream, NULL,
+                                   0, OV_CALLBACKS_DEFAULT             );
 #else
-    const int result = ov_open(m_oggFile, &m_oggStream, NULL, 0);
+        result = ov_open(m_oggFile, &m_oggStream, NULL, 0);
 #endif
+        if (result < 0)
+            fclose(m_oggFile);
+    }
+    else
+    {
+        // The music might be part of a mounted addon archive
+        result = openVorbisReadFile(m_fileName, &m_oggStream);
+        if (result == OV_EREAD)
+        {
+            logerror("MusicOgg", "Loading Music: %s failed (fopen returned NULL)",
+                       m_fileName.c_str());
+            return false;
+        }
+    }
 
     if (result < 0)
     {
-        fclose(m_oggFile);
 
 
         const char* errorMessage;
@@ -125,9 +155,137 @@ bool MusicOggStream::load(const std::string& filename)
     alSourcei (m_soundSource, AL_SOURCE_RELATIVE, AL_TRUE      );
 
     m_error=false;
+    // Start decoding now, so that data is ready when the music is played
+    startDecoder();
     return true;
 }   // load
 
+//-----------------------------------------------------------------------------
+/** Starts the thread that decodes the music ahead of time.
+ */
+void MusicOggStream::startDecoder()
+{
+    m_decoded_first  = 0;
+    m_decoded_count  = 0;
+    m_stop_decoder   = false;
+    m_decoder_failed = false;
+    m_decoder_running = pthread_create(&m_decoder_thread, NULL,
+                                       &MusicOggStream::decoderLoop,
+                                       this) == 0;
+    if (!m_decoder_running)
+    {
+        logerror("MusicOgg", "Could not create decoder thread for '%s'.",
+                 m_fileName.c_str());
+        m_decoder_failed = true;
+    }
+}   // startDecoder
+
+//-----------------------------------------------------------------------------
+/** Stops the decoder thread and waits for it to finish.
+ */
+void MusicOggStream::stopDecoder()
+{
+    if (!m_decoder_running) return;
+    pthread_mutex_lock(&m_decoder_mutex);
+    m_stop_decoder = true;
+    pthread_cond_broadcast(&m_decoder_cond);
+    pthread_mutex_unlock(&m_decoder_mutex);
+    pthread_join(m_decoder_thread, NULL);
+    m_decoder_running = false;
+}   // stopDecoder
+
+//-----------------------------------------------------------------------------
+/** The decoder thread: keeps all buffers of the ring filled with decoded
+ *  data, till it is stopped or no more data can be decoded.
+ *  \param obj The music object.
+ */
+void *MusicOggStream::decoderLoop(void *obj)
+{
+    MusicOggStream *me = (MusicOggStream*)obj;
+    VS::setThreadName("MusicDecoder");
+    // Decoding is ahead by several buffers, so it does not need to compete
+    // with the threads doing the game and graphics work.
+#if defined(WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(SCHED_BATCH)
+    sched_param param;
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+#endif
+
+    pthread_mutex_lock(&me->m_decoder_mutex);
+    while (true)
+    {
+        while (!me->m_stop_decoder &&
+               me->m_decoded_count == NUM_DECODED_BUFFERS)
+            pthread_cond_wait(&me->m_decoder_cond, &me->m_decoder_mutex);
+        if (me->m_stop_decoder) break;
+
+        // This buffer is not used by the consumer till m_decoded_count
+        // is increased, so it can be filled without holding the lock.
+        int index = (me->m_decoded_first + me->m_decoded_count)
+                  % NUM_DECODED_BUFFERS;
+        pthread_mutex_unlock(&me->m_decoder_mutex);
+        int size = me->decode(me->m_decoded[index].data());
+        pthread_mutex_lock(&me->m_decoder_mutex);
+
+        if (size <= 0)
+        {
+            me->m_decoder_failed = true;
+            pthread_cond_broadcast(&me->m_decoder_cond);
+            break;
+        }
+        me->m_decoded_size[index] = size;
+        me->m_decoded_count++;
+        pthread_cond_broadcast(&me->m_decoder_cond);
+    }
+    pthread_mutex_unlock(&me->m_decoder_mutex);
+    return NULL;
+}   // decoderLoop
+
+//-----------------------------------------------------------------------------
+/** Decodes one buffer of music. When the end of the music is reached, it
+ *  continues at the loop start.
+ *  \param pcm Where to store the data (m_buffer_size bytes).
+ *  \return Number of bytes decoded, 0 if no data is available, or a
+ *          negative value on error.
+ */
+int MusicOggStream::decode(char *pcm)
+{
+    const int isBigEndian = (IS_LITTLE_ENDIAN ? 0 : 1);
+
+    int  size = 0;
+    int  portion;
+    bool looped = false;
+
+    while(size < m_buffer_size)
+    {
+        int result = ov_read(&m_oggStream, pcm + size, m_buffer_size - size,
+                         isBigEndian, 2, 1, &portion);
+
+        if(result > 0)
+        {
+            size  += result;
+            looped = false;
+        }
+        else if(result < 0)
+        {
+            logerror("MusicOgg", "Error decoding '%s': %s",
+                     m_fileName.c_str(), errorString(result).c_str());
+            return result;
+        }
+        else
+        {
+            // No more data. Seek to loop start (causes the sound to loop),
+            // but avoid an endless loop if there is no data after it.
+            if (looped) break;
+            ov_time_seek(&m_oggStream, m_loop_start);
+            looped = true;
+        }
+    }
+    return size;
+}   // decode
+
 //-----------------------------------------------------------------------------
 bool MusicOggStream::empty()
 {
@@ -157,6 +315,9 @@ bool MusicOggStream::release()
     pauseMusic();
     m_fileName= "";
 
+    // The decoder must be stopped before the ogg stream is cleared
+    stopDecoder();
+
     empty();
     alDeleteSources(1, &m_soundSource);
     check("alDeleteSources");
@@ -178,10 +339,10 @@ bool MusicOggStream::playMusic()
     if(isPlaying())
         return true;
 
-    if(!streamIntoBuffer(m_soundBuffers[0]))
+    if(!streamIntoBuffer(m_soundBuffers[0], /*wait*/true))
         return false;
 
-    if(!streamIntoBuffer(m_soundBuffers[1]))
+    if(!streamIntoBuffer(m_soundBuffers[1], /*wait*/true))
         return false;
 
     alSourceQueueBuffers(m_soundSource, 2, m_soundBuffers);
@@ -275,29 +436,28 @@ void MusicOggStream::update()
     }
 
     int processed= 0;
-    bool active= true;
 
     alGetSourcei(m_soundSource, AL_BUFFERS_PROCESSED, &processed);
 
-    while(processed--)
+    // Only unqueue buffers for which decoded data is available. If the
+    // decoder is behind, the remaining buffers are refilled in a later call.
+    while(processed-- && hasDecodedData())
     {
         ALuint buffer;
 
         alSourceUnqueueBuffers(m_soundSource, 1, &buffer);
         if(!check("alSourceUnqueueBuffers")) return;
 
-        active = streamIntoBuffer(buffer);
-        if(!active)
-        {
-            // no more data. Seek to loop start (causes the sound to loop)
-            ov_time_seek(&m_oggStream, m_loop_start);
-            active = streamIntoBuffer(buffer);//now there really should be data
-        }
+        streamIntoBuffer(buffer, /*wait*/false);
 
         alSourceQueueBuffers(m_soundSource, 1, &buffer);
         if (!check("alSourceQueueBuffers")) return;
     }
 
+    pthread_mutex_lock(&m_decoder_mutex);
+    bool active = m_decoded_count > 0 || !m_decoder_failed;
+    pthread_mutex_unlock(&m_decoder_mutex);
+
     if (active)
     {
         // For debugging
@@ -318,38 +478,56 @@ void MusicOggStream::update()
     }
     else
     {
-        logwarn("MusicOgg", "Attempt to stream music into buffer failed twice in a row.");
+        // Prevent flooding
+        static int count = 0;
+        if (count++ < 10)
+            logwarn("MusicOgg", "No more music data could be decoded.");
     }
 }   // update
 
 //-----------------------------------------------------------------------------
-bool MusicOggStream::streamIntoBuffer(ALuint buffer)
+/** Returns true if decoded data is ready. Only the sfx thread uses the
+ *  decoded data, so if this returns true, the data stays available.
+ */
+bool MusicOggStream::hasDecodedData()
 {
-    char pcm[m_buffer_size];
-    const int isBigEndian = (IS_LITTLE_ENDIAN ? 0 : 1);
+    pthread_mutex_lock(&m_decoder_mutex);
+    bool has_data = m_decoded_count > 0;
+    pthread_mutex_unlock(&m_decoder_mutex);
+    return has_data;
+}   // hasDecodedData
 
-    int  size = 0;
-    int  portion;
-
-    while(size < m_buffer_size)
+//-----------------------------------------------------------------------------
+/** Copies the next decoded buffer into an OpenAL buffer.
+ *  \param buffer The OpenAL buffer to fill.
+ *  \param wait If no decoded data is ready, wait for the decoder (which
+ *         is only done when starting to play the music).
+ *  \return False if no data was available.
+ */
+bool MusicOggStream::streamIntoBuffer(ALuint buffer, bool wait)
+{
+    pthread_mutex_lock(&m_decoder_mutex);
+    while (wait && m_decoded_count == 0 && !m_decoder_failed)
+        pthread_cond_wait(&m_decoder_cond, &m_decoder_mutex);
+    if (m_decoded_count == 0)
     {
-        int result = ov_read(&m_oggStream, pcm + size, m_buffer_size - size,
-                         isBigEndian, 2, 1, &portion);
-
-        if(result > 0)
-            size += result;
-        else
-            if(result < 0)
-                throw errorString(result);
-            else
-                break;
+        pthread_mutex_unlock(&m_decoder_mutex);
+        return false;
     }
+    int index = m_decoded_first;
+    pthread_mutex_unlock(&m_decoder_mutex);
 
-    if(size == 0) return false;
-
-    alBufferData(buffer, nb_channels, pcm, size, m_vorbisInfo->rate);
+    // The decoder does not touch this buffer till it is released below
+    alBufferData(buffer, nb_channels, m_decoded[index].data(),
+                 m_decoded_size[index], m_vorbisInfo->rate);
     check("alBufferData");
 
+    pthread_mutex_lock(&m_decoder_mutex);
+    m_decoded_first = (m_decoded_first + 1) % NUM_DECODED_BUFFERS;
+    m_decoded_count--;
+    pthread_cond_broadcast(&m_decoder_cond);
+    pthread_mutex_unlock(&m_decoder_mutex);
+
     return true;
 }   // streamIntoBuffer
 
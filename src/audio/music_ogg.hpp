@@ -21,7 +21,9 @@
 
 #if HAVE_OGGVORBIS
 
+#include <pthread.h>
 #include <string>
+#include <vector>
 
 #include <ogg/ogg.h>
 // Disable warning about potential loss of precision in vorbisfile.h
@@ -42,6 +44,9 @@
 
 /**
   * \brief ogg files based implementation of the Music interface
+  *  The music is decoded ahead of time by a separate (low priority) thread
+  *  into a ring of PCM buffers, so that update(), which is called from the
+  *  sfx thread, only has to copy ready data into OpenAL buffers.
   * \ingroup audio
   */
 class MusicOggStream : public Music
@@ -69,7 +74,12 @@ protected:
 
 private:
     bool release();
-    bool streamIntoBuffer(ALuint buffer);
+    bool streamIntoBuffer(ALuint buffer, bool wait);
+    bool hasDecodedData();
+    int  decode(char *pcm);
+    void startDecoder();
+    void stopDecoder();
+    static void *decoderLoop(void *obj);
 
     float           m_loop_start;
     std::string     m_fileName;
@@ -88,6 +98,40 @@ private:
 
     //one full second of audio at 44100 samples per second
     static const int m_buffer_size = 11025*4;
+
+    /** Number of decoded buffers the decoder thread keeps ready. */
+    static const int NUM_DECODED_BUFFERS = 8;
+
+    /** The ring of decoded PCM data. */
+    std::vector<char> m_decoded[NUM_DECODED_BUFFERS];
+
+    /** Number of bytes in each decoded buffer. */
+    int m_decoded_size[NUM_DECODED_BUFFERS];
+
+    /** Index of the next decoded buffer to give to OpenAL. */
+    int m_decoded_first;
+
+    /** Number of decoded buffers ready to be used. */
+    int m_decoded_count;
+
+    /** Protects the ring of decoded buffers and the decoder flags. */
+    pthread_mutex_t m_decoder_mutex;
+
+    /** Signaled when a buffer was decoded or used, or the decoder should
+     *  stop. */
+    pthread_cond_t  m_decoder_cond;
+
+    /** The decoder thread. */
+    pthread_t       m_decoder_thread;
+
+    /** True while the decoder thread is running. */
+    bool            m_decoder_running;
+
+    /** Set to stop the decoder thread. */
+    bool            m_stop_decoder;
+
+    /** Set by the decoder thread if no more data can be decoded. */
+    bool            m_decoder_failed;
 };
 
 #endif
@@ -37,6 +37,10 @@ class Vec3;
  *  effect object, use sfx_manager->getSFX(...); do not create an instance
  *  with new, since SFXManager makes sure to stop/restart all SFX (esp.
  *  looping sfx like engine sounds) when necessary.
+ *  A playing sfx is either real, i.e. it is actually mixed by the audio
+ *  backend, or virtual: only its play time is advanced. Only a limited
+ *  number of sfx can be real at the same time, SFXManager::assignVoices()
+ *  decides which sfx get a real voice.
  * \ingroup audio
  */
 class SFXBase : public NoCopy
@@ -49,6 +53,20 @@ public:
         SFX_NOT_INITIALISED = 3
     };
 
+    /** Priority class of a sound effect. If more sound effects are playing
+     *  than real voices are available, the audibility of a sfx is weighted
+     *  with its priority to decide which sfx get a real voice. */
+    enum SFXPriority
+    {
+        SFX_PRIORITY_LOW = 0, SFX_PRIORITY_NORMAL = 1, SFX_PRIORITY_HIGH = 2
+    };
+
+private:
+    /** The priority class of this sfx. */
+    SFXPriority m_priority;
+
+public:
+                       SFXBase() { m_priority = SFX_PRIORITY_NORMAL; }
     virtual           ~SFXBase()  {}
 
     /** Late creation, if SFX was initially disabled */
@@ -84,6 +102,18 @@ public:
     virtual void       setRolloff(float rolloff)            = 0;
     virtual const SFXBuffer* getBuffer() const              = 0;
     virtual SFXStatus  getStatus()                          = 0;
+    virtual float      getAudibility(const Vec3 &listener)  = 0;
+    virtual float      getPlayTime()                        = 0;
+    virtual bool       isVirtual()                          = 0;
+    virtual bool       reallyMakeRealNow()                  = 0;
+    virtual void       reallyMakeVirtualNow()               = 0;
+
+    // ------------------------------------------------------------------------
+    /** Sets the priority class of this sfx. */
+    void        setPriority(SFXPriority priority) { m_priority = priority; }
+    // ------------------------------------------------------------------------
+    /** Returns the priority class of this sfx. */
+    SFXPriority getPriority() const { return m_priority; }
 
 };   // SFXBase
 
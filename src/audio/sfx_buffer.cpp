@@ -18,11 +18,20 @@
 
 #include "audio/sfx_buffer.hpp"
 #include "audio/sfx_manager.hpp"
+#include "audio/vorbis_read_file.hpp"
 #include "config/user_config.hpp"
 #include "io/file_manager.hpp"
 #include "utils/constants.hpp"
+#include "utils/hash.hpp"
 #include "utils/log.hpp"
 
+#include <IFileSystem.h>
+#include <IReadFile.h>
+
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
 #if HAVE_OGGVORBIS
 #  include <vorbis/codec.h>
 #  include <vorbis/vorbisfile.h>
@@ -35,6 +44,11 @@
 #  endif
 #endif
 
+/** Only sfx whose decoded data is at most this size (about 12 seconds of
+ *  stereo data at 44.1 kHz) are cached, music-like sfx are decoded each
+ *  time. */
+static const uint32_t MAX_CACHED_PCM_SIZE = 2*1024*1024;
+
 //----------------------------------------------------------------------------
 /** Creates a sfx. The parameter are taken from the parameters:
  *  \param file File name of the buffer.
@@ -55,6 +69,9 @@ SFXBuffer::SFXBuffer(const std::string& file,
     m_loaded      = false;
     m_max_dist    = max_dist;
     m_duration    = -1.0f;
+    m_decoded     = false;
+    m_channels    = 0;
+    m_rate        = 0;
     m_file        = file;
 
     m_rolloff     = rolloff;
@@ -75,6 +92,9 @@ SFXBuffer::SFXBuffer(const std::string& file,
     m_rolloff     = 0.1f;
     m_max_dist    = 300.0f;
     m_duration    = -1.0f;
+    m_decoded     = false;
+    m_channels    = 0;
+    m_rate        = 0;
     m_positional  = false;
     m_loaded      = false;
     m_file        = file;
@@ -99,6 +119,14 @@ bool SFXBuffer::load()
 #if HAVE_OGGVORBIS
     if (m_loaded) return false;
 
+    // The data might already have been decoded by SFXManager::loadSfx()
+    if (!decode())
+    {
+        logerror("SFXBuffer", "Could not load sound effect %s",
+                   m_file.c_str());
+        return false;
+    }
+
     alGetError(); // clear errors from previously
 
     alGenBuffers(1, &m_buffer);
@@ -109,13 +137,24 @@ bool SFXBuffer::load()
 
     assert( alIsBuffer(m_buffer) );
 
-    if (!loadVorbisBuffer(m_file, m_buffer))
+    alBufferData(m_buffer, m_channels == 1 ? AL_FORMAT_MONO16
+                                           : AL_FORMAT_STEREO16,
+                 m_pcm.data(), (ALsizei)m_pcm.size(), m_rate);
+    if (!SFXManager::checkError("loading a buffer"))
     {
-        logerror("SFXBuffer", "Could not load sound effect %s",
-                   m_file.c_str());
-        // TODO: free al buffer here?
+        alDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
         return false;
     }
+
+    // Allow the xml data to overwrite the duration, but if there is no
+    // duration (which is the norm), compute it (the data is 16 bit):
+    if (m_duration < 0)
+        m_duration = float(m_pcm.size()) / (m_rate*m_channels*2);
+
+    // OpenAL has its own copy of the data now
+    std::vector<char>().swap(m_pcm);
+    m_decoded = false;
 #endif
 
     m_loaded = true;
@@ -141,91 +180,187 @@ void SFXBuffer::unload()
 }   // unload
 
 //----------------------------------------------------------------------------
-/** Load a vorbis file into an OpenAL buffer
- *  based on a routine by Peter Mulholland, used with permission (quote :
- *  "Feel free to use")
+/** Decodes the vorbis file of this buffer into 16 bit PCM data, which is
+ *  then uploaded to OpenAL by load(). Short sfx are stored decoded in the
+ *  sfx cache directory, using a hash of the vorbis file as name, so that
+ *  they only need to be decoded once. This function does not use OpenAL, so
+ *  it can be called for several buffers in parallel.
+ *  Decoding is based on a routine by Peter Mulholland, used with
+ *  permission (quote : "Feel free to use")
+ *  \return Whether decoding was successful.
  */
-bool SFXBuffer::loadVorbisBuffer(const std::string &name, ALuint buffer)
+bool SFXBuffer::decode()
 {
 #if HAVE_OGGVORBIS
-    const int ogg_endianness = (IS_LITTLE_ENDIAN ? 0 : 1);
-
-
-    bool success = false;
-    FILE *file;
-    vorbis_info *info;
-    OggVorbis_File oggFile;
+    if (m_decoded) return true;
 
-    if (alIsBuffer(buffer) == AL_FALSE)
+    // Open the file through irrlicht, so that sfx in addon archives work
+    io::IFileSystem *fs = file_manager->getFileSystem();
+    io::IReadFile *file = fs->createAndOpenFile(m_file.c_str());
+    if (!file)
     {
-        logerror("SFXBuffer", "Error, bad OpenAL buffer");
+        logerror("SFXBuffer", "decode() - couldn't open file '%s'!",
+                 m_file.c_str());
         return false;
     }
-
-    file = fopen(name.c_str(), "rb");
-
-    if(!file)
+    const s32 size = (s32)file->getSize();
+    char *data = new char[size];
+    const s32 read = file->read(data, size);
+    file->drop();
+    if (read != size)
     {
-        logerror("SFXBuffer", "LoadVorbisBuffer() - couldn't open file!");
+        delete [] data;
+        logerror("SFXBuffer", "decode() - couldn't read file '%s'!",
+                 m_file.c_str());
         return false;
     }
 
-    if (ov_open_callbacks(file, &oggFile, NULL, 0,  OV_CALLBACKS_NOCLOSE) != 0)
+    std::string cache_name;
+    uint64_t hash = 0;
+    if (UserConfigParams::m_cache_sfx &&
+        !file_manager->getCachedSFXDir().empty())
     {
-        fclose(file);
-        logerror("SFXBuffer", "LoadVorbisBuffer() - ov_open_callbacks() failed, file isn't vorbis?");
-        return false;
+        // Use a hash of the content, so that a modified sfx (or the same
+        // sfx in different places) is handled correctly.
+        hash = Hash::fnv1a(data, size);
+        std::ostringstream oss;
+        oss << file_manager->getCachedSFXDir() << std::hex << hash << ".pcm";
+        cache_name = oss.str();
+        if (readCachedPCM(cache_name, hash))
+        {
+            delete [] data;
+            m_decoded = true;
+            return true;
+        }
     }
 
-    info = ov_info(&oggFile, -1);
-
-    // always 16 bit data
-    long len = (long)ov_pcm_total(&oggFile, -1) * info->channels * 2;
-
-    char *data = (char *) malloc(len);
-    if(!data)
+    // The memory file takes ownership of the data
+    io::IReadFile *memory_file =
+        fs->createMemoryReadFile(data, size, m_file.c_str(),
+                                 /*deleteMemoryWhenDropped*/true);
+    OggVorbis_File ogg_file;
+    int result = openVorbisReadFile(memory_file, &ogg_file);
+    if (result != 0)
     {
-        ov_clear(&oggFile);
-        logerror("SFXBuffer", "[SFXBuffer] Could not allocate decode buffer.");
+        logerror("SFXBuffer", "decode() - ov_open_callbacks() failed, "
+                 "file '%s' isn't vorbis?", m_file.c_str());
         return false;
     }
 
+    const int ogg_endianness = (IS_LITTLE_ENDIAN ? 0 : 1);
+    vorbis_info *info = ov_info(&ogg_file, -1);
+    m_channels = info->channels;
+    m_rate     = (int)info->rate;
+
+    // always 16 bit data
+    long len = (long)ov_pcm_total(&ogg_file, -1) * info->channels * 2;
+    m_pcm.resize(len);
+
     int bs = -1;
     long todo = len;
-    char *bufpt = data;
-
-    while (todo)
+    char *bufpt = m_pcm.data();
+    while (todo > 0)
     {
-        int read = ov_read(&oggFile, bufpt, todo, ogg_endianness, 2, 1, &bs);
-        todo -= read;
-        bufpt += read;
+        long n = ov_read(&ogg_file, bufpt, (int)todo, ogg_endianness, 2, 1,
+                         &bs);
+        if (n <= 0) break;
+        todo  -= n;
+        bufpt += n;
     }
+    m_pcm.resize(len - todo);
+    ov_clear(&ogg_file);
+
+    if (!cache_name.empty() && m_pcm.size() <= MAX_CACHED_PCM_SIZE)
+        writeCachedPCM(cache_name, hash);
 
-    alBufferData(buffer, (info->channels == 1) ? AL_FORMAT_MONO16
-                 : AL_FORMAT_STEREO16,
-                 data, len, info->rate);
-    success = true;
+    m_decoded = true;
+    return true;
+#else
+    return false;
+#endif
+}   // decode
 
-    free(data);
+//----------------------------------------------------------------------------
+/** The header of a cached decoded sfx. */
+struct CachedPCMHeader
+{
+    char     m_magic[8];
+    uint64_t m_hash;
+    uint32_t m_channels;
+    uint32_t m_rate;
+    uint32_t m_size;
+};   // CachedPCMHeader
 
-    ov_clear(&oggFile);
+static const char CACHED_PCM_MAGIC[8] = "STKPCM1";
+
+//----------------------------------------------------------------------------
+/** Reads the decoded data of this sfx from the cache.
+ *  \param name Name of the cache file.
+ *  \param hash Hash of the vorbis file, to detect hash collisions.
+ *  \return True if the data was read.
+ */
+bool SFXBuffer::readCachedPCM(const std::string &name, uint64_t hash)
+{
+    FILE *file = fopen(name.c_str(), "rb");
+    if (!file) return false;
+
+    CachedPCMHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1      &&
+              memcmp(header.m_magic, CACHED_PCM_MAGIC, 8) == 0  &&
+              header.m_hash == hash                             &&
+              (header.m_channels == 1 || header.m_channels == 2) &&
+              header.m_rate > 0                                 &&
+              header.m_size <= MAX_CACHED_PCM_SIZE;
+    if (ok)
+    {
+        m_pcm.resize(header.m_size);
+        ok = header.m_size == 0 ||
+             fread(m_pcm.data(), header.m_size, 1, file) == 1;
+    }
     fclose(file);
+    if (!ok)
+    {
+        m_pcm.clear();
+        logwarn("SFXBuffer", "Ignoring invalid cached sfx '%s'.",
+                name.c_str());
+        return false;
+    }
+    m_channels = header.m_channels;
+    m_rate     = header.m_rate;
+    return true;
+}   // readCachedPCM
 
-    // Allow the xml data to overwrite the duration, but if there is no
-    // duration (which is the norm), compute it:
-    if(m_duration < 0)
+//----------------------------------------------------------------------------
+/** Writes the decoded data of this sfx to the cache. The data is written to
+ *  a temporary file first, so that an incomplete cache file is never used.
+ *  \param name Name of the cache file.
+ *  \param hash Hash of the vorbis file.
+ */
+void SFXBuffer::writeCachedPCM(const std::string &name, uint64_t hash) const
+{
+    CachedPCMHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, CACHED_PCM_MAGIC, 8);
+    header.m_hash     = hash;
+    header.m_channels = m_channels;
+    header.m_rate     = m_rate;
+    header.m_size     = (uint32_t)m_pcm.size();
+
+    const std::string tmp_name = name + ".tmp";
+    FILE *file = fopen(tmp_name.c_str(), "wb");
+    if (!file)
     {
-        ALint buffer_size, frequency, bits_per_sample, channels;
-        alGetBufferi(buffer, AL_SIZE,      &buffer_size    );
-        alGetBufferi(buffer, AL_FREQUENCY, &frequency      );
-        alGetBufferi(buffer, AL_CHANNELS,  &channels       );
-        alGetBufferi(buffer, AL_BITS,      &bits_per_sample);
-        m_duration = float(buffer_size) 
-                   / (frequency*channels*(bits_per_sample / 8));
+        logwarn("SFXBuffer", "Can not write cached sfx '%s'.", name.c_str());
+        return;
     }
-    return success;
-#else
-    return false;
-#endif
-}   // loadVorbisBuffer
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (m_pcm.empty() ||
+               fwrite(m_pcm.data(), m_pcm.size(), 1, file) == 1);
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp_name.c_str(), name.c_str()) != 0)
+    {
+        remove(tmp_name.c_str());
+        logwarn("SFXBuffer", "Can not write cached sfx '%s'.", name.c_str());
+    }
+}   // writeCachedPCM
 
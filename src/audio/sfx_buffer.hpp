@@ -32,8 +32,10 @@ typedef unsigned int ALuint;
 #include "utils/no_copy.hpp"
 #include "utils/vec3.hpp"
 #include "utils/leak_check.hpp"
+#include "utils/types.hpp"
 
 #include <string>
+#include <vector>
 
 class SFXBase;
 class XMLNode;
@@ -72,7 +74,20 @@ private:
     /** Duration of the sfx. */
     float    m_duration;
 
-    bool loadVorbisBuffer(const std::string &name, ALuint buffer);
+    /** Decoded 16 bit PCM data, only kept between decode() and load(). */
+    std::vector<char> m_pcm;
+
+    /** True if m_pcm contains the decoded data. */
+    bool     m_decoded;
+
+    /** Number of channels of the decoded data. */
+    int      m_channels;
+
+    /** Sample rate of the decoded data. */
+    int      m_rate;
+
+    bool readCachedPCM(const std::string &name, uint64_t hash);
+    void writeCachedPCM(const std::string &name, uint64_t hash) const;
 
 public:
 
@@ -89,6 +104,7 @@ public:
     }   // ~SFXBuffer
 
 
+    bool decode();
     bool load();
     void unload();
 
@@ -24,6 +24,7 @@
 #include "io/file_manager.hpp"
 #include "modes/world.hpp"
 #include "race/race_manager.hpp"
+#include "utils/job_system.hpp"
 #include "utils/vs.hpp"
 
 #include <pthread.h>
@@ -48,6 +49,16 @@
 
 SFXManager *SFXManager::m_sfx_manager;
 
+/** How often (in seconds) the real voices are assigned to the most
+ *  audible sfx. */
+static const double VOICE_UPDATE_INTERVAL = 0.05;
+
+/** Sfx that are less audible than this are always virtual. */
+static const float MIN_AUDIBILITY = 0.001f;
+
+/** The weight of each priority class when ranking the sfx. */
+static const float PRIORITY_WEIGHT[] = { 0.25f, 1.0f, 4.0f };
+
 // ----------------------------------------------------------------------------
 /** Static function to create the singleton sfx manager.
  */
@@ -77,6 +88,9 @@ SFXManager::SFXManager()
     m_initialized = music_manager->initialized();
     m_master_gain = UserConfigParams::m_sfx_volume;
     m_last_update_time = -1.0f;
+    m_last_voice_update = -1.0;
+    m_num_sources      = 0;
+    m_max_voices       = std::max(1, (int)UserConfigParams::m_max_sfx_voices);
     // Init position, since it can be used before positionListener is called.
     // No need to use lock here, since the thread will be created later.
     m_listener_position.getData() = Vec3(0, 0, 0);
@@ -149,6 +163,24 @@ SFXManager::~SFXManager()
     m_quick_sounds.getData().clear();
     m_quick_sounds.unlock();
 
+    // ---- free the OpenAL sources, which were all released by the sfx
+#if HAVE_OGGVORBIS
+    m_free_sources.lock();
+    if (!m_free_sources.getData().empty())
+    {
+        alDeleteSources((ALsizei)m_free_sources.getData().size(),
+                        m_free_sources.getData().data());
+    }
+    m_free_sources.getData().clear();
+    m_free_sources.unlock();
+#endif
+
+    VoiceStatistics stats = getVoiceStatistics();
+    loginfo("SFXManager", "Voices: at most %u sfx playing, %u real voices, "
+            "%lu times realised, %lu times virtualised.", stats.m_max_playing,
+            m_num_sources, (unsigned long)stats.m_num_realised,
+            (unsigned long)stats.m_num_virtualised);
+
     // ---- clear m_all_sfx_types
     {
         std::map<std::string, SFXBuffer*>::iterator i = m_all_sfx_types.begin();
@@ -502,25 +534,26 @@ void SFXManager::loadSfx()
 
     delete root;
 
-    // Now load them in parallel
-    const int max = m_all_sfx_types.size();
-    SFXBuffer **array = new SFXBuffer *[max];
-    i = 0;
-
+    // Now decode them in parallel (which is not done if sfx are disabled,
+    // see SFXBuffer::load), then upload them to OpenAL in this thread.
+    std::vector<SFXBuffer*> buffers;
     for (std::map<std::string, SFXBuffer*>::iterator it = m_all_sfx_types.begin();
          it != m_all_sfx_types.end(); it++)
     {
-        SFXBuffer* const buffer = (*it).second;
-        array[i++] = buffer;
+        buffers.push_back(it->second);
     }
 
-    #pragma omp parallel for private(i)
-    for (i = 0; i < max; i++)
+    if (UserConfigParams::m_sfx && JobSystem::isCreated())
     {
-        array[i]->load();
+        JobSystem::get()->parallelFor((int)buffers.size(),
+                                      [&buffers](int n)
+                                      {
+                                          buffers[n]->decode();
+                                      });
     }
 
-    delete [] array;
+    for (unsigned int n = 0; n < buffers.size(); n++)
+        buffers[n]->load();
 }   // loadSfx
 
 // -----------------------------------------------------------------------------
@@ -632,6 +665,10 @@ SFXBase* SFXManager::createSoundSource(SFXBuffer* buffer,
 #endif
 
     sfx->setMasterVolume(m_master_gain);
+    // Non-positional sfx are menu and HUD sounds, or all sounds in split
+    // screen, which should not be dropped in favour of distant karts.
+    if (!positional)
+        sfx->setPriority(SFXBase::SFX_PRIORITY_HIGH);
 
     if (add_to_SFX_list) 
     {
@@ -741,8 +778,193 @@ void SFXManager::reallyUpdateNow(SFXCommand *current)
     }   // for i in m_all_sfx
     m_quick_sounds.unlock();
 
+    if (m_last_update_time - m_last_voice_update >= VOICE_UPDATE_INTERVAL)
+    {
+        m_last_voice_update = m_last_update_time;
+        updateVoices();
+    }
 }   // reallyUpdateNow
 
+//----------------------------------------------------------------------------
+/** Assigns the real voices to the most audible of all playing sfx
+ *  (including quick sounds). Executed in the sfx thread.
+ */
+void SFXManager::updateVoices()
+{
+    if (!sfxAllowed()) return;
+
+    std::vector<SFXBase*> all_sfx;
+    m_all_sfx.lock();
+    all_sfx = m_all_sfx.getData();
+    m_quick_sounds.lock();
+    std::map<std::string, SFXBase*>::iterator i;
+    for (i = m_quick_sounds.getData().begin();
+         i != m_quick_sounds.getData().end(); i++)
+        all_sfx.push_back(i->second);
+    m_quick_sounds.unlock();
+
+    m_listener_position.lock();
+    Vec3 listener = m_listener_position.getData();
+    m_listener_position.unlock();
+
+    // Keep m_all_sfx locked, so that no sfx is deleted while its voice
+    // is changed.
+    m_voice_statistics.lock();
+    assignVoices(all_sfx, listener, m_max_voices,
+                 &m_voice_statistics.getData());
+    m_voice_statistics.unlock();
+    m_all_sfx.unlock();
+}   // updateVoices
+
+//----------------------------------------------------------------------------
+/** Computes how loud a sfx is at the listener, using the same distance
+ *  model as OpenAL (inverse distance clamped with a reference distance of 1).
+ *  \param gain Gain of the sfx.
+ *  \param positional If the sfx is positional, otherwise distance, rolloff
+ *         and maximum distance are ignored.
+ *  \param distance Distance between sfx and listener.
+ *  \param rolloff Rolloff factor of the sfx.
+ *  \param max_dist Maximum distance at which the sfx can be heard.
+ */
+float SFXManager::computeAudibility(float gain, bool positional,
+                                   float distance, float rolloff,
+                                   float max_dist)
+{
+    if (!positional) return gain;
+    // STK mutes positional sfx that are too far away
+    if (distance > max_dist) return 0.0f;
+    if (distance < 1.0f) distance = 1.0f;
+    return gain / (1.0f + rolloff*(distance - 1.0f));
+}   // computeAudibility
+
+//----------------------------------------------------------------------------
+/** Decides which of the playing sfx are actually mixed: the sfx are ranked
+ *  by their audibility weighted with their priority class, and the first
+ *  max_voices of them get a real voice, all others become virtual. Sfx that
+ *  can not be heard are always virtual. Sfx that already have a real voice
+ *  win ties, to avoid switching voices back and forth.
+ *  \param all_sfx All sfx to consider, sfx that are not playing are ignored.
+ *  \param listener Position of the listener.
+ *  \param max_voices Maximum number of real voices.
+ *  \param statistics The statistics to update.
+ */
+void SFXManager::assignVoices(const std::vector<SFXBase*> &all_sfx,
+                              const Vec3 &listener, unsigned int max_voices,
+                              VoiceStatistics *statistics)
+{
+    std::vector<std::pair<float, SFXBase*> > playing;
+    for (unsigned int i = 0; i < all_sfx.size(); i++)
+    {
+        SFXBase *sfx = all_sfx[i];
+        if (sfx->getStatus() != SFXBase::SFX_PLAYING) continue;
+        float audibility = sfx->getAudibility(listener);
+        if (audibility < MIN_AUDIBILITY)
+            audibility = 0.0f;
+        else
+            audibility *= PRIORITY_WEIGHT[sfx->getPriority()];
+        playing.push_back(std::make_pair(audibility, sfx));
+    }
+
+    std::sort(playing.begin(), playing.end(),
+              [](const std::pair<float, SFXBase*> &a,
+                 const std::pair<float, SFXBase*> &b)
+              {
+                  if (a.first != b.first) return a.first > b.first;
+                  return !a.second->isVirtual() && b.second->isVirtual();
+              });
+
+    // First make sfx virtual, so that their voices can be used by others
+    unsigned int num_real = 0;
+    for (unsigned int i = 0; i < playing.size(); i++)
+    {
+        SFXBase *sfx = playing[i].second;
+        if ((i >= max_voices || playing[i].first == 0) && !sfx->isVirtual())
+        {
+            sfx->reallyMakeVirtualNow();
+            statistics->m_num_virtualised++;
+        }
+    }
+    for (unsigned int i = 0; i < playing.size(); i++)
+    {
+        SFXBase *sfx = playing[i].second;
+        if (i >= max_voices || playing[i].first == 0) break;
+        if (sfx->isVirtual())
+        {
+            // This can fail if the audio backend runs out of voices
+            if (!sfx->reallyMakeRealNow()) continue;
+            statistics->m_num_realised++;
+        }
+        num_real++;
+    }
+
+    statistics->m_num_real    = num_real;
+    statistics->m_num_virtual = (unsigned int)playing.size() - num_real;
+    statistics->m_max_playing = std::max(statistics->m_max_playing,
+                                         (unsigned int)playing.size());
+}   // assignVoices
+
+//----------------------------------------------------------------------------
+/** Returns an OpenAL source for a sfx that gets a real voice, or 0 if all
+ *  voices are in use. At most m_max_voices sources are created.
+ */
+ALuint SFXManager::acquireSource()
+{
+    ALuint source = 0;
+#if HAVE_OGGVORBIS
+    m_free_sources.lock();
+    if (!m_free_sources.getData().empty())
+    {
+        source = m_free_sources.getData().back();
+        m_free_sources.getData().pop_back();
+    }
+    else if (m_num_sources < m_max_voices)
+    {
+        alGenSources(1, &source);
+        if (checkError("generating a source"))
+            m_num_sources++;
+        else
+        {
+            // The OpenAL implementation can not mix more sources, so
+            // don't try to create more.
+            source = 0;
+            m_max_voices = m_num_sources;
+            logwarn("SFXManager", "Limiting number of voices to %u.",
+                    m_max_voices);
+        }
+    }
+    m_free_sources.unlock();
+#endif
+    return source;
+}   // acquireSource
+
+//----------------------------------------------------------------------------
+/** Stops an OpenAL source that is not used anymore, and makes it available
+ *  for other sfx.
+ *  \param source The source to release.
+ */
+void SFXManager::releaseSource(ALuint source)
+{
+#if HAVE_OGGVORBIS
+    alSourceStop(source);
+    alSourcei(source, AL_BUFFER, 0);
+    checkError("releasing a source");
+    m_free_sources.lock();
+    m_free_sources.getData().push_back(source);
+    m_free_sources.unlock();
+#endif
+}   // releaseSource
+
+//----------------------------------------------------------------------------
+/** Returns the current voice statistics.
+ */
+SFXManager::VoiceStatistics SFXManager::getVoiceStatistics()
+{
+    m_voice_statistics.lock();
+    VoiceStatistics statistics = m_voice_statistics.getData();
+    m_voice_statistics.unlock();
+    return statistics;
+}   // getVoiceStatistics
+
 //----------------------------------------------------------------------------
 /** Delete a sound effect object, and removes it from the internal list of
  *  all SFXs. This call deletes the object, and removes it from the list of
@@ -985,3 +1207,77 @@ SFXBase* SFXManager::quickSound(const std::string &sound_type)
 
 }   // quickSound
 
+
+//-----------------------------------------------------------------------------
+/** Tests the assignment of real and virtual voices using the dummy sfx
+ *  backend, which does not need an audio device.
+ */
+void SFXManager::unitTesting()
+{
+    SFXBuffer buffer("unit-test.ogg", /*positional*/true, /*rolloff*/0.1f,
+                     /*max_dist*/100.0f, /*gain*/1.0f);
+    std::vector<SFXBase*> all_sfx;
+    for (int i = 1; i <= 6; i++)
+    {
+        DummySFX *sfx = new DummySFX(&buffer, /*positional*/true, 1.0f);
+        sfx->setLoop(true);
+        // The last sfx is too far away to be heard
+        sfx->play(Vec3(i < 6 ? 10.0f*i : 200.0f, 0, 0));
+        all_sfx.push_back(sfx);
+    }
+    // A sfx that is not playing must be ignored
+    all_sfx.push_back(new DummySFX(&buffer, true, 1.0f));
+
+    VoiceStatistics stats = VoiceStatistics();
+    assignVoices(all_sfx, Vec3(0, 0, 0), 3, &stats);
+    assert(stats.m_num_real == 3 && stats.m_num_virtual == 3);
+    assert(stats.m_num_realised == 3 && stats.m_num_virtualised == 0);
+    for (unsigned int i = 0; i < 6; i++)
+        assert(all_sfx[i]->isVirtual() == (i >= 3));
+    assert(!all_sfx[6]->isVirtual());
+
+    // Virtual voices keep on advancing their play time
+    all_sfx[4]->updatePlayingSFX(0.5f);
+    assert(all_sfx[4]->getPlayTime() == 0.5f);
+    assert(all_sfx[4]->getStatus() == SFXBase::SFX_PLAYING);
+
+    // A high priority sfx takes the voice of the least audible real sfx
+    all_sfx[4]->setPriority(SFXBase::SFX_PRIORITY_HIGH);
+    assignVoices(all_sfx, Vec3(0, 0, 0), 3, &stats);
+    assert(!all_sfx[0]->isVirtual() && !all_sfx[1]->isVirtual());
+    assert(all_sfx[2]->isVirtual() && !all_sfx[4]->isVirtual());
+    assert(stats.m_num_realised == 4 && stats.m_num_virtualised == 1);
+    assert(all_sfx[4]->getPlayTime() == 0.5f);
+
+    // Moving the listener: only the sfx close to it can be heard
+    assignVoices(all_sfx, Vec3(200.0f, 0, 0), 3, &stats);
+    assert(stats.m_num_real == 1 && stats.m_num_virtual == 5);
+    for (unsigned int i = 0; i < 6; i++)
+        assert(all_sfx[i]->isVirtual() == (i != 5));
+
+    // Stopped and paused sfx don't use a voice
+    all_sfx[5]->stop();
+    all_sfx[0]->pause();
+    assignVoices(all_sfx, Vec3(0, 0, 0), 3, &stats);
+    assert(stats.m_num_real == 3 && stats.m_num_virtual == 1);
+    assert(stats.m_max_playing == 6);
+
+    // Sfx that already have a voice win ties
+    all_sfx[4]->setPriority(SFXBase::SFX_PRIORITY_NORMAL);
+    assignVoices(all_sfx, Vec3(25.0f, 0, 0), 1, &stats);
+    SFXBase *real = all_sfx[1]->isVirtual() ? all_sfx[2] : all_sfx[1];
+    for (int i = 0; i < 10; i++)
+    {
+        assignVoices(all_sfx, Vec3(25.0f, 0, 0), 1, &stats);
+        assert(!real->isVirtual());
+    }
+    (void)real;   // avoid compiler warning with NDEBUG
+
+    // Non-positional sfx ignore the distance to the listener
+    DummySFX non_positional(&buffer, /*positional*/false, 1.0f);
+    non_positional.play(Vec3(1000.0f, 0, 0));
+    assert(non_positional.getAudibility(Vec3(0, 0, 0)) == 1.0f);
+
+    for (unsigned int i = 0; i < all_sfx.size(); i++)
+        delete all_sfx[i];
+}   // unitTesting
@@ -23,6 +23,7 @@
 #include "utils/leak_check.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/synchronised.hpp"
+#include "utils/types.hpp"
 #include "utils/vec3.hpp"
 
 #include <map>
@@ -110,6 +111,21 @@ public:
         NUM_CUSTOMS
     };
 
+    /** Statistics about real and virtual voices. */
+    struct VoiceStatistics
+    {
+        /** Number of playing sfx with a real voice. */
+        unsigned int m_num_real;
+        /** Number of playing sfx that are virtual. */
+        unsigned int m_num_virtual;
+        /** Highest number of sfx that were playing at the same time. */
+        unsigned int m_max_playing;
+        /** How often a virtual sfx got a real voice. */
+        uint64_t     m_num_realised;
+        /** How often a real sfx was made virtual. */
+        uint64_t     m_num_virtualised;
+    };   // VoiceStatistics
+
 private:
 
     /** Data structure for the queue, which stores a sfx and the command to 
@@ -220,6 +236,22 @@ private:
     /** A conditional variable to wake up the main loop. */
     pthread_cond_t            m_cond_request;
 
+    /** OpenAL sources not used by any sfx. Its lock is also used to
+     *  protect m_num_sources. */
+    Synchronised<std::vector<ALuint> > m_free_sources;
+
+    /** Number of OpenAL sources created, which is at most m_max_voices. */
+    unsigned int              m_num_sources;
+
+    /** Maximum number of sfx that are actually mixed at the same time. */
+    unsigned int              m_max_voices;
+
+    /** Time at which the voices were last assigned. */
+    double                    m_last_voice_update;
+
+    /** Statistics about the real and virtual voices. */
+    Synchronised<VoiceStatistics> m_voice_statistics;
+
     void                      loadSfx();
                              SFXManager();
     virtual                 ~SFXManager();
@@ -228,10 +260,18 @@ private:
     void deleteSFX(SFXBase *sfx);
     void queueCommand(SFXCommand *command);
     void reallyPositionListenerNow();
+    void updateVoices();
 
 public:
     static void create();
     static void destroy();
+    static void unitTesting();
+    static float computeAudibility(float gain, bool positional,
+                                   float distance, float rolloff,
+                                   float max_dist);
+    static void  assignVoices(const std::vector<SFXBase*> &all_sfx,
+                              const Vec3 &listener, unsigned int max_voices,
+                              VoiceStatistics *statistics);
     void queue(SFXCommands command,  SFXBase *sfx=NULL);
     void queue(SFXCommands command,  SFXBase *sfx, float f);
     void queue(SFXCommands command,  SFXBase *sfx, const Vec3 &p);
@@ -277,6 +317,10 @@ public:
     void                     setMasterSFXVolume(float gain);
     float                    getMasterSFXVolume() const { return m_master_gain; }
 
+    ALuint                   acquireSource();
+    void                     releaseSource(ALuint source);
+    VoiceStatistics          getVoiceStatistics();
+
     static bool              checkError(const std::string &context);
     static const std::string getErrorString(int err);
 
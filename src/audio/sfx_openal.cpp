@@ -52,6 +52,8 @@ SFXOpenAL::SFXOpenAL(SFXBuffer* buffer, bool positional, float volume,
     m_master_gain  = 1.0f;
     m_owns_buffer  = owns_buffer;
     m_play_time    = 0.0f;
+    m_pitch        = 1.0f;
+    m_rolloff      = buffer->getRolloff();
 
     // Don't initialise anything else if the sfx manager was not correctly
     // initialised. First of all the initialisation will not work, and it
@@ -67,10 +69,8 @@ SFXOpenAL::SFXOpenAL(SFXBuffer* buffer, bool positional, float volume,
  *  buffer. */
 SFXOpenAL::~SFXOpenAL()
 {
-    if (m_status!=SFX_UNKNOWN && m_status!=SFX_NOT_INITIALISED)
-    {
-        alDeleteSources(1, &m_sound_source);
-    }
+    if (m_sound_source)
+        SFXManager::get()->releaseSource(m_sound_source);
 
     if (m_owns_buffer && m_sound_buffer)
     {
@@ -80,51 +80,124 @@ SFXOpenAL::~SFXOpenAL()
 }   // ~SFXOpenAL
 
 //-----------------------------------------------------------------------------
-/** Initialises the sfx. 
+/** Initialises the sfx. The OpenAL source is only attached once the sfx
+ *  is playing and gets a real voice, see reallyMakeRealNow().
  */
 bool SFXOpenAL::init()
 {
     m_status = SFX_UNKNOWN;
 
-    alGenSources(1, &m_sound_source );
-    if (!SFXManager::checkError("generating a source"))
-        return false;
-
     assert( alIsBuffer(m_sound_buffer->getBufferID()) );
-    assert( alIsSource(m_sound_source) );
 
-    alSourcei (m_sound_source, AL_BUFFER, m_sound_buffer->getBufferID());
+    m_status = SFX_STOPPED;
+    return true;
+}   // init
 
-    if (!SFXManager::checkError("attaching the buffer to the source"))
-        return false;
+// ------------------------------------------------------------------------
+/** Returns the gain of this sfx (without the master gain). */
+float SFXOpenAL::getGain() const
+{
+    return m_gain < 0.0f ? m_default_gain : m_gain;
+}   // getGain
+
+// ------------------------------------------------------------------------
+/** Sets the gain of the OpenAL source. Positional sfx that are too far away
+ *  from the listener are muted.
+ */
+void SFXOpenAL::updateSourceGain()
+{
+    if (m_positional &&
+        SFXManager::get()->getListenerPos().distance(m_position)
+                                          > m_sound_buffer->getMaxDist())
+    {
+        alSourcef(m_sound_source, AL_GAIN, 0);
+    }
+    else
+    {
+        alSourcef(m_sound_source, AL_GAIN, getGain() * m_master_gain);
+    }
+}   // updateSourceGain
 
-    alSource3f(m_sound_source, AL_POSITION,       0.0, 0.0, 0.0);
+// ------------------------------------------------------------------------
+/** Copies all settings of this sfx to its (newly acquired) OpenAL source.
+ */
+void SFXOpenAL::setupSource()
+{
+    alSourcei (m_sound_source, AL_BUFFER, m_sound_buffer->getBufferID());
     alSource3f(m_sound_source, AL_VELOCITY,       0.0, 0.0, 0.0);
     alSource3f(m_sound_source, AL_DIRECTION,      0.0, 0.0, 0.0);
-
-    alSourcef (m_sound_source, AL_ROLLOFF_FACTOR, m_sound_buffer->getRolloff());
+    alSourcef (m_sound_source, AL_ROLLOFF_FACTOR, m_rolloff);
     alSourcef (m_sound_source, AL_MAX_DISTANCE,   m_sound_buffer->getMaxDist());
+    alSourcef (m_sound_source, AL_PITCH,          m_pitch);
+    alSourcei (m_sound_source, AL_LOOPING, m_loop ? AL_TRUE : AL_FALSE);
 
-    if (m_gain < 0.0f)
+    if (m_positional)
     {
-        alSourcef (m_sound_source, AL_GAIN, m_default_gain * m_master_gain);
+        alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_FALSE);
+        alSource3f(m_sound_source, AL_POSITION, m_position.getX(),
+                   m_position.getY(), -m_position.getZ());
     }
     else
     {
-        alSourcef (m_sound_source, AL_GAIN, m_gain * m_master_gain);
+        alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_TRUE);
+        alSource3f(m_sound_source, AL_POSITION, 0.0, 0.0, 0.0);
     }
+    updateSourceGain();
+}   // setupSource
 
-    if (m_positional) alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_FALSE);
-    else              alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_TRUE);
+// ------------------------------------------------------------------------
+/** Gives a playing virtual sfx a real voice: an OpenAL source is acquired
+ *  from the sfx manager, and the sfx is started at its current play
+ *  position. Executed in the sfx manager thread.
+ *  \return True if the sfx has a real voice now.
+ */
+bool SFXOpenAL::reallyMakeRealNow()
+{
+    if (m_status != SFX_PLAYING) return false;
+    if (m_sound_source) return true;
 
-    alSourcei(m_sound_source, AL_LOOPING, m_loop ? AL_TRUE : AL_FALSE);
+    float offset = m_play_time;
+    const float duration = m_sound_buffer->getDuration();
+    if (duration > 0)
+    {
+        if (m_loop)
+            offset = fmodf(offset, duration);
+        else if (offset >= duration)
+            return false;   // will be stopped in the next update
+    }
 
-    if(!SFXManager::checkError("setting up the source"))
-        return false;
+    m_sound_source = SFXManager::get()->acquireSource();
+    if (!m_sound_source) return false;
 
-    m_status = SFX_STOPPED;
-    return true;
-}   // init
+    setupSource();
+    alSourcef(m_sound_source, AL_SEC_OFFSET, offset);
+    alSourcePlay(m_sound_source);
+    return SFXManager::checkError("making a sfx real");
+}   // reallyMakeRealNow
+
+// ------------------------------------------------------------------------
+/** Makes this sfx virtual: its OpenAL source is returned to the sfx manager,
+ *  but the play time keeps on being updated, so that the sfx can continue
+ *  at the right position when it gets a real voice again.
+ */
+void SFXOpenAL::reallyMakeVirtualNow()
+{
+    if (!m_sound_source) return;
+    SFXManager::get()->releaseSource(m_sound_source);
+    m_sound_source = 0;
+}   // reallyMakeVirtualNow
+
+// ------------------------------------------------------------------------
+/** Returns how loud this sfx is at the given listener position.
+ *  \param listener Position of the listener.
+ */
+float SFXOpenAL::getAudibility(const Vec3 &listener)
+{
+    return SFXManager::computeAudibility(getGain(), m_positional,
+                                         (m_position - listener).length(),
+                                         m_rolloff,
+                                         m_sound_buffer->getMaxDist());
+}   // getAudibility
 
 // ------------------------------------------------------------------------
 /** Updates the status of a playing sfx. If the sound has been played long
@@ -135,9 +208,13 @@ bool SFXOpenAL::init()
 void SFXOpenAL::updatePlayingSFX(float dt)
 {
     assert(m_status==SFX_PLAYING);
-    m_play_time += dt;
+    // Virtual sfx are not mixed, but their play position still advances
+    m_play_time += dt*m_pitch;
     if(!m_loop && m_play_time > m_sound_buffer->getDuration())
+    {
         m_status = SFX_STOPPED;
+        reallyMakeVirtualNow();
+    }
 }   // updatePlayingSFX
 
 //-----------------------------------------------------------------------------
@@ -175,6 +252,8 @@ void SFXOpenAL::reallySetSpeed(float factor)
     {
         factor = 0.5f;
     }
+    m_pitch = factor;
+    if (!m_sound_source) return;
     alSourcef(m_sound_source,AL_PITCH,factor);
     SFXManager::checkError("setting speed");
 }   // reallySetSpeed
@@ -207,7 +286,8 @@ void SFXOpenAL::reallySetVolume(float volume)
             return;
     }
 
-    alSourcef(m_sound_source, AL_GAIN, m_gain * m_master_gain);
+    if (m_sound_source)
+        alSourcef(m_sound_source, AL_GAIN, m_gain * m_master_gain);
 }   // reallySetVolume
 
 //-----------------------------------------------------------------------------
@@ -230,10 +310,9 @@ void SFXOpenAL::reallySetMasterVolumeNow(float volume)
 {
     m_master_gain = volume;
     
-    if(m_status==SFX_UNKNOWN || m_status == SFX_NOT_INITIALISED) return;
+    if(!m_sound_source) return;
 
-    alSourcef(m_sound_source, AL_GAIN, 
-               (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
+    alSourcef(m_sound_source, AL_GAIN, getGain() * m_master_gain);
     SFXManager::checkError("setting volume");
 }   // reallySetMasterVolumeNow
 
@@ -261,6 +340,8 @@ void SFXOpenAL::reallySetLoop(bool status)
             return;
     }
 
+    m_loop = status;
+    if (!m_sound_source) return;
     alSourcei(m_sound_source, AL_LOOPING, status ? AL_TRUE : AL_FALSE);
     SFXManager::checkError("looping");
 }   // reallySetLoop
@@ -283,9 +364,8 @@ void SFXOpenAL::reallyStopNow()
     {
         m_status = SFX_STOPPED;
         m_loop = false;
-        alSourcei(m_sound_source, AL_LOOPING, AL_FALSE);
-        alSourceStop(m_sound_source);
-        SFXManager::checkError("stoping");
+        // Releasing the source also stops it
+        reallyMakeVirtualNow();
     }
 }   // reallyStopNow
 
@@ -307,8 +387,9 @@ void SFXOpenAL::reallyPauseNow()
     // from pauseAll, and we have to make sure to only pause playing sfx.
     if (m_status != SFX_PLAYING || !SFXManager::get()->sfxAllowed()) return;
     m_status = SFX_PAUSED;
-    alSourcePause(m_sound_source);
-    SFXManager::checkError("pausing");
+    // A paused sfx does not need a voice, it will continue at the right
+    // position once it is resumed.
+    reallyMakeVirtualNow();
 }   // reallyPauseNow
 
 //-----------------------------------------------------------------------------
@@ -335,9 +416,10 @@ void SFXOpenAL::reallyResumeNow()
 
     if(m_status==SFX_PAUSED)
     {
-        alSourcePlay(m_sound_source);
-        SFXManager::checkError("resuming");
         m_status = SFX_PLAYING;
+        // If no voice is available the sfx stays virtual, and might get
+        // a voice in the next SFXManager::updateVoices()
+        reallyMakeRealNow();
     }
 }   // reallyResumeNow
 
@@ -376,8 +458,6 @@ void SFXOpenAL::reallyPlayNow()
         if (m_status==SFX_UNKNOWN) return;
     }
 
-    alSourcePlay(m_sound_source);
-    SFXManager::checkError("playing");
     // Esp. with terrain sounds it can (very likely) happen that the status
     // got overwritten: a sound is created and an init event is queued. Then
     // a play event is queued, and the status is immediately changed to
@@ -385,6 +465,16 @@ void SFXOpenAL::reallyPlayNow()
     // to stopped again. So for this case we have to set the status to
     // playing again.
     m_status = SFX_PLAYING;
+
+    if (m_sound_source)
+    {
+        // Restart a sfx that is already playing
+        alSourceRewind(m_sound_source);
+        alSourcePlay(m_sound_source);
+        SFXManager::checkError("playing");
+    }
+    else
+        reallyMakeRealNow();
 }   // reallyPlayNow
 
 //-----------------------------------------------------------------------------
@@ -454,19 +544,12 @@ void SFXOpenAL::reallySetPosition(const Vec3 &position)
         return;
     }
 
+    m_position = position;
+    if (!m_sound_source) return;
+
     alSource3f(m_sound_source, AL_POSITION, position.getX(),
                position.getY(), -position.getZ());
-
-    if (SFXManager::get()->getListenerPos().distance(position)
-        > m_sound_buffer->getMaxDist())
-    {
-        alSourcef(m_sound_source, AL_GAIN, 0);
-    }
-    else
-    {
-        alSourcef(m_sound_source, AL_GAIN, 
-                  (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
-    }
+    updateSourceGain();
 
     SFXManager::checkError("positioning");
 }   // reallySetPosition
@@ -511,11 +594,8 @@ void SFXOpenAL::onSoundEnabledBack()
         if (m_status==SFX_NOT_INITIALISED) init();
         if (m_status!=SFX_UNKNOWN)
         {
-            alSourcef(m_sound_source, AL_GAIN, 0);
             play();
             pause();
-            alSourcef(m_sound_source, AL_GAIN,
-                     (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
         }
     }
 }   // onSoundEnabledBack
@@ -524,7 +604,9 @@ void SFXOpenAL::onSoundEnabledBack()
 
 void SFXOpenAL::setRolloff(float rolloff)
 {
-    alSourcef (m_sound_source, AL_ROLLOFF_FACTOR,  rolloff);
+    m_rolloff = rolloff;
+    if (m_sound_source)
+        alSourcef (m_sound_source, AL_ROLLOFF_FACTOR,  rolloff);
 }
 
 #endif //if HAVE_OGGVORBIS
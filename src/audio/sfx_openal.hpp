@@ -42,7 +42,8 @@ private:
     /** Buffers hold sound data. */
     SFXBuffer*   m_sound_buffer;
 
-    /** Sources are points emitting sound. */
+    /** Sources are points emitting sound. This is 0 if the sfx does not
+     *  have a real voice, i.e. it is not playing or it is virtual. */
     ALuint       m_sound_source;
 
     /** The status of this SFX. */
@@ -75,6 +76,19 @@ private:
     /** How long the sfx has been playing. */
     float m_play_time;
 
+    /** The pitch of this sfx. */
+    float m_pitch;
+
+    /** The rolloff factor of this sfx. */
+    float m_rolloff;
+
+    /** The position of this sfx (if it is positional). */
+    Vec3 m_position;
+
+    float getGain() const;
+    void  setupSource();
+    void  updateSourceGain();
+
 public:
               SFXOpenAL(SFXBuffer* buffer, bool positional, float volume,
                         bool owns_buffer = false);
@@ -107,6 +121,18 @@ public:
     virtual void      reallySetMasterVolumeNow(float volue);
     virtual void      onSoundEnabledBack();
     virtual void      setRolloff(float rolloff);
+    virtual float     getAudibility(const Vec3 &listener);
+    virtual bool      reallyMakeRealNow();
+    virtual void      reallyMakeVirtualNow();
+    // ------------------------------------------------------------------------
+    /** Returns if this sfx is playing, but not mixed. */
+    virtual bool      isVirtual()
+    {
+        return m_status == SFX_PLAYING && m_sound_source == 0;
+    }   // isVirtual
+    // ------------------------------------------------------------------------
+    /** Returns how long this sfx has been playing. */
+    virtual float     getPlayTime() { return m_play_time; }
     // ------------------------------------------------------------------------
     /** Returns if this sfx is looped or not. */
     virtual bool      isLooped() { return m_loop; }
@@ -0,0 +1,87 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#if HAVE_OGGVORBIS
+
+#include "audio/vorbis_read_file.hpp"
+
+#include "io/file_manager.hpp"
+
+#include <IReadFile.h>
+#include <stdio.h>
+
+// ----------------------------------------------------------------------------
+static size_t readFunc(void *ptr, size_t size, size_t nmemb, void *source)
+{
+    io::IReadFile *file = (io::IReadFile*)source;
+    if (size == 0) return 0;
+    return file->read(ptr, (u32)(size*nmemb)) / size;
+}   // readFunc
+
+// ----------------------------------------------------------------------------
+static int seekFunc(void *source, ogg_int64_t offset, int whence)
+{
+    io::IReadFile *file = (io::IReadFile*)source;
+    switch (whence)
+    {
+    case SEEK_SET: return file->seek((long)offset)                     ? 0 : -1;
+    case SEEK_CUR: return file->seek((long)offset, /*relative*/true)   ? 0 : -1;
+    case SEEK_END: return file->seek(file->getSize() + (long)offset) ? 0 : -1;
+    }
+    return -1;
+}   // seekFunc
+
+// ----------------------------------------------------------------------------
+static int closeFunc(void *source)
+{
+    ((io::IReadFile*)source)->drop();
+    return 0;
+}   // closeFunc
+
+// ----------------------------------------------------------------------------
+static long tellFunc(void *source)
+{
+    return ((io::IReadFile*)source)->getPos();
+}   // tellFunc
+
+// ----------------------------------------------------------------------------
+int openVorbisReadFile(const std::string &name, OggVorbis_File *ogg_file)
+{
+    io::IReadFile *file =
+        file_manager->getFileSystem()->createAndOpenFile(name.c_str());
+    if (!file)
+        return OV_EREAD;
+    return openVorbisReadFile(file, ogg_file);
+}   // openVorbisReadFile
+
+// ----------------------------------------------------------------------------
+int openVorbisReadFile(io::IReadFile *file, OggVorbis_File *ogg_file)
+{
+    ov_callbacks callbacks;
+    callbacks.read_func  = &readFunc;
+    callbacks.seek_func  = &seekFunc;
+    callbacks.close_func = &closeFunc;
+    callbacks.tell_func  = &tellFunc;
+    int result = ov_open_callbacks(file, ogg_file, NULL, 0, callbacks);
+    // On failure the file is not closed by vorbis
+    if (result != 0)
+        file->drop();
+    return result;
+}   // openVorbisReadFile
+
+#endif
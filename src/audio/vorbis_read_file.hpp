@@ -0,0 +1,53 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_VORBIS_READ_FILE_HPP
+#define HEADER_VORBIS_READ_FILE_HPP
+
+#if HAVE_OGGVORBIS
+
+#include <vorbis/vorbisfile.h>
+
+#include <string>
+
+namespace irr
+{
+    namespace io { class IReadFile; }
+}
+
+/** Opens an ogg vorbis file through irrlicht's file system (which means
+ *  that files in mounted addon archives can be read). The file is closed
+ *  by ov_clear().
+ *  \param name Name of the file.
+ *  \param ogg_file The vorbis file structure to initialise.
+ *  \return 0 on success, otherwise the (negative) vorbis error code.
+ */
+int openVorbisReadFile(const std::string &name, OggVorbis_File *ogg_file);
+
+/** Opens an ogg vorbis stream from an irrlicht read file (e.g. a memory
+ *  file). The vorbis file takes over the reference to the read file, which
+ *  is dropped by ov_clear(), or immediately if opening fails.
+ *  \param file The file to read from.
+ *  \param ogg_file The vorbis file structure to initialise.
+ *  \return 0 on success, otherwise the (negative) vorbis error code.
+ */
+int openVorbisReadFile(irr::io::IReadFile *file, OggVorbis_File *ogg_file);
+
+#endif
+
+#endif
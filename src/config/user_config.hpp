@@ -329,6 +329,11 @@ namespace UserConfigParams
     PARAM_PREFIX FloatUserConfigParam       m_music_volume
             PARAM_DEFAULT(  FloatUserConfigParam(0.7f, "music_volume",
             &m_audio_group, "Music volume from 0.0 to 1.0") );
+    PARAM_PREFIX IntUserConfigParam         m_max_sfx_voices
+            PARAM_DEFAULT(  IntUserConfigParam(32, "max_sfx_voices",
+            &m_audio_group, "Maximum number of sound effects that are mixed "
+                            "at the same time. Less audible sound effects "
+                            "are virtualised.") );
 
     // ---- Race setup
     PARAM_PREFIX GroupUserConfigParam        m_race_setup_group
@@ -506,6 +511,10 @@ namespace UserConfigParams
     PARAM_PREFIX BoolUserConfigParam        m_texture_compression
         PARAM_DEFAULT(BoolUserConfigParam(true, "enable_texture_compression",
         &m_video_group, "Enable Texture Compression"));
+    PARAM_PREFIX BoolUserConfigParam        m_batch_2d
+        PARAM_DEFAULT(BoolUserConfigParam(true, "batch_2d",
+        &m_video_group, "Combine the quads drawn for GUI, HUD and text into "
+                        "as few draw calls as possible."));
     /** This is a bit flag: bit 0: enabled (1) or disabled(0).
      *  Bit 1: setting done by default(0), or by user choice (2). This allows
      *  to e.g. disable h.d. textures on hd3000 as default, but still allow the
@@ -557,6 +566,18 @@ namespace UserConfigParams
     /** If gamepad debugging is enabled. */
     PARAM_PREFIX bool m_unit_testing PARAM_DEFAULT(false);
 
+    /** If the font layout benchmark should be run. */
+    PARAM_PREFIX bool m_font_benchmark PARAM_DEFAULT(false);
+
+    /** URL to use for the http benchmark, empty if it should not be run. */
+    PARAM_PREFIX std::string m_http_benchmark_url PARAM_DEFAULT("");
+
+    /** If the script callback benchmark should be run. */
+    PARAM_PREFIX bool m_script_benchmark PARAM_DEFAULT(false);
+
+    /** If the raycast benchmark for driveable track objects should be run. */
+    PARAM_PREFIX bool m_raycast_benchmark PARAM_DEFAULT(false);
+
     /** If gamepad debugging is enabled. */
     PARAM_PREFIX bool m_gamepad_debug PARAM_DEFAULT( false );
 
@@ -591,6 +612,19 @@ namespace UserConfigParams
     /** True if arena (battle/soccer) ai profiling. */
     PARAM_PREFIX bool m_arena_ai_stats PARAM_DEFAULT(false);
 
+    /** True if the simulation advances in fixed ticks of 1/60 s. */
+    PARAM_PREFIX bool m_fixed_ticks PARAM_DEFAULT(false);
+
+    /** True if the history of a profile race is saved when it ends. */
+    PARAM_PREFIX bool m_save_history PARAM_DEFAULT(false);
+
+    /** Ticks per second of a server without graphics. */
+    PARAM_PREFIX int m_server_tick_rate PARAM_DEFAULT(60);
+
+    /** Point selection algorithm of the skidding AI: 0 default, 1 fixed,
+     *  2 new, 3 cached. */
+    PARAM_PREFIX int m_ai_point_selection PARAM_DEFAULT(0);
+
     /** True if slipstream debugging is activated. */
     PARAM_PREFIX bool m_slipstream_debug  PARAM_DEFAULT( false );
 
@@ -661,6 +695,11 @@ namespace UserConfigParams
             PARAM_DEFAULT( BoolUserConfigParam(false, "log-network-packets",
                                                  "If all network packets should be logged") );
 
+    PARAM_PREFIX BoolUserConfigParam m_log_packets_binary
+            PARAM_DEFAULT( BoolUserConfigParam(false, "log-network-packets-binary",
+                                                 "If network packets should be logged in a compact "
+                                                 "binary trace instead of a text file") );
+
     // ---- Graphic Quality
     PARAM_PREFIX GroupUserConfigParam        m_graphics_quality
             PARAM_DEFAULT( GroupUserConfigParam("GFX",
@@ -751,6 +790,33 @@ namespace UserConfigParams
     PARAM_PREFIX BoolUserConfigParam        m_cache_overworld
             PARAM_DEFAULT(  BoolUserConfigParam(true, "cache-overworld") );
 
+    PARAM_PREFIX BoolUserConfigParam        m_cache_xml
+            PARAM_DEFAULT(  BoolUserConfigParam(true, "cache-xml",
+                            "Keep a binary copy of all XML files that are "
+                            "read, which can be loaded faster.") );
+
+    PARAM_PREFIX BoolUserConfigParam        m_cache_sfx
+            PARAM_DEFAULT(  BoolUserConfigParam(true, "cache-sfx",
+                            "Keep decoded copies of short sound effects, "
+                            "which avoids decoding them at each start.") );
+
+    PARAM_PREFIX BoolUserConfigParam        m_cache_scripts
+            PARAM_DEFAULT(  BoolUserConfigParam(true, "cache-scripts",
+                            "Keep the compiled byte code of track scripts, "
+                            "so they do not need to be compiled again.") );
+
+    PARAM_PREFIX BoolUserConfigParam        m_cache_shaders
+            PARAM_DEFAULT(  BoolUserConfigParam(true, "cache-shaders",
+                            "Keep the linked shader programs in the format of "
+                            "the graphics driver, which avoids compiling the "
+                            "shaders at each start.") );
+
+    PARAM_PREFIX IntUserConfigParam         m_simulation_threads
+            PARAM_DEFAULT(  IntUserConfigParam(0, "simulation-threads",
+                            "Number of additional threads used to update "
+                            "the karts: 0 updates all karts in the main "
+                            "thread, -1 uses one thread per CPU core.") );
+
     // TODO : is this used with new code? does it still work?
     PARAM_PREFIX BoolUserConfigParam        m_crashed
             PARAM_DEFAULT(  BoolUserConfigParam(false, "crashed") );
@@ -831,6 +897,12 @@ namespace UserConfigParams
                                                "wasn't asked, 1: allowed, 2: "
                                                "not allowed") );
 
+    PARAM_PREFIX IntUserConfigParam        m_max_concurrent_requests
+            PARAM_DEFAULT(  IntUserConfigParam(4, "max-concurrent-requests",
+                                               "Maximum number of http "
+                                               "requests that are executed "
+                                               "at the same time.") );
+
     PARAM_PREFIX GroupUserConfigParam       m_hw_report_group
             PARAM_DEFAULT( GroupUserConfigParam("HWReport",
                                           "Everything related to hardware configuration.") );
@@ -918,6 +990,12 @@ namespace UserConfigParams
                                                 &m_addon_group,
                                         "Time addon-list was updated last.") );
 
+    PARAM_PREFIX BoolUserConfigParam        m_mount_addon_archives
+            PARAM_DEFAULT(  BoolUserConfigParam(true, "mount_addon_archives",
+                                                &m_addon_group,
+                                        "Keep downloaded addons as archives "
+                                        "instead of extracting them.") );
+
     PARAM_PREFIX StringUserConfigParam      m_language
             PARAM_DEFAULT( StringUserConfigParam("system", "language",
                         "Which language to use (language code or 'system')") );
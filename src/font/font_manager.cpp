@@ -22,8 +22,10 @@
 #include "font/bold_face.hpp"
 #include "font/digit_face.hpp"
 #include "font/face_ttf.hpp"
+#include "font/font_settings.hpp"
 #include "font/regular_face.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/translation.hpp"
 
 FontManager *font_manager = NULL;
@@ -134,3 +136,83 @@ void FontManager::unitTesting()
     }
 
 }   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Benchmark for the text layout cache: renders a typical set of race GUI
+ *  texts (player names, ranks, lap counter and a timer that changes every
+ *  frame) through the \ref FontWithFace::FontCharCollector path, once
+ *  without and once with layout cache, and prints the time per frame and
+ *  the cache hit rate. No glyph is drawn, so this can be run with
+ *  --no-graphics on a machine without GPU.
+ *  \param frames Number of frames to simulate.
+ */
+void FontManager::benchmarkLayout(int frames)
+{
+    /** A collector that only counts the characters. */
+    class CountingCollector : public FontWithFace::FontCharCollector
+    {
+    public:
+        unsigned int m_num_chars;
+        CountingCollector() : m_num_chars(0) {}
+        virtual void collectChar(video::ITexture* texture,
+                                 const core::rect<float>& destRect,
+                                 const core::rect<s32>& sourceRect,
+                                 const video::SColor* const colors)
+        {
+            m_num_chars++;
+        }
+    };   // CountingCollector
+
+    std::vector<core::stringw> texts;
+    const wchar_t *names[] = { L"Tux", L"Nolok", L"Gnu", L"Kiki", L"Pidgin",
+                               L"Sara the Racer", L"Adiumy", L"Wilber" };
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        texts.push_back(names[i]);
+        texts.push_back(StringUtils::toWString(i + 1));
+    }
+    texts.push_back(L"Lap 2/3");
+    texts.push_back(L"Rank 3/8");
+
+    RegularFace *regular = getFont<RegularFace>();
+    DigitFace   *digit   = getFont<DigitFace>();
+    FontSettings settings(/*black_border*/true, /*rtl*/false, /*scale*/1.0f);
+    const core::rect<s32> position(0, 0, 300, 40);
+    const video::SColor color(255, 255, 255, 255);
+
+    for (unsigned int pass = 0; pass < 2; pass++)
+    {
+        FontWithFace::setLayoutCacheEnabled(pass == 1);
+        uint64_t hits_before, misses_before;
+        FontWithFace::getLayoutStatistics(&hits_before, &misses_before);
+        CountingCollector collector;
+
+        const double start = StkTime::getRealTime();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            for (unsigned int i = 0; i < texts.size(); i++)
+            {
+                regular->render(texts[i], position, color, /*hcenter*/true,
+                                /*vcenter*/true, /*clip*/NULL, &settings,
+                                &collector);
+            }
+            core::stringw timer =
+                StringUtils::timeToString(frame / 60.0f).c_str();
+            digit->render(timer, position, color, /*hcenter*/false,
+                          /*vcenter*/false, /*clip*/NULL, &settings,
+                          &collector);
+        }
+        const double duration = StkTime::getRealTime() - start;
+
+        uint64_t hits, misses;
+        FontWithFace::getLayoutStatistics(&hits, &misses);
+        hits   -= hits_before;
+        misses -= misses_before;
+        loginfo("FontManager", "Layout cache %s: %.4f ms per frame, "
+                "%u characters, %d%% cache hits.",
+                pass == 1 ? "enabled" : "disabled",
+                duration * 1000.0 / frames, collector.m_num_chars,
+                hits + misses > 0 ? (int)(hits * 100 / (hits + misses)) : 0);
+    }
+    FontWithFace::setLayoutCacheEnabled(true);
+}   // benchmarkLayout
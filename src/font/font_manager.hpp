@@ -97,6 +97,8 @@ public:
     // ------------------------------------------------------------------------
     void unitTesting();
     // ------------------------------------------------------------------------
+    void benchmarkLayout(int frames);
+    // ------------------------------------------------------------------------
     /** Return the \ref m_ft_library. */
     FT_Library getFTLibrary() const                    { return m_ft_library; }
 
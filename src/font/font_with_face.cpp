@@ -28,8 +28,19 @@
 #include "graphics/stk_tex_manager.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/skin.hpp"
+#include "modes/profile_world.hpp"
 #include "utils/string_utils.hpp"
 
+unsigned int FontWithFace::m_reset_count          = 0;
+bool         FontWithFace::m_layout_cache_enabled = true;
+uint64_t     FontWithFace::m_layout_hits          = 0;
+uint64_t     FontWithFace::m_layout_misses        = 0;
+
+/** Maximum number of cached layouts per font. Texts that change every frame
+ *  (e.g. timers) would otherwise fill the cache, so it is simply cleared
+ *  when it gets too big. */
+static const unsigned int MAX_CACHED_LAYOUTS = 256;
+
 // ----------------------------------------------------------------------------
 /** Constructor. It will initialize the \ref m_spritebank and TTF files to use.
  *  \param name The name of face, used by irrlicht to distinguish spritebank.
@@ -46,6 +57,7 @@ FontWithFace::FontWithFace(const std::string& name, FaceTTF* ttf)
     m_fallback_font_scale = 1.0f;
     m_glyph_max_height = 0;
     m_face_ttf = ttf;
+    m_layout_reset_count = m_reset_count;
 
 }   // FontWithFace
 // ----------------------------------------------------------------------------
@@ -100,6 +112,9 @@ void FontWithFace::init()
  */
 void FontWithFace::reset()
 {
+    // Cached layouts of all fonts might refer to the glyph pages of this font
+    m_reset_count++;
+    m_layout_cache.clear();
     m_new_char_holder.clear();
     m_character_area_map.clear();
     m_character_glyph_info_map.clear();
@@ -206,7 +221,7 @@ void FontWithFace::insertGlyph(wchar_t c, const GlyphInfo& gi)
 
     const unsigned int cur_tex = m_spritebank->getTextureCount() -1;
 #ifndef SERVER_ONLY
-    if (bits->buffer != NULL)
+    if (bits->buffer != NULL && !ProfileWorld::isNoGraphics())
     {
         video::ITexture* tex = m_spritebank->getTexture(cur_tex);
         glBindTexture(GL_TEXTURE_2D, tex->getOpenGLTextureName());
@@ -478,6 +493,9 @@ void FontWithFace::render(const core::stringw& text,
     const float scale = font_settings ? font_settings->getScale() : 1.0f;
     const float shadow = font_settings ? font_settings->useShadow() : false;
 
+    // All glyphs (including shadow and border) are drawn in one batch
+    begin2DBatch();
+
     if (shadow)
     {
         assert(font_settings);
@@ -494,182 +512,75 @@ void FontWithFace::render(const core::stringw& text,
         font_settings->setShadow(true);
     }
 
-    core::position2d<float> offset(float(position.UpperLeftCorner.X),
+    const TextLayout &layout = getLayout(text, scale, char_collector != NULL);
+
+    // Start of the first line and of all other lines
+    core::position2d<float> first_line(float(position.UpperLeftCorner.X),
         float(position.UpperLeftCorner.Y));
-    core::dimension2d<s32> text_dimension;
+    core::position2d<float> other_lines = first_line;
 
     if (rtl || hcenter || vcenter || clip)
     {
-        text_dimension = getDimension(text.c_str(), font_settings);
+        const core::dimension2d<s32> &text_dimension = layout.m_dimension;
 
         if (hcenter)
-            offset.X += (position.getWidth() - text_dimension.Width) / 2;
+        {
+            first_line.X  += (position.getWidth() - text_dimension.Width) / 2;
+            other_lines.X += (position.getWidth() - text_dimension.Width) >> 1;
+        }
         else if (rtl)
-            offset.X += (position.getWidth() - text_dimension.Width);
+            first_line.X += (position.getWidth() - text_dimension.Width);
 
         if (vcenter)
-            offset.Y += (position.getHeight() - text_dimension.Height) / 2;
+        {
+            first_line.Y += (position.getHeight() - text_dimension.Height) / 2;
+            other_lines.Y = first_line.Y;
+        }
         if (clip)
         {
             core::rect<s32> clippedRect(core::position2d<s32>
-                (s32(offset.X), s32(offset.Y)), text_dimension);
+                (s32(first_line.X), s32(first_line.Y)), text_dimension);
             clippedRect.clipAgainst(*clip);
-            if (!clippedRect.isValid()) return;
-        }
-    }
-
-    // Collect character locations
-    const unsigned int text_size = text.size();
-    core::array<s32> indices(text_size);
-    core::array<core::position2d<float>> offsets(text_size);
-    std::vector<bool> fallback(text_size);
-
-    // Test again if lazy load char is needed,
-    // as some text isn't drawn with getDimension
-    insertCharacters(text.c_str());
-    updateCharactersList();
-
-    for (u32 i = 0; i < text_size; i++)
-    {
-        wchar_t c = text[i];
-
-        if (c == L'\r' ||          // Windows breaks
-            c == L'\n'    )        // Unix breaks
-        {
-            if (c==L'\r' && text[i+1]==L'\n')
-                c = text[++i];
-            offset.Y += m_font_max_height * scale;
-            offset.X  = float(position.UpperLeftCorner.X);
-            if (hcenter)
-                offset.X += (position.getWidth() - text_dimension.Width) >> 1;
-            continue;
-        }   // if lineBreak
-
-        bool use_fallback_font = false;
-        const FontArea &area   = getAreaFromCharacter(c, &use_fallback_font);
-        fallback[i]            = use_fallback_font;
-        if (char_collector == NULL)
-        {
-            float glyph_offset_x = area.bearing_x *
-                (fallback[i] ? m_fallback_font_scale : scale);
-            float glyph_offset_y = area.offset_y *
-                (fallback[i] ? m_fallback_font_scale : scale);
-            offset.X += glyph_offset_x;
-            offset.Y += glyph_offset_y;
-            offsets.push_back(offset);
-            offset.X -= glyph_offset_x;
-            offset.Y -= glyph_offset_y;
-        }
-        else
-        {
-            // Billboard text specific, use offset_y_bt instead
-            float glyph_offset_x = area.bearing_x *
-                (fallback[i] ? m_fallback_font_scale : scale);
-            float glyph_offset_y = area.offset_y_bt *
-                (fallback[i] ? m_fallback_font_scale : scale);
-            offset.X += glyph_offset_x;
-            offset.Y += glyph_offset_y;
-            offsets.push_back(offset);
-            offset.X -= glyph_offset_x;
-            offset.Y -= glyph_offset_y;
+            if (!clippedRect.isValid())
+            {
+                end2DBatch();
+                return;
+            }
         }
-
-        indices.push_back(area.spriteno);
-        offset.X += getCharWidth(area, fallback[i], scale);
-    }   // for i < text_size
-
-    // Do the actual rendering
-    const int indice_amount                 = indices.size();
-    core::array<gui::SGUISprite>& sprites   = m_spritebank->getSprites();
-    core::array<core::rect<s32>>& positions = m_spritebank->getPositions();
-    core::array<gui::SGUISprite>* fallback_sprites;
-    core::array<core::rect<s32>>* fallback_positions;
-    if (m_fallback_font != NULL)
-    {
-        fallback_sprites   = &m_fallback_font->m_spritebank->getSprites();
-        fallback_positions = &m_fallback_font->m_spritebank->getPositions();
     }
-    else
-    {
-        fallback_sprites   = NULL;
-        fallback_positions = NULL;
-    }
-
-    const int sprite_amount = sprites.size();
 
+    const unsigned int glyph_amount = (unsigned int)layout.m_glyphs.size();
     if ((black_border || isBold()) && char_collector == NULL)
     {
         // Draw black border first, to make it behind the real character
         // which make script language display better
         video::SColor black(color.getAlpha(),0,0,0);
-        for (int n = 0; n < indice_amount; n++)
+        for (unsigned int n = 0; n < glyph_amount; n++)
         {
-            const int sprite_id = indices[n];
-            if (!fallback[n] && (sprite_id < 0 || sprite_id >= sprite_amount))
-                continue;
-            if (indices[n] == -1) continue;
-
-            const int tex_id = (fallback[n] ?
-                (*fallback_sprites)[sprite_id].Frames[0].textureNumber :
-                sprites[sprite_id].Frames[0].textureNumber);
-
-            core::rect<s32> source = (fallback[n] ? (*fallback_positions)
-                [(*fallback_sprites)[sprite_id].Frames[0].rectNumber] :
-                positions[sprites[sprite_id].Frames[0].rectNumber]);
-
-            core::dimension2d<float> size(0.0f, 0.0f);
-
-            float cur_scale = (fallback[n] ? m_fallback_font_scale : scale);
-            size.Width  = source.getSize().Width  * cur_scale;
-            size.Height = source.getSize().Height * cur_scale;
-
-            core::rect<float> dest(offsets[n], size);
-
-            video::ITexture* texture = (fallback[n] ?
-                m_fallback_font->m_spritebank->getTexture(tex_id) :
-                m_spritebank->getTexture(tex_id));
+            const GlyphLayout &glyph = layout.m_glyphs[n];
+            const core::rect<float> dest = glyph.m_dest +
+                (glyph.m_line == 0 ? first_line : other_lines);
 
             for (int x_delta = -2; x_delta <= 2; x_delta++)
             {
                 for (int y_delta = -2; y_delta <= 2; y_delta++)
                 {
                     if (x_delta == 0 || y_delta == 0) continue;
-                    draw2DImage(texture, dest + core::position2d<float>
-                        (float(x_delta), float(y_delta)), source, clip,
-                        black, true);
+                    draw2DImage(glyph.m_texture, dest + core::position2d<float>
+                        (float(x_delta), float(y_delta)), glyph.m_source,
+                        clip, black, true);
                 }
             }
         }
     }
 
-    for (int n = 0; n < indice_amount; n++)
+    for (unsigned int n = 0; n < glyph_amount; n++)
     {
-        const int sprite_id = indices[n];
-        if (!fallback[n] && (sprite_id < 0 || sprite_id >= sprite_amount))
-            continue;
-        if (indices[n] == -1) continue;
-
-        const int tex_id = (fallback[n] ?
-            (*fallback_sprites)[sprite_id].Frames[0].textureNumber :
-            sprites[sprite_id].Frames[0].textureNumber);
+        const GlyphLayout &glyph = layout.m_glyphs[n];
+        const core::rect<float> dest = glyph.m_dest +
+            (glyph.m_line == 0 ? first_line : other_lines);
 
-        core::rect<s32> source = (fallback[n] ?
-            (*fallback_positions)[(*fallback_sprites)[sprite_id].Frames[0]
-            .rectNumber] : positions[sprites[sprite_id].Frames[0].rectNumber]);
-
-        core::dimension2d<float> size(0.0f, 0.0f);
-
-        float cur_scale = (fallback[n] ? m_fallback_font_scale : scale);
-        size.Width  = source.getSize().Width  * cur_scale;
-        size.Height = source.getSize().Height * cur_scale;
-
-        core::rect<float> dest(offsets[n], size);
-
-        video::ITexture* texture = (fallback[n] ?
-            m_fallback_font->m_spritebank->getTexture(tex_id) :
-            m_spritebank->getTexture(tex_id));
-
-        if (fallback[n] || isBold())
+        if (glyph.m_fallback || isBold())
         {
             video::SColor top = GUIEngine::getSkin()->getColor("font::top");
             video::SColor bottom = GUIEngine::getSkin()
@@ -680,12 +591,13 @@ void FontWithFace::render(const core::stringw& text,
             video::SColor title_colors[] = {top, bottom, top, bottom};
             if (char_collector != NULL)
             {
-                char_collector->collectChar(texture, dest, source,
-                    title_colors);
+                char_collector->collectChar(glyph.m_texture, dest,
+                    glyph.m_source, title_colors);
             }
             else
             {
-                draw2DImage(texture, dest, source, clip, title_colors, true);
+                draw2DImage(glyph.m_texture, dest, glyph.m_source, clip,
+                    title_colors, true);
             }
         }
         else
@@ -693,13 +605,127 @@ void FontWithFace::render(const core::stringw& text,
             if (char_collector != NULL)
             {
                 video::SColor colors[] = {color, color, color, color};
-                char_collector->collectChar(texture, dest, source, colors);
+                char_collector->collectChar(glyph.m_texture, dest,
+                    glyph.m_source, colors);
             }
             else
             {
-                draw2DImage(texture, dest, source, clip, color, true);
+                draw2DImage(glyph.m_texture, dest, glyph.m_source, clip,
+                    color, true);
             }
         }
     }
+    end2DBatch();
 #endif
 }   // render
+
+// ----------------------------------------------------------------------------
+/** Returns the layout of a text, either from the layout cache or by laying
+ *  out the text (which also lazy loads missing characters).
+ *  \param text The text.
+ *  \param scale The scaling of the text.
+ *  \param billboard True if the text is used in a billboard.
+ */
+const FontWithFace::TextLayout& FontWithFace::getLayout(
+                                  const core::stringw& text, float scale,
+                                  bool billboard)
+{
+    if (m_layout_reset_count != m_reset_count || !m_layout_cache_enabled)
+    {
+        m_layout_cache.clear();
+        m_layout_reset_count = m_reset_count;
+    }
+
+    LayoutKey key;
+    key.m_text      = text;
+    key.m_scale     = scale;
+    key.m_billboard = billboard;
+    std::map<LayoutKey, TextLayout>::const_iterator i =
+        m_layout_cache.find(key);
+    if (i != m_layout_cache.end())
+    {
+        m_layout_hits++;
+        return i->second;
+    }
+
+    m_layout_misses++;
+    if (m_layout_cache.size() >= MAX_CACHED_LAYOUTS)
+        m_layout_cache.clear();
+    TextLayout &layout = m_layout_cache[key];
+    layoutText(text, scale, billboard, &layout);
+    return layout;
+}   // getLayout
+
+// ----------------------------------------------------------------------------
+/** Determines the position of all glyphs of a text relative to the start of
+ *  the text. Missing characters are lazy loaded.
+ *  \param text The text.
+ *  \param scale The scaling of the text.
+ *  \param billboard True if the text is used in a billboard.
+ *  \param layout On return contains the layout.
+ */
+void FontWithFace::layoutText(const core::stringw& text, float scale,
+                              bool billboard, TextLayout* layout)
+{
+    // This also lazy loads missing characters
+    FontSettings font_settings(/*black_border*/false, /*rtl*/false, scale);
+    layout->m_dimension = core::dimension2d<s32>(
+                               getDimension(text.c_str(), &font_settings));
+    layout->m_glyphs.clear();
+
+    core::array<gui::SGUISprite>& sprites   = m_spritebank->getSprites();
+    core::array<core::rect<s32>>& positions = m_spritebank->getPositions();
+    const int sprite_amount = sprites.size();
+
+    core::position2d<float> offset(0.0f, 0.0f);
+    unsigned int line = 0;
+    const unsigned int text_size = text.size();
+    for (u32 i = 0; i < text_size; i++)
+    {
+        wchar_t c = text[i];
+
+        if (c == L'\r' ||          // Windows breaks
+            c == L'\n'    )        // Unix breaks
+        {
+            if (c==L'\r' && text[i+1]==L'\n')
+                c = text[++i];
+            offset.Y += m_font_max_height * scale;
+            offset.X  = 0.0f;
+            line++;
+            continue;
+        }   // if lineBreak
+
+        bool fallback = false;
+        const FontArea &area = getAreaFromCharacter(c, &fallback);
+        const float cur_scale = fallback ? m_fallback_font_scale : scale;
+        core::position2d<float> glyph_offset = offset;
+        glyph_offset.X += area.bearing_x * cur_scale;
+        glyph_offset.Y += (billboard ? area.offset_y_bt : area.offset_y) *
+                          cur_scale;
+        offset.X += getCharWidth(area, fallback, scale);
+
+        const int sprite_id = area.spriteno;
+        if (!fallback && (sprite_id < 0 || sprite_id >= sprite_amount))
+            continue;
+        if (sprite_id == -1) continue;
+
+        const gui::SGUISpriteFrame &frame = fallback ?
+            m_fallback_font->m_spritebank->getSprites()[sprite_id].Frames[0] :
+            sprites[sprite_id].Frames[0];
+
+        GlyphLayout glyph;
+        glyph.m_source = fallback ?
+            m_fallback_font->m_spritebank->getPositions()[frame.rectNumber] :
+            positions[frame.rectNumber];
+        glyph.m_texture = fallback ?
+            m_fallback_font->m_spritebank->getTexture(frame.textureNumber) :
+            m_spritebank->getTexture(frame.textureNumber);
+        const core::dimension2d<float> size(
+            glyph.m_source.getSize().Width  * cur_scale,
+            glyph.m_source.getSize().Height * cur_scale);
+        glyph.m_dest     = core::rect<float>(glyph_offset, size);
+        glyph.m_line     = line;
+        glyph.m_fallback = fallback;
+        layout->m_glyphs.push_back(glyph);
+    }   // for i < text_size
+}   // layoutText
@@ -22,12 +22,14 @@
 #include "utils/cpp2011.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/types.hpp"
 
 #include <algorithm>
 #include <cassert>
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -180,6 +182,63 @@ private:
     /** Store a list of loaded and tested character to a \ref GlyphInfo. */
     std::map<wchar_t, GlyphInfo> m_character_glyph_info_map;
 
+    /** A glyph of a laid out text. */
+    struct GlyphLayout
+    {
+        /** The glyph page containing this glyph. */
+        video::ITexture*  m_texture;
+        /** The rectangle of the glyph in the glyph page. */
+        core::rect<s32>   m_source;
+        /** The destination rectangle relative to the start of the text. */
+        core::rect<float> m_dest;
+        /** The line of the text this glyph is in. */
+        unsigned int      m_line;
+        /** True if this glyph is taken from the fallback font. */
+        bool              m_fallback;
+    };
+
+    /** The result of laying out a text: all glyphs and its dimension. */
+    struct TextLayout
+    {
+        std::vector<GlyphLayout> m_glyphs;
+        core::dimension2d<s32>   m_dimension;
+    };
+
+    /** Key of the layout cache. Besides the text the layout only depends on
+     *  the scaling and on whether the text is used in a billboard (which
+     *  uses a different vertical offset). */
+    struct LayoutKey
+    {
+        core::stringw m_text;
+        float         m_scale;
+        bool          m_billboard;
+        bool operator<(const LayoutKey &other) const
+        {
+            if (m_scale != other.m_scale)
+                return m_scale < other.m_scale;
+            if (m_billboard != other.m_billboard)
+                return other.m_billboard;
+            return m_text < other.m_text;
+        }
+    };
+
+    /** Cache of the layouts of recently rendered texts. */
+    std::map<LayoutKey, TextLayout> m_layout_cache;
+
+    /** Value of \ref m_reset_count when the layout cache was last cleared. A
+     *  reset of any font (including the fallback font) invalidates the glyph
+     *  pages the cached layouts refer to. */
+    unsigned int m_layout_reset_count;
+
+    /** Counts the calls of \ref reset of all fonts. */
+    static unsigned int m_reset_count;
+
+    /** True if the layout cache is used. */
+    static bool m_layout_cache_enabled;
+
+    /** Statistics: layouts found in / added to the cache. */
+    static uint64_t m_layout_hits, m_layout_misses;
+
     // ------------------------------------------------------------------------
     /** Return a character width.
      *  \param area \ref FontArea to get glyph metrics.
@@ -245,6 +304,12 @@ private:
     // ------------------------------------------------------------------------
     void setDPI();
     // ------------------------------------------------------------------------
+    const TextLayout& getLayout(const core::stringw& text, float scale,
+                                bool billboard);
+    // ------------------------------------------------------------------------
+    void layoutText(const core::stringw& text, float scale, bool billboard,
+                    TextLayout* layout);
+    // ------------------------------------------------------------------------
     /** Override it if sub-class should not do lazy loading characters. */
     virtual bool supportLazyLoadChar() const                   { return true; }
     // ------------------------------------------------------------------------
@@ -301,6 +366,20 @@ public:
     // ------------------------------------------------------------------------
     /** Return the dpi of this face. */
     unsigned int getDPI() const                          { return m_face_dpi; }
+    // ------------------------------------------------------------------------
+    /** Enables or disables the layout cache of all fonts. */
+    static void setLayoutCacheEnabled(bool enabled)
+    {
+        m_layout_cache_enabled = enabled;
+    }   // setLayoutCacheEnabled
+    // ------------------------------------------------------------------------
+    /** Returns how many texts were rendered using a cached layout, and how
+     *  many texts had to be laid out. */
+    static void getLayoutStatistics(uint64_t* hits, uint64_t* misses)
+    {
+        *hits   = m_layout_hits;
+        *misses = m_layout_misses;
+    }   // getLayoutStatistics
 
 };   // FontWithFace
 
@@ -18,6 +18,10 @@
 #ifndef SERVER_ONLY
 #include "graphics/2dutils.hpp"
 
+#include "config/user_config.hpp"
+#include "font/font_manager.hpp"
+#include "font/font_settings.hpp"
+#include "font/regular_face.hpp"
 #include "graphics/central_settings.hpp"
 #include "graphics/glwrap.hpp"
 #include "graphics/irr_driver.hpp"
@@ -25,8 +29,38 @@
 #include "graphics/shaders.hpp"
 #include "graphics/shared_gpu_objects.hpp"
 #include "graphics/texture_shader.hpp"
+#include "guiengine/engine.hpp"
+#include "guiengine/skin.hpp"
 #include "utils/cpp2011.hpp"
 
+#include <algorithm>
+#include <assert.h>
+#include <cstddef>
+#include <string.h>
+#include <vector>
+
+/** Maximum number of quads drawn in one draw call. The vertices are
+ *  addressed with 16 bit indices. */
+static const unsigned int MAX_BATCHED_QUADS = 4096;
+
+/** Blend modes used for 2D drawing. */
+enum BlendMode2D
+{
+    BLEND_NONE,
+    BLEND_ALPHA,
+    BLEND_ADDITIVE
+};   // BlendMode2D
+
+/** A vertex of a batched quad. */
+struct BatchVertex
+{
+    /** Position in normalised device coordinates. */
+    float m_position[2];
+    float m_uv[2];
+    /** Colour as RGBA. */
+    u8    m_color[4];
+};   // BatchVertex
+
 // ============================================================================
 class Primitive2DList : public TextureShader<Primitive2DList, 1, float>
 {
@@ -59,162 +93,199 @@ public:
 };   // UniformColoredTextureRectShader
 
 // ============================================================================
-class TextureRectShader : public TextureShader<TextureRectShader, 1, 
-                                             core::vector2df, core::vector2df,
-                                             core::vector2df, core::vector2df>
-{
-public:
-    TextureRectShader()
-    {
-        loadProgram(OBJECT, GL_VERTEX_SHADER, "texturedquad.vert",
-                            GL_FRAGMENT_SHADER, "texturedquad.frag");
-        assignUniforms("center", "size", "texcenter", "texsize");
-
-        assignSamplerNames(0, "tex", ST_BILINEAR_FILTERED);
-    }   // TextureRectShader
-};   // TextureRectShader
-
-// ============================================================================
-class ColoredRectShader : public Shader<ColoredRectShader, core::vector2df,
-                                        core::vector2df, video::SColor>
-{
-public:
-    ColoredRectShader()
-    {
-        loadProgram(OBJECT, GL_VERTEX_SHADER, "coloredquad.vert",
-                            GL_FRAGMENT_SHADER, "coloredquad.frag");
-        assignUniforms("center", "size", "color");
-    }   // ColoredRectShader
-};   // ColoredRectShader
-
-// ============================================================================
-
-class ColoredTextureRectShader : public TextureShader<ColoredTextureRectShader, 1,
-                                               core::vector2df, core::vector2df,
-                                               core::vector2df, core::vector2df>
+/** Draws a batch of textured and coloured quads with a single draw call. The
+ *  vertices contain the position in normalised device coordinates, so no
+ *  uniforms are needed. Untextured quads use a 1x1 white texture, so that
+ *  they can be drawn with the same shader. */
+class BatchedQuadShader : public TextureShader<BatchedQuadShader, 1>
 {
-#ifdef XX
-private:
-    GLuint m_quad_buffer;
-
-    void initQuadBuffer()
-    {
-        const float quad_vertex[] = { -1., -1., -1.,  1.,   // UpperLeft
-                                      -1.,  1., -1., -1.,   // LowerLeft
-                                       1., -1.,  1.,  1.,   // UpperRight
-                                       1.,  1.,  1., -1. }; // LowerRight 
-        glGenBuffers(1, &m_quad_buffer);
-        glBindBuffer(GL_ARRAY_BUFFER, m_quad_buffer);
-        glBufferData(GL_ARRAY_BUFFER, 16 * sizeof(float), quad_vertex,
-                     GL_STATIC_DRAW);
-
-        glGenVertexArrays(1, &SharedObject::UIVAO);
-        glBindVertexArray(SharedObject::UIVAO);
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(3);
-        glBindBuffer(GL_ARRAY_BUFFER, m_quad_buffer);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 
-                              (GLvoid *)(2 * sizeof(float)));
-        glBindVertexArray(0);
-    }   // initQuadBuffer
-#endif
 public:
-    GLuint m_color_vbo;
     GLuint m_vao;
+    GLuint m_vbo;
+    GLuint m_ibo;
+    GLuint m_white_texture;
 
-    ColoredTextureRectShader()
+    BatchedQuadShader()
     {
-#ifdef XX
-        initQuadBuffer();
-#endif
-        loadProgram(OBJECT, GL_VERTEX_SHADER, "colortexturedquad.vert",
+        loadProgram(OBJECT, GL_VERTEX_SHADER, "batchedquad.vert",
                             GL_FRAGMENT_SHADER, "colortexturedquad.frag");
-        assignUniforms("center", "size", "texcenter", "texsize");
-
+        assignUniforms();
         assignSamplerNames(0, "tex", ST_BILINEAR_FILTERED);
 
+        // Two triangles for each quad, using the vertices in the order
+        // upper left, lower left, lower right, upper right
+        std::vector<u16> indices(MAX_BATCHED_QUADS * 6);
+        for (unsigned int i = 0; i < MAX_BATCHED_QUADS; i++)
+        {
+            indices[6 * i    ] = u16(4 * i    );
+            indices[6 * i + 1] = u16(4 * i + 1);
+            indices[6 * i + 2] = u16(4 * i + 2);
+            indices[6 * i + 3] = u16(4 * i    );
+            indices[6 * i + 4] = u16(4 * i + 2);
+            indices[6 * i + 5] = u16(4 * i + 3);
+        }
+
         glGenVertexArrays(1, &m_vao);
         glBindVertexArray(m_vao);
+        glGenBuffers(1, &m_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER, MAX_BATCHED_QUADS * 4 *
+                     sizeof(BatchVertex), NULL, GL_STREAM_DRAW);
         glEnableVertexAttribArray(0);
         glEnableVertexAttribArray(3);
         glEnableVertexAttribArray(2);
-        glBindBuffer(GL_ARRAY_BUFFER, SharedGPUObjects::getQuadBuffer());
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 
-                              (GLvoid *)(2 * sizeof(float)));
-        const unsigned quad_color[] = {   0,   0,   0, 255,
-                                        255,   0,   0, 255,
-                                          0, 255,   0, 255,
-                                          0,   0, 255, 255 };
-        glGenBuffers(1, &m_color_vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, m_color_vbo);
-        glBufferData(GL_ARRAY_BUFFER, 16 * sizeof(unsigned), quad_color,
-                     GL_DYNAMIC_DRAW);
-        glVertexAttribIPointer(2, 4, GL_UNSIGNED_INT, 4 * sizeof(unsigned), 0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex),
+                              (GLvoid*)offsetof(BatchVertex, m_position));
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex),
+                              (GLvoid*)offsetof(BatchVertex, m_uv));
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                              sizeof(BatchVertex),
+                              (GLvoid*)offsetof(BatchVertex, m_color));
+        glGenBuffers(1, &m_ibo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(u16),
+                     indices.data(), GL_STATIC_DRAW);
         glBindVertexArray(0);
-    }   // ColoredTextureRectShader
-};   // ColoredTextureRectShader
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        const u8 white[] = { 255, 255, 255, 255 };
+        glGenTextures(1, &m_white_texture);
+        glBindTexture(GL_TEXTURE_2D, m_white_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, white);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }   // BatchedQuadShader
+};   // BatchedQuadShader
 
 // ============================================================================
-static void drawTexColoredQuad(const video::ITexture *texture,
-                               const video::SColor *col, float width,
-                               float height, float center_pos_x,
-                               float center_pos_y, float tex_center_pos_x,
-                               float tex_center_pos_y, float tex_width,
-                               float tex_height)
+/** The quads collected since the last flush, all of them using the same
+ *  texture, blend mode and clipping rectangle. */
+struct QuadBatch
 {
-    unsigned colors[] = {
-        col[0].getRed(), col[0].getGreen(), col[0].getBlue(), col[0].getAlpha(),
-        col[1].getRed(), col[1].getGreen(), col[1].getBlue(), col[1].getAlpha(),
-        col[2].getRed(), col[2].getGreen(), col[2].getBlue(), col[2].getAlpha(),
-        col[3].getRed(), col[3].getGreen(), col[3].getBlue(), col[3].getAlpha(),
-    };
-
-    glBindBuffer(GL_ARRAY_BUFFER,
-                 ColoredTextureRectShader::getInstance()->m_color_vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, 16 * sizeof(unsigned), colors);
-
-    ColoredTextureRectShader::getInstance()->use();
-    glBindVertexArray(ColoredTextureRectShader::getInstance()->m_vao);
-    ColoredTextureRectShader::getInstance()
-        ->setTextureUnits(texture->getOpenGLTextureName());
-    ColoredTextureRectShader::getInstance()
-        ->setUniforms(core::vector2df(center_pos_x, center_pos_y),
-                      core::vector2df(width, height),
-                      core::vector2df(tex_center_pos_x, tex_center_pos_y),
-                      core::vector2df(tex_width, tex_height));
-
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    std::vector<BatchVertex> m_vertices;
+    GLuint           m_texture;
+    BlendMode2D      m_blend;
+    bool             m_clip;
+    core::rect<s32>  m_clip_rect;
+    /** Nesting depth of begin2DBatch() calls. */
+    int              m_depth;
+    /** If set, quads are only counted but not drawn, see record2DQuads(). */
+    bool             m_record_only;
+    /** Quads and draw calls of the current frame. */
+    unsigned int     m_frame_quads;
+    unsigned int     m_frame_draws;
+    Draw2DStatistics m_statistics;
+
+    QuadBatch() : m_texture(0), m_blend(BLEND_NONE), m_clip(false),
+                  m_depth(0), m_record_only(false), m_frame_quads(0),
+                  m_frame_draws(0)
+    {
+        memset(&m_statistics, 0, sizeof(m_statistics));
+    }
+};   // QuadBatch
 
-    glGetError();
-}   // drawTexColoredQuad
+static QuadBatch g_quad_batch;
 
 // ----------------------------------------------------------------------------
-static void drawTexQuad(GLuint texture, float width, float height,
-                        float center_pos_x, float center_pos_y, 
-                        float tex_center_pos_x, float tex_center_pos_y,
-                        float tex_width, float tex_height)
+/** Returns true if quads are collected in g_quad_batch, false if they are
+ *  drawn by irrlicht. */
+static bool useQuadBatch()
 {
-    TextureRectShader::getInstance()->use();
-    glBindVertexArray(SharedGPUObjects::getUI_VAO());
+    return CVS->isGLSL() || g_quad_batch.m_record_only;
+}   // useQuadBatch
 
-    TextureRectShader::getInstance()->setTextureUnits(texture);
-    TextureRectShader::getInstance()->setUniforms(
-                    core::vector2df(center_pos_x, center_pos_y), 
-                    core::vector2df(width, height),
-                    core::vector2df(tex_center_pos_x, tex_center_pos_y),
-                    core::vector2df(tex_width, tex_height)                );
+// ----------------------------------------------------------------------------
+/** Adds a quad to the current batch. If the quad can not be combined with
+ *  the quads already in the batch (different texture, blend mode or
+ *  clipping), the batch is drawn first. Outside of begin2DBatch() and
+ *  end2DBatch() the quad is drawn immediately.
+ *  \param texture The OpenGL texture to use.
+ *  \param texture_size Size of the texture, used to compute the texture
+ *         coordinates from source.
+ *  \param texture_is_rtt True if the texture is a render target, which is
+ *         stored upside down.
+ *  \param dest Destination rectangle in pixels.
+ *  \param source Source rectangle in the texture in pixels.
+ *  \param clip Optional clipping rectangle.
+ *  \param colors The colours of the lower left, upper left, lower right and
+ *         upper right corner. NULL means white.
+ *  \param blend The blend mode to use.
+ */
+static void addQuad(GLuint texture,
+                    const core::dimension2d<u32> &texture_size,
+                    bool texture_is_rtt, const core::rect<float> &dest,
+                    const core::rect<s32> &source, const core::rect<s32> *clip,
+                    const video::SColor *colors, BlendMode2D blend)
+{
+    if (clip && !clip->isValid())
+        return;
 
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    QuadBatch &batch = g_quad_batch;
+    if (!batch.m_vertices.empty() &&
+        (batch.m_texture != texture || batch.m_blend != blend ||
+         batch.m_clip != (clip != NULL)                       ||
+         (clip && batch.m_clip_rect != *clip)                 ||
+         batch.m_vertices.size() >= MAX_BATCHED_QUADS * 4       ))
+    {
+        flush2DBatch();
+    }
+    batch.m_texture = texture;
+    batch.m_blend   = blend;
+    batch.m_clip    = clip != NULL;
+    if (clip)
+        batch.m_clip_rect = *clip;
+
+    const core::dimension2d<u32> &screen = irr_driver->getActualScreenSize();
+    const float left   = 2.0f * dest.UpperLeftCorner.X  / screen.Width - 1.0f;
+    const float right  = 2.0f * dest.LowerRightCorner.X / screen.Width - 1.0f;
+    const float top    = 1.0f - 2.0f * dest.UpperLeftCorner.Y  / screen.Height;
+    const float bottom = 1.0f - 2.0f * dest.LowerRightCorner.Y / screen.Height;
+
+    const float u0 = float(source.UpperLeftCorner.X ) / texture_size.Width;
+    const float u1 = float(source.LowerRightCorner.X) / texture_size.Width;
+    float v0 = float(source.UpperLeftCorner.Y ) / texture_size.Height;
+    float v1 = float(source.LowerRightCorner.Y) / texture_size.Height;
+    if (texture_is_rtt)
+        std::swap(v0, v1);
+
+    const video::SColor white(255, 255, 255, 255);
+    const video::SColor &lower_left  = colors ? colors[0] : white;
+    const video::SColor &upper_left  = colors ? colors[1] : white;
+    const video::SColor &lower_right = colors ? colors[2] : white;
+    const video::SColor &upper_right = colors ? colors[3] : white;
+
+    const BatchVertex vertices[4] =
+    {
+        { { left,  top    }, { u0, v0 }, { u8(upper_left.getRed()),
+          u8(upper_left.getGreen()),  u8(upper_left.getBlue()),
+          u8(upper_left.getAlpha())  } },
+        { { left,  bottom }, { u0, v1 }, { u8(lower_left.getRed()),
+          u8(lower_left.getGreen()),  u8(lower_left.getBlue()),
+          u8(lower_left.getAlpha())  } },
+        { { right, bottom }, { u1, v1 }, { u8(lower_right.getRed()),
+          u8(lower_right.getGreen()), u8(lower_right.getBlue()),
+          u8(lower_right.getAlpha()) } },
+        { { right, top    }, { u1, v0 }, { u8(upper_right.getRed()),
+          u8(upper_right.getGreen()), u8(upper_right.getBlue()),
+          u8(upper_right.getAlpha()) } }
+    };
+    batch.m_vertices.insert(batch.m_vertices.end(), vertices, vertices + 4);
+    batch.m_frame_quads++;
 
-    glGetError();
-}   // drawTexQuad
+    if (batch.m_depth == 0 || !UserConfigParams::m_batch_2d)
+        flush2DBatch();
+}   // addQuad
 
+// ----------------------------------------------------------------------------
+/** Returns the blend mode used by the draw2DImage functions. */
+static BlendMode2D getBlendMode(bool use_alpha_channel_of_texture,
+                                bool draw_translucently)
+{
+    if (draw_translucently)
+        return BLEND_ADDITIVE;
+    return use_alpha_channel_of_texture ? BLEND_ALPHA : BLEND_NONE;
+}   // getBlendMode
 
 // ----------------------------------------------------------------------------
 static void getSize(unsigned texture_width, unsigned texture_height,
@@ -260,114 +331,166 @@ static void getSize(unsigned texture_width, unsigned texture_height,
 }   // getSize
 
 // ----------------------------------------------------------------------------
-static void getSize(unsigned texture_width, unsigned texture_height,
-                    bool textureisRTT, const core::rect<float>& destRect,
-                    const core::rect<s32>& sourceRect,
-                    float &width, float &height,
-                    float &center_pos_x, float &center_pos_y,
-                    float &tex_width, float &tex_height,
-                    float &tex_center_pos_x, float &tex_center_pos_y   )
+/** Starts collecting 2D quads. All quads drawn with draw2DImage and
+ *  GL32_draw2DRectangle till the matching end2DBatch() call are combined
+ *  into as few draw calls as possible. Calls can be nested, the quads are
+ *  drawn when the outermost batch ends. Anything the irrlicht driver draws
+ *  while a batch is active draws the batch first. Any other OpenGL drawing
+ *  done while a batch is active must call flush2DBatch() first to keep the
+ *  drawing order.
+ */
+void begin2DBatch()
 {
-    core::dimension2d<u32> frame_size = irr_driver->getActualScreenSize();
-    const int screen_w = frame_size.Width;
-    const int screen_h =  frame_size.Height;
-    center_pos_x = destRect.UpperLeftCorner.X + destRect.LowerRightCorner.X;
-    center_pos_x /= screen_w;
-    center_pos_x -= 1.;
-    center_pos_y = destRect.UpperLeftCorner.Y + destRect.LowerRightCorner.Y;
-    center_pos_y /= screen_h;
-    center_pos_y = float(1.f - center_pos_y);
-    width = destRect.LowerRightCorner.X - destRect.UpperLeftCorner.X;
-    width /= screen_w;
-    height = destRect.LowerRightCorner.Y - destRect.UpperLeftCorner.Y;
-    height /= screen_h;
-
-    tex_center_pos_x = float(sourceRect.UpperLeftCorner.X + sourceRect.LowerRightCorner.X);
-    tex_center_pos_x /= texture_width * 2.f;
-    tex_center_pos_y = float(sourceRect.UpperLeftCorner.Y + sourceRect.LowerRightCorner.Y);
-    tex_center_pos_y /= texture_height * 2.f;
-    tex_width = float(sourceRect.LowerRightCorner.X - sourceRect.UpperLeftCorner.X);
-    tex_width /= texture_width * 2.f;
-    tex_height = float(sourceRect.LowerRightCorner.Y - sourceRect.UpperLeftCorner.Y);
-    tex_height /= texture_height * 2.f;
-
-    if (textureisRTT)
-        tex_height = -tex_height;
-
-    const f32 invW = 1.f / static_cast<f32>(texture_width);
-    const f32 invH = 1.f / static_cast<f32>(texture_height);
-    const core::rect<f32> tcoords(sourceRect.UpperLeftCorner.X  * invW,
-                                  sourceRect.UpperLeftCorner.Y  * invH,
-                                  sourceRect.LowerRightCorner.X * invW,
-                                  sourceRect.LowerRightCorner.Y * invH);
-}   // getSize
+    if (g_quad_batch.m_depth++ == 0 && irr_driver->getVideoDriver())
+        irr_driver->getVideoDriver()->setBeforeDrawCallback(flush2DBatch);
+}   // begin2DBatch
 
 // ----------------------------------------------------------------------------
-void draw2DImage(const video::ITexture* texture,
-                 const core::rect<s32>& destRect,
-                 const core::rect<s32>& sourceRect,
-                 const core::rect<s32>* clip_rect,
-                 const video::SColor &colors, bool use_alpha_channel_of_texture)
+/** Ends a batch started with begin2DBatch(). */
+void end2DBatch()
 {
-    if (!CVS->isGLSL())
+    assert(g_quad_batch.m_depth > 0);
+    g_quad_batch.m_depth--;
+    if (g_quad_batch.m_depth == 0)
     {
-        video::SColor duplicatedArray[4] = { colors, colors, colors, colors };
-        draw2DImage(texture, destRect, sourceRect, clip_rect, duplicatedArray,
-                    use_alpha_channel_of_texture);
-        return;
+        flush2DBatch();
+        if (irr_driver->getVideoDriver())
+            irr_driver->getVideoDriver()->setBeforeDrawCallback(NULL);
     }
+}   // end2DBatch
 
-    float width, height, center_pos_x, center_pos_y;
-    float tex_width, tex_height, tex_center_pos_x, tex_center_pos_y;
+// ----------------------------------------------------------------------------
+/** If enabled, the quads of the draw2DImage and GL32_draw2DRectangle
+ *  functions are collected, batched and counted as usual, even without
+ *  GLSL, but nothing is drawn. This allows to check the batching without
+ *  a GPU (e.g. with --no-graphics).
+ *  \param record_only True to only count the quads, false to draw them.
+ */
+void record2DQuads(bool record_only)
+{
+    flush2DBatch();
+    g_quad_batch.m_record_only = record_only;
+}   // record2DQuads
 
-    getSize(texture->getSize().Width, texture->getSize().Height,
-            texture->isRenderTarget(), destRect, sourceRect, width, height,
-            center_pos_x, center_pos_y, tex_width, tex_height,
-            tex_center_pos_x, tex_center_pos_y);
+// ----------------------------------------------------------------------------
+/** Draws all quads collected in the current batch. */
+void flush2DBatch()
+{
+    QuadBatch &batch = g_quad_batch;
+    if (batch.m_vertices.empty())
+        return;
 
-    if (use_alpha_channel_of_texture)
+    if (batch.m_record_only)
     {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        batch.m_vertices.clear();
+        batch.m_frame_draws++;
+        return;
     }
-    else
+
+    switch (batch.m_blend)
     {
+    case BLEND_NONE:
         glDisable(GL_BLEND);
+        break;
+    case BLEND_ALPHA:
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    case BLEND_ADDITIVE:
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        break;
     }
 
-    if (clip_rect)
+    if (batch.m_clip)
     {
-        if (!clip_rect->isValid())
-            return;
-
         glEnable(GL_SCISSOR_TEST);
         const core::dimension2d<u32>& render_target_size =
-                           irr_driver->getActualScreenSize();
-        glScissor(clip_rect->UpperLeftCorner.X,
-                  render_target_size.Height - clip_rect->LowerRightCorner.Y,
-                  clip_rect->getWidth(), clip_rect->getHeight());
+                            irr_driver->getActualScreenSize();
+        glScissor(batch.m_clip_rect.UpperLeftCorner.X,
+                  render_target_size.Height -
+                  batch.m_clip_rect.LowerRightCorner.Y,
+                  batch.m_clip_rect.getWidth(),
+                  batch.m_clip_rect.getHeight());
     }
 
-    UniformColoredTextureRectShader::getInstance()->use();
-    glBindVertexArray(SharedGPUObjects::getUI_VAO());
-    UniformColoredTextureRectShader::getInstance()
-        ->setTextureUnits(texture->getOpenGLTextureName());
-
-    UniformColoredTextureRectShader::getInstance()
-        ->setUniforms(core::vector2df(center_pos_x, center_pos_y),
-                      core::vector2df(width, height),
-                      core::vector2df(tex_center_pos_x, tex_center_pos_y),
-                      core::vector2df(tex_width, tex_height),
-                      colors);
-
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    BatchedQuadShader *shader = BatchedQuadShader::getInstance();
+    shader->use();
+    glBindVertexArray(shader->m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, shader->m_vbo);
+    // Orphan the old buffer content, so that the driver does not need to
+    // wait for the previous draw call
+    glBufferData(GL_ARRAY_BUFFER, MAX_BATCHED_QUADS * 4 * sizeof(BatchVertex),
+                 NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0,
+                    batch.m_vertices.size() * sizeof(BatchVertex),
+                    batch.m_vertices.data());
+    shader->setTextureUnits(batch.m_texture);
+    shader->setUniforms();
+
+    const GLsizei num_quads = GLsizei(batch.m_vertices.size() / 4);
+    glDrawElements(GL_TRIANGLES, num_quads * 6, GL_UNSIGNED_SHORT, 0);
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    if (clip_rect)
+    if (batch.m_clip)
         glDisable(GL_SCISSOR_TEST);
     glUseProgram(0);
 
     glGetError();
+    batch.m_vertices.clear();
+    batch.m_frame_draws++;
+}   // flush2DBatch
+
+// ----------------------------------------------------------------------------
+/** Called once per frame to update the 2D drawing statistics. */
+void next2DFrame()
+{
+    QuadBatch &batch = g_quad_batch;
+    assert(batch.m_depth == 0);
+    flush2DBatch();
+    Draw2DStatistics &s = batch.m_statistics;
+    s.m_frame_quads  = batch.m_frame_quads;
+    s.m_frame_draws  = batch.m_frame_draws;
+    s.m_frames++;
+    s.m_total_quads += batch.m_frame_quads;
+    s.m_total_draws += batch.m_frame_draws;
+    batch.m_frame_quads = 0;
+    batch.m_frame_draws = 0;
+}   // next2DFrame
+
+// ----------------------------------------------------------------------------
+/** Returns the number of 2D quads and draw calls of the last frame and of
+ *  all frames so far. */
+const Draw2DStatistics& get2DStatistics()
+{
+    return g_quad_batch.m_statistics;
+}   // get2DStatistics
+
+// ----------------------------------------------------------------------------
+void draw2DImage(const video::ITexture* texture,
+                 const core::rect<s32>& destRect,
+                 const core::rect<s32>& sourceRect,
+                 const core::rect<s32>* clip_rect,
+                 const video::SColor &colors, bool use_alpha_channel_of_texture)
+{
+    if (!useQuadBatch())
+    {
+        video::SColor duplicatedArray[4] = { colors, colors, colors, colors };
+        draw2DImage(texture, destRect, sourceRect, clip_rect, duplicatedArray,
+                    use_alpha_channel_of_texture);
+        return;
+    }
+
+    const video::SColor duplicated_array[4] = { colors, colors, colors,
+                                                colors };
+    addQuad(texture->getOpenGLTextureName(), texture->getSize(),
+            texture->isRenderTarget(),
+            core::rect<float>(float(destRect.UpperLeftCorner.X),
+                              float(destRect.UpperLeftCorner.Y),
+                              float(destRect.LowerRightCorner.X),
+                              float(destRect.LowerRightCorner.Y)),
+            sourceRect, clip_rect, duplicated_array,
+            getBlendMode(use_alpha_channel_of_texture, false));
 }   // draw2DImage
 
 // ----------------------------------------------------------------------------
@@ -378,7 +501,7 @@ void draw2DImage(const video::ITexture* texture,
                  const video::SColor &colors,
                  bool use_alpha_channel_of_texture)
 {
-    if (!CVS->isGLSL())
+    if (!useQuadBatch())
     {
         core::rect<irr::s32> dest_rect
             (irr::s32(destRect.UpperLeftCorner.X),
@@ -392,57 +515,12 @@ void draw2DImage(const video::ITexture* texture,
         return;
     }
 
-    float width, height, center_pos_x, center_pos_y;
-    float tex_width, tex_height, tex_center_pos_x, tex_center_pos_y;
-
-    getSize(texture->getSize().Width, texture->getSize().Height,
-            texture->isRenderTarget(), destRect, sourceRect, width, height,
-            center_pos_x, center_pos_y, tex_width, tex_height,
-            tex_center_pos_x, tex_center_pos_y);
-
-    if (use_alpha_channel_of_texture)
-    {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    }
-    else
-    {
-        glDisable(GL_BLEND);
-    }
-
-    if (clip_rect)
-    {
-        if (!clip_rect->isValid())
-            return;
-
-        glEnable(GL_SCISSOR_TEST);
-        const core::dimension2d<u32>& render_target_size = 
-                           irr_driver->getActualScreenSize();
-        glScissor(clip_rect->UpperLeftCorner.X,
-                  render_target_size.Height - clip_rect->LowerRightCorner.Y,
-                  clip_rect->getWidth(), clip_rect->getHeight());
-    }
-
-    UniformColoredTextureRectShader::getInstance()->use();
-    glBindVertexArray(SharedGPUObjects::getUI_VAO());
-    UniformColoredTextureRectShader::getInstance()
-        ->setTextureUnits(texture->getOpenGLTextureName());
-
-    UniformColoredTextureRectShader::getInstance()
-        ->setUniforms(core::vector2df(center_pos_x, center_pos_y),
-                      core::vector2df(width, height),
-                      core::vector2df(tex_center_pos_x, tex_center_pos_y),
-                      core::vector2df(tex_width, tex_height),
-                      colors);
-
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    if (clip_rect)
-        glDisable(GL_SCISSOR_TEST);
-    glUseProgram(0);
-
-    glGetError();
+    const video::SColor duplicated_array[4] = { colors, colors, colors,
+                                                colors };
+    addQuad(texture->getOpenGLTextureName(), texture->getSize(),
+            texture->isRenderTarget(), destRect, sourceRect, clip_rect,
+            duplicated_array,
+            getBlendMode(use_alpha_channel_of_texture, false));
 }   // draw2DImage
 
 // ----------------------------------------------------------------------------
@@ -453,6 +531,9 @@ void draw2DImageFromRTT(GLuint texture, size_t texture_w, size_t texture_h,
                         const video::SColor &colors,
                         bool use_alpha_channel_of_texture)
 {
+    // This is not batched, so draw all previous quads first
+    flush2DBatch();
+
     if (use_alpha_channel_of_texture)
     {
         glEnable(GL_BLEND);
@@ -480,6 +561,8 @@ void draw2DImageFromRTT(GLuint texture, size_t texture_w, size_t texture_h,
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    g_quad_batch.m_frame_quads++;
+    g_quad_batch.m_frame_draws++;
 }   // draw2DImageFromRTT
 
 // ----------------------------------------------------------------------------
@@ -491,7 +574,7 @@ void draw2DImage(const video::ITexture* texture,
                  bool use_alpha_channel_of_texture,
                  bool draw_translucently)
 {
-    if (!CVS->isGLSL())
+    if (!useQuadBatch())
     {
         irr_driver->getVideoDriver()->draw2DImage(texture, destRect, sourceRect,
                                                   clip_rect, colors,
@@ -499,57 +582,14 @@ void draw2DImage(const video::ITexture* texture,
         return;
     }
 
-    float width, height, center_pos_x, center_pos_y, tex_width, tex_height;
-    float tex_center_pos_x, tex_center_pos_y;
-
-    getSize(texture->getSize().Width, texture->getSize().Height,
-            texture->isRenderTarget(), destRect, sourceRect, width, height, 
-            center_pos_x, center_pos_y, tex_width, tex_height,
-            tex_center_pos_x, tex_center_pos_y);
-
-    if (draw_translucently)
-    {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    }
-    else if (use_alpha_channel_of_texture)
-    {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    }
-    else
-    {
-        glDisable(GL_BLEND);
-    }
-    if (clip_rect)
-    {
-        if (!clip_rect->isValid())
-            return;
-
-        glEnable(GL_SCISSOR_TEST);
-        const core::dimension2d<u32>& render_target_size =
-                            irr_driver->getActualScreenSize();
-        glScissor(clip_rect->UpperLeftCorner.X, 
-                  render_target_size.Height - clip_rect->LowerRightCorner.Y,
-                  clip_rect->getWidth(), clip_rect->getHeight());
-    }
-    if (colors)
-    {
-        drawTexColoredQuad(texture, colors, width, height, center_pos_x,
-                           center_pos_y, tex_center_pos_x, tex_center_pos_y,
-                           tex_width, tex_height);
-    }
-    else
-    {
-        drawTexQuad(texture->getOpenGLTextureName(), width, height,
-                    center_pos_x, center_pos_y, tex_center_pos_x,
-                    tex_center_pos_y, tex_width, tex_height);
-    }
-    if (clip_rect)
-        glDisable(GL_SCISSOR_TEST);
-    glUseProgram(0);
-
-    glGetError();
+    addQuad(texture->getOpenGLTextureName(), texture->getSize(),
+            texture->isRenderTarget(),
+            core::rect<float>(float(destRect.UpperLeftCorner.X),
+                              float(destRect.UpperLeftCorner.Y),
+                              float(destRect.LowerRightCorner.X),
+                              float(destRect.LowerRightCorner.Y)),
+            sourceRect, clip_rect, colors,
+            getBlendMode(use_alpha_channel_of_texture, draw_translucently));
 }   // draw2DImage
 
 // ----------------------------------------------------------------------------
@@ -561,7 +601,7 @@ void draw2DImage(const video::ITexture* texture,
                  bool use_alpha_channel_of_texture,
                  bool draw_translucently)
 {
-    if (!CVS->isGLSL())
+    if (!useQuadBatch())
     {
         core::rect<irr::s32> dest_rect
             (irr::s32(destRect.UpperLeftCorner.X),
@@ -575,57 +615,9 @@ void draw2DImage(const video::ITexture* texture,
         return;
     }
 
-    float width, height, center_pos_x, center_pos_y, tex_width, tex_height;
-    float tex_center_pos_x, tex_center_pos_y;
-
-    getSize(texture->getSize().Width, texture->getSize().Height,
-            texture->isRenderTarget(), destRect, sourceRect, width, height,
-            center_pos_x, center_pos_y, tex_width, tex_height,
-            tex_center_pos_x, tex_center_pos_y);
-
-    if (draw_translucently)
-    {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    }
-    else if (use_alpha_channel_of_texture)
-    {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    }
-    else
-    {
-        glDisable(GL_BLEND);
-    }
-    if (clip_rect)
-    {
-        if (!clip_rect->isValid())
-            return;
-
-        glEnable(GL_SCISSOR_TEST);
-        const core::dimension2d<u32>& render_target_size =
-                            irr_driver->getActualScreenSize();
-        glScissor(clip_rect->UpperLeftCorner.X,
-                  render_target_size.Height - clip_rect->LowerRightCorner.Y,
-                  clip_rect->getWidth(), clip_rect->getHeight());
-    }
-    if (colors)
-    {
-        drawTexColoredQuad(texture, colors, width, height, center_pos_x,
-                           center_pos_y, tex_center_pos_x, tex_center_pos_y,
-                           tex_width, tex_height);
-    }
-    else
-    {
-        drawTexQuad(texture->getOpenGLTextureName(), width, height,
-                    center_pos_x, center_pos_y, tex_center_pos_x,
-                    tex_center_pos_y, tex_width, tex_height);
-    }
-    if (clip_rect)
-        glDisable(GL_SCISSOR_TEST);
-    glUseProgram(0);
-
-    glGetError();
+    addQuad(texture->getOpenGLTextureName(), texture->getSize(),
+            texture->isRenderTarget(), destRect, sourceRect, clip_rect, colors,
+            getBlendMode(use_alpha_channel_of_texture, draw_translucently));
 }   // draw2DImage
 
 // ----------------------------------------------------------------------------
@@ -643,6 +635,9 @@ void draw2DVertexPrimitiveList(video::ITexture *tex, const void* vertices,
         return;
     }
 
+    // This is not batched, so draw all previous quads first
+    flush2DBatch();
+
     GLuint tmpvao, tmpvbo, tmpibo;
     primitiveCount += 2;
     glGenVertexArrays(1, &tmpvao);
@@ -666,6 +661,7 @@ void draw2DVertexPrimitiveList(video::ITexture *tex, const void* vertices,
     glDeleteVertexArrays(1, &tmpvao);
     glDeleteBuffers(1, &tmpvbo);
     glDeleteBuffers(1, &tmpibo);
+    g_quad_batch.m_frame_draws++;
 
 }   // draw2DVertexPrimitiveList
 
@@ -674,64 +670,73 @@ void GL32_draw2DRectangle(video::SColor color, const core::rect<s32>& position,
                           const core::rect<s32>* clip)
 {
 
-    if (!CVS->isGLSL())
+    if (!useQuadBatch())
     {
         irr_driver->getVideoDriver()->draw2DRectangle(color, position, clip);
         return;
     }
 
-    core::dimension2d<u32> frame_size = irr_driver->getActualScreenSize();
-    const int screen_w = frame_size.Width;
-    const int screen_h = frame_size.Height;
-    float center_pos_x = float(position.UpperLeftCorner.X + position.LowerRightCorner.X);
-    center_pos_x /= screen_w;
-    center_pos_x -= 1;
-    float center_pos_y = float(position.UpperLeftCorner.Y + position.LowerRightCorner.Y);
-    center_pos_y /= screen_h;
-    center_pos_y = 1 - center_pos_y;
-    float width = float(position.LowerRightCorner.X - position.UpperLeftCorner.X);
-    width /= screen_w;
-    float height = float(position.LowerRightCorner.Y - position.UpperLeftCorner.Y);
-    height /= screen_h;
-
-    if (color.getAlpha() < 255)
-    {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    }
-    else
-    {
-        glDisable(GL_BLEND);
-    }
-
-    if (clip)
-    {
-        if (!clip->isValid())
-            return;
-
-        glEnable(GL_SCISSOR_TEST);
-        const core::dimension2d<u32>& render_target_size = 
-                                            irr_driver->getActualScreenSize();
-        glScissor(clip->UpperLeftCorner.X,
-                  render_target_size.Height - clip->LowerRightCorner.Y,
-                  clip->getWidth(), clip->getHeight());
-    }
-
-    ColoredRectShader::getInstance()->use();
-    glBindVertexArray(SharedGPUObjects::getUI_VAO());
-    ColoredRectShader::getInstance()
-        ->setUniforms(core::vector2df(center_pos_x, center_pos_y),
-                      core::vector2df(width, height), color        );
-
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    if (clip)
-        glDisable(GL_SCISSOR_TEST);
-    glUseProgram(0);
-
-    glGetError();
+    const video::SColor colors[4] = { color, color, color, color };
+    addQuad(g_quad_batch.m_record_only
+            ? 0 : BatchedQuadShader::getInstance()->m_white_texture,
+            core::dimension2d<u32>(1, 1), /*is_rtt*/false,
+            core::rect<float>(float(position.UpperLeftCorner.X),
+                              float(position.UpperLeftCorner.Y),
+                              float(position.LowerRightCorner.X),
+                              float(position.LowerRightCorner.Y)),
+            core::rect<s32>(0, 0, 1, 1), clip, colors,
+            color.getAlpha() < 255 ? BLEND_ALPHA : BLEND_NONE);
 }   // GL32_draw2DRectangle
 
-#endif   // !SERVER_ONLY
+// ----------------------------------------------------------------------------
+/** Draws a text with black border and a box from a stretchable texture, and
+ *  checks the number of quads and draw calls of the batches.
+ */
+void unitTesting2D()
+{
+    bool saved_batch_2d = UserConfigParams::m_batch_2d;
+    UserConfigParams::m_batch_2d = true;
+    record2DQuads(true);
+    next2DFrame();
+    // Each glyph is drawn 16 times for the border, and once on top of it
+    FontSettings border_settings(/*black_border*/true);
+    font_manager->getFont<RegularFace>()->render(L"STK",
+        core::recti(0, 0, 200, 50), video::SColor(255, 255, 255, 255),
+        false, false, NULL, &border_settings);
+    next2DFrame();
+    assert(get2DStatistics().m_frame_quads == 3 * 17);
+    assert(get2DStatistics().m_frame_draws == 1);
+
+    // One quad for each area of the box, and one more for each corner
+    GUIEngine::SkinWidgetContainer container;
+    const std::string box_type = "generic-message::neutral";
+    const int areas =
+        GUIEngine::getSkin()->getBoxRenderParams(box_type).areas;
+    const bool l = (areas & GUIEngine::BoxRenderParams::LEFT  ) != 0;
+    const bool r = (areas & GUIEngine::BoxRenderParams::RIGHT ) != 0;
+    const bool t = (areas & GUIEngine::BoxRenderParams::TOP   ) != 0;
+    const bool b = (areas & GUIEngine::BoxRenderParams::BOTTOM) != 0;
+    const unsigned int box_quads =
+        ((areas & GUIEngine::BoxRenderParams::BODY) != 0) + l + r + t + b
+        + (l && t) + (r && t) + (l && b) + (r && b);
+    GUIEngine::getSkin()->drawMessage(&container,
+                                      core::recti(100, 100, 400, 200),
+                                      box_type);
+    next2DFrame();
+    assert(get2DStatistics().m_frame_quads == box_quads);
+    assert(get2DStatistics().m_frame_draws == (box_quads > 0 ? 1 : 0));
+
+    // Without batching each quad is drawn on its own
+    UserConfigParams::m_batch_2d = false;
+    GUIEngine::getSkin()->drawMessage(&container,
+                                      core::recti(100, 100, 400, 200),
+                                      box_type);
+    next2DFrame();
+    assert(get2DStatistics().m_frame_quads == box_quads);
+    assert(get2DStatistics().m_frame_draws == box_quads);
+    (void)box_quads;   // avoid compiler warning with NDEBUG
+    record2DQuads(false);
+    UserConfigParams::m_batch_2d = saved_batch_2d;
+}   // unitTesting2D
 
+#endif   // !SERVER_ONLY
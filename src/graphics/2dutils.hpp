@@ -19,6 +19,7 @@
 #define UTILS2D_HPP
 
 #include "gl_headers.hpp"
+#include "utils/types.hpp"
 
 #include <EPrimitiveTypes.h>
 #include <irrTypes.h>
@@ -28,6 +29,23 @@
 #include <SColor.h>
 #include <SVertexIndex.h>
 
+/** Number of 2D quads and draw calls, see get2DStatistics(). */
+struct Draw2DStatistics
+{
+    /** Quads and draw calls of the last frame. */
+    unsigned int m_frame_quads, m_frame_draws;
+    /** Number of frames, and quads and draw calls of all frames. */
+    uint64_t     m_frames, m_total_quads, m_total_draws;
+};   // Draw2DStatistics
+
+void begin2DBatch();
+void end2DBatch();
+void flush2DBatch();
+void record2DQuads(bool record_only);
+void next2DFrame();
+const Draw2DStatistics& get2DStatistics();
+void unitTesting2D();
+
 void draw2DImageFromRTT(GLuint texture, size_t texture_w, size_t texture_h,
                         const irr::core::rect<irr::s32>& destRect,
                         const irr::core::rect<irr::s32>& sourceRect,
@@ -0,0 +1,242 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/buffer_allocator.hpp"
+
+#include <assert.h>
+
+// ----------------------------------------------------------------------------
+BufferAllocator::BufferAllocator()
+{
+    m_capacity = 0;
+    m_end      = 0;
+    m_num_used = 0;
+}   // BufferAllocator
+
+// ----------------------------------------------------------------------------
+/** Returns the size class of a range, i.e. the index of the highest bit set.
+ *  \param count Number of elements, must not be 0.
+ */
+unsigned int BufferAllocator::getSizeClass(size_t count)
+{
+    assert(count > 0);
+    unsigned int size_class = 0;
+    while (count >>= 1)
+        size_class++;
+    return size_class;
+}   // getSizeClass
+
+// ----------------------------------------------------------------------------
+/** Adds a range to the free lists (without merging it with its neighbours).
+ */
+void BufferAllocator::addFreeRange(size_t offset, size_t count)
+{
+    m_free_ranges[offset] = count;
+    m_free_lists[getSizeClass(count)].insert(std::make_pair(count, offset));
+}   // addFreeRange
+
+// ----------------------------------------------------------------------------
+/** Removes a range from the free lists. */
+void BufferAllocator::removeFreeRange(size_t offset, size_t count)
+{
+    m_free_ranges.erase(offset);
+    m_free_lists[getSizeClass(count)].erase(std::make_pair(count, offset));
+}   // removeFreeRange
+
+// ----------------------------------------------------------------------------
+/** Finds the free range to use for an allocation: the smallest fitting
+ *  range of the size class of the allocation, otherwise the smallest range
+ *  of the next larger non-empty class.
+ *  \param count Number of elements needed.
+ *  \param offset On return the offset of the free range.
+ *  \param range On return the size of the free range.
+ *  \return False if no free range is large enough.
+ */
+bool BufferAllocator::findFreeRange(size_t count, size_t *offset,
+                                    size_t *range) const
+{
+    const unsigned int size_class = getSizeClass(count);
+    std::set<std::pair<size_t, size_t> >::const_iterator it =
+        m_free_lists[size_class].lower_bound(std::make_pair(count, (size_t)0));
+    if (it == m_free_lists[size_class].end())
+    {
+        unsigned int i = size_class + 1;
+        while (i < NUM_SIZE_CLASSES && m_free_lists[i].empty())
+            i++;
+        if (i == NUM_SIZE_CLASSES) return false;
+        it = m_free_lists[i].begin();
+    }
+    *range  = it->first;
+    *offset = it->second;
+    return true;
+}   // findFreeRange
+
+// ----------------------------------------------------------------------------
+/** Allocates a range.
+ *  \param count Number of elements.
+ *  \return The offset of the range, or INVALID_OFFSET if the buffer is too
+ *          small (in which case the buffer must be made larger).
+ */
+size_t BufferAllocator::allocate(size_t count)
+{
+    assert(count > 0);
+    size_t offset, range;
+    if (findFreeRange(count, &offset, &range))
+    {
+        removeFreeRange(offset, range);
+        if (range > count)
+            addFreeRange(offset + count, range - count);
+    }
+    else if (m_end + count <= m_capacity)
+    {
+        offset = m_end;
+        m_end += count;
+    }
+    else
+        return INVALID_OFFSET;
+
+    m_num_used += count;
+    return offset;
+}   // allocate
+
+// ----------------------------------------------------------------------------
+/** Frees a range. It is merged with adjacent free ranges.
+ *  \param offset Offset of the range as returned by allocate.
+ *  \param count Number of elements.
+ */
+void BufferAllocator::free(size_t offset, size_t count)
+{
+    assert(count > 0 && offset + count <= m_end);
+    assert(m_num_used >= count);
+    m_num_used -= count;
+
+    std::map<size_t, size_t>::iterator next =
+        m_free_ranges.lower_bound(offset);
+    assert(next == m_free_ranges.end() || next->first >= offset + count);
+    if (next != m_free_ranges.begin())
+    {
+        std::map<size_t, size_t>::iterator previous = next;
+        previous--;
+        assert(previous->first + previous->second <= offset);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            count += previous->second;
+            removeFreeRange(previous->first, previous->second);
+        }
+    }
+    if (next != m_free_ranges.end() && next->first == offset + count)
+    {
+        const size_t next_count = next->second;
+        removeFreeRange(next->first, next_count);
+        count += next_count;
+    }
+
+    if (offset + count == m_end)
+        m_end = offset;
+    else
+        addFreeRange(offset, count);
+}   // free
+
+// ----------------------------------------------------------------------------
+/** Sets the size of the buffer, it can not be made smaller than the used
+ *  part.
+ */
+void BufferAllocator::setCapacity(size_t capacity)
+{
+    assert(capacity >= m_end);
+    m_capacity = capacity;
+}   // setCapacity
+
+// ----------------------------------------------------------------------------
+/** Returns the size of the largest free range (including the free part at
+ *  the end of the buffer).
+ */
+size_t BufferAllocator::getLargestFreeRange() const
+{
+    size_t largest = m_capacity - m_end;
+    for (unsigned int i = NUM_SIZE_CLASSES; i > 0; i--)
+    {
+        if (!m_free_lists[i - 1].empty())
+        {
+            if (m_free_lists[i - 1].rbegin()->first > largest)
+                largest = m_free_lists[i - 1].rbegin()->first;
+            break;
+        }
+    }
+    return largest;
+}   // getLargestFreeRange
+
+// ----------------------------------------------------------------------------
+/** Returns the fragmentation of the free space: 0 if all free elements are
+ *  in one range, close to 1 if they are split into many small ranges.
+ */
+float BufferAllocator::getFragmentation() const
+{
+    const size_t num_free = m_capacity - m_num_used;
+    if (num_free == 0) return 0.0f;
+    return 1.0f - (float)getLargestFreeRange() / num_free;
+}   // getFragmentation
+
+// ----------------------------------------------------------------------------
+/** Tests allocation from the end and from free ranges, and merging of free
+ *  ranges.
+ */
+void BufferAllocator::unitTesting()
+{
+    BufferAllocator a;
+    size_t r = a.allocate(10);
+    assert(r == INVALID_OFFSET);
+    a.setCapacity(100);
+    size_t r0 = a.allocate(10);
+    size_t r1 = a.allocate(20);
+    size_t r2 = a.allocate(30);
+    size_t r3 = a.allocate(5);
+    assert(r0 == 0 && r1 == 10 && r2 == 30 && r3 == 60);
+    assert(a.getEnd() == 65 && a.getNumUsed() == 65);
+    r = a.allocate(40);
+    assert(r == INVALID_OFFSET);
+
+    // A freed range is reused by a smaller allocation, the rest stays free
+    a.free(r1, 20);
+    assert(a.getFragmentation() > 0.0f);
+    size_t r4 = a.allocate(15);
+    assert(r4 == 10);
+    size_t r5 = a.allocate(5);
+    assert(r5 == 25);
+    assert(a.getNumUsed() == 65);
+
+    // The smallest fitting range is used
+    a.free(r0, 10);
+    a.free(r2, 30);
+    r = a.allocate(8);
+    assert(r == 0);
+    a.free(r, 8);
+    assert(a.getNumUsed() == 25);
+
+    // Merging with both neighbours, and freeing at the end makes the used
+    // part shorter
+    a.free(r4, 15);
+    a.free(r5, 5);
+    assert(a.getLargestFreeRange() == 60);
+    a.free(r3, 5);
+    assert(a.getEnd() == 0 && a.getNumUsed() == 0);
+    assert(a.getFragmentation() == 0.0f);
+    r = a.allocate(100);
+    assert(r == 0);
+    assert(a.getLargestFreeRange() == 0);
+}   // unitTesting
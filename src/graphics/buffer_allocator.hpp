@@ -0,0 +1,91 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_BUFFER_ALLOCATOR_HPP
+#define HEADER_BUFFER_ALLOCATOR_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <map>
+#include <set>
+#include <stddef.h>
+#include <utility>
+
+/**
+  * \brief Manages the space in a buffer which is shared by many users.
+  *  The buffer is measured in elements (e.g. vertices). Ranges are taken
+  *  from the end of the used part of the buffer, or from ranges that were
+  *  freed before. Adjacent free ranges are merged, and a free range at the
+  *  end of the used part makes the used part shorter. The free ranges are
+  *  kept in free lists of size classes (powers of two), so a fitting range
+  *  is found quickly. The allocator does not own any memory, the user must
+  *  resize the actual buffer with setCapacity when allocate fails.
+  * \ingroup graphics
+  */
+class BufferAllocator : public NoCopy
+{
+public:
+    /** Returned by allocate if there is not enough space. */
+    static const size_t INVALID_OFFSET = (size_t)-1;
+
+private:
+    /** Number of size classes, class i contains free ranges with at least
+     *  2^i and less than 2^(i+1) elements. */
+    static const unsigned int NUM_SIZE_CLASSES = 8 * sizeof(size_t);
+
+    /** Size of the buffer. */
+    size_t m_capacity;
+
+    /** All elements from here to the end of the buffer are free. */
+    size_t m_end;
+
+    /** Number of allocated elements. */
+    size_t m_num_used;
+
+    /** The free ranges below m_end: offset -> number of elements. */
+    std::map<size_t, size_t> m_free_ranges;
+
+    /** The free ranges of each size class as (number of elements, offset),
+     *  so the smallest fitting range of a class is found first. */
+    std::set<std::pair<size_t, size_t> > m_free_lists[NUM_SIZE_CLASSES];
+
+    static unsigned int getSizeClass(size_t count);
+    void addFreeRange(size_t offset, size_t count);
+    void removeFreeRange(size_t offset, size_t count);
+    bool findFreeRange(size_t count, size_t *offset, size_t *range) const;
+
+public:
+           BufferAllocator();
+    size_t allocate(size_t count);
+    void   free(size_t offset, size_t count);
+    void   setCapacity(size_t capacity);
+    size_t getLargestFreeRange() const;
+    float  getFragmentation() const;
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns the size of the buffer. */
+    size_t getCapacity() const { return m_capacity; }
+    // ------------------------------------------------------------------------
+    /** Returns the end of the used part, i.e. the number of elements that
+     *  must be kept when the buffer is resized. */
+    size_t getEnd() const { return m_end; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of allocated elements. */
+    size_t getNumUsed() const { return m_num_used; }
+};   // BufferAllocator
+
+#endif
@@ -52,6 +52,7 @@ void CentralVideoSettings::init()
     hasGS = false;
     hasTextureFilterAnisotropic = false;
     hasTextureSwizzle = false;
+    hasProgramBinary = false;
 
 #if defined(USE_GLES2)
     hasBGRA = false;
@@ -196,6 +197,19 @@ void CentralVideoSettings::init()
             hasTextureSwizzle = true;
             loginfo("GLDriver", "ARB Texture Swizzle Present");
         }
+        // A driver can support the extension without supporting any binary
+        // format (e.g. old mesa versions), in which case it is useless.
+        GLint num_binary_formats = 0;
+        if (!GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_GET_PROGRAM_BINARY) &&
+            hasGLExtension("GL_ARB_get_program_binary"))
+        {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+            if (num_binary_formats > 0)
+            {
+                hasProgramBinary = true;
+                loginfo("GLDriver", "ARB Get Program Binary Present");
+            }
+        }
         // Only unset the high def textures if they are set as default. If the
         // user has enabled them (bit 1 set), then leave them enabled.
         if (GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_HIGHDEFINITION_TEXTURES) &&
@@ -260,6 +274,18 @@ void CentralVideoSettings::init()
             hasColorBufferFloat = true;
             loginfo("GLDriver", "EXT Color Buffer Float Present");
         }
+
+        GLint num_binary_formats = 0;
+        if (!GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_GET_PROGRAM_BINARY) &&
+            m_glsl == true)
+        {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+            if (num_binary_formats > 0)
+            {
+                hasProgramBinary = true;
+                loginfo("GLDriver", "Get Program Binary Present");
+            }
+        }
 #endif
     }
 }
@@ -476,4 +502,9 @@ bool CentralVideoSettings::isARBTextureSwizzleUsable() const
     return m_glsl && hasTextureSwizzle;
 }
 
+bool CentralVideoSettings::isARBGetProgramBinaryUsable() const
+{
+    return m_glsl && hasProgramBinary;
+}
+
 #endif   // !SERVER_ONLY
@@ -61,6 +61,7 @@ namespace GraphicsRestrictions
         GR_FRAMEBUFFER_SRGB_CAPABLE,
         GR_GI,
         GR_FORCE_LEGACY_DEVICE,
+        GR_GET_PROGRAM_BINARY,
         GR_COUNT  /** MUST be last entry. */
     } ;
 
@@ -162,6 +162,15 @@ IrrDriver::~IrrDriver()
 #ifndef SERVER_ONLY
     if (CVS->isGLSL())
     {
+        const Draw2DStatistics &stats = get2DStatistics();
+        if (stats.m_frames > 0)
+        {
+            loginfo("irr_driver", "2D drawing: %.1f quads in %.1f draw calls "
+                    "per frame (%d frames).",
+                    float(stats.m_total_quads) / stats.m_frames,
+                    float(stats.m_total_draws) / stats.m_frames,
+                    (int)stats.m_frames);
+        }
         Shaders::destroy();
     }
 #endif
@@ -1860,6 +1869,11 @@ void IrrDriver::update(float dt)
         m_video_driver->endScene();
     }
 
+#ifndef SERVER_ONLY
+    if (CVS->isGLSL())
+        next2DFrame();
+#endif
+
     if (m_request_screenshot) doScreenShot();
 
     // Enable this next print statement to get render information printed
@@ -416,7 +416,7 @@ public:
     // ------------------------------------------------------------------------
     u32 getRenderPass() { return m_renderpass; }
     // ------------------------------------------------------------------------
-    std::vector<LightNode *> getLights() { return m_lights; }
+    const std::vector<LightNode *>& getLights() const { return m_lights; }
     // ------------------------------------------------------------------------
     void addGlowingNode(scene::ISceneNode *n, float r = 1.0f, float g = 1.0f,
                         float b = 1.0f)
@@ -0,0 +1,167 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/light_culling.hpp"
+
+#include "utils/job_system.hpp"
+
+#include <assert.h>
+#include <cmath>
+
+/** Below this number of lights the lights are culled in the calling
+ *  thread, since distributing the work costs more than it saves. */
+static const unsigned int MIN_LIGHTS_FOR_JOBS = 256;
+
+// ----------------------------------------------------------------------------
+LightCulling::LightCulling()
+{
+    setCamera(core::vector3df(0, 0, 0), core::vector3df(0, 0, 1),
+              core::vector3df(0, 1, 0), core::PI * 0.5f, 1.0f, 1.0f, 100.0f);
+}   // LightCulling
+
+// ----------------------------------------------------------------------------
+/** Sets the camera for which the lights are culled.
+ *  \param position Position of the camera.
+ *  \param target The point the camera looks at.
+ *  \param up Up vector of the camera.
+ *  \param fov_y The vertical field of view in radians.
+ *  \param aspect Width divided by height of the viewport.
+ *  \param near_value Distance of the near plane.
+ *  \param far_value Distance of the far plane.
+ */
+void LightCulling::setCamera(const core::vector3df &position,
+                             const core::vector3df &target,
+                             const core::vector3df &up,
+                             float fov_y, float aspect, float near_value,
+                             float far_value)
+{
+    m_view.buildCameraLookAtMatrixLH(position, target, up);
+    m_near       = near_value;
+    m_far        = far_value;
+    m_tan_y      = tanf(fov_y * 0.5f);
+    m_tan_x      = m_tan_y * aspect;
+    m_inv_norm_x = 1.0f / sqrtf(1.0f + m_tan_x * m_tan_x);
+    m_inv_norm_y = 1.0f / sqrtf(1.0f + m_tan_y * m_tan_y);
+}   // setCamera
+
+// ----------------------------------------------------------------------------
+/** Removes all lights. */
+void LightCulling::clearLights()
+{
+    m_position.clear();
+    m_radius.clear();
+}   // clearLights
+
+// ----------------------------------------------------------------------------
+/** Adds a point light. Its index is the number of lights added before.
+ *  \param position Position of the light in world coordinates.
+ *  \param radius Radius of the light.
+ */
+void LightCulling::addLight(const core::vector3df &position, float radius)
+{
+    core::vector3df view_position;
+    m_view.transformVect(view_position, position);
+    m_position.push_back(view_position);
+    m_radius.push_back(radius);
+}   // addLight
+
+// ----------------------------------------------------------------------------
+/** Tests one light against the planes of the view frustum. The side planes
+ *  go through the camera, so the signed distance of the light to the right
+ *  plane is (x - tan_x * z) / |(1, -tan_x)|, and similar for the others.
+ */
+void LightCulling::cullLight(unsigned int light)
+{
+    const core::vector3df &p = m_position[light];
+    const float r = m_radius[light];
+    const float dx = p.Z * m_tan_x;
+    const float dy = p.Z * m_tan_y;
+
+    m_visible[light] = p.Z + r >= m_near && p.Z - r <= m_far             &&
+                       ( p.X - dx) * m_inv_norm_x <= r                   &&
+                       (-p.X - dx) * m_inv_norm_x <= r                   &&
+                       ( p.Y - dy) * m_inv_norm_y <= r                   &&
+                       (-p.Y - dy) * m_inv_norm_y <= r;
+}   // cullLight
+
+// ----------------------------------------------------------------------------
+/** Culls all lights. With many lights this is done in parallel by the job
+ *  system.
+ */
+void LightCulling::cull()
+{
+    const unsigned int num_lights = getNumLights();
+    m_visible.resize(num_lights);
+    if (num_lights >= MIN_LIGHTS_FOR_JOBS && JobSystem::isCreated())
+    {
+        JobSystem::get()->parallelFor((int)num_lights,
+                                      [this](int i) { cullLight(i); });
+    }
+    else
+    {
+        for (unsigned int i = 0; i < num_lights; i++)
+            cullLight(i);
+    }
+}   // cull
+
+// ----------------------------------------------------------------------------
+/** Tests the culling with a camera at the origin looking along the z axis,
+ *  with a 90 degree field of view.
+ */
+void LightCulling::unitTesting()
+{
+    LightCulling culling;
+    culling.setCamera(core::vector3df(0, 0, 0), core::vector3df(0, 0, 1),
+                      core::vector3df(0, 1, 0), core::PI * 0.5f, 1.0f,
+                      1.0f, 100.0f);
+    culling.addLight(core::vector3df(  0,    0,  10), 1.0f);  // center
+    culling.addLight(core::vector3df(  0,    0, -10), 1.0f);  // behind
+    culling.addLight(core::vector3df( 50,    0,  10), 1.0f);  // right of view
+    culling.addLight(core::vector3df(-10.5f, 0,  10), 1.0f);  // left edge
+    culling.addLight(core::vector3df(  0,    0, 200), 1.0f);  // too far
+    culling.addLight(core::vector3df(  0,    0, 0.5f), 2.0f); // at camera
+    culling.addLight(core::vector3df(  0,   12,  10), 1.0f);  // above view
+    culling.addLight(core::vector3df(  0,    0, 100.5f), 1.0f); // far edge
+    culling.cull();
+
+    assert( culling.isVisible(0));
+    assert(!culling.isVisible(1));
+    assert(!culling.isVisible(2));
+    assert( culling.isVisible(3));
+    assert(!culling.isVisible(4));
+    assert( culling.isVisible(5));
+    assert(!culling.isVisible(6));
+    assert( culling.isVisible(7));
+
+    // Lights added after culling are culled by the next cull()
+    culling.clearLights();
+    culling.addLight(core::vector3df(0, 0, -10), 1.0f);
+    culling.addLight(core::vector3df(0, 0,  10), 1.0f);
+    culling.cull();
+    assert(!culling.isVisible(0));
+    assert( culling.isVisible(1));
+
+    // Many lights are culled by the job system (if it exists), with the
+    // same result
+    culling.clearLights();
+    for (unsigned int i = 0; i < 2 * MIN_LIGHTS_FOR_JOBS; i++)
+        culling.addLight(core::vector3df(0, 0, i % 2 ? 10.0f : -10.0f), 1.0f);
+    culling.cull();
+    for (unsigned int i = 0; i < culling.getNumLights(); i++)
+        assert(culling.isVisible(i) == (i % 2 == 1));
+}   // unitTesting
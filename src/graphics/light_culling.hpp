@@ -0,0 +1,92 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_LIGHT_CULLING_HPP
+#define HEADER_LIGHT_CULLING_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <matrix4.h>
+#include <vector3d.h>
+#include <vector>
+
+using namespace irr;
+
+/**
+  * \brief Finds the point lights that can be seen from a camera.
+  *  Each point light is a sphere, which is tested against the six planes
+  *  of the view frustum of the camera (the test is conservative, i.e. a
+  *  sphere close to a corner of the frustum might be considered visible).
+  *  The deferred renderer draws one volume per light, so this is all that
+  *  is needed to skip the lights that do not affect the image.
+  *  This class only needs the camera parameters and does not use OpenGL,
+  *  so it can be used (and tested) without a GPU.
+  * \ingroup graphics
+  */
+class LightCulling : public NoCopy
+{
+private:
+    /** Transforms world coordinates into view space. */
+    core::matrix4 m_view;
+
+    /** Near and far value of the camera. */
+    float m_near, m_far;
+
+    /** Tangens of half the horizontal and vertical field of view, and
+     *  1/length of the normals of the side planes. */
+    float m_tan_x, m_inv_norm_x;
+    float m_tan_y, m_inv_norm_y;
+
+    /** View space position and radius of all lights. */
+    std::vector<core::vector3df> m_position;
+    std::vector<float> m_radius;
+
+    /** 1 if the light touches the view frustum, 0 otherwise. A byte per
+     *  light (and not std::vector<bool>) so that lights can be culled in
+     *  parallel. */
+    std::vector<uint8_t> m_visible;
+
+    void cullLight(unsigned int light);
+
+public:
+         LightCulling();
+    void setCamera(const core::vector3df &position,
+                   const core::vector3df &target, const core::vector3df &up,
+                   float fov_y, float aspect, float near_value,
+                   float far_value);
+    void clearLights();
+    void addLight(const core::vector3df &position, float radius);
+    void cull();
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns the number of lights added. */
+    unsigned int getNumLights() const
+    {
+        return (unsigned int)m_radius.size();
+    }   // getNumLights
+    // ------------------------------------------------------------------------
+    /** Returns true if the light touches the view frustum, i.e. it can be
+     *  seen from the camera. Only valid after cull(). */
+    bool isVisible(unsigned int light) const
+    {
+        return m_visible[light] != 0;
+    }   // isVisible
+};   // LightCulling
+
+#endif
@@ -31,6 +31,8 @@
 #include "tracks/track.hpp"
 #include "utils/profiler.hpp"
 
+#include <algorithm>
+
 class LightBaseClass
 {
 public:
@@ -471,12 +473,17 @@ void LightingPasses::renderSunlight(const core::vector3df &direction,
 void LightingPasses::updateLightsInfo(scene::ICameraSceneNode * const camnode,
                                       float dt)
 {
-    std::vector<LightNode *> lights = irr_driver->getLights();
-    const u32 lightcount = (u32)lights.size();
+    const std::vector<LightNode *> &lights = irr_driver->getLights();
     const core::vector3df &campos = camnode->getAbsolutePosition();
 
-    std::vector<LightNode *> BucketedLN[15];
-    for (unsigned int i = 0; i < lightcount; i++)
+    m_light_culling.setCamera(campos, camnode->getTarget(),
+                              camnode->getUpVector(), camnode->getFOV(),
+                              camnode->getAspectRatio(),
+                              camnode->getNearValue(),
+                              camnode->getFarValue());
+    m_light_culling.clearLights();
+    m_point_lights.clear();
+    for (unsigned int i = 0; i < lights.size(); i++)
     {
         if (!lights[i]->isVisible())
             continue;
@@ -486,66 +493,75 @@ void LightingPasses::updateLightsInfo(scene::ICameraSceneNode * const camnode,
             lights[i]->render();
             continue;
         }
-        const core::vector3df &lightpos =
-                                 (lights[i]->getAbsolutePosition() - campos);
-        unsigned idx = (unsigned)(lightpos.getLength() / 10);
-        if (idx > 14)
-            idx = 14;
-        BucketedLN[idx].push_back(lights[i]);
+        m_point_lights.push_back(lights[i]);
+        m_light_culling.addLight(lights[i]->getAbsolutePosition(),
+                                 lights[i]->getRadius());
     }
+    m_light_culling.cull();
 
-    m_point_light_count = 0;
-    bool multiplayer = (race_manager->getNumLocalPlayers() > 1);
+    // Lights outside of the view frustum are not rendered, so they don't
+    // take the place of visible lights if there are too many lights.
+    m_lights_by_distance.clear();
+    for (unsigned int i = 0; i < m_point_lights.size(); i++)
+    {
+        if (!m_light_culling.isVisible(i))
+            continue;
+        float d2 = (m_point_lights[i]->getAbsolutePosition() - campos)
+                 .getLengthSQ();
+        m_lights_by_distance.push_back(std::make_pair(d2, i));
+    }
 
-    for (unsigned i = 0; i < 15; i++)
+    // If there are too many lights, only keep the closest ones
+    irr_driver->setLastLightBucketDistance(0);
+    if (m_lights_by_distance.size() > LightBaseClass::MAXLIGHT)
     {
-        for (unsigned j = 0; j < BucketedLN[i].size(); j++)
+        std::nth_element(m_lights_by_distance.begin(),
+                         m_lights_by_distance.begin()
+                                             + LightBaseClass::MAXLIGHT,
+                         m_lights_by_distance.end());
+        for (unsigned int i = LightBaseClass::MAXLIGHT;
+             i < m_lights_by_distance.size(); i++)
         {
-            if (++m_point_light_count >= LightBaseClass::MAXLIGHT)
-            {
-                LightNode* light_node = BucketedLN[i].at(j);
-                light_node->setEnergyMultiplier(0.0f);
-            }
-            else
-            {
-                LightNode* light_node = BucketedLN[i].at(j);
-
-                float em = light_node->getEnergyMultiplier();
-                if (em < 1.0f)
-                {
-                    // In single-player, fade-in lights.
-                    // In multi-player, can't do that, the light objects are shared by all players
-                    if (multiplayer)
-                        light_node->setEnergyMultiplier(1.0f);
-                    else
-                        light_node->setEnergyMultiplier(std::min(1.0f, em + dt));
-                }
-
-                const core::vector3df &pos = light_node->getAbsolutePosition();
-                m_point_lights_info[m_point_light_count].posX = pos.X;
-                m_point_lights_info[m_point_light_count].posY = pos.Y;
-                m_point_lights_info[m_point_light_count].posZ = pos.Z;
-
-                m_point_lights_info[m_point_light_count].energy =
-                                              light_node->getEffectiveEnergy();
-
-                const core::vector3df &col = light_node->getColor();
-                m_point_lights_info[m_point_light_count].red = col.X;
-                m_point_lights_info[m_point_light_count].green = col.Y;
-                m_point_lights_info[m_point_light_count].blue = col.Z;
-
-                // Light radius
-                m_point_lights_info[m_point_light_count].radius = light_node->getRadius();
-            }
+            m_point_lights[m_lights_by_distance[i].second]
+                ->setEnergyMultiplier(0.0f);
         }
-        if (m_point_light_count > LightBaseClass::MAXLIGHT)
+        irr_driver->setLastLightBucketDistance((unsigned)sqrtf(
+                 m_lights_by_distance[LightBaseClass::MAXLIGHT].first));
+        m_lights_by_distance.resize(LightBaseClass::MAXLIGHT);
+    }
+
+    bool multiplayer = (race_manager->getNumLocalPlayers() > 1);
+    m_point_light_count = (unsigned)m_lights_by_distance.size();
+    for (unsigned int i = 0; i < m_point_light_count; i++)
+    {
+        LightNode* light_node = m_point_lights[m_lights_by_distance[i].second];
+
+        float em = light_node->getEnergyMultiplier();
+        if (em < 1.0f)
         {
-            irr_driver->setLastLightBucketDistance(i * 10);
-            break;
+            // In single-player, fade-in lights.
+            // In multi-player, can't do that, the light objects are shared by all players
+            if (multiplayer)
+                light_node->setEnergyMultiplier(1.0f);
+            else
+                light_node->setEnergyMultiplier(std::min(1.0f, em + dt));
         }
-    }
 
-    m_point_light_count++;
+        const core::vector3df &pos = light_node->getAbsolutePosition();
+        m_point_lights_info[i].posX = pos.X;
+        m_point_lights_info[i].posY = pos.Y;
+        m_point_lights_info[i].posZ = pos.Z;
+
+        m_point_lights_info[i].energy = light_node->getEffectiveEnergy();
+
+        const core::vector3df &col = light_node->getColor();
+        m_point_lights_info[i].red = col.X;
+        m_point_lights_info[i].green = col.Y;
+        m_point_lights_info[i].blue = col.Z;
+
+        // Light radius
+        m_point_lights_info[i].radius = light_node->getRadius();
+    }
 }   // updateLightsInfo
 
 // ----------------------------------------------------------------------------
@@ -19,9 +19,13 @@
 #define HEADER_LIGHTING_PASSES_HPP
 
 #include "graphics/gl_headers.hpp"
+#include "graphics/light_culling.hpp"
 #include <irrlicht.h>
+#include <utility>
+#include <vector>
 
 class FrameBuffer;
+class LightNode;
 class PostProcessing;
 class ShadowMatrices;
 
@@ -32,6 +36,17 @@ class LightingPasses
 private:
     unsigned m_point_light_count;
 
+    /** Culls the point lights against the view frustum of the camera, so
+     *  that lights which cannot be seen are skipped. */
+    LightCulling m_light_culling;
+
+    /** The visible point lights of the current camera. */
+    std::vector<LightNode*> m_point_lights;
+
+    /** Squared distance to the camera and index in m_point_lights of all
+     *  lights in the view frustum. */
+    std::vector<std::pair<float, unsigned int> > m_lights_by_distance;
+
     void renderEnvMap(GLuint normal_depth_texture,
                       GLuint depth_stencil_texture,
                       GLuint specular_probe);
@@ -0,0 +1,341 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef SERVER_ONLY
+
+#include "graphics/program_binary_cache.hpp"
+
+#include "config/user_config.hpp"
+#include "graphics/central_settings.hpp"
+#include "io/file_manager.hpp"
+#include "utils/log.hpp"
+
+#include <assert.h>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+/** The header of a cached program binary. */
+struct CachedProgramHeader
+{
+    char     m_magic[8];
+    uint64_t m_driver_hash;
+    uint64_t m_source_hash;
+    uint32_t m_format;
+    uint32_t m_size;
+};   // CachedProgramHeader
+
+static const char CACHED_PROGRAM_MAGIC[8] = "STKPRG1";
+
+/** Binaries are never that big, a larger size means a broken file. */
+static const uint32_t MAX_PROGRAM_BINARY_SIZE = 64 * 1024 * 1024;
+
+// ----------------------------------------------------------------------------
+/** Enables the cache if the driver supports program binaries and the cached
+ *  shaders directory exists, and computes the hash of the driver.
+ */
+ProgramBinaryCache::ProgramBinaryCache()
+{
+    m_driver_hash  = 0;
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    if (!UserConfigParams::m_cache_shaders ||
+        !CVS->isARBGetProgramBinaryUsable()  ||
+        file_manager->getCachedShadersDir().empty())
+        return;
+
+    std::ostringstream driver;
+    driver << glGetString(GL_VENDOR) << "\n" << glGetString(GL_RENDERER)
+           << "\n" << glGetString(GL_VERSION) << "\n"
+           << glGetString(GL_SHADING_LANGUAGE_VERSION) << "\n"
+           << CVS->getGLSLVersion();
+    const std::string &s = driver.str();
+    m_driver_hash = hash(s.c_str(), s.size());
+    m_directory   = file_manager->getCachedShadersDir();
+}   // ProgramBinaryCache
+
+// ----------------------------------------------------------------------------
+ProgramBinaryCache::~ProgramBinaryCache()
+{
+    if (isEnabled())
+    {
+        loginfo("ProgramBinaryCache", "%d programs loaded from the cache, "
+                "%d programs added (%d not cached, %d outdated), %d binaries "
+                "rejected by the driver.", m_statistics.m_num_loaded,
+                m_statistics.m_num_saved, m_statistics.m_num_missing,
+                m_statistics.m_num_outdated, m_statistics.m_num_rejected);
+    }
+}   // ~ProgramBinaryCache
+
+// ----------------------------------------------------------------------------
+/** Returns the name of the cache file of a program.
+ *  \param program_hash Hash of the names of the shaders of the program.
+ */
+std::string ProgramBinaryCache::getFileName(uint64_t program_hash) const
+{
+    std::ostringstream oss;
+    oss << m_directory << std::hex << program_hash << ".bin";
+    return oss.str();
+}   // getFileName
+
+// ----------------------------------------------------------------------------
+/** Reads a program binary from a cache file.
+ *  \param name Name of the cache file.
+ *  \param driver_hash Hash of the current driver.
+ *  \param source_hash Hash of the current source code of the program.
+ *  \param format On return the format of the binary.
+ *  \param binary On return the binary.
+ *  \return READ_OK if the file exists, is valid and was created by the same
+ *          driver from the same source code, otherwise the reason why the
+ *          file can not be used.
+ */
+ProgramBinaryCache::ReadResult
+    ProgramBinaryCache::readBinary(const std::string &name,
+                                   uint64_t driver_hash,
+                                   uint64_t source_hash, GLenum *format,
+                                   std::vector<char> *binary)
+{
+    FILE *file = fopen(name.c_str(), "rb");
+    if (!file) return READ_MISSING;
+
+    CachedProgramHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1          &&
+              memcmp(header.m_magic, CACHED_PROGRAM_MAGIC, 8) == 0  &&
+              header.m_size > 0                                     &&
+              header.m_size <= MAX_PROGRAM_BINARY_SIZE;
+    // An outdated file is not an error, it is replaced once the program
+    // is linked again.
+    const bool up_to_date = ok && header.m_driver_hash == driver_hash &&
+                            header.m_source_hash == source_hash;
+    if (up_to_date)
+    {
+        binary->resize(header.m_size);
+        ok = fread(binary->data(), header.m_size, 1, file) == 1;
+    }
+    fclose(file);
+    if (!ok)
+    {
+        binary->clear();
+        logwarn("ProgramBinaryCache", "Ignoring invalid cached program '%s'.",
+                name.c_str());
+        return READ_INVALID;
+    }
+    if (!up_to_date)
+        return READ_OUTDATED;
+    *format = header.m_format;
+    return READ_OK;
+}   // readBinary
+
+// ----------------------------------------------------------------------------
+/** Looks up a program binary in the cache, and counts the reason if it can
+ *  not be used.
+ *  \param name Name of the cache file.
+ *  \param driver_hash Hash of the current driver.
+ *  \param source_hash Hash of the current source code of the program.
+ *  \param format On return the format of the binary.
+ *  \param binary On return the binary.
+ *  \param statistics The statistics to update.
+ *  \return True if a binary for this driver and source code was found.
+ */
+bool ProgramBinaryCache::findBinary(const std::string &name,
+                                    uint64_t driver_hash,
+                                    uint64_t source_hash, GLenum *format,
+                                    std::vector<char> *binary,
+                                    Statistics *statistics)
+{
+    switch (readBinary(name, driver_hash, source_hash, format, binary))
+    {
+    case READ_OK:       return true;
+    case READ_MISSING:  statistics->m_num_missing++;  break;
+    case READ_OUTDATED: statistics->m_num_outdated++; break;
+    case READ_INVALID:  break;
+    }
+    return false;
+}   // findBinary
+
+// ----------------------------------------------------------------------------
+/** Writes a program binary to a cache file. The data is written to a
+ *  temporary file first, so that an incomplete cache file is never used.
+ *  \param name Name of the cache file.
+ *  \param driver_hash Hash of the current driver.
+ *  \param source_hash Hash of the source code of the program.
+ *  \param format Format of the binary.
+ *  \param binary The binary.
+ *  \return True if the file was written.
+ */
+bool ProgramBinaryCache::writeBinary(const std::string &name,
+                                     uint64_t driver_hash,
+                                     uint64_t source_hash, GLenum format,
+                                     const std::vector<char> &binary)
+{
+    CachedProgramHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, CACHED_PROGRAM_MAGIC, 8);
+    header.m_driver_hash = driver_hash;
+    header.m_source_hash = source_hash;
+    header.m_format      = format;
+    header.m_size        = (uint32_t)binary.size();
+
+    const std::string tmp_name = name + ".tmp";
+    FILE *file = fopen(tmp_name.c_str(), "wb");
+    if (!file)
+    {
+        logwarn("ProgramBinaryCache", "Can not write cached program '%s'.",
+                name.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(binary.data(), binary.size(), 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    // rename does not replace an existing file on windows
+    remove(name.c_str());
+    if (!ok || rename(tmp_name.c_str(), name.c_str()) != 0)
+    {
+        remove(tmp_name.c_str());
+        logwarn("ProgramBinaryCache", "Can not write cached program '%s'.",
+                name.c_str());
+        return false;
+    }
+    return true;
+}   // writeBinary
+
+// ----------------------------------------------------------------------------
+/** Tries to load a program from the cache.
+ *  \param program The (empty) program object.
+ *  \param name Name of the cache file.
+ *  \param source_hash Hash of the source code of the program.
+ *  \return True if the program was loaded and is linked. If false is
+ *          returned, the program object must not be used anymore, since the
+ *          driver might have rejected the binary.
+ */
+bool ProgramBinaryCache::loadProgram(GLuint program, const std::string &name,
+                                     uint64_t source_hash)
+{
+    GLenum format;
+    std::vector<char> binary;
+    if (!findBinary(name, m_driver_hash, source_hash, &format, &binary,
+                    &m_statistics))
+        return false;
+
+    glProgramBinary(program, format, binary.data(), (GLsizei)binary.size());
+    GLint result = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &result);
+    glGetError();
+    if (result == GL_FALSE)
+    {
+        // Some drivers reject their own binaries, e.g. if an internal
+        // state changed. Compiling the program again fixes the cache.
+        logwarn("ProgramBinaryCache", "The driver rejected the cached "
+                "program '%s', compiling the shaders.", name.c_str());
+        remove(name.c_str());
+        m_statistics.m_num_rejected++;
+        return false;
+    }
+    m_statistics.m_num_loaded++;
+    return true;
+}   // loadProgram
+
+// ----------------------------------------------------------------------------
+/** Saves a linked program in the cache. The program must have been linked
+ *  with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+ *  \param program The linked program.
+ *  \param name Name of the cache file.
+ *  \param source_hash Hash of the source code of the program.
+ */
+void ProgramBinaryCache::saveProgram(GLuint program, const std::string &name,
+                                     uint64_t source_hash)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        glGetError();
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format   = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (glGetError() != GL_NO_ERROR || written <= 0)
+        return;
+    binary.resize(written);
+    if (writeBinary(name, m_driver_hash, source_hash, format, binary))
+        m_statistics.m_num_saved++;
+}   // saveProgram
+
+// ----------------------------------------------------------------------------
+/** Tests the cache files in a temporary directory (which does not need a GL
+ *  context): a program that is not in the cache is a miss, a cached binary
+ *  is only used if driver and source code are the same, and a binary of
+ *  another driver is rejected.
+ */
+void ProgramBinaryCache::unitTesting()
+{
+    const std::string dir =
+        file_manager->createTemporaryDirectory("stk-program-cache");
+    if (dir.empty()) return;
+    const std::string name = dir + "unit-test.bin";
+
+    std::vector<char> binary;
+    for (unsigned int i = 0; i < 1000; i++)
+        binary.push_back((char)(i * 7));
+
+    Statistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+    GLenum format = 0;
+    std::vector<char> result;
+
+    // Miss: the program is not cached yet
+    assert(!findBinary(name, 1, 2, &format, &result, &statistics));
+    assert(statistics.m_num_missing == 1 && statistics.m_num_outdated == 0);
+
+    // Hit: same driver and same source code
+    assert(writeBinary(name, 1, 2, 0x1234, binary));
+    assert(findBinary(name, 1, 2, &format, &result, &statistics));
+    assert(format == 0x1234);
+    assert(result == binary);
+
+    // Reject: the binary was created by another driver, or from other
+    // source code
+    assert(!findBinary(name, 3, 2, &format, &result, &statistics));
+    assert(statistics.m_num_outdated == 1);
+    assert(!findBinary(name, 1, 3, &format, &result, &statistics));
+    assert(statistics.m_num_outdated == 2);
+    assert(statistics.m_num_missing == 1);
+
+    // The other driver replaces the file, which is then rejected for the
+    // first driver
+    assert(writeBinary(name, 3, 2, 0x5678, binary));
+    assert(findBinary(name, 3, 2, &format, &result, &statistics));
+    assert(format == 0x5678);
+    assert(!findBinary(name, 1, 2, &format, &result, &statistics));
+    assert(statistics.m_num_outdated == 3);
+
+    // A truncated file is ignored, but not counted as outdated
+    FILE *file = fopen(name.c_str(), "wb");
+    assert(file);
+    fwrite(CACHED_PROGRAM_MAGIC, 8, 1, file);
+    fclose(file);
+    assert(!findBinary(name, 3, 2, &format, &result, &statistics));
+    assert(statistics.m_num_outdated == 3 && statistics.m_num_missing == 1);
+    (void)format;   // avoid compiler warning with NDEBUG
+
+    remove(name.c_str());
+    file_manager->removeDirectory(dir);
+}   // unitTesting
+
+#endif   // !SERVER_ONLY
@@ -0,0 +1,112 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef SERVER_ONLY
+
+#ifndef HEADER_PROGRAM_BINARY_CACHE_HPP
+#define HEADER_PROGRAM_BINARY_CACHE_HPP
+
+#include "graphics/gl_headers.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/hash.hpp"
+#include "utils/singleton.hpp"
+#include "utils/types.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+  * \brief Caches linked shader programs on disk.
+  *  If the driver supports GL_ARB_get_program_binary, the binary of each
+  *  linked program is saved in the cached shaders directory, and loaded with
+  *  glProgramBinary at the next start instead of compiling and linking the
+  *  shaders again. The name of a cache file is a hash of the program (i.e.
+  *  the names of its shaders). Each file stores a hash of the driver (vendor,
+  *  renderer, version and GLSL version) and a hash of the complete source
+  *  code of all shaders (which includes all defines), so a binary is not
+  *  used after a driver update or a change of the shaders or the graphics
+  *  settings, and is replaced when the program is linked again. If the
+  *  driver rejects a binary, the file is removed and the program is compiled
+  *  from source.
+  * \ingroup graphics
+  */
+class ProgramBinaryCache : public Singleton<ProgramBinaryCache>, NoCopy
+{
+private:
+    /** The directory of the cache files, or "" if the cache is disabled. */
+    std::string  m_directory;
+
+    /** Hash of the driver strings, binaries of other drivers are ignored. */
+    uint64_t     m_driver_hash;
+
+    /** Statistics, printed when the cache is deleted. */
+    struct Statistics
+    {
+        /** Programs that were loaded from the cache. */
+        unsigned int m_num_loaded;
+        /** Programs that were added to the cache. */
+        unsigned int m_num_saved;
+        /** Binaries that were rejected by the driver. */
+        unsigned int m_num_rejected;
+        /** Programs that were not in the cache. */
+        unsigned int m_num_missing;
+        /** Cache files of another driver or other source code. */
+        unsigned int m_num_outdated;
+    };   // Statistics
+    Statistics   m_statistics;
+
+    /** The result of reading a cache file. */
+    enum ReadResult { READ_OK, READ_MISSING, READ_OUTDATED, READ_INVALID };
+
+    static ReadResult readBinary(const std::string &name,
+                                 uint64_t driver_hash, uint64_t source_hash,
+                                 GLenum *format, std::vector<char> *binary);
+    static bool findBinary(const std::string &name, uint64_t driver_hash,
+                           uint64_t source_hash, GLenum *format,
+                           std::vector<char> *binary,
+                           Statistics *statistics);
+    static bool writeBinary(const std::string &name, uint64_t driver_hash,
+                            uint64_t source_hash, GLenum format,
+                            const std::vector<char> &binary);
+
+public:
+                ProgramBinaryCache();
+               ~ProgramBinaryCache();
+    std::string getFileName(uint64_t program_hash) const;
+    bool        loadProgram(GLuint program, const std::string &name,
+                            uint64_t source_hash);
+    void        saveProgram(GLuint program, const std::string &name,
+                            uint64_t source_hash);
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns true if programs are cached. */
+    bool isEnabled() const { return !m_directory.empty(); }
+    // ------------------------------------------------------------------------
+    /** Adds data to the hash that identifies a program.
+     *  \param data The data to add.
+     *  \param size Number of bytes.
+     *  \param previous The hash of the previous data. */
+    static uint64_t hash(const void *data, size_t size,
+                         uint64_t previous = Hash::FNV_OFFSET_BASIS)
+    {
+        return Hash::fnv1a(data, size, previous);
+    }   // hash
+};   // ProgramBinaryCache
+
+#endif
+
+#endif   // !SERVER_ONLY
@@ -123,6 +123,8 @@ GL3RenderTarget::~GL3RenderTarget()
 void GL3RenderTarget::renderToTexture(irr::scene::ICameraSceneNode* camera,
                                       float dt)
 {
+    // Draw pending 2D quads before the render target is bound
+    flush2DBatch();
     m_frame_buffer = NULL;
     m_renderer->setRTT(m_rtts);
     m_renderer->renderToTexture(this, camera, dt);
@@ -145,6 +147,8 @@ void GL3RenderTarget::draw2DImage(const irr::core::rect<s32>& dest_rect,
     assert(m_frame_buffer != NULL);
     irr::core::rect<s32> source_rect(0, 0, m_frame_buffer->getWidth(),
                                      m_frame_buffer->getHeight());
+    // Pending 2D quads must not be drawn with sRGB conversion
+    flush2DBatch();
     glEnable(GL_FRAMEBUFFER_SRGB);
     draw2DImageFromRTT(m_frame_buffer->getRTT()[0],
                        m_frame_buffer->getWidth(), m_frame_buffer->getHeight(),
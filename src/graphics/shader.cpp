@@ -20,12 +20,14 @@
 
 #include "graphics/shader.hpp"
 #include "graphics/irr_driver.hpp"
+#include "graphics/program_binary_cache.hpp"
 #include "graphics/spherical_harmonics.hpp"
 #include "utils/log.hpp"
 
 #include <fstream>
 #include <sstream>
 #include <stdio.h>
+#include <string.h>
 
 std::vector<void(*)()>  ShaderBase::m_all_kill_functions;
 
@@ -37,34 +39,114 @@ int ShaderBase::loadTFBProgram(const std::string &shader_name,
                                const char **varyings,
                                unsigned varying_count)
 {
-    m_program = glCreateProgram();
-    loadAndAttachShader(GL_VERTEX_SHADER, shader_name);
+    std::vector<ShaderFile> files;
+    files.push_back(ShaderFile(GL_VERTEX_SHADER, shader_name));
 #ifdef USE_GLES2
-    loadAndAttachShader(GL_FRAGMENT_SHADER, "tfb_dummy.frag");
+    files.push_back(ShaderFile(GL_FRAGMENT_SHADER, "tfb_dummy.frag"));
 #endif
-    if (!CVS->isARBExplicitAttribLocationUsable())
-        setAttribute(PARTICLES_SIM);
+    linkProgram(PARTICLES_SIM, files, varyings, varying_count);
+    return m_program;
+}   // loadTFBProgram
+
+// ----------------------------------------------------------------------------
+/** Creates the program from a list of shader files and links it. If the
+ *  same program was linked before with the same driver, it is loaded from
+ *  the program binary cache instead, so the shaders are not compiled.
+ *  \param type Used to bind the attribute locations if explicit attribute
+ *         locations are not supported.
+ *  \param files Type and file name of each shader.
+ *  \param varyings The transform feedback varyings, or NULL.
+ *  \param varying_count Number of transform feedback varyings.
+ */
+void ShaderBase::linkProgram(AttributeType type,
+                             const std::vector<ShaderFile> &files,
+                             const char **varyings, unsigned varying_count)
+{
+    ShaderFilesManager *sfm   = ShaderFilesManager::getInstance();
+    ProgramBinaryCache *cache = ProgramBinaryCache::getInstance();
+    m_program = glCreateProgram();
+
+    std::string cache_name;
+    uint64_t source_hash = 0;
+    if (cache->isEnabled())
+    {
+        // The cache file is determined by everything that is passed to the
+        // linker, the binary depends additionally on the complete source.
+        uint64_t program_hash = ProgramBinaryCache::hash(&type, sizeof(type));
+        for (unsigned int i = 0; i < files.size(); i++)
+        {
+            program_hash = ProgramBinaryCache::hash(&files[i].first,
+                                                    sizeof(GLint),
+                                                    program_hash);
+            program_hash = ProgramBinaryCache::hash(files[i].second.c_str(),
+                                                    files[i].second.size()+1,
+                                                    program_hash);
+        }
+        for (unsigned int i = 0; i < varying_count; i++)
+        {
+            program_hash = ProgramBinaryCache::hash(varyings[i],
+                                                    strlen(varyings[i]) + 1,
+                                                    program_hash);
+        }
+        source_hash = program_hash;
+        for (unsigned int i = 0; i < files.size(); i++)
+        {
+            uint64_t hash = sfm->getShaderHash(files[i].second,
+                                               files[i].first);
+            source_hash = ProgramBinaryCache::hash(&hash, sizeof(hash),
+                                                   source_hash);
+        }
+        cache_name = cache->getFileName(program_hash);
+        if (cache->loadProgram(m_program, cache_name, source_hash))
+            return;
+        glDeleteProgram(m_program);
+        m_program = glCreateProgram();
+    }
 
-    glTransformFeedbackVaryings(m_program, varying_count, varyings,
-                               GL_INTERLEAVED_ATTRIBS);
+    for (unsigned int i = 0; i < files.size(); i++)
+    {
+        GLint shader_id = sfm->getShaderFile(files[i].second, files[i].first);
+        glAttachShader(m_program, shader_id);
+        GLint is_deleted = GL_TRUE;
+        glGetShaderiv(shader_id, GL_DELETE_STATUS, &is_deleted);
+        if (is_deleted == GL_FALSE)
+            glDeleteShader(shader_id);
+    }
+    if (!CVS->isARBExplicitAttribLocationUsable())
+        setAttribute(type);
+    if (varying_count > 0)
+    {
+        glTransformFeedbackVaryings(m_program, varying_count, varyings,
+                                    GL_INTERLEAVED_ATTRIBS);
+    }
+    if (cache->isEnabled())
+    {
+        glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                            GL_TRUE);
+    }
     glLinkProgram(m_program);
 
     GLint result = GL_FALSE;
     glGetProgramiv(m_program, GL_LINK_STATUS, &result);
     if (result == GL_FALSE)
     {
-        int info_log_length;
-        glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &info_log_length);
-        char *error_message = new char[info_log_length];
-        glGetProgramInfoLog(m_program, info_log_length, NULL, error_message);
-        logerror("s","ShaderBase", error_message);
+        int info_length;
+        logerror("Shader", "Error when linking these shaders :");
+        for (unsigned int i = 0; i < files.size(); i++)
+            logerror("Shader", "%s", files[i].second.c_str());
+        glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &info_length);
+        char *error_message = new char[info_length];
+        glGetProgramInfoLog(m_program, info_length, NULL, error_message);
+        logerror("Shader", "%s", error_message);
         delete[] error_message;
     }
+    else if (cache->isEnabled())
+    {
+        cache->saveProgram(m_program, cache_name, source_hash);
+    }
 
     glGetError();
-
-    return m_program;
-}   // loadTFBProgram
+}   // linkProgram
 
 // ----------------------------------------------------------------------------
 void ShaderBase::bypassUBO() const
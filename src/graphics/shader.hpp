@@ -53,6 +53,9 @@ protected:
         SKINNED_MESH,
     };   // AttributeType
 
+    /** The type and the file name of a shader. */
+    typedef std::pair<GLint, std::string> ShaderFile;
+
     /** OpenGL's program id. */
     GLuint m_program;
 
@@ -60,35 +63,33 @@ protected:
 
     // ========================================================================
     /** Ends recursion. */
-    template<typename ... Types>
-    void loadAndAttachShader()
+    void collectShaderFiles(std::vector<ShaderFile> *files)
     {
         return;
-    }   // loadAndAttachShader
+    }   // collectShaderFiles
     // ------------------------------------------------------------------------
     template<typename ... Types>
-    void loadAndAttachShader(GLint shader_type, const std::string &name,
-                             Types ... args)
+    void collectShaderFiles(std::vector<ShaderFile> *files,
+                            GLint shader_type, const std::string &name,
+                            Types ... args)
     {
-        GLint shader_id = ShaderFilesManager::getInstance()
-            ->getShaderFile(name, shader_type);
-        glAttachShader(m_program, shader_id);
-        GLint is_deleted = GL_TRUE;
-        glGetShaderiv(shader_id, GL_DELETE_STATUS, &is_deleted);
-        if (is_deleted == GL_FALSE)
-            glDeleteShader(shader_id);
-        loadAndAttachShader(args...);
-    }   // loadAndAttachShader
+        files->push_back(ShaderFile(shader_type, name));
+        collectShaderFiles(files, args...);
+    }   // collectShaderFiles
     // ------------------------------------------------------------------------
     /** Convenience interface using const char. */
     template<typename ... Types>
-    void loadAndAttachShader(GLint shader_type, const char *name,
-                             Types ... args)
+    void collectShaderFiles(std::vector<ShaderFile> *files,
+                            GLint shader_type, const char *name,
+                            Types ... args)
     {
-        loadAndAttachShader(shader_type, std::string(name), args...);
-    }   // loadAndAttachShader
+        collectShaderFiles(files, shader_type, std::string(name), args...);
+    }   // collectShaderFiles
     // ------------------------------------------------------------------------
     void setAttribute(AttributeType type);
+    void linkProgram(AttributeType type, const std::vector<ShaderFile> &files,
+                     const char **varyings = NULL,
+                     unsigned varying_count = 0);
 
 public:
         ShaderBase();
@@ -267,31 +268,6 @@ private:
     }   // setUniformsImpl
 
 
-    // printFileList: Variadic template for printing a list of shader filenames
-    // ========================================================================
-    /** Variadic template to print a list of file names.
-    *  \param shader_type Ignored (used since the variadic calling function
-    *         has this parameter).
-    *  \param filepath Name of the file to print.
-    */
-protected:
-    template<typename ...Types>
-    void printFileList(GLint shader_type, const char *filepath, Types ... args)
-    {
-        logerror("S","shader", filepath);
-        printFileList(args...);
-    }   // printFileList
-
-    // ------------------------------------------------------------------------
-    /** End recursion for variadic template. */
-private:
-    template<typename ...Types>
-    void printFileList()
-    {
-        return;
-    }   // printFileList
-
-
     // Variadic template implementation of assignTextureUnit
     // ========================================================================
 public:
@@ -347,24 +323,9 @@ public:
     template<typename ... Types>
     void loadProgram(AttributeType type, Types ... args)
     {
-        m_program = glCreateProgram();
-        loadAndAttachShader(args...);
-        if (!CVS->isARBExplicitAttribLocationUsable())
-            setAttribute(type);
-        glLinkProgram(m_program);
-
-        GLint Result = GL_FALSE;
-        glGetProgramiv(m_program, GL_LINK_STATUS, &Result);
-        if (Result == GL_FALSE) {
-            int info_length;
-            logerror("Shader", "Error when linking these shaders :");
-            printFileList(args...);
-            glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &info_length);
-            char *error_message = new char[info_length];
-            glGetProgramInfoLog(m_program, info_length, NULL, error_message);
-            logerror("s","Shader", error_message);
-            delete[] error_message;
-        }
+        std::vector<ShaderFile> files;
+        collectShaderFiles(&files, args...);
+        linkProgram(type, files);
     }   // loadProgram
 
     // ------------------------------------------------------------------------
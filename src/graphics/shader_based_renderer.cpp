@@ -20,6 +20,7 @@
 #include "graphics/shader_based_renderer.hpp"
 
 #include "config/user_config.hpp"
+#include "graphics/2dutils.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/central_settings.hpp"
 #include "graphics/draw_policies.hpp"
@@ -29,12 +30,14 @@
 #include "graphics/irr_driver.hpp"
 #include "graphics/lod_node.hpp"
 #include "graphics/post_processing.hpp"
+#include "graphics/program_binary_cache.hpp"
 #include "graphics/render_target.hpp"
 #include "graphics/rtts.hpp"
 #include "graphics/shaders.hpp"
 #include "graphics/skybox.hpp"
 #include "graphics/stk_mesh_scene_node.hpp"
 #include "graphics/spherical_harmonics.hpp"
+#include "graphics/vao_manager.hpp"
 #include "items/item_manager.hpp"
 #include "items/powerup_manager.hpp"
 #include "modes/world.hpp"
@@ -661,6 +664,8 @@ ShaderBasedRenderer::~ShaderBasedRenderer()
     delete m_skybox;
     delete m_rtts;
     ShaderFilesManager::kill();
+    ProgramBinaryCache::kill();
+    VAOManager::kill();
 }
 
 // ----------------------------------------------------------------------------
@@ -875,7 +880,9 @@ void ShaderBasedRenderer::render(float dt)
         oss << "renderPlayerView() for kart " << i;
 
         PROFILER_PUSH_CPU_MARKER(oss.str().c_str(), 0x00, 0x00, (i+1)*60);
+        begin2DBatch();
         rg->renderPlayerView(camera, dt);
+        end2DBatch();
 
         PROFILER_POP_CPU_MARKER();
     }  // for i<getNumKarts
@@ -19,6 +19,7 @@
 
 #include "graphics/shader_files_manager.hpp"
 #include "graphics/central_settings.hpp"
+#include "graphics/program_binary_cache.hpp"
 #include "graphics/shared_gpu_objects.hpp"
 #include "io/file_manager.hpp"
 #include "utils/log.hpp"
@@ -52,14 +53,15 @@ const std::string& ShaderFilesManager::getHeader()
 }   // getHeader
 
 // ----------------------------------------------------------------------------
-/** Loads a single shader. This is NOT cached, use addShaderFile for that.
- *  \param file Filename of the shader to load.
+/** Returns the complete source code of a shader as it is passed to the
+ *  driver, i.e. including the version, all defines depending on the
+ *  hardware, the header and all included files.
+ *  \param file Filename of the shader.
  *  \param type Type of the shader.
  */
-GLuint ShaderFilesManager::loadShader(const std::string &file, unsigned type)
+std::string ShaderFilesManager::getShaderSource(const std::string &file,
+                                                unsigned type)
 {
-    const GLuint id = glCreateShader(type);
-
     std::ostringstream code;
 #if !defined(USE_GLES2)
     code << "#version " << CVS->getGLSLVersion()<<"\n";
@@ -187,8 +189,42 @@ GLuint ShaderFilesManager::loadShader(const std::string &file, unsigned type)
         logerror("ShaderFilesManager", "Can not open '%s'.", file.c_str());
     }
 
+    return code.str();
+}   // getShaderSource
+
+// ----------------------------------------------------------------------------
+/** Returns a hash of the complete source code of a shader. The hashes are
+ *  cached (like the compiled shaders), so each file is only read once for
+ *  each type.
+ *  \param file Filename of the shader.
+ *  \param type Type of the shader.
+ */
+uint64_t ShaderFilesManager::getShaderHash(const std::string &file,
+                                           unsigned type)
+{
+    const std::pair<std::string, unsigned> key(file, type);
+    auto it = m_shader_hashes.find(key);
+    if (it != m_shader_hashes.end())
+        return it->second;
+
+    const std::string source = getShaderSource(file, type);
+    const uint64_t hash = ProgramBinaryCache::hash(source.data(),
+                                                   source.size());
+    m_shader_hashes[key] = hash;
+    return hash;
+}   // getShaderHash
+
+// ----------------------------------------------------------------------------
+/** Loads a single shader. This is NOT cached, use addShaderFile for that.
+ *  \param file Filename of the shader to load.
+ *  \param type Type of the shader.
+ */
+GLuint ShaderFilesManager::loadShader(const std::string &file, unsigned type)
+{
+    const GLuint id = glCreateShader(type);
+
     loginfo("ShaderFilesManager", "Compiling shader : %s", file.c_str());
-    const std::string &source  = code.str();
+    const std::string source   = getShaderSource(file, type);
     char const *source_pointer = source.c_str();
     int len                    = source.size();
     glShaderSource(id, 1, &source_pointer, &len);
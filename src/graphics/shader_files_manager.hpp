@@ -23,10 +23,13 @@
 #include "graphics/gl_headers.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/singleton.hpp"
+#include "utils/types.hpp"
 
 #include <algorithm>
+#include <map>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 class ShaderFilesManager : public Singleton<ShaderFilesManager>, NoCopy
 {
@@ -36,6 +39,13 @@ private:
      */
     std::unordered_map<std::string, GLuint> m_shader_files_loaded;
 
+    /** Map from a filename and shader type to the hash of the complete
+     *  source code. The type is part of the key since the source code
+     *  depends on it (e.g. the extensions and the precision). All other
+     *  defines only depend on the hardware and settings, which do not
+     *  change until clean() is called. */
+    std::map<std::pair<std::string, unsigned>, uint64_t> m_shader_hashes;
+
     // ------------------------------------------------------------------------
     const std::string& getHeader();
 
@@ -45,7 +55,15 @@ public:
     // ------------------------------------------------------------------------
     ~ShaderFilesManager()                                          { clean(); }
     // ------------------------------------------------------------------------
-    void clean()                             { m_shader_files_loaded.clear(); }
+    void clean()
+    {
+        m_shader_files_loaded.clear();
+        m_shader_hashes.clear();
+    }   // clean
+    // ------------------------------------------------------------------------
+    std::string getShaderSource(const std::string &file, unsigned type);
+    // ------------------------------------------------------------------------
+    uint64_t getShaderHash(const std::string &file, unsigned type);
     // ------------------------------------------------------------------------
     GLuint loadShader(const std::string &file, unsigned type);
     // ------------------------------------------------------------------------
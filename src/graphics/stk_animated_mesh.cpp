@@ -61,6 +61,8 @@ void STKAnimatedMesh::cleanGLMeshes()
     for (u32 i = 0; i < GLmeshes.size(); ++i)
     {
         GLMesh mesh = GLmeshes[i];
+        if (mesh.vaoManaged && VAOManager::isCreated())
+            VAOManager::getInstance()->releaseBase(mesh.mb);
         if (!mesh.vertex_buffer)
             continue;
         if (mesh.vao)
@@ -262,9 +264,13 @@ void STKAnimatedMesh::updateGL()
 
             if (CVS->isARBBaseInstanceUsable())
             {
-                std::pair<unsigned, unsigned> p = VAOManager::getInstance()->getBase(mb);
-                mesh.vaoBaseVertex = p.first;
-                mesh.vaoOffset = p.second;
+                if (!mesh.vaoManaged)
+                {
+                    std::pair<unsigned, unsigned> p = VAOManager::getInstance()->getBase(mb);
+                    mesh.vaoBaseVertex = p.first;
+                    mesh.vaoOffset = p.second;
+                    mesh.vaoManaged = true;
+                }
             }
             else
             {
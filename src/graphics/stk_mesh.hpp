@@ -57,6 +57,9 @@ struct GLMesh
     core::vector2df texture_trans;
     size_t vaoBaseVertex;
     size_t vaoOffset;
+    /** True if the mesh buffer is in the buffers of the VAOManager, i.e. it
+     *  must be released with VAOManager::releaseBase. */
+    bool vaoManaged;
     video::E_VERTEX_TYPE VAOType;
     uint64_t TextureHandles[8];
     scene::IMeshBuffer *mb;
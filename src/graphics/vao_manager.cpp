@@ -23,6 +23,9 @@
 #include "graphics/glwrap.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/stk_mesh.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
 
 VAOManager::VAOManager()
 {
@@ -31,10 +34,6 @@ VAOManager::VAOManager()
         vao[i] = 0;
         vbo[i] = 0;
         ibo[i] = 0;
-        last_vertex[i] = 0;
-        last_index[i] = 0;
-        RealVBOSize[i] = 0;
-        RealIBOSize[i] = 0;
     }
 
     for (unsigned i = 0; i < InstanceTypeCount; i++)
@@ -74,6 +73,9 @@ VAOManager::~VAOManager()
             glDeleteBuffers(1, &ibo[i]);
         if (vao[i])
             glDeleteVertexArrays(1, &vao[i]);
+        std::unordered_map<scene::IMeshBuffer*, MappedRange>::iterator It;
+        for (It = mappedRanges[i].begin(); It != mappedRanges[i].end(); It++)
+            It->first->drop();
     }
     for (unsigned i = 0; i < InstanceTypeCount; i++)
     {
@@ -82,45 +84,72 @@ VAOManager::~VAOManager()
 
 }
 
+/** Replaces a buffer with a larger one, and copies the used part of the old
+ *  buffer into it.
+ *  \param used Number of elements to copy.
+ *  \param bufferSize New number of elements.
+ */
 static void
-resizeBufferIfNecessary(size_t &lastIndex, size_t newLastIndex, size_t bufferSize, size_t stride, GLenum type, GLuint &id, void *&Pointer)
+resizeBuffer(size_t used, size_t bufferSize, size_t stride, GLenum type, GLuint &id, void *&Pointer)
 {
-    if (newLastIndex * stride >= bufferSize)
-    {
-        while (newLastIndex >= bufferSize)
-            bufferSize = 2 * bufferSize + 1;
-        GLuint newVBO;
-        glGenBuffers(1, &newVBO);
-        glBindBuffer(type, newVBO);
+    GLuint newVBO;
+    glGenBuffers(1, &newVBO);
+    glBindBuffer(type, newVBO);
 #if !defined(USE_GLES2)
-        if (CVS->supportsAsyncInstanceUpload())
-        {
-            glBufferStorage(type, bufferSize *stride, 0, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
-            Pointer = glMapBufferRange(type, 0, bufferSize * stride, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
-        }
-        else
+    if (CVS->supportsAsyncInstanceUpload())
+    {
+        glBufferStorage(type, bufferSize *stride, 0, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+        Pointer = glMapBufferRange(type, 0, bufferSize * stride, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+    }
+    else
 #endif
-            glBufferData(type, bufferSize * stride, 0, GL_DYNAMIC_DRAW);
+        glBufferData(type, bufferSize * stride, 0, GL_DYNAMIC_DRAW);
 
-        if (id)
-        {
-            // Copy old data
-            GLuint oldVBO = id;
-            glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
-            glBindBuffer(GL_COPY_READ_BUFFER, oldVBO);
-            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, lastIndex * stride);
-            glDeleteBuffers(1, &oldVBO);
-        }
-        id = newVBO;
+    if (id)
+    {
+        // Copy old data
+        GLuint oldVBO = id;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+        glBindBuffer(GL_COPY_READ_BUFFER, oldVBO);
+        if (used > 0)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used * stride);
+        glDeleteBuffers(1, &oldVBO);
     }
-    lastIndex = newLastIndex;
+    id = newVBO;
 }
 
-void VAOManager::regenerateBuffer(enum VTXTYPE tp, size_t newlastvertex, size_t newlastindex)
+/** Resizes the vertex and index buffer of a vertex type if their capacity
+ *  changed.
+ */
+void VAOManager::regenerateBuffer(enum VTXTYPE tp, size_t vertex_capacity, size_t index_capacity)
 {
     glBindVertexArray(0);
-    resizeBufferIfNecessary(last_vertex[tp], newlastvertex, RealVBOSize[tp], getVertexPitch(tp), GL_ARRAY_BUFFER, vbo[tp], VBOPtr[tp]);
-    resizeBufferIfNecessary(last_index[tp], newlastindex, RealIBOSize[tp], sizeof(u16), GL_ELEMENT_ARRAY_BUFFER, ibo[tp], IBOPtr[tp]);
+    if (!vbo[tp] || vertex_capacity != vertexAllocator[tp].getCapacity())
+    {
+        resizeBuffer(vertexAllocator[tp].getEnd(), vertex_capacity, getVertexPitch(tp), GL_ARRAY_BUFFER, vbo[tp], VBOPtr[tp]);
+        vertexAllocator[tp].setCapacity(vertex_capacity);
+    }
+    if (!ibo[tp] || index_capacity != indexAllocator[tp].getCapacity())
+    {
+        resizeBuffer(indexAllocator[tp].getEnd(), index_capacity, sizeof(u16), GL_ELEMENT_ARRAY_BUFFER, ibo[tp], IBOPtr[tp]);
+        indexAllocator[tp].setCapacity(index_capacity);
+    }
+}
+
+/** Makes the buffers of a vertex type larger (they are never made smaller),
+ *  and updates the VAOs which use them.
+ */
+void VAOManager::growBuffer(enum VTXTYPE tp, size_t vertex_capacity, size_t index_capacity)
+{
+    vertex_capacity = std::max(vertex_capacity, vertexAllocator[tp].getCapacity());
+    index_capacity = std::max(index_capacity, indexAllocator[tp].getCapacity());
+    if (vbo[tp] && ibo[tp] &&
+        vertex_capacity == vertexAllocator[tp].getCapacity() &&
+        index_capacity == indexAllocator[tp].getCapacity())
+        return;
+    regenerateBuffer(tp, vertex_capacity, index_capacity);
+    regenerateVAO(tp);
+    regenerateInstancedVAO();
 }
 
 void VAOManager::regenerateVAO(enum VTXTYPE tp)
@@ -318,10 +347,39 @@ irr::video::E_VERTEX_TYPE VAOManager::getVertexType(enum VTXTYPE tp)
 
 void VAOManager::append(scene::IMeshBuffer *mb, VTXTYPE tp)
 {
-    size_t old_vtx_cnt = last_vertex[tp];
-    size_t old_idx_cnt = last_index[tp];
-
-    regenerateBuffer(tp, old_vtx_cnt + mb->getVertexCount(), old_idx_cnt + mb->getIndexCount());
+    MappedRange range;
+    range.m_vertex_count = mb->getVertexCount();
+    range.m_index_count = mb->getIndexCount();
+    range.m_base_vertex = 0;
+    range.m_base_index = 0;
+    range.m_ref_count = 1;
+
+    // If the buffers are too small, they grow at least by a factor of two,
+    // since each resize has to copy the whole buffer.
+    if (range.m_vertex_count > 0)
+        range.m_base_vertex = vertexAllocator[tp].allocate(range.m_vertex_count);
+    if (range.m_index_count > 0)
+        range.m_base_index = indexAllocator[tp].allocate(range.m_index_count);
+    if (range.m_base_vertex == BufferAllocator::INVALID_OFFSET ||
+        range.m_base_index == BufferAllocator::INVALID_OFFSET ||
+        !vbo[tp] || !ibo[tp])
+    {
+        size_t vertex_capacity = vertexAllocator[tp].getCapacity();
+        if (range.m_base_vertex == BufferAllocator::INVALID_OFFSET)
+            vertex_capacity = std::max(2 * vertex_capacity, vertexAllocator[tp].getEnd() + range.m_vertex_count);
+        size_t index_capacity = indexAllocator[tp].getCapacity();
+        if (range.m_base_index == BufferAllocator::INVALID_OFFSET)
+            index_capacity = std::max(2 * index_capacity, indexAllocator[tp].getEnd() + range.m_index_count);
+        growBuffer(tp, std::max<size_t>(vertex_capacity, 1), std::max<size_t>(index_capacity, 1));
+        if (range.m_base_vertex == BufferAllocator::INVALID_OFFSET)
+            range.m_base_vertex = vertexAllocator[tp].allocate(range.m_vertex_count);
+        if (range.m_base_index == BufferAllocator::INVALID_OFFSET)
+            range.m_base_index = indexAllocator[tp].allocate(range.m_index_count);
+        assert(range.m_base_vertex != BufferAllocator::INVALID_OFFSET);
+        assert(range.m_base_index != BufferAllocator::INVALID_OFFSET);
+    }
+    const size_t old_vtx_cnt = range.m_base_vertex;
+    const size_t old_idx_cnt = range.m_base_index;
 #if !defined(USE_GLES2)
     if (CVS->supportsAsyncInstanceUpload())
     {
@@ -347,28 +405,131 @@ void VAOManager::append(scene::IMeshBuffer *mb, VTXTYPE tp)
         glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, old_idx_cnt * sizeof(u16), mb->getIndexCount() * sizeof(u16), mb->getIndices());
     }
 
-    mappedBaseVertex[tp][mb] = old_vtx_cnt;
-    mappedBaseIndex[tp][mb] = old_idx_cnt * sizeof(u16);
+    // Keep the mesh buffer alive as long as it has a range, so that its
+    // address can not be reused by another mesh buffer in the meantime.
+    mb->grab();
+    mappedRanges[tp][mb] = range;
 }
 
+/** Returns the base vertex and the offset (in bytes) of the first index of a
+ *  mesh buffer in the buffers of its vertex type. The mesh buffer is added
+ *  to the buffers if it is not used by another mesh yet. Each call must be
+ *  matched by a call to releaseBase.
+ */
 std::pair<unsigned, unsigned> VAOManager::getBase(scene::IMeshBuffer *mb)
 {
     VTXTYPE tp = getVTXTYPE(mb->getVertexType());
-    if (mappedBaseVertex[tp].find(mb) == mappedBaseVertex[tp].end())
+    std::unordered_map<scene::IMeshBuffer*, MappedRange>::iterator It;
+    It = mappedRanges[tp].find(mb);
+    if (It == mappedRanges[tp].end())
     {
-        assert(mappedBaseIndex[tp].find(mb) == mappedBaseIndex[tp].end());
         append(mb, tp);
-        regenerateVAO(tp);
-        regenerateInstancedVAO();
+        It = mappedRanges[tp].find(mb);
+        assert(It != mappedRanges[tp].end());
+    }
+    else
+        It->second.m_ref_count++;
+
+    return std::pair<unsigned, unsigned>((unsigned)It->second.m_base_vertex,
+        (unsigned)(It->second.m_base_index * sizeof(u16)));
+}
+
+/** Called when a mesh does not use a mesh buffer anymore. If no other mesh
+ *  uses it, its space in the buffers is freed and can be reused. All vertex
+ *  types are searched, since the vertex type of skinned mesh buffers is only
+ *  changed temporarily when they are added.
+ */
+void VAOManager::releaseBase(scene::IMeshBuffer *mb)
+{
+    unsigned tp = 0;
+    std::unordered_map<scene::IMeshBuffer*, MappedRange>::iterator It;
+    for (; tp < VTXTYPE_COUNT; tp++)
+    {
+        It = mappedRanges[tp].find(mb);
+        if (It != mappedRanges[tp].end())
+            break;
+    }
+    if (tp == VTXTYPE_COUNT)
+        return;
+    MappedRange &range = It->second;
+    assert(range.m_ref_count > 0);
+    if (--range.m_ref_count > 0)
+        return;
+    if (range.m_vertex_count > 0)
+        vertexAllocator[tp].free(range.m_base_vertex, range.m_vertex_count);
+    if (range.m_index_count > 0)
+        indexAllocator[tp].free(range.m_base_index, range.m_index_count);
+    mappedRanges[tp].erase(It);
+    mb->drop();
+}
+
+/** Frees the ranges of all mesh buffers that are not used by anything but
+ *  the VAOManager anymore, i.e. whose mesh was deleted without releasing the
+ *  range. This should never be necessary, so a warning is printed.
+ *  \return The number of freed ranges.
+ */
+unsigned int VAOManager::releaseUnusedBases()
+{
+    unsigned int count = 0;
+    for (unsigned tp = 0; tp < VTXTYPE_COUNT; tp++)
+    {
+        std::unordered_map<scene::IMeshBuffer*, MappedRange>::iterator It;
+        for (It = mappedRanges[tp].begin(); It != mappedRanges[tp].end();)
+        {
+            if (It->first->getReferenceCount() > 1)
+            {
+                It++;
+                continue;
+            }
+            const MappedRange &range = It->second;
+            if (range.m_vertex_count > 0)
+                vertexAllocator[tp].free(range.m_base_vertex, range.m_vertex_count);
+            if (range.m_index_count > 0)
+                indexAllocator[tp].free(range.m_base_index, range.m_index_count);
+            It->first->drop();
+            It = mappedRanges[tp].erase(It);
+            count++;
+        }
+    }
+    if (count > 0)
+    {
+        logwarn("VAOManager", "Freed %d mesh buffers that were not "
+                "released.", count);
     }
+    return count;
+}
+
+/** Makes sure that mesh buffers with the given number of vertices and
+ *  indices can be added without resizing the buffers, e.g. with the totals
+ *  of a track before it is rendered the first time.
+ */
+void VAOManager::reserve(video::E_VERTEX_TYPE type, size_t vertex_count, size_t index_count)
+{
+    VTXTYPE tp = getVTXTYPE(type);
+    growBuffer(tp, std::max<size_t>(vertexAllocator[tp].getEnd() + vertex_count, 1),
+               std::max<size_t>(indexAllocator[tp].getEnd() + index_count, 1));
+}
 
-    std::unordered_map<scene::IMeshBuffer*, unsigned>::iterator It;
-    It = mappedBaseVertex[tp].find(mb);
-    assert(It != mappedBaseVertex[tp].end());
-    unsigned vtx = It->second;
-    It = mappedBaseIndex[tp].find(mb);
-    assert(It != mappedBaseIndex[tp].end());
-    return std::pair<unsigned, unsigned>(vtx, It->second);
+/** Prints the usage of all buffers and the fragmentation of their free
+ *  space.
+ */
+void VAOManager::printStatistics() const
+{
+    const char *names[VTXTYPE_COUNT] = { "standard", "2tcoords", "tangents", "skinned" };
+    for (unsigned i = 0; i < VTXTYPE_COUNT; i++)
+    {
+        if (vertexAllocator[i].getCapacity() == 0)
+            continue;
+        loginfo("VAOManager", "%s: %d mesh buffers, %d of %d vertices "
+                "(fragmentation %.2f), %d of %d indices (fragmentation %.2f).",
+                names[i], (int)mappedRanges[i].size(),
+                (int)vertexAllocator[i].getNumUsed(),
+                (int)vertexAllocator[i].getCapacity(),
+                vertexAllocator[i].getFragmentation(),
+                (int)indexAllocator[i].getNumUsed(),
+                (int)indexAllocator[i].getCapacity(),
+                indexAllocator[i].getFragmentation());
+    }
 }
 
 #endif   // !SERVER_ONLY
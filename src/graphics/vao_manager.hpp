@@ -18,6 +18,7 @@
 #ifndef VAOMANAGER_HPP
 #define VAOMANAGER_HPP
 
+#include "graphics/buffer_allocator.hpp"
 #include "graphics/gl_headers.hpp"
 #include "utils/singleton.hpp"
 #include "utils/tuple.hpp"
@@ -194,13 +195,24 @@ class VAOManager : public Singleton<VAOManager>
     GLuint instance_vbo[InstanceTypeCount];
     void *Ptr[InstanceTypeCount];
     void *VBOPtr[VTXTYPE_COUNT], *IBOPtr[VTXTYPE_COUNT];
-    size_t RealVBOSize[VTXTYPE_COUNT], RealIBOSize[VTXTYPE_COUNT];
-    size_t last_vertex[VTXTYPE_COUNT], last_index[VTXTYPE_COUNT];
-    std::unordered_map<irr::scene::IMeshBuffer*, unsigned> mappedBaseVertex[VTXTYPE_COUNT], mappedBaseIndex[VTXTYPE_COUNT];
+    /** Manage the space in the vertex and index buffers (counted in
+     *  vertices and indices). */
+    BufferAllocator vertexAllocator[VTXTYPE_COUNT], indexAllocator[VTXTYPE_COUNT];
+
+    /** The part of the buffers used by one mesh buffer, and the number of
+     *  meshes using it (the space is freed when it is not used anymore). */
+    struct MappedRange
+    {
+        size_t m_base_vertex, m_vertex_count;
+        size_t m_base_index, m_index_count;
+        unsigned int m_ref_count;
+    };
+    std::unordered_map<irr::scene::IMeshBuffer*, MappedRange> mappedRanges[VTXTYPE_COUNT];
     std::map<std::pair<irr::video::E_VERTEX_TYPE, InstanceType>, GLuint> InstanceVAO;
 
     void cleanInstanceVAOs();
     void regenerateBuffer(enum VTXTYPE, size_t, size_t);
+    void growBuffer(enum VTXTYPE tp, size_t vertex_capacity, size_t index_capacity);
     void regenerateVAO(enum VTXTYPE);
     void regenerateInstancedVAO();
     size_t getVertexPitch(enum VTXTYPE) const;
@@ -210,6 +222,10 @@ class VAOManager : public Singleton<VAOManager>
 public:
     VAOManager();
     std::pair<unsigned, unsigned> getBase(irr::scene::IMeshBuffer *);
+    void releaseBase(irr::scene::IMeshBuffer *);
+    unsigned int releaseUnusedBases();
+    void reserve(irr::video::E_VERTEX_TYPE type, size_t vertex_count, size_t index_count);
+    void printStatistics() const;
     GLuint getInstanceBuffer(InstanceType it) { return instance_vbo[it]; }
     void *getInstanceBufferPtr(InstanceType it) { return Ptr[it]; }
     unsigned getVBO(irr::video::E_VERTEX_TYPE type) { return vbo[getVTXTYPE(type)]; }
@@ -669,6 +669,7 @@ namespace GUIEngine
 #endif
 #include "graphics/irr_driver.hpp"
 #include "guiengine/event_handler.hpp"
+#include "guiengine/layout_manager.hpp"
 #include "guiengine/modaldialog.hpp"
 #include "guiengine/message_queue.hpp"
 #include "guiengine/scalable_font.hpp"
@@ -1013,6 +1014,9 @@ namespace GUIEngine
         g_driver = driver_a;
         g_state_manager = state_manager;
 
+        // The textures and fonts used by the layouts are loaded again
+        LayoutManager::clearCache();
+
         for (unsigned int n=0; n<MAX_PLAYER_COUNT; n++)
         {
             g_focus_for_player[n] = NULL;
@@ -1118,6 +1122,9 @@ namespace GUIEngine
         g_env->setSkin(g_skin);
         g_skin->drop(); // g_env grabbed it
         assert(g_skin->getReferenceCount() == 1);
+
+        // Icons of the new skin can have other sizes
+        LayoutManager::clearCache();
     }   // reloadSkin
 
     // -----------------------------------------------------------------------
@@ -1175,7 +1182,12 @@ namespace GUIEngine
             else
             {
                 RaceGUIBase* rg = World::getWorld()->getRaceGUI();
-                if (rg != NULL) rg->renderGlobal(elapsed_time);
+                if (rg != NULL)
+                {
+                    begin2DBatch();
+                    rg->renderGlobal(elapsed_time);
+                    end2DBatch();
+                }
             }
         }
 
@@ -1184,7 +1196,12 @@ namespace GUIEngine
         if (gamestate == INGAME_MENU && dynamic_cast<CutsceneWorld*>(World::getWorld()) != NULL)
         {
             RaceGUIBase* rg = World::getWorld()->getRaceGUI();
-            if (rg != NULL) rg->renderGlobal(elapsed_time);
+            if (rg != NULL)
+            {
+                begin2DBatch();
+                rg->renderGlobal(elapsed_time);
+                end2DBatch();
+            }
         }
 
         if (gamestate == MENU || gamestate == INGAME_MENU)
@@ -17,6 +17,7 @@
 
 #include "guiengine/layout_manager.hpp"
 
+#include <assert.h>
 #include <iostream>
 
 #include <IGUIFont.h>
@@ -28,6 +29,7 @@
 #include "guiengine/scalable_font.hpp"
 #include "guiengine/widget.hpp"
 #include "io/file_manager.hpp"
+#include "utils/hash.hpp"
 #include "utils/ptr_vector.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/vs.hpp"
@@ -37,6 +39,15 @@ using namespace gui;
 using namespace video;
 using namespace GUIEngine;
 
+std::map<uint64_t, std::vector<LayoutManager::Coords> >
+    LayoutManager::m_cached_layouts;
+
+/** Number of layouts that were reused. */
+static unsigned int g_num_reused_layouts = 0;
+
+/** The cache is cleared when it gets larger, a layout takes about 1 kB. */
+static const unsigned int MAX_CACHED_LAYOUTS = 256;
+
 /** Like atoi, but on error prints an error message to stderr */
 int atoi_p(const char* val)
 {
@@ -398,11 +409,173 @@ void LayoutManager::recursivelyReadCoords(PtrVector<Widget>& widgets)
 
 // ----------------------------------------------------------------------------
 
+/** Lays out the widgets. A layout only depends on the widgets, the size of
+ *  the container and the fonts, so the result of a layout is stored and
+ *  reused when the same widgets are laid out again (e.g. each time a screen
+ *  or dialog is opened).
+ */
 void LayoutManager::calculateLayout(PtrVector<Widget>& widgets, AbstractTopLevelContainer* topLevelContainer)
 {
+    const int size[2] = { topLevelContainer->getWidth(),
+                          topLevelContainer->getHeight() };
+    const int font_heights[2] = { GUIEngine::getFontHeight(),
+                                  GUIEngine::getTitleFontHeight() };
+    uint64_t hash = Hash::fnv1a(size, sizeof(size));
+    hash = Hash::fnv1a(font_heights, sizeof(font_heights), hash);
+    if (GUIEngine::getFont() != NULL)
+    {
+        const float scale = GUIEngine::getFont()->getScale();
+        hash = Hash::fnv1a(&scale, sizeof(scale), hash);
+    }
+    hash = hashWidgets(widgets, hash);
+
+    // The number of widgets is checked as well, so that a hash collision
+    // can not read past the end of the cached coordinates
+    std::map<uint64_t, std::vector<Coords> >::const_iterator cached =
+        m_cached_layouts.find(hash);
+    if (cached != m_cached_layouts.end() &&
+        cached->second.size() == countWidgets(widgets))
+    {
+        unsigned int index = 0;
+        restoreCoords(widgets, cached->second, &index);
+        g_num_reused_layouts++;
+        return;
+    }
+
     recursivelyReadCoords(widgets);
     doCalculateLayout(widgets, topLevelContainer, NULL);
-}
+
+    if (m_cached_layouts.size() >= MAX_CACHED_LAYOUTS)
+        m_cached_layouts.clear();
+    std::vector<Coords>& coords = m_cached_layouts[hash];
+    coords.clear();
+    saveCoords(widgets, &coords);
+}   // calculateLayout
+
+// ----------------------------------------------------------------------------
+
+void LayoutManager::clearCache()
+{
+    m_cached_layouts.clear();
+}   // clearCache
+
+// ----------------------------------------------------------------------------
+
+unsigned int LayoutManager::getNumReusedLayouts()
+{
+    return g_num_reused_layouts;
+}   // getNumReusedLayouts
+
+// ----------------------------------------------------------------------------
+
+LayoutManager::Coords LayoutManager::getCoords(const Widget* widget)
+{
+    Coords c;
+    c.m_x                  = widget->m_x;
+    c.m_y                  = widget->m_y;
+    c.m_w                  = widget->m_w;
+    c.m_h                  = widget->m_h;
+    c.m_absolute_x         = widget->m_absolute_x;
+    c.m_absolute_y         = widget->m_absolute_y;
+    c.m_absolute_w         = widget->m_absolute_w;
+    c.m_absolute_h         = widget->m_absolute_h;
+    c.m_absolute_reverse_x = widget->m_absolute_reverse_x;
+    c.m_absolute_reverse_y = widget->m_absolute_reverse_y;
+    c.m_relative_x         = widget->m_relative_x;
+    c.m_relative_y         = widget->m_relative_y;
+    c.m_relative_w         = widget->m_relative_w;
+    c.m_relative_h         = widget->m_relative_h;
+    return c;
+}   // getCoords
+
+// ----------------------------------------------------------------------------
+/** Adds everything the layout of the widgets (and of all their children)
+ *  depends on to a hash, including the current coordinates since the layout
+ *  does not set all of them.
+ */
+uint64_t LayoutManager::hashWidgets(const PtrVector<Widget>& widgets, uint64_t hash)
+{
+    const unsigned int count = widgets.size();
+    hash = Hash::fnv1a(&count, sizeof(count), hash);
+    for (unsigned int n = 0; n < count; n++)
+    {
+        const Widget* widget = widgets.get(n);
+        const int values[5] = { widget->m_type, widget->m_title_font,
+                                widget->m_show_bounding_box,
+                                widget->getWidthNeededAroundLabel(),
+                                widget->getHeightNeededAroundLabel() };
+        hash = Hash::fnv1a(values, sizeof(values), hash);
+        const Coords coords = getCoords(widget);
+        hash = Hash::fnv1a(&coords, sizeof(coords), hash);
+
+        std::map<Property, std::string>::const_iterator p;
+        for (p = widget->m_properties.begin(); p != widget->m_properties.end(); p++)
+        {
+            // The terminating 0 separates the values
+            hash = Hash::fnv1a(&p->first, sizeof(p->first), hash);
+            hash = Hash::fnv1a(p->second.c_str(), p->second.size() + 1, hash);
+        }
+        hash = Hash::fnv1a(widget->m_text.c_str(),
+                           (widget->m_text.size() + 1) * sizeof(wchar_t), hash);
+
+        hash = hashWidgets(widget->m_children, hash);
+    }
+    return hash;
+}   // hashWidgets
+
+// ----------------------------------------------------------------------------
+/** Returns the number of widgets, including all their children. */
+unsigned int LayoutManager::countWidgets(const PtrVector<Widget>& widgets)
+{
+    unsigned int count = widgets.size();
+    for (unsigned int n = 0; n < widgets.size(); n++)
+        count += countWidgets(widgets[n].m_children);
+    return count;
+}   // countWidgets
+
+// ----------------------------------------------------------------------------
+
+void LayoutManager::saveCoords(const PtrVector<Widget>& widgets, std::vector<Coords>* coords)
+{
+    for (unsigned int n = 0; n < widgets.size(); n++)
+    {
+        coords->push_back(getCoords(widgets.get(n)));
+        saveCoords(widgets[n].m_children, coords);
+    }
+}   // saveCoords
+
+// ----------------------------------------------------------------------------
+
+void LayoutManager::restoreCoords(PtrVector<Widget>& widgets, const std::vector<Coords>& coords,
+                                  unsigned int* index)
+{
+    for (unsigned int n = 0; n < widgets.size(); n++)
+    {
+        if (*index >= coords.size())
+        {
+            logerror("LayoutManager", "Cached layout has too few widgets.");
+            assert(false);
+            return;
+        }
+        const Coords& c = coords[(*index)++];
+        Widget* widget = widgets.get(n);
+        widget->m_x                  = c.m_x;
+        widget->m_y                  = c.m_y;
+        widget->m_w                  = c.m_w;
+        widget->m_h                  = c.m_h;
+        widget->m_absolute_x         = c.m_absolute_x;
+        widget->m_absolute_y         = c.m_absolute_y;
+        widget->m_absolute_w         = c.m_absolute_w;
+        widget->m_absolute_h         = c.m_absolute_h;
+        widget->m_absolute_reverse_x = c.m_absolute_reverse_x;
+        widget->m_absolute_reverse_y = c.m_absolute_reverse_y;
+        widget->m_relative_x         = c.m_relative_x;
+        widget->m_relative_y         = c.m_relative_y;
+        widget->m_relative_w         = c.m_relative_w;
+        widget->m_relative_h         = c.m_relative_h;
+        restoreCoords(widget->m_children, coords, index);
+    }
+}   // restoreCoords
 
 // ----------------------------------------------------------------------------
 
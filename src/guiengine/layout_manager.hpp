@@ -19,7 +19,10 @@
 #define __LAYOUT_MANAGER_HPP__
 
 #include <cstring> // for NULL
+#include <map>
+#include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "utils/ptr_vector.hpp"
 
@@ -52,6 +55,26 @@ namespace GUIEngine
         static void doCalculateLayout(PtrVector<Widget>& widgets, AbstractTopLevelContainer* topLevelContainer,
                                       Widget* parent);
 
+        /** The fields of a widget that are read and written by the layout. */
+        struct Coords
+        {
+            int   m_x, m_y, m_w, m_h;
+            int   m_absolute_x, m_absolute_y, m_absolute_w, m_absolute_h;
+            int   m_absolute_reverse_x, m_absolute_reverse_y;
+            float m_relative_x, m_relative_y, m_relative_w, m_relative_h;
+        };
+
+        /** The layouts calculated so far: hash of everything a layout depends
+         *  on -> the coordinates of all widgets (in pre-order) after it. */
+        static std::map<uint64_t, std::vector<Coords> > m_cached_layouts;
+
+        static Coords   getCoords(const Widget* widget);
+        static uint64_t hashWidgets(const PtrVector<Widget>& widgets, uint64_t hash);
+        static unsigned int countWidgets(const PtrVector<Widget>& widgets);
+        static void     saveCoords(const PtrVector<Widget>& widgets, std::vector<Coords>* coords);
+        static void     restoreCoords(PtrVector<Widget>& widgets, const std::vector<Coords>& coords,
+                                      unsigned int* index);
+
 
     public:
 
@@ -63,6 +86,15 @@ namespace GUIEngine
          */
         static void calculateLayout(PtrVector<Widget>& widgets, AbstractTopLevelContainer* topLevelContainer);
 
+        /**
+         * \brief Forgets all layouts, must be called when something changes that
+         * the layout depends on and that is not part of the widgets (e.g. the skin).
+         */
+        static void clearCache();
+
+        /** \return how often calculateLayout reused a cached layout. */
+        static unsigned int getNumReusedLayouts();
+
         /**
          * \brief Find a widget's x, y, w and h coords from what is specified in the XML properties.
          * Most notably, expands coords relative to parent and percentages.
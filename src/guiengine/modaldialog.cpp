@@ -24,6 +24,7 @@
 #include "guiengine/widget.hpp"
 #include "input/input_manager.hpp"
 #include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
 #include "utils/log.hpp"
 
 #include <IGUIEnvironment.h>
@@ -67,9 +68,10 @@ void ModalDialog::loadFromFile(const char* xmlFile)
     doInit();
     std::string path = file_manager->getAssetChecked(FileManager::GUI,xmlFile,
                                                      true);
-    IXMLReader* xml = file_manager->createXMLReader(path);
+    XMLNode* xml = file_manager->createXMLTree(path);
 
-    Screen::parseScreenFileDiv(xml, m_widgets, m_irrlicht_window);
+    if (xml != NULL)
+        Screen::parseScreenFileDiv(xml, m_widgets, m_irrlicht_window);
     delete xml;
 
     loadedFromFile();
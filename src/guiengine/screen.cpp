@@ -19,6 +19,7 @@
 #include "guiengine/screen.hpp"
 
 #include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
 #include "graphics/irr_driver.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/layout_manager.hpp"
@@ -128,16 +129,16 @@ void Screen::loadFromFile()
     assert(m_magic_number == 0xCAFEC001);
 
     std::string path = file_manager->getAssetChecked(FileManager::GUI, m_filename, true);
-    IXMLReader* xml = file_manager->createXMLReader( path );
+    XMLNode* xml = file_manager->createXMLTree(path);
 
-    parseScreenFileDiv(xml, m_widgets);
+    if (xml != NULL)
+        parseScreenFileDiv(xml, m_widgets);
+    delete xml;
     m_loaded = true;
     calculateLayout();
 
     // invoke callback so that the class deriving from Screen is aware of this event
     loadedFromFile();
-
-    delete xml;
 }   // loadFromFile
 
 // -----------------------------------------------------------------------------
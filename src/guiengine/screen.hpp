@@ -33,6 +33,8 @@ namespace irr
 }
 using namespace irr;
 
+class XMLNode;
+
 #include "config/stk_config.hpp"
 #include "guiengine/abstract_top_level_container.hpp"
 #include "guiengine/engine.hpp"
@@ -116,6 +118,8 @@ namespace GUIEngine
         /** to catch errors as early as possible, for debugging purposes only */
         unsigned int m_magic_number;
 
+        static Widget* createWidget(const std::string &name);
+
     protected:
         bool m_throttle_FPS;
 
@@ -131,10 +135,12 @@ namespace GUIEngine
          * transcription of the XML file, with little analysis or layout
          * performed on them.
          */
-        static void parseScreenFileDiv(irr::io::IXMLReader* xml,
+        static void parseScreenFileDiv(const XMLNode* node,
                                        PtrVector<Widget>& append_to,
                                        irr::gui::IGUIElement* parent = NULL);
 
+        static void unitTesting();
+
 
         Screen(bool pause_race=true);
 
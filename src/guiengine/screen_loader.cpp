@@ -18,10 +18,15 @@
 
 #include "guiengine/screen.hpp"
 #include "guiengine/engine.hpp"
+#include "guiengine/layout_manager.hpp"
 #include "guiengine/widgets.hpp"
+#include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
+#include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
+#include <assert.h>
 #include <iostream>
-#include <irrXML.h>
+#include <set>
 #include <sstream>
 
 using namespace irr;
@@ -33,251 +38,292 @@ using namespace io;
 using namespace gui;
 using namespace GUIEngine;
 
-void Screen::parseScreenFileDiv(irr::io::IXMLReader* xml, PtrVector<Widget>& append_to,
-                                irr::gui::IGUIElement* parent)
+/** The attributes of a tag that are copied into the properties of the
+ *  widget (absent attributes result in an empty property). */
+static const struct
+{
+    const char *m_name;
+    Property    m_property;
+} WIDGET_PROPERTIES[] =
 {
-    // parse XML file
-    while (xml && xml->read())
+    { "id",             PROP_ID              },
+    { "proportion",     PROP_PROPORTION      },
+    { "width",          PROP_WIDTH           },
+    { "height",         PROP_HEIGHT          },
+    { "child_width",    PROP_CHILD_WIDTH     },
+    { "child_height",   PROP_CHILD_HEIGHT    },
+    { "word_wrap",      PROP_WORD_WRAP       },
+    //{ "grow_with_text", PROP_GROW_WITH_TEXT  },
+    { "x",              PROP_X               },
+    { "y",              PROP_Y               },
+    { "layout",         PROP_LAYOUT          },
+    { "align",          PROP_ALIGN           },
+    { "custom_ratio",   PROP_CUSTOM_RATIO    },
+
+    { "icon",           PROP_ICON            },
+    { "focus_icon",     PROP_FOCUS_ICON      },
+    { "text_align",     PROP_TEXT_ALIGN      },
+    { "min_value",      PROP_MIN_VALUE       },
+    { "max_value",      PROP_MAX_VALUE       },
+    { "square_items",   PROP_SQUARE          },
+
+    { "max_width",      PROP_MAX_WIDTH       },
+    { "max_height",     PROP_MAX_HEIGHT      },
+    { "extend_label",   PROP_EXTEND_LABEL    },
+    { "label_location", PROP_LABELS_LOCATION },
+    { "max_rows",       PROP_MAX_ROWS        },
+    { "wrap_around",    PROP_WRAP_AROUND     },
+    { "padding",        PROP_DIV_PADDING     },
+    { "keep_selection", PROP_KEEP_SELECTION  },
+};
+
+// ----------------------------------------------------------------------------
+/** Creates the widget specified by a tag of a STK GUI file.
+ *  \param name Name of the tag.
+ *  \return The new widget, or NULL if the tag is unknown.
+ */
+Widget* Screen::createWidget(const std::string &name)
+{
+    if (name == "div")
+    {
+        return new Widget(WTYPE_DIV);
+    }
+    else if (name == "placeholder")
     {
+        return new Widget(WTYPE_DIV, true);
+    }
+    else if (name == "box")
+    {
+        Widget* w = new Widget(WTYPE_DIV);
+        w->m_show_bounding_box = true;
+        return w;
+    }
+    else if (name == "bottombar")
+    {
+        Widget* w = new Widget(WTYPE_DIV);
+        w->m_bottom_bar = true;
+        return w;
+    }
+    else if (name == "topbar")
+    {
+        Widget* w = new Widget(WTYPE_DIV);
+        w->m_top_bar = true;
+        return w;
+    }
+    else if (name == "roundedbox")
+    {
+        Widget* w = new Widget(WTYPE_DIV);
+        w->m_show_bounding_box = true;
+        w->m_is_bounding_box_round = true;
+        return w;
+    }
+    else if (name == "ribbon")
+        return new RibbonWidget();
+    else if (name == "buttonbar")
+        return new RibbonWidget(RIBBON_TOOLBAR);
+    else if (name == "tabs")
+        return new RibbonWidget(RIBBON_TABS);
+    else if (name == "spinner")
+        return new SpinnerWidget();
+    else if (name == "button")
+        return new ButtonWidget();
+    else if (name == "gauge")
+        return new SpinnerWidget(true);
+    else if (name == "progressbar")
+        return new ProgressBarWidget();
+    else if (name == "icon-button")
+        return new IconButtonWidget();
+    else if (name == "icon")
+        return new IconButtonWidget(IconButtonWidget::SCALE_MODE_KEEP_TEXTURE_ASPECT_RATIO,
+                                    false, false);
+    else if (name == "checkbox")
+        return new CheckBoxWidget();
+    else if (name == "label")
+        return new LabelWidget();
+    else if (name == "bright")
+        return new LabelWidget(false, true);
+    else if (name == "bubble")
+        return new BubbleWidget();
+    else if (name == "header")
+        return new LabelWidget(true);
+    else if (name == "spacer")
+        return new Widget(WTYPE_SPACER);
+    else if (name == "ribbon_grid")
+        return new DynamicRibbonWidget(false /* combo */, true /* multi-row */);
+    else if (name == "scrollable_ribbon")
+        return new DynamicRibbonWidget(true /* combo */, false /* multi-row */);
+    else if (name == "scrollable_toolbar")
+        return new DynamicRibbonWidget(false /* combo */, false /* multi-row */);
+    else if (name == "model")
+        return new ModelViewWidget();
+    else if (name == "list")
+        return new ListWidget();
+    else if (name == "textbox")
+        return new TextBoxWidget();
+    else if (name == "ratingbar")
+        return new RatingBarWidget();
+    return NULL;
+}   // createWidget
 
-        switch (xml->getNodeType())
+// ----------------------------------------------------------------------------
+/** Creates the widget of a node (and of all nodes below it) and adds it to a
+ *  list of widgets. The XML tree usually comes from the binary cache of the
+ *  file manager, so a screen can be loaded without parsing its file again.
+ *  \param node The node.
+ *  \param append_to The list the widget is added to. Only the children of
+ *         divs and ribbons are added to the children of the widget, the
+ *         children of other widgets (and of unknown tags) are added to the
+ *         same list after the widget.
+ *  \param parent The irrlicht parent of the widgets, or NULL.
+ */
+void Screen::parseScreenFileDiv(const XMLNode* node,
+                                PtrVector<Widget>& append_to,
+                                irr::gui::IGUIElement* parent)
+{
+    Widget* widget = createWidget(node->getName());
+    if (widget == NULL)
+    {
+        // 'stkgui' is the outer node that's there only to comply with XML
+        // standard (and expat)
+        if (node->getName() != "stkgui")
         {
-            case irr::io::EXN_TEXT:
-            {
-                break;
-            }
-
-            case irr::io::EXN_ELEMENT:
-            {
-                /* find which type of widget is specified by the current tag, and instanciate it */
-                if (wcscmp(L"div", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"stkgui", xml->getNodeName()) == 0)
-                {
-                    // outer node that's there only to comply with XML standard (and expat)
-                    continue;
-                }
-                else if (wcscmp(L"placeholder", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV, true);
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"box", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    w->m_show_bounding_box = true;
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"bottombar", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    w->m_bottom_bar = true;
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"topbar", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    w->m_top_bar = true;
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"roundedbox", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    w->m_show_bounding_box = true;
-                    w->m_is_bounding_box_round = true;
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"ribbon", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new RibbonWidget());
-                }
-                else if (wcscmp(L"buttonbar", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new RibbonWidget(RIBBON_TOOLBAR));
-                }
-                else if (wcscmp(L"tabs", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new RibbonWidget(RIBBON_TABS));
-                }
-                else if (wcscmp(L"spinner", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new SpinnerWidget());
-                }
-                else if (wcscmp(L"button", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new ButtonWidget());
-                }
-                else if (wcscmp(L"gauge", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new SpinnerWidget(true));
-                }
-                else if (wcscmp(L"progressbar", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new ProgressBarWidget());
-                }
-                else if (wcscmp(L"icon-button", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new IconButtonWidget());
-                }
-                else if (wcscmp(L"icon", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new IconButtonWidget(IconButtonWidget::SCALE_MODE_KEEP_TEXTURE_ASPECT_RATIO,
-                                                             false, false));
-                }
-                else if (wcscmp(L"checkbox", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new CheckBoxWidget());
-                }
-                else if (wcscmp(L"label", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new LabelWidget());
-                }
-                else if (wcscmp(L"bright", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new LabelWidget(false, true));
-                }
-                else if (wcscmp(L"bubble", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new BubbleWidget());
-                }
-                else if (wcscmp(L"header", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new LabelWidget(true));
-                }
-                else if (wcscmp(L"spacer", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new Widget(WTYPE_SPACER));
-                }
-                else if (wcscmp(L"ribbon_grid", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new DynamicRibbonWidget(false /* combo */, true /* multi-row */));
-                }
-                else if (wcscmp(L"scrollable_ribbon", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new DynamicRibbonWidget(true /* combo */, false /* multi-row */));
-                }
-                else if (wcscmp(L"scrollable_toolbar", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new DynamicRibbonWidget(false /* combo */, false /* multi-row */));
-                }
-                else if (wcscmp(L"model", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new ModelViewWidget());
-                }
-                else if (wcscmp(L"list", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new ListWidget());
-                }
-                else if (wcscmp(L"textbox", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new TextBoxWidget());
-                }
-                else if (wcscmp(L"ratingbar", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new RatingBarWidget());
-                }
-                else
-                {
-                    logwarn("Screen::parseScreenFileDiv", "unknown tag found in STK GUI file '%s'", xml->getNodeName());
-                    continue;
-                }
+            logwarn("Screen::parseScreenFileDiv",
+                    "unknown tag found in STK GUI file '%s'",
+                    node->getName().c_str());
+        }
+        for (unsigned int i = 0; i < node->getNumNodes(); i++)
+            parseScreenFileDiv(node->getNode(i), append_to, parent);
+        return;
+    }
+    append_to.push_back(widget);
 
-                /* retrieve the created widget */
-                Widget& widget = append_to[append_to.size()-1];
+    const unsigned int num_properties =
+        sizeof(WIDGET_PROPERTIES) / sizeof(WIDGET_PROPERTIES[0]);
+    for (unsigned int i = 0; i < num_properties; i++)
+    {
+        std::string value;
+        node->get(WIDGET_PROPERTIES[i].m_name, &value);
+        widget->m_properties[WIDGET_PROPERTIES[i].m_property] = value;
+    }
 
-                /* read widget properties using macro magic */
+    std::string text;
+    if (node->get("text", &text))
+    {
+        widget->m_text = _(text.c_str());
+    }
 
-#define READ_PROPERTY( prop_name, prop_flag ) const wchar_t* prop_name = xml->getAttributeValue( L###prop_name ); \
-if(prop_name != NULL) widget.m_properties[prop_flag] = core::stringc(prop_name).c_str(); else widget.m_properties[prop_flag] = ""
+    core::stringw raw_text;
+    if (node->get("raw_text", &raw_text))
+    {
+        widget->m_text = raw_text;
+    }
 
-                READ_PROPERTY(id,             PROP_ID);
-                READ_PROPERTY(proportion,     PROP_PROPORTION);
-                READ_PROPERTY(width,          PROP_WIDTH);
-                READ_PROPERTY(height,         PROP_HEIGHT);
-                READ_PROPERTY(child_width,    PROP_CHILD_WIDTH);
-                READ_PROPERTY(child_height,   PROP_CHILD_HEIGHT);
-                READ_PROPERTY(word_wrap,      PROP_WORD_WRAP);
-                //READ_PROPERTY(grow_with_text, PROP_GROW_WITH_TEXT);
-                READ_PROPERTY(x,              PROP_X);
-                READ_PROPERTY(y,              PROP_Y);
-                READ_PROPERTY(layout,         PROP_LAYOUT);
-                READ_PROPERTY(align,          PROP_ALIGN);
-                READ_PROPERTY(custom_ratio,   PROP_CUSTOM_RATIO);
+    if (parent != NULL)
+    {
+        widget->setParent(parent);
+    }
 
-                READ_PROPERTY(icon,           PROP_ICON);
-                READ_PROPERTY(focus_icon,     PROP_FOCUS_ICON);
-                READ_PROPERTY(text_align,     PROP_TEXT_ALIGN);
-                READ_PROPERTY(min_value,      PROP_MIN_VALUE);
-                READ_PROPERTY(max_value,      PROP_MAX_VALUE);
-                READ_PROPERTY(square_items,   PROP_SQUARE);
+    /* a new div starts here, continue parsing with this new div as new parent */
+    PtrVector<Widget>& children =
+        widget->getType() == WTYPE_DIV || widget->getType() == WTYPE_RIBBON
+        ? widget->m_children : append_to;
+    for (unsigned int i = 0; i < node->getNumNodes(); i++)
+        parseScreenFileDiv(node->getNode(i), children, parent);
+}   // parseScreenFileDiv
 
-                READ_PROPERTY(max_width,      PROP_MAX_WIDTH);
-                READ_PROPERTY(max_height,     PROP_MAX_HEIGHT);
-                READ_PROPERTY(extend_label,   PROP_EXTEND_LABEL);
-                READ_PROPERTY(label_location, PROP_LABELS_LOCATION);
-                READ_PROPERTY(max_rows,       PROP_MAX_ROWS);
-                READ_PROPERTY(wrap_around,    PROP_WRAP_AROUND);
-                READ_PROPERTY(padding,        PROP_DIV_PADDING);
-                READ_PROPERTY(keep_selection, PROP_KEEP_SELECTION);
-#undef READ_PROPERTY
+// ----------------------------------------------------------------------------
+namespace
+{
+    /** A container of fixed size to lay out screens in the unit test. */
+    class TestContainer : public AbstractTopLevelContainer
+    {
+    public:
+        int m_width, m_height;
+        TestContainer() : m_width(1024), m_height(768) {}
+        virtual int getWidth()  { return m_width;  }
+        virtual int getHeight() { return m_height; }
+    };   // TestContainer
+}   // namespace
 
-                const wchar_t* text = xml->getAttributeValue( L"text" );
+// ----------------------------------------------------------------------------
+/** Loads each screen and dialog of the GUI directory from the cached binary
+ *  XML tree twice. The first tree is laid out to fill the layout cache, the
+ *  second one is laid out from the cache. Then the screen is loaded from its
+ *  XML file and laid out with an empty cache. The test checks that the
+ *  layout from the cache and the fresh layout result in the same widgets at
+ *  the same positions.
+ */
+void Screen::unitTesting()
+{
+    const std::string dir = file_manager->getAsset(FileManager::GUI, "");
+    std::set<std::string> files;
+    file_manager->listFiles(files, dir);
 
-                if (text != NULL)
-                {
-                    widget.m_text = _(text);
-                }
+    TestContainer container;
+    for (std::set<std::string>::iterator i = files.begin(); i != files.end(); i++)
+    {
+        if (!StringUtils::hasSuffix(*i, ".stkgui")) continue;
+        const std::string path = dir + *i;
 
-                const wchar_t* raw_text = xml->getAttributeValue(L"raw_text");
+        // The first call creates the cache file, the second one reads it
+        XMLNode* fresh_xml = new XMLNode(path);
+        delete file_manager->createXMLTree(path);
+        XMLNode* cached_xml = file_manager->createXMLTree(path);
+        assert(cached_xml != NULL);
 
-                if (raw_text != NULL)
-                {
-                    widget.m_text = raw_text;
-                }
+        PtrVector<Widget> first, cached, fresh;
+        parseScreenFileDiv(cached_xml, first);
+        parseScreenFileDiv(cached_xml, cached);
+        parseScreenFileDiv(fresh_xml, fresh);
+        delete fresh_xml;
 
-                if (parent != NULL)
-                {
-                    widget.setParent(parent);
-                }
+        LayoutManager::clearCache();
+        LayoutManager::calculateLayout(first, &container);
+        const unsigned int num_reused = LayoutManager::getNumReusedLayouts();
+        (void)num_reused;   // avoid compiler warning with NDEBUG
+        LayoutManager::calculateLayout(cached, &container);
+        assert(LayoutManager::getNumReusedLayouts() == num_reused + 1);
 
-                /* a new div starts here, continue parsing with this new div as new parent */
-                if (widget.getType() == WTYPE_DIV || widget.getType() == WTYPE_RIBBON)
-                {
-                    parseScreenFileDiv( xml, append_to[append_to.size()-1].m_children, parent );
-                }
-            }// end case EXN_ELEMENT
+        // The reference layout is calculated without any cached layout
+        LayoutManager::clearCache();
+        LayoutManager::calculateLayout(fresh, &container);
+        assert(LayoutManager::getNumReusedLayouts() == num_reused + 1);
 
-                break;
-            case irr::io::EXN_ELEMENT_END:
+        std::vector<std::pair<PtrVector<Widget>*, PtrVector<Widget>*> > todo;
+        todo.push_back(std::make_pair(&fresh, &cached));
+        while (!todo.empty())
+        {
+            PtrVector<Widget>& a = *todo.back().first;
+            PtrVector<Widget>& b = *todo.back().second;
+            todo.pop_back();
+            assert(a.size() == b.size());
+            for (unsigned int n = 0; n < a.size(); n++)
             {
-                // we're done parsing this 'div', return one step back in the recursive call
-                if (wcscmp(L"div", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"box", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"placeholder", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"roundedbox", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"bottombar", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"topbar", xml->getNodeName()) == 0)
-                    return;
-
-                // We're done parsing this 'ribbon', return one step back in
-                // the recursive call.
-                if (wcscmp(L"ribbon", xml->getNodeName()) == 0 ||
-                    wcscmp(L"buttonbar", xml->getNodeName()) == 0 ||
-                    wcscmp(L"tabs", xml->getNodeName()) == 0)
-                    return;
+                assert(a[n].getType()       == b[n].getType());
+                assert(a[n].m_properties    == b[n].m_properties);
+                assert(a[n].m_text          == b[n].m_text);
+                assert(a[n].m_x == b[n].m_x && a[n].m_y == b[n].m_y);
+                assert(a[n].m_w == b[n].m_w && a[n].m_h == b[n].m_h);
+                assert(a[n].m_absolute_w    == b[n].m_absolute_w);
+                assert(a[n].m_absolute_h    == b[n].m_absolute_h);
+                todo.push_back(std::make_pair(&a[n].m_children,
+                                              &b[n].m_children));
             }
-                break;
+        }
 
-            default: break;
-        }//end switch
-    } // end while
-} // end function
+        // A layout for another resolution must not be reused
+        PtrVector<Widget> other;
+        parseScreenFileDiv(cached_xml, other);
+        delete cached_xml;
+        container.m_width = 800;
+        LayoutManager::calculateLayout(other, &container);
+        assert(LayoutManager::getNumReusedLayouts() == num_reused + 1);
+        container.m_width = 1024;
 
+        first.clearAndDeleteAll();
+        cached.clearAndDeleteAll();
+        fresh.clearAndDeleteAll();
+        other.clearAndDeleteAll();
+    }
+    LayoutManager::clearCache();
+}   // unitTesting
@@ -635,6 +635,7 @@ X##_yflip.LowerRightCorner.Y = w->m_skin_dest_y + \
         colorptr[3].setAlpha(100);
     }
 
+    begin2DBatch();
     if ((areas & BoxRenderParams::LEFT) != 0)
     {
         draw2DImage(source, dest_area_left,
@@ -699,6 +700,7 @@ X##_yflip.LowerRightCorner.Y = w->m_skin_dest_y + \
                                             clipRect, colorptr,
                                             /*alpha*/true );
     }
+    end2DBatch();
 
     if (colorptr != NULL)
     {
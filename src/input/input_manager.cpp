@@ -284,7 +284,7 @@ void InputManager::handleStaticAction(int key, int value)
                 fgets(s, 256, stdin);
                 float t;
                 StringUtils::fromString(s,t);
-                RewindManager::get()->rewindTo(t);
+                RewindManager::get()->rewindTo(WorldStatus::timeToTicks(t));
                 loginfo("Rewind", "Rewinding from %f to %f",
                           world->getTime(), t);
             }
@@ -0,0 +1,498 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/addon_archive.hpp"
+
+#include "utils/job_system.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <string.h>
+#include <zlib.h>
+
+/** Maximum size of all entries in the cache (excluding preloaded entries
+ *  that were not used yet). */
+static const size_t MAX_CACHE_SIZE = 4*1024*1024;
+
+/** Only entries up to this size are kept in the cache after they are used. */
+static const size_t MAX_CACHED_ENTRY_SIZE = 256*1024;
+
+/** Maximum number of bytes decompressed by one preload() call. */
+static const size_t MAX_PRELOAD_SIZE = 64*1024*1024;
+
+// ----------------------------------------------------------------------------
+/** Reads a little endian 16 bit value. */
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}   // get16
+
+// ----------------------------------------------------------------------------
+/** Reads a little endian 32 bit value. */
+static uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}   // get32
+
+// ----------------------------------------------------------------------------
+/** Opens an archive and reads its index.
+ *  \param archive_name Name of the zip file.
+ *  \param mount_dir The directory in which the files of the archive should
+ *         appear.
+ *  \param file_system The irrlicht file system.
+ *  \return The archive, or NULL if the archive can not be used (e.g.
+ *          because it is encrypted or uses an unsupported compression).
+ */
+AddonArchive *AddonArchive::create(const std::string &archive_name,
+                                   const std::string &mount_dir,
+                                   io::IFileSystem *file_system)
+{
+    AddonArchive *archive = new AddonArchive(archive_name, mount_dir,
+                                             file_system);
+    if (!archive->readIndex())
+    {
+        archive->drop();
+        return NULL;
+    }
+    return archive;
+}   // create
+
+// ----------------------------------------------------------------------------
+AddonArchive::AddonArchive(const std::string &archive_name,
+                           const std::string &mount_dir,
+                           io::IFileSystem *file_system)
+{
+    m_archive_name = archive_name;
+    m_mount_dir    = mount_dir;
+    if (m_mount_dir.empty() || m_mount_dir[m_mount_dir.size()-1] != '/')
+        m_mount_dir += "/";
+    m_file_system  = file_system;
+    m_file         = fopen(archive_name.c_str(), "rb");
+    m_file_list    = file_system->createEmptyFileList(m_mount_dir.c_str(),
+                                                      /*ignoreCase*/false,
+                                                      /*ignorePaths*/false);
+    m_cache_size      = 0;
+    m_use_counter     = 0;
+    m_opened          = 0;
+    m_cache_hits      = 0;
+    m_bytes           = 0;
+    m_decompress_usec = 0;
+    pthread_mutex_init(&m_mutex, NULL);
+}   // AddonArchive
+
+// ----------------------------------------------------------------------------
+AddonArchive::~AddonArchive()
+{
+    if (m_file)
+        fclose(m_file);
+    m_file_list->drop();
+    pthread_mutex_destroy(&m_mutex);
+}   // ~AddonArchive
+
+// ----------------------------------------------------------------------------
+/** Reads the central directory of the zip file.
+ *  \return False if the archive can not be used.
+ */
+bool AddonArchive::readIndex()
+{
+    if (!m_file)
+        return false;
+
+    // The end of central directory record is at the end of the file,
+    // followed by a comment of up to 64 KB.
+    fseek(m_file, 0, SEEK_END);
+    long file_size = ftell(m_file);
+    long tail_size = std::min(file_size, 65535L + 22L);
+    if (tail_size < 22)
+        return false;
+    std::vector<uint8_t> tail(tail_size);
+    fseek(m_file, file_size - tail_size, SEEK_SET);
+    if (fread(tail.data(), 1, tail_size, m_file) != (size_t)tail_size)
+        return false;
+
+    long eocd = -1;
+    for (long i = tail_size - 22; i >= 0; i--)
+    {
+        if (get32(&tail[i]) == 0x06054b50)
+        {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0)
+    {
+        logwarn("AddonArchive", "'%s' is not a zip file.",
+                m_archive_name.c_str());
+        return false;
+    }
+
+    unsigned int num_entries = get16(&tail[eocd + 10]);
+    uint32_t cd_size         = get32(&tail[eocd + 12]);
+    uint32_t cd_offset       = get32(&tail[eocd + 16]);
+    if (num_entries == 0xffff || cd_offset == 0xffffffff ||
+        (long)cd_offset + (long)cd_size > file_size)
+    {
+        // Zip64 archives are not supported
+        return false;
+    }
+
+    std::vector<uint8_t> cd(cd_size);
+    fseek(m_file, cd_offset, SEEK_SET);
+    if (cd_size > 0 && fread(cd.data(), 1, cd_size, m_file) != cd_size)
+        return false;
+
+    // Maps the base name of each file to its entry. Later entries replace
+    // earlier ones with the same name, as they would when extracting.
+    std::map<std::string, unsigned int> names;
+    size_t pos = 0;
+    for (unsigned int i = 0; i < num_entries; i++)
+    {
+        if (pos + 46 > cd.size() || get32(&cd[pos]) != 0x02014b50)
+            return false;
+        uint16_t flags       = get16(&cd[pos +  8]);
+        Entry entry;
+        entry.m_method          = get16(&cd[pos + 10]);
+        entry.m_crc             = get32(&cd[pos + 16]);
+        entry.m_compressed_size = get32(&cd[pos + 20]);
+        entry.m_size            = get32(&cd[pos + 24]);
+        uint16_t name_length    = get16(&cd[pos + 28]);
+        uint16_t extra_length   = get16(&cd[pos + 30]);
+        uint16_t comment_length = get16(&cd[pos + 32]);
+        entry.m_header_offset   = get32(&cd[pos + 42]);
+        entry.m_data_offset     = 0;
+        if (pos + 46 + name_length > cd.size())
+            return false;
+        std::string name((const char*)&cd[pos + 46], name_length);
+        pos += 46 + name_length + extra_length + comment_length;
+
+        // Skip directories
+        if (name.empty() || name[name.size()-1] == '/')
+            continue;
+        if (flags & 1)
+        {
+            logwarn("AddonArchive", "'%s' is encrypted.",
+                    m_archive_name.c_str());
+            return false;
+        }
+        if (entry.m_method != 0 && entry.m_method != 8)
+        {
+            logwarn("AddonArchive", "'%s' uses unsupported compression %d.",
+                    m_archive_name.c_str(), entry.m_method);
+            return false;
+        }
+        std::string base = StringUtils::getBasename(name);
+        // Hidden files are not extracted either
+        if (base.empty() || base[0] == '.')
+            continue;
+        names[base] = (unsigned int)m_entries.size();
+        m_entries.push_back(entry);
+    }   // for i < num_entries
+
+    for (std::map<std::string, unsigned int>::const_iterator i = names.begin();
+         i != names.end(); i++)
+    {
+        m_file_list->addItem((m_mount_dir + i->first).c_str(), 0,
+                             m_entries[i->second].m_size,
+                             /*isDirectory*/false, i->second + 1);
+    }
+    m_file_list->sort();
+    return true;
+}   // readIndex
+
+// ----------------------------------------------------------------------------
+/** Reads the compressed data of an entry.
+ *  \param index Index of the entry.
+ *  \param data On return contains the compressed data.
+ *  \return False if an error occurred.
+ */
+bool AddonArchive::readCompressed(unsigned int index,
+                                  std::vector<uint8_t> *data)
+{
+    pthread_mutex_lock(&m_mutex);
+    Entry &entry = m_entries[index];
+    bool ok = true;
+    if (entry.m_data_offset == 0)
+    {
+        // The size of the extra field in the local header can be different
+        // from the one in the central directory, so read the local header.
+        uint8_t header[30];
+        fseek(m_file, entry.m_header_offset, SEEK_SET);
+        ok = fread(header, 1, 30, m_file) == 30 &&
+             get32(header) == 0x04034b50;
+        if (ok)
+            entry.m_data_offset = entry.m_header_offset + 30 +
+                                  get16(&header[26]) + get16(&header[28]);
+    }
+    if (ok)
+    {
+        data->resize(entry.m_compressed_size);
+        fseek(m_file, entry.m_data_offset, SEEK_SET);
+        ok = entry.m_compressed_size == 0 ||
+             fread(data->data(), 1, entry.m_compressed_size, m_file) ==
+                                                      entry.m_compressed_size;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    if (!ok)
+        logerror("AddonArchive", "Can not read entry %d of '%s'.", index,
+                 m_archive_name.c_str());
+    return ok;
+}   // readCompressed
+
+// ----------------------------------------------------------------------------
+/** Decompresses an entry. This does not need the archive lock, so it can be
+ *  called by several threads at the same time.
+ *  \param index Index of the entry.
+ *  \param in The compressed data.
+ *  \param out On return contains the decompressed data, it must have room
+ *         for the (uncompressed) size of the entry.
+ *  \return False if the data is invalid.
+ */
+bool AddonArchive::decompress(unsigned int index,
+                              const std::vector<uint8_t> &in, uint8_t *out)
+{
+    const Entry &entry = m_entries[index];
+    double start = StkTime::getRealTime();
+    bool ok;
+    if (entry.m_method == 0)
+    {
+        ok = in.size() == entry.m_size;
+        if (ok && entry.m_size > 0)
+            memcpy(out, in.data(), entry.m_size);
+    }
+    else
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        stream.next_in   = (Bytef*)in.data();
+        stream.avail_in  = (uInt)in.size();
+        stream.next_out  = (Bytef*)out;
+        stream.avail_out = (uInt)entry.m_size;
+        // Negative window bits: raw deflate data without zlib header
+        ok = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+        if (ok)
+        {
+            int result = inflate(&stream, Z_FINISH);
+            ok = result == Z_STREAM_END && stream.total_out == entry.m_size;
+            inflateEnd(&stream);
+        }
+    }
+    if (ok)
+        ok = crc32(0, out, (uInt)entry.m_size) == entry.m_crc;
+    m_decompress_usec += (uint64_t)((StkTime::getRealTime() - start)*1.0e6);
+    if (!ok)
+        logerror("AddonArchive", "Entry %d of '%s' is corrupt.", index,
+                 m_archive_name.c_str());
+    return ok;
+}   // decompress
+
+// ----------------------------------------------------------------------------
+/** Adds decompressed data to the cache. Unless the data was preloaded, the
+ *  least recently used entries are removed to keep the cache size limited.
+ *  \param index Index of the entry.
+ *  \param data The data, which will be moved into the cache.
+ *  \param preloaded True if the data is preloaded.
+ */
+void AddonArchive::addToCache(unsigned int index, std::vector<uint8_t> *data,
+                              bool preloaded)
+{
+    pthread_mutex_lock(&m_mutex);
+    if (m_cache.find(index) == m_cache.end())
+    {
+        while (!preloaded && !m_cache.empty() &&
+               m_cache_size + data->size() > MAX_CACHE_SIZE)
+        {
+            std::map<unsigned int, CacheEntry>::iterator oldest =
+                                                              m_cache.begin();
+            for (std::map<unsigned int, CacheEntry>::iterator i =
+                 m_cache.begin(); i != m_cache.end(); i++)
+            {
+                if (i->second.m_last_used < oldest->second.m_last_used)
+                    oldest = i;
+            }
+            m_cache_size -= oldest->second.m_data.size();
+            m_cache.erase(oldest);
+        }
+        CacheEntry &cache_entry = m_cache[index];
+        cache_entry.m_data.swap(*data);
+        cache_entry.m_last_used = m_use_counter++;
+        cache_entry.m_preloaded = preloaded;
+        m_cache_size += cache_entry.m_data.size();
+    }
+    pthread_mutex_unlock(&m_mutex);
+}   // addToCache
+
+// ----------------------------------------------------------------------------
+/** Returns the decompressed data of an entry, either copied from the cache
+ *  or decompressed directly into the returned buffer.
+ *  \param index Index of the entry.
+ *  \return A buffer with the data, which must be freed with delete[], or
+ *          NULL if an error occurred.
+ */
+c8 *AddonArchive::getData(unsigned int index)
+{
+    m_opened++;
+    // The size is not changed after the index was read
+    const uint32_t size = m_entries[index].m_size;
+    c8 *buffer = new c8[size > 0 ? size : 1];
+    pthread_mutex_lock(&m_mutex);
+    std::map<unsigned int, CacheEntry>::iterator i = m_cache.find(index);
+    if (i != m_cache.end())
+    {
+        CacheEntry &cache_entry = i->second;
+        if (size > 0)
+            memcpy(buffer, cache_entry.m_data.data(), size);
+        if (cache_entry.m_preloaded && size > MAX_CACHED_ENTRY_SIZE)
+        {
+            // Big preloaded entries are only used once
+            m_cache_size -= size;
+            m_cache.erase(i);
+        }
+        else
+        {
+            cache_entry.m_last_used = m_use_counter++;
+            cache_entry.m_preloaded = false;
+        }
+        pthread_mutex_unlock(&m_mutex);
+        m_cache_hits++;
+        m_bytes += size;
+        return buffer;
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    std::vector<uint8_t> compressed;
+    if (!readCompressed(index, &compressed) ||
+        !decompress(index, compressed, (uint8_t*)buffer))
+    {
+        delete [] buffer;
+        return NULL;
+    }
+    m_bytes += size;
+    if (size <= MAX_CACHED_ENTRY_SIZE)
+    {
+        std::vector<uint8_t> copy(buffer, buffer + size);
+        addToCache(index, &copy, /*preloaded*/false);
+    }
+    return buffer;
+}   // getData
+
+// ----------------------------------------------------------------------------
+/** Opens a file in the archive.
+ *  \param filename Full name of the file (including the mount directory).
+ *  \return The file, or NULL if the file is not in this archive.
+ */
+io::IReadFile *AddonArchive::createAndOpenFile(const io::path &filename)
+{
+    s32 index = m_file_list->findFile(filename);
+    if (index < 0)
+        return NULL;
+    return createAndOpenFile((u32)index);
+}   // createAndOpenFile(filename)
+
+// ----------------------------------------------------------------------------
+/** Opens a file in the archive.
+ *  \param index Index of the file in the file list.
+ */
+io::IReadFile *AddonArchive::createAndOpenFile(u32 index)
+{
+    if (index >= m_file_list->getFileCount())
+        return NULL;
+    const unsigned int entry = m_file_list->getID(index) - 1;
+    c8 *buffer = getData(entry);
+    if (!buffer)
+        return NULL;
+
+    // The memory file deletes the buffer with delete[]
+    return m_file_system->createMemoryReadFile(buffer,
+                                           (s32)m_entries[entry].m_size,
+                                           m_file_list->getFullFileName(index),
+                                           /*deleteMemoryWhenDropped*/true);
+}   // createAndOpenFile(index)
+
+// ----------------------------------------------------------------------------
+/** Decompresses all entries that are not yet cached (up to a maximum total
+ *  size) using the job system, and stores them in the cache. Preloaded
+ *  entries stay in the cache till they are used or releasePreloaded() is
+ *  called.
+ */
+void AddonArchive::preload()
+{
+    std::vector<unsigned int> todo;
+    size_t total = 0;
+    pthread_mutex_lock(&m_mutex);
+    for (unsigned int i = 0; i < m_entries.size(); i++)
+    {
+        if (m_cache.find(i) != m_cache.end() ||
+            total + m_entries[i].m_size > MAX_PRELOAD_SIZE)
+            continue;
+        total += m_entries[i].m_size;
+        todo.push_back(i);
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    std::function<void(int)> load = [this, &todo](int n)
+    {
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> data(m_entries[todo[n]].m_size);
+        if (readCompressed(todo[n], &compressed) &&
+            decompress(todo[n], compressed, data.data()))
+            addToCache(todo[n], &data, /*preloaded*/true);
+    };
+    if (JobSystem::isCreated())
+        JobSystem::get()->parallelFor((int)todo.size(), load);
+    else
+    {
+        for (unsigned int i = 0; i < todo.size(); i++)
+            load(i);
+    }
+}   // preload
+
+// ----------------------------------------------------------------------------
+/** Removes all preloaded entries that were not used from the cache.
+ */
+void AddonArchive::releasePreloaded()
+{
+    pthread_mutex_lock(&m_mutex);
+    std::map<unsigned int, CacheEntry>::iterator i = m_cache.begin();
+    while (i != m_cache.end())
+    {
+        if (i->second.m_preloaded)
+        {
+            m_cache_size -= i->second.m_data.size();
+            m_cache.erase(i++);
+        }
+        else
+            i++;
+    }
+    pthread_mutex_unlock(&m_mutex);
+}   // releasePreloaded
+
+// ----------------------------------------------------------------------------
+/** Returns the statistics of this archive. */
+AddonArchive::Statistics AddonArchive::getStatistics() const
+{
+    Statistics s;
+    s.m_opened          = m_opened;
+    s.m_cache_hits      = m_cache_hits;
+    s.m_bytes           = m_bytes;
+    s.m_decompress_usec = m_decompress_usec;
+    return s;
+}   // getStatistics
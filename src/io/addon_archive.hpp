@@ -0,0 +1,174 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_ADDON_ARCHIVE_HPP
+#define HEADER_ADDON_ARCHIVE_HPP
+
+#include "utils/cpp2011.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <IFileArchive.h>
+#include <IFileSystem.h>
+
+#include <atomic>
+#include <map>
+#include <pthread.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace irr;
+
+/**
+  * \brief A zip archive of an addon, mounted as a read-only directory.
+  *  Instead of extracting a downloaded addon, the archive is kept and added
+  *  to irrlicht's file system. All files in the archive appear to be in the
+  *  data directory of the addon, so any code that finds files with
+  *  FileManager::fileExists() and opens them through irrlicht's file system
+  *  (models, textures, XML files, sounds) can use them without changes.
+  *  The paths inside the archive are ignored, which gives the same layout
+  *  as extracting the archive with extract_zip().
+  *  Entries are decompressed when they are opened. Small entries are kept
+  *  in a cache, since some files (e.g. kart.xml) are read several times.
+  *  preload() decompresses all entries on the worker threads of the job
+  *  system, so that loading e.g. a track does not need to decompress all
+  *  its files one after the other.
+  * \ingroup io
+  */
+class AddonArchive : public io::IFileArchive, public NoCopy
+{
+public:
+    /** Statistics about reading files from an archive. */
+    struct Statistics
+    {
+        /** Number of files opened. */
+        uint64_t m_opened;
+        /** Number of files taken from the cache. */
+        uint64_t m_cache_hits;
+        /** Number of bytes (uncompressed) read. */
+        uint64_t m_bytes;
+        /** Time spent decompressing in microseconds (summed over all
+         *  threads). */
+        uint64_t m_decompress_usec;
+    };   // Statistics
+
+private:
+    /** Information about one file in the archive. */
+    struct Entry
+    {
+        /** Offset of the local header of this entry in the archive. */
+        uint32_t m_header_offset;
+        /** Offset of the (compressed) data, 0 if not yet known. */
+        uint32_t m_data_offset;
+        /** Size of the compressed data. */
+        uint32_t m_compressed_size;
+        /** Size of the uncompressed data. */
+        uint32_t m_size;
+        /** CRC32 of the uncompressed data. */
+        uint32_t m_crc;
+        /** Compression method: 0 = stored, 8 = deflate. */
+        uint16_t m_method;
+    };   // Entry
+
+    /** A decompressed entry in the cache. */
+    struct CacheEntry
+    {
+        std::vector<uint8_t> m_data;
+        /** Value of m_use_counter when this entry was last used. */
+        uint64_t             m_last_used;
+        /** True if this entry was preloaded, and should be removed from
+         *  the cache once it is used if it is too big to stay cached. */
+        bool                 m_preloaded;
+    };   // CacheEntry
+
+    /** Name of the archive file. */
+    std::string m_archive_name;
+
+    /** The directory the archive is mounted at (with a trailing '/'). */
+    std::string m_mount_dir;
+
+    /** The irrlicht file system, used to create the read files. */
+    io::IFileSystem *m_file_system;
+
+    /** The open archive file. */
+    FILE *m_file;
+
+    /** All files in the archive. */
+    std::vector<Entry> m_entries;
+
+    /** The list of file names (with the mount directory), used by irrlicht
+     *  to find files. The id of each item is the index in m_entries + 1. */
+    io::IFileList *m_file_list;
+
+    /** Protects m_file, m_entries (data offset), and the cache. */
+    pthread_mutex_t m_mutex;
+
+    /** The cache of decompressed entries, indexed by entry. */
+    std::map<unsigned int, CacheEntry> m_cache;
+
+    /** Number of bytes in the cache. */
+    size_t m_cache_size;
+
+    /** Counter to determine the least recently used cache entry. */
+    uint64_t m_use_counter;
+
+    /** Statistics counters. */
+    std::atomic<uint64_t> m_opened, m_cache_hits, m_bytes, m_decompress_usec;
+
+         AddonArchive(const std::string &archive_name,
+                      const std::string &mount_dir,
+                      io::IFileSystem *file_system);
+    bool readIndex();
+    bool readCompressed(unsigned int index, std::vector<uint8_t> *data);
+    bool decompress(unsigned int index, const std::vector<uint8_t> &in,
+                    uint8_t *out);
+    c8  *getData(unsigned int index);
+    void addToCache(unsigned int index, std::vector<uint8_t> *data,
+                    bool preloaded);
+
+public:
+    static AddonArchive *create(const std::string &archive_name,
+                                const std::string &mount_dir,
+                                io::IFileSystem *file_system);
+    virtual ~AddonArchive();
+    virtual io::IReadFile *createAndOpenFile(const io::path &filename)
+                                                                   OVERRIDE;
+    virtual io::IReadFile *createAndOpenFile(u32 index) OVERRIDE;
+    void preload();
+    void releasePreloaded();
+    Statistics getStatistics() const;
+    // ------------------------------------------------------------------------
+    virtual const io::IFileList *getFileList() const OVERRIDE
+    {
+        return m_file_list;
+    }   // getFileList
+    // ------------------------------------------------------------------------
+    virtual io::E_FILE_ARCHIVE_TYPE getType() const OVERRIDE
+    {
+        return io::EFAT_ZIP;
+    }   // getType
+    // ------------------------------------------------------------------------
+    /** Returns the directory this archive is mounted at. */
+    const std::string &getMountDir() const { return m_mount_dir; }
+    // ------------------------------------------------------------------------
+    /** Returns the name of the archive file. */
+    const std::string &getArchiveName() const { return m_archive_name; }
+};   // AddonArchive
+
+#endif
@@ -23,9 +23,11 @@
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
+#include "io/scan_index.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/command_line.hpp"
+#include "utils/hash.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 
@@ -35,6 +37,8 @@
 
 #include <irrlicht.h>
 
+#include <algorithm>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdexcept>
 #include <sstream>
@@ -119,6 +123,8 @@ FileManager* file_manager = 0;
  */
 FileManager::FileManager()
 {
+    m_scan_index = NULL;
+    memset(&m_unmounted_statistics, 0, sizeof(m_unmounted_statistics));
     m_subdir_name.resize(ASSET_COUNT);
     m_subdir_name[CHALLENGE  ] = "challenges";
     m_subdir_name[GFX        ] = "gfx";
@@ -224,6 +230,10 @@ FileManager::FileManager()
     checkAndCreateScreenshotDir();
     checkAndCreateReplayDir();
     checkAndCreateCachedTexturesDir();
+    m_cached_xml_dir     = checkAndCreateCacheSubdir("cached-xml");
+    m_cached_sfx_dir     = checkAndCreateCacheSubdir("cached-sfx");
+    m_cached_scripts_dir = checkAndCreateCacheSubdir("cached-scripts");
+    m_cached_shaders_dir = checkAndCreateCacheSubdir("cached-shaders");
     checkAndCreateGPDir();
 
     redirectOutput();
@@ -325,11 +335,29 @@ void FileManager::init()
         for(int i=0;i<(int)dirs.size(); i++)
             pushMusicSearchPath(dirs[i]);
     }
+
+    mountAddonArchives();
 }   // init
 
 //-----------------------------------------------------------------------------
 FileManager::~FileManager()
 {
+    // Deleting the index saves it if it was modified
+    delete m_scan_index;
+    m_scan_index = NULL;
+
+    AddonArchive::Statistics statistics = getArchiveStatistics();
+    if (statistics.m_opened > 0)
+    {
+        loginfo("[FileManager]", "Addon archives: %d files read (%d from "
+                "cache), %.1f MB, %.1f ms decompressing.",
+                (int)statistics.m_opened, (int)statistics.m_cache_hits,
+                statistics.m_bytes/(1024.0*1024.0),
+                statistics.m_decompress_usec/1000.0);
+    }
+    while (!m_archives.empty())
+        unmountArchive(m_archives.back()->getMountDir());
+
     // Clean up left-over files in addons/tmp that are older than 24h
     // ==============================================================
     // (The 24h delay is useful when debugging a problem with a zip file)
@@ -419,9 +447,19 @@ void FileManager::addRootDirs(const std::string &roots)
 }   // addRootDirs
 
 //-----------------------------------------------------------------------------
+/** Creates an irrlicht XML reader for a file. The reader reads the whole
+ *  file when it is created, so only the creation needs to be serialised
+ *  (irrlicht's file system is not thread-safe). This allows XML files to
+ *  be parsed from several threads (e.g. while loading karts and tracks).
+ *  \param filename Name of the XML file.
+ */
 io::IXMLReader *FileManager::createXMLReader(const std::string &filename)
 {
-    return m_file_system->createXMLReader(filename.c_str());
+    static pthread_mutex_t reader_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_lock(&reader_mutex);
+    io::IXMLReader *reader = m_file_system->createXMLReader(filename.c_str());
+    pthread_mutex_unlock(&reader_mutex);
+    return reader;
 }   // getXMLReader
 //-----------------------------------------------------------------------------
 /** Reads in a XML file and converts it into a XMLNode tree.
@@ -429,9 +467,36 @@ io::IXMLReader *FileManager::createXMLReader(const std::string &filename)
  */
 XMLNode *FileManager::createXMLTree(const std::string &filename)
 {
+    // If the file exists in the file system (i.e. not only in an archive),
+    // use a cached binary version of the file if it is up to date, i.e. if
+    // the size and modification time of the file are unchanged. This only
+    // needs a stat, the XML file itself is not read.
+    struct stat st;
+    std::string cache_name;
+    if (UserConfigParams::m_cache_xml && !m_cached_xml_dir.empty() &&
+        stat(filename.c_str(), &st) == 0)
+    {
+        // Use a hash of the full name as file name for the cache
+        std::ostringstream oss;
+        oss << m_cached_xml_dir << std::hex << Hash::fnv1a(filename) << ".bin";
+        cache_name = oss.str();
+        XMLNode *node = XMLNode::loadBinary(cache_name, filename,
+                                            (uint64_t)st.st_size,
+                                            (uint64_t)st.st_mtime);
+        if (node)
+            return node;
+    }
+
     try
     {
         XMLNode* node = new XMLNode(filename);
+        if (!cache_name.empty() &&
+            !node->saveBinary(cache_name, (uint64_t)st.st_size,
+                              (uint64_t)st.st_mtime))
+        {
+            logwarn("[FileManager]", "Can not write cached XML file '%s'.",
+                    cache_name.c_str());
+        }
         return node;
     }
     catch (std::runtime_error& e)
@@ -689,6 +754,56 @@ std::string FileManager::getCachedTexturesDir() const
     return m_cached_textures_dir;
 }   // getCachedTexturesDir
 
+//-----------------------------------------------------------------------------
+/** Returns the directory in which binary versions of XML files are cached.
+ */
+std::string FileManager::getCachedXMLDir() const
+{
+    return m_cached_xml_dir;
+}   // getCachedXMLDir
+
+//-----------------------------------------------------------------------------
+/** Returns the directory in which decoded sound effects are cached.
+ */
+std::string FileManager::getCachedSFXDir() const
+{
+    return m_cached_sfx_dir;
+}   // getCachedSFXDir
+
+//-----------------------------------------------------------------------------
+/** Returns the directory in which the byte code of compiled scripts is
+ *  cached.
+ */
+std::string FileManager::getCachedScriptsDir() const
+{
+    return m_cached_scripts_dir;
+}   // getCachedScriptsDir
+
+//-----------------------------------------------------------------------------
+/** Returns the directory in which linked shader programs are cached.
+ */
+std::string FileManager::getCachedShadersDir() const
+{
+    return m_cached_shaders_dir;
+}   // getCachedShadersDir
+
+//-----------------------------------------------------------------------------
+/** Returns the index of directories containing karts and tracks. The index
+ *  is stored in the cached XML directory (if XML caching is enabled),
+ *  otherwise it is only kept in memory.
+ */
+ScanIndex *FileManager::getScanIndex()
+{
+    if (!m_scan_index)
+    {
+        std::string filename;
+        if (UserConfigParams::m_cache_xml && !m_cached_xml_dir.empty())
+            filename = m_cached_xml_dir + "scan-index.xml";
+        m_scan_index = new ScanIndex(filename);
+    }
+    return m_scan_index;
+}   // getScanIndex
+
 //-----------------------------------------------------------------------------
 /** Returns the directory in which user-defined grand prix should be stored.
  */
@@ -1016,6 +1131,33 @@ void FileManager::checkAndCreateCachedTexturesDir()
 
 }   // checkAndCreateCachedTexturesDir
 
+// ----------------------------------------------------------------------------
+/** Creates a subdirectory of the user cache directory, which is used for one
+ *  kind of cached files (e.g. binary XML files or decoded sound effects).
+ *  \param name Name of the subdirectory.
+ *  \return The path of the directory (with a trailing '/'), or "" if it can
+ *          not be created, in which case these files are not cached.
+ */
+std::string FileManager::checkAndCreateCacheSubdir(const std::string &name)
+{
+#if defined(WIN32) || defined(__CYGWIN__)
+    std::string dir = m_user_config_dir + name + "/";
+#elif defined(__APPLE__)
+    std::string dir = getenv("HOME");
+    dir += "/Library/Application Support/SuperTuxKart/" + name + "/";
+#else
+    std::string dir = checkAndCreateLinuxDir("XDG_CACHE_HOME", "supertuxkart", ".cache/", ".");
+    dir += name + "/";
+#endif
+
+    if (!checkAndCreateDirectory(dir))
+    {
+        logerror("FileManager", "Can not create cache directory '%s', these files will not be cached.", dir.c_str());
+        return "";
+    }
+    return dir;
+}   // checkAndCreateCacheSubdir
+
 // ----------------------------------------------------------------------------
 /** Creates the directories for user-defined grand prix. This will set m_gp_dir
  *  with the appropriate path.
@@ -1243,6 +1385,153 @@ bool FileManager::isDirectory(const std::string &path) const
     return S_ISDIR(mystat.st_mode);
 }   // isDirectory
 
+//-----------------------------------------------------------------------------
+/** Returns the name of the archive of an addon that is mounted instead of
+ *  being extracted.
+ *  \param dir The data directory of the addon.
+ */
+std::string FileManager::getAddonArchiveName(const std::string &dir) const
+{
+    if (!dir.empty() && dir[dir.size()-1] == '/')
+        return dir + "stk-addon.zip";
+    return dir + "/stk-addon.zip";
+}   // getAddonArchiveName
+
+//-----------------------------------------------------------------------------
+/** Mounts the archives of all installed addons that were not extracted.
+ */
+void FileManager::mountAddonArchives()
+{
+    const char *types[] = { "karts/", "tracks/" };
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        std::string type_dir = getAddonsFile(types[i]);
+        std::set<std::string> dirs;
+        listFiles(dirs, type_dir);
+        for (std::set<std::string>::iterator j = dirs.begin();
+             j != dirs.end(); j++)
+        {
+            if (*j == "." || *j == "..") continue;
+            std::string archive = getAddonArchiveName(type_dir + *j);
+            struct stat st;
+            if (stat(archive.c_str(), &st) == 0 &&
+                !mountArchive(archive, type_dir + *j))
+            {
+                logerror("[FileManager]", "Can not mount '%s'.",
+                         archive.c_str());
+            }
+        }
+    }
+}   // mountAddonArchives
+
+//-----------------------------------------------------------------------------
+/** Returns the archive mounted at a directory, or NULL if no archive is
+ *  mounted there.
+ *  \param dir The directory.
+ */
+AddonArchive *FileManager::findArchive(const std::string &dir) const
+{
+    std::string mount_dir = dir;
+    if (mount_dir.empty() || mount_dir[mount_dir.size()-1] != '/')
+        mount_dir += "/";
+    for (unsigned int i = 0; i < m_archives.size(); i++)
+    {
+        if (m_archives[i]->getMountDir() == mount_dir)
+            return m_archives[i];
+    }
+    return NULL;
+}   // findArchive
+
+//-----------------------------------------------------------------------------
+/** Mounts a zip archive, so that all files in the archive appear to be in
+ *  the specified directory (the paths inside the archive are ignored). The
+ *  files can then be found and read with the normal file manager and
+ *  irrlicht functions. Any archive already mounted at this directory is
+ *  unmounted first.
+ *  \param archive_name Name of the zip file.
+ *  \param dir The directory at which to mount the archive.
+ *  \return False if the archive can not be mounted.
+ */
+bool FileManager::mountArchive(const std::string &archive_name,
+                               const std::string &dir)
+{
+    unmountArchive(dir);
+    AddonArchive *archive = AddonArchive::create(archive_name, dir,
+                                                 m_file_system);
+    if (!archive)
+        return false;
+    m_file_system->addFileArchive(archive);
+    m_archives.push_back(archive);
+    if (UserConfigParams::logAddons())
+        loginfo("[FileManager]", "Mounted '%s' at '%s' (%d files).",
+                archive_name.c_str(), archive->getMountDir().c_str(),
+                archive->getFileList()->getFileCount());
+    return true;
+}   // mountArchive
+
+//-----------------------------------------------------------------------------
+/** Unmounts the archive mounted at the specified directory (if any).
+ *  \param dir The directory.
+ */
+void FileManager::unmountArchive(const std::string &dir)
+{
+    AddonArchive *archive = findArchive(dir);
+    if (!archive)
+        return;
+    AddonArchive::Statistics s = archive->getStatistics();
+    m_unmounted_statistics.m_opened          += s.m_opened;
+    m_unmounted_statistics.m_cache_hits      += s.m_cache_hits;
+    m_unmounted_statistics.m_bytes           += s.m_bytes;
+    m_unmounted_statistics.m_decompress_usec += s.m_decompress_usec;
+    m_archives.erase(std::find(m_archives.begin(), m_archives.end(),
+                               archive));
+    // The file system owns the archive since addFileArchive (which does
+    // not grab it), and drops it here
+    m_file_system->removeFileArchive(archive);
+}   // unmountArchive
+
+//-----------------------------------------------------------------------------
+/** If an archive is mounted at the specified directory, decompresses all
+ *  its files in parallel, so that they are available when they are read.
+ *  \param dir The directory.
+ */
+void FileManager::preloadArchive(const std::string &dir)
+{
+    AddonArchive *archive = findArchive(dir);
+    if (archive)
+        archive->preload();
+}   // preloadArchive
+
+//-----------------------------------------------------------------------------
+/** Frees the memory of all preloaded files of an archive that were not
+ *  read.
+ *  \param dir The directory.
+ */
+void FileManager::releasePreloadedArchive(const std::string &dir)
+{
+    AddonArchive *archive = findArchive(dir);
+    if (archive)
+        archive->releasePreloaded();
+}   // releasePreloadedArchive
+
+//-----------------------------------------------------------------------------
+/** Returns the statistics about reading files from all archives, including
+ *  archives that were already unmounted.
+ */
+AddonArchive::Statistics FileManager::getArchiveStatistics() const
+{
+    AddonArchive::Statistics total = m_unmounted_statistics;
+    for (unsigned int i = 0; i < m_archives.size(); i++)
+    {
+        AddonArchive::Statistics s = m_archives[i]->getStatistics();
+        total.m_opened          += s.m_opened;
+        total.m_cache_hits      += s.m_cache_hits;
+        total.m_bytes           += s.m_bytes;
+        total.m_decompress_usec += s.m_decompress_usec;
+    }
+    return total;
+}   // getArchiveStatistics
+
 //-----------------------------------------------------------------------------
 /** Returns a list of files in a given directory.
  *  \param result A reference to a std::vector<std::string> which will
@@ -1369,6 +1658,42 @@ bool FileManager::removeDirectory(const std::string &name) const
 #endif
 }   // remove directory
 
+// ----------------------------------------------------------------------------
+/** Creates a new, empty directory in the temporary directory of the system,
+ *  e.g. for files written by unit tests. It can be deleted with
+ *  removeDirectory.
+ *  \param prefix Prefix of the name of the directory.
+ *  \return The path of the directory (with a trailing '/'), or "" if no
+ *          directory could be created.
+ */
+std::string FileManager::createTemporaryDirectory(const std::string &prefix)
+{
+#if defined(WIN32)
+    const char *tmp = getenv("TEMP");
+    std::string base = tmp && tmp[0] ? tmp : m_user_config_dir;
+#else
+    const char *tmp = getenv("TMPDIR");
+    std::string base = tmp && tmp[0] ? tmp : "/tmp";
+#endif
+    if (base[base.size() - 1] != '/' && base[base.size() - 1] != '\\')
+        base += "/";
+
+    static unsigned int count = 0;
+    for (unsigned int i = 0; i < 100; i++)
+    {
+        std::ostringstream oss;
+        oss << base << prefix << "-"
+            << (unsigned int)StkTime::getTimeSinceEpoch() << "-" << count++;
+        const std::string dir = oss.str();
+        if (!m_file_system->existFile(io::path(dir.c_str())) &&
+            checkAndCreateDirectory(dir))
+            return dir + "/";
+    }
+    logerror("FileManager", "Can not create a temporary directory in '%s'.",
+             base.c_str());
+    return "";
+}   // createTemporaryDirectory
+
 // ----------------------------------------------------------------------------
 /** Copies the file source to dest.
  *  \param source The file to read.
@@ -34,9 +34,12 @@
 namespace irr { class IrrlichtDevice; }
 using namespace irr;
 
+#include "io/addon_archive.hpp"
 #include "io/xml_node.hpp"
 #include "utils/no_copy.hpp"
 
+class ScanIndex;
+
 struct TextureSearchPath
 {
     std::string m_texture_search_path;
@@ -93,9 +96,31 @@ private:
     /** Directory where resized textures are cached. */
     std::string       m_cached_textures_dir;
 
+    /** Directory where binary versions of XML files are cached. */
+    std::string       m_cached_xml_dir;
+
+    /** Directory where decoded sound effects are cached. */
+    std::string       m_cached_sfx_dir;
+
+    /** Directory where compiled scripts are cached. */
+    std::string       m_cached_scripts_dir;
+
+    /** Directory where linked shader programs are cached. */
+    std::string       m_cached_shaders_dir;
+
     /** Directory where user-defined grand prix are stored. */
     std::string       m_gp_dir;
 
+    /** Index of all directories containing karts or tracks, created
+     *  on first use. */
+    ScanIndex        *m_scan_index;
+
+    /** All mounted addon archives. */
+    std::vector<AddonArchive*> m_archives;
+
+    /** Statistics of archives that were already unmounted. */
+    AddonArchive::Statistics m_unmounted_statistics;
+
     std::vector<TextureSearchPath> m_texture_search_path;
 
     std::vector<std::string>
@@ -118,8 +143,11 @@ private:
     void              checkAndCreateScreenshotDir();
     void              checkAndCreateReplayDir();
     void              checkAndCreateCachedTexturesDir();
+    std::string       checkAndCreateCacheSubdir(const std::string &name);
     void              checkAndCreateGPDir();
     void              discoverPaths();
+    void              mountAddonArchives();
+    AddonArchive     *findArchive(const std::string &dir) const;
 #if !defined(WIN32) && !defined(__CYGWIN__) && !defined(__APPLE__)
     std::string       checkAndCreateLinuxDir(const char *env_name,
                                              const char *dir_name,
@@ -140,14 +168,27 @@ public:
     std::string       getScreenshotDir() const;
     std::string       getReplayDir() const;
     std::string       getCachedTexturesDir() const;
+    std::string       getCachedXMLDir() const;
+    std::string       getCachedSFXDir() const;
+    std::string       getCachedScriptsDir() const;
+    std::string       getCachedShadersDir() const;
     std::string       getGPDir() const;
+    ScanIndex        *getScanIndex();
     bool              checkAndCreateDirectoryP(const std::string &path);
     const std::string &getAddonsDir() const;
     std::string        getAddonsFile(const std::string &name);
     void checkAndCreateDirForAddons(const std::string &dir);
     bool isDirectory(const std::string &path) const;
+    std::string getAddonArchiveName(const std::string &dir) const;
+    bool mountArchive(const std::string &archive_name,
+                      const std::string &dir);
+    void unmountArchive(const std::string &dir);
+    void preloadArchive(const std::string &dir);
+    void releasePreloadedArchive(const std::string &dir);
+    AddonArchive::Statistics getArchiveStatistics() const;
     bool removeFile(const std::string &name) const;
     bool removeDirectory(const std::string &name) const;
+    std::string createTemporaryDirectory(const std::string &prefix);
     bool copyFile(const std::string &source, const std::string &dest);
     std::vector<std::string>getMusicDirs() const;
     std::string getAssetChecked(AssetType type, const std::string& name,
@@ -0,0 +1,274 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/scan_index.hpp"
+
+#include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
+#include "utils/log.hpp"
+
+#include <fstream>
+#include <set>
+#include <sys/stat.h>
+
+/** Version of the index file. Increase it if the format changes. */
+static const int SCAN_INDEX_VERSION = 1;
+
+// ----------------------------------------------------------------------------
+/** Escapes the characters that are not allowed in an XML attribute. The
+ *  string is kept in UTF-8.
+ */
+static std::string escapeAttribute(const std::string &s)
+{
+    std::string result;
+    result.reserve(s.size());
+    for (unsigned int i = 0; i < s.size(); i++)
+    {
+        switch (s[i])
+        {
+        case '&': result += "&amp;";  break;
+        case '<': result += "&lt;";   break;
+        case '>': result += "&gt;";   break;
+        case '"': result += "&quot;"; break;
+        default:  result += s[i];     break;
+        }
+    }
+    return result;
+}   // escapeAttribute
+
+// ----------------------------------------------------------------------------
+/** Creates the index and reads the content of the index file (if it exists).
+ *  \param filename Name of the index file.
+ */
+ScanIndex::ScanIndex(const std::string &filename)
+{
+    m_filename = filename;
+    m_changed  = false;
+    m_hits     = 0;
+    m_misses   = 0;
+    load();
+}   // ScanIndex
+
+// ----------------------------------------------------------------------------
+ScanIndex::~ScanIndex()
+{
+    save();
+}   // ~ScanIndex
+
+// ----------------------------------------------------------------------------
+/** Reads the index file. Any problem with the file just results in an
+ *  empty index, which means that all directories will be scanned.
+ */
+void ScanIndex::load()
+{
+    if (m_filename.empty() || !file_manager->fileExists(m_filename))
+        return;
+
+    XMLNode *root = file_manager->createXMLTree(m_filename);
+    int version = 0;
+    if (!root || root->getName() != "scan-index" ||
+        !root->get("version", &version) || version != SCAN_INDEX_VERSION)
+    {
+        logwarn("ScanIndex", "Ignoring invalid scan index '%s'.",
+                m_filename.c_str());
+        delete root;
+        return;
+    }
+
+    for (unsigned int i = 0; i < root->getNumNodes(); i++)
+    {
+        const XMLNode *dir = root->getNode(i);
+        if (dir->getName() != "dir") continue;
+        std::string path, config;
+        int64_t mtime = 0;
+        dir->get("path",       &path  );
+        dir->get("config",     &config);
+        dir->get("mtime",      &mtime );
+        DirInfo &info = m_dirs[config + "|" + path];
+        info.m_mtime      = (uint64_t)mtime;
+        info.m_has_config = false;
+        dir->get("has-config", &info.m_has_config);
+        for (unsigned int j = 0; j < dir->getNumNodes(); j++)
+        {
+            const XMLNode *sub = dir->getNode(j);
+            SubDir s;
+            int64_t sub_mtime = 0;
+            s.m_has_config = false;
+            sub->get("name",       &s.m_name      );
+            sub->get("mtime",      &sub_mtime     );
+            sub->get("has-config", &s.m_has_config);
+            s.m_mtime = (uint64_t)sub_mtime;
+            info.m_subdirs.push_back(s);
+        }
+    }   // for i < getNumNodes
+    delete root;
+}   // load
+
+// ----------------------------------------------------------------------------
+/** Writes the index file if the index was changed.
+ */
+void ScanIndex::save()
+{
+    if (!m_changed || m_filename.empty())
+        return;
+
+    std::ofstream out(m_filename.c_str(), std::ios::out | std::ios::binary);
+    if (!out.is_open())
+    {
+        logwarn("ScanIndex", "Can not write scan index '%s'.",
+                m_filename.c_str());
+        return;
+    }
+
+    out << "<?xml version=\"1.0\"?>\n";
+    out << "<scan-index version=\"" << SCAN_INDEX_VERSION << "\">\n";
+    std::map<std::string, DirInfo>::const_iterator i;
+    for (i = m_dirs.begin(); i != m_dirs.end(); i++)
+    {
+        const std::string &key = i->first;
+        size_t separator = key.find('|');
+        const DirInfo &info = i->second;
+        out << "  <dir path=\""
+            << escapeAttribute(key.substr(separator + 1))
+            << "\" config=\"" << escapeAttribute(key.substr(0, separator))
+            << "\" mtime=\"" << info.m_mtime
+            << "\" has-config=\"" << (info.m_has_config ? "y" : "n")
+            << "\">\n";
+        for (unsigned int j = 0; j < info.m_subdirs.size(); j++)
+        {
+            const SubDir &s = info.m_subdirs[j];
+            out << "    <subdir name=\"" << escapeAttribute(s.m_name)
+                << "\" mtime=\"" << s.m_mtime
+                << "\" has-config=\"" << (s.m_has_config ? "y" : "n")
+                << "\"/>\n";
+        }
+        out << "  </dir>\n";
+    }
+    out << "</scan-index>\n";
+    m_changed = false;
+}   // save
+
+// ----------------------------------------------------------------------------
+/** Determines the modification time of a file or directory.
+ *  \param path The file or directory.
+ *  \param mtime On return contains the modification time.
+ *  \return False if the path does not exist.
+ */
+bool ScanIndex::getMTime(const std::string &path, uint64_t *mtime)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+    *mtime = (uint64_t)st.st_mtime;
+    return true;
+}   // getMTime
+
+// ----------------------------------------------------------------------------
+/** Tests if the cached information about a directory is still up to date,
+ *  i.e. if neither the directory itself nor any of its subdirectories were
+ *  modified since the index entry was created.
+ */
+bool ScanIndex::isValid(const std::string &dir, const DirInfo &info) const
+{
+    uint64_t mtime;
+    if (!getMTime(dir, &mtime) || mtime != info.m_mtime)
+        return false;
+    for (unsigned int i = 0; i < info.m_subdirs.size(); i++)
+    {
+        const SubDir &s = info.m_subdirs[i];
+        if (!getMTime(dir + s.m_name, &mtime) || mtime != s.m_mtime)
+            return false;
+    }
+    return true;
+}   // isValid
+
+// ----------------------------------------------------------------------------
+/** Scans a directory for the config file: first the directory itself is
+ *  tested, and if it does not contain the config file all subdirectories.
+ *  \param dir The directory to scan (with a trailing '/').
+ *  \param config_file Name of the config file (e.g. "kart.xml").
+ *  \param info On return contains the result of the scan.
+ */
+void ScanIndex::scan(const std::string &dir, const std::string &config_file,
+                     DirInfo *info) const
+{
+    info->m_subdirs.clear();
+    info->m_mtime = 0;
+    getMTime(dir, &info->m_mtime);
+    info->m_has_config = file_manager->fileExists(dir + config_file);
+    if (info->m_has_config)
+        return;
+
+    std::set<std::string> files;
+    file_manager->listFiles(files, dir);
+    for (std::set<std::string>::const_iterator i = files.begin();
+         i != files.end(); i++)
+    {
+        if (*i == "." || *i == "..") continue;
+        SubDir s;
+        s.m_name = *i;
+        // Ignore plain files, only directories can contain content
+        if (!getMTime(dir + *i, &s.m_mtime) ||
+            !file_manager->isDirectory(dir + *i))
+            continue;
+        s.m_has_config = file_manager->fileExists(dir + *i + "/" +
+                                                  config_file);
+        info->m_subdirs.push_back(s);
+    }
+}   // scan
+
+// ----------------------------------------------------------------------------
+/** Returns all directories that contain a certain config file. If the
+ *  search directory itself contains the config file, only an empty string
+ *  is returned, otherwise the names of all subdirectories containing the
+ *  config file. The result is taken from the index if it is still valid.
+ *  \param dir The search directory (with a trailing '/').
+ *  \param config_file Name of the config file (e.g. "kart.xml").
+ *  \param result On return contains the directories relative to dir.
+ */
+void ScanIndex::findContentDirs(const std::string &dir,
+                                const std::string &config_file,
+                                std::vector<std::string> *result)
+{
+    result->clear();
+    const std::string key = config_file + "|" + dir;
+    std::map<std::string, DirInfo>::iterator i = m_dirs.find(key);
+    if (i != m_dirs.end() && isValid(dir, i->second))
+    {
+        m_hits++;
+    }
+    else
+    {
+        m_misses++;
+        scan(dir, config_file, &m_dirs[key]);
+        i = m_dirs.find(key);
+        m_changed = true;
+    }
+
+    const DirInfo &info = i->second;
+    if (info.m_has_config)
+    {
+        result->push_back("");
+        return;
+    }
+    for (unsigned int j = 0; j < info.m_subdirs.size(); j++)
+    {
+        if (info.m_subdirs[j].m_has_config)
+            result->push_back(info.m_subdirs[j].m_name);
+    }
+}   // findContentDirs
@@ -0,0 +1,101 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SCAN_INDEX_HPP
+#define HEADER_SCAN_INDEX_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+  * \brief A persistent index of the directories that contain karts or tracks.
+  *  At startup the kart and track managers need to find all directories
+  *  (in all search paths) that contain a kart.xml or track.xml file. With
+  *  many addons installed this means listing and probing hundreds of
+  *  directories. This index stores the result of the scan together with
+  *  the modification time of every scanned directory, so a warm start only
+  *  reads the index file and stats the directories. Adding or removing a
+  *  directory changes the modification time of its parent, which
+  *  invalidates the cached entry.
+  * \ingroup io
+  */
+class ScanIndex : public NoCopy
+{
+private:
+    /** Information about one scanned subdirectory. */
+    struct SubDir
+    {
+        /** Name of the subdirectory (relative to the search dir). */
+        std::string m_name;
+        /** Modification time of the subdirectory when it was scanned. */
+        uint64_t    m_mtime;
+        /** True if the subdirectory contains the config file. */
+        bool        m_has_config;
+    };   // SubDir
+
+    /** Information about one search directory. */
+    struct DirInfo
+    {
+        /** Modification time of the search directory. */
+        uint64_t            m_mtime;
+        /** True if the search directory itself contains the config file. */
+        bool                m_has_config;
+        /** All subdirectories of the search directory. */
+        std::vector<SubDir> m_subdirs;
+    };   // DirInfo
+
+    /** Maps "config-file|directory" to the scan result for this directory. */
+    std::map<std::string, DirInfo> m_dirs;
+
+    /** Name of the file the index is stored in. */
+    std::string m_filename;
+
+    /** True if the index was modified and needs to be saved. */
+    bool m_changed;
+
+    /** Number of directories found in the index / scanned. */
+    unsigned int m_hits, m_misses;
+
+    static bool getMTime(const std::string &path, uint64_t *mtime);
+    bool isValid(const std::string &dir, const DirInfo &info) const;
+    void scan(const std::string &dir, const std::string &config_file,
+              DirInfo *info) const;
+    void load();
+
+public:
+         ScanIndex(const std::string &filename);
+        ~ScanIndex();
+    void findContentDirs(const std::string &dir,
+                         const std::string &config_file,
+                         std::vector<std::string> *result);
+    void save();
+    // ------------------------------------------------------------------------
+    /** Returns how many search directories were taken from the index and
+     *  how many had to be scanned. */
+    void getStatistics(unsigned int *hits, unsigned int *misses) const
+    {
+        *hits   = m_hits;
+        *misses = m_misses;
+    }   // getStatistics
+};   // ScanIndex
+
+#endif
@@ -22,11 +22,109 @@
 #include "utils/interpolation_array.hpp"
 #include "utils/vec3.hpp"
 
+#include <algorithm>
 #include <stdexcept>
+#include <stdio.h>
 
+// ============================================================================
+/** A simple bump allocator. Memory is taken from large blocks and only freed
+ *  when the whole arena is deleted (i.e. when the root node is deleted).
+ *  This avoids one heap allocation per node, attribute and attribute value.
+ */
+class XMLNode::Arena : public NoCopy
+{
+private:
+    /** Size of each block. Larger requests get their own block. */
+    static const size_t BLOCK_SIZE = 16384;
+
+    /** All allocated blocks. */
+    std::vector<char*> m_blocks;
+
+    /** Number of bytes used in the last block. */
+    size_t m_used;
+
+    /** Size of the last block. */
+    size_t m_block_size;
+
+public:
+    /** Name of the file the nodes were read from, used in warnings. */
+    std::string m_file_name;
+
+    Arena(const std::string &file_name)
+        : m_used(0), m_block_size(0), m_file_name(file_name)
+    {
+    }   // Arena
+    // ------------------------------------------------------------------------
+    ~Arena()
+    {
+        for (unsigned int i = 0; i < m_blocks.size(); i++)
+            delete [] m_blocks[i];
+    }   // ~Arena
+    // ------------------------------------------------------------------------
+    /** Returns size bytes of memory, aligned for any type. */
+    void *allocate(size_t size)
+    {
+        const size_t align = sizeof(double) > sizeof(void*) ? sizeof(double)
+                                                            : sizeof(void*);
+        m_used = (m_used + align - 1) & ~(align - 1);
+        if (m_blocks.empty() || m_used + size > m_block_size)
+        {
+            m_block_size = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+            m_blocks.push_back(new char[m_block_size]);
+            m_used = 0;
+        }
+        void *p = m_blocks.back() + m_used;
+        m_used += size;
+        return p;
+    }   // allocate
+    // ------------------------------------------------------------------------
+    /** Copies a string of the given length into the arena and adds a 0. */
+    const char *addString(const char *s, size_t len)
+    {
+        char *p = (char*)allocate(len + 1);
+        memcpy(p, s, len);
+        p[len] = 0;
+        return p;
+    }   // addString
+};   // Arena
+
+// ============================================================================
+namespace XMLNodeInternal
+{
+    /** Magic number and version at the start of each binary XML file. */
+    const char BINARY_MAGIC[8] = { 'S','T','K','X','M','L','\0','\3' };
+
+    /** Returns the index of a name in the table of attribute names, or the
+     *  size of the table if the name is not in it. */
+    uint32_t findName(const std::vector<const char*> &names, const char *name)
+    {
+        for (unsigned int i = 0; i < names.size(); i++)
+        {
+            if (strcmp(names[i], name) == 0)
+                return i;
+        }
+        return (uint32_t)names.size();
+    }   // findName
+}   // namespace XMLNodeInternal
+using namespace XMLNodeInternal;
+
+// ----------------------------------------------------------------------------
+/** Creates an empty node that uses the given arena. */
+XMLNode::XMLNode(Arena *arena)
+{
+    m_arena          = arena;
+    m_owns_arena     = false;
+    m_attributes     = NULL;
+    m_num_attributes = 0;
+}   // XMLNode(Arena)
+
+// ----------------------------------------------------------------------------
 XMLNode::XMLNode(io::IXMLReader *xml)
 {
-    m_file_name = "[unknown]";
+    m_arena          = new Arena("[unknown]");
+    m_owns_arena     = true;
+    m_attributes     = NULL;
+    m_num_attributes = 0;
 
     while(xml->getNodeType()!=io::EXN_ELEMENT && xml->read());
     readXML(xml);
@@ -38,14 +136,18 @@ XMLNode::XMLNode(io::IXMLReader *xml)
  */
 XMLNode::XMLNode(const std::string &filename)
 {
-    m_file_name = filename;
+    m_attributes     = NULL;
+    m_num_attributes = 0;
+    m_owns_arena     = true;
 
     io::IXMLReader *xml = file_manager->createXMLReader(filename);
     
     if (xml == NULL)
     {
+        m_arena = NULL;
         throw std::runtime_error("Cannot find file "+filename);
     }
+    m_arena = new Arena(filename);
 
     bool is_first_element = true;
     while(xml->read())
@@ -75,14 +177,18 @@ XMLNode::XMLNode(const std::string &filename)
 }   // XMLNode
 
 // ----------------------------------------------------------------------------
-/** Destructor. */
+/** Destructor. The children are allocated in the arena, so only their
+ *  destructors are called. The root node then deletes the arena. Note that
+ *  this means that only a root node can be deleted. */
 XMLNode::~XMLNode()
 {
     for(unsigned int i=0; i<m_nodes.size(); i++)
     {
-        delete m_nodes[i];
+        m_nodes[i]->~XMLNode();
     }
     m_nodes.clear();
+    if (m_owns_arena)
+        delete m_arena;
 }   // ~XMLNode
 
 // ----------------------------------------------------------------------------
@@ -93,11 +199,20 @@ void XMLNode::readXML(io::IXMLReader *xml)
 {
     m_name = std::string(core::stringc(xml->getNodeName()).c_str());
 
-    for(unsigned int i=0; i<xml->getAttributeCount(); i++)
+    m_num_attributes = xml->getAttributeCount();
+    if (m_num_attributes > 0)
+    {
+        m_attributes = (Attribute*)m_arena->allocate(m_num_attributes
+                                                     * sizeof(Attribute));
+    }
+    for(unsigned int i=0; i<m_num_attributes; i++)
     {
-        std::string   name  = core::stringc(xml->getAttributeName(i)).c_str();
-        core::stringw value = xml->getAttributeValue(i);
-        m_attributes[name] = value;
+        std::string name  = core::stringc(xml->getAttributeName(i)).c_str();
+        std::string value = StringUtils::wideToUtf8(xml->getAttributeValue(i));
+        m_attributes[i].m_name  = m_arena->addString(name.c_str(),
+                                                     name.size());
+        m_attributes[i].m_value = m_arena->addString(value.c_str(),
+                                                     value.size());
     }   // for i
 
     // If no children, we are done
@@ -111,9 +226,10 @@ void XMLNode::readXML(io::IXMLReader *xml)
         {
         case io::EXN_ELEMENT:
             {
-                XMLNode* n = new XMLNode(xml);
-                n->m_file_name = m_file_name;
+                XMLNode* n = new (m_arena->allocate(sizeof(XMLNode)))
+                                 XMLNode(m_arena);
                 m_nodes.push_back(n);
+                n->readXML(xml);
                 break;
             }
         case io::EXN_ELEMENT_END:
@@ -128,6 +244,13 @@ void XMLNode::readXML(io::IXMLReader *xml)
     }   // while
 }   // readXML
 
+// ----------------------------------------------------------------------------
+/** Returns the name of the file this node was read from. */
+const std::string &XMLNode::getFileName() const
+{
+    return m_arena->m_file_name;
+}   // getFileName
+
 // ----------------------------------------------------------------------------
 /** Returns the i.th node.
  *  \param i Number of node to return.
@@ -166,6 +289,22 @@ const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) c
     }
 }   // getNode
 
+// ----------------------------------------------------------------------------
+/** Returns the UTF-8 value of the given attribute, or NULL if this node does
+ *  not have this attribute. Nodes usually have only a few attributes, so a
+ *  linear search is used.
+ *  \param attribute Name of the attribute.
+ */
+const char *XMLNode::getAttribute(const std::string &attribute) const
+{
+    for (unsigned int i = 0; i < m_num_attributes; i++)
+    {
+        if (strcmp(m_attributes[i].m_name, attribute.c_str()) == 0)
+            return m_attributes[i].m_value;
+    }
+    return NULL;
+}   // getAttribute
+
 // ----------------------------------------------------------------------------
 /** If 'attribute' was defined, set 'value' to the value of the
 *   attribute and return 1, otherwise return 0 and do not change value.
@@ -174,31 +313,26 @@ const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) c
 */
 int XMLNode::get(const std::string &attribute, std::string *value) const
 {
-    if(m_attributes.empty()) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value=core::stringc(o->second).c_str();
+    const char *v = getAttribute(attribute);
+    if(!v) return 0;
+    *value = v;
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, core::stringw *value) const
 {
-    if(m_attributes.empty()) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value = o->second;
+    const char *v = getAttribute(attribute);
+    if(!v) return 0;
+    *value = StringUtils::utf8ToWide(v);
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::getAndDecode(const std::string &attribute, core::stringw *value) const
 {
-    if (m_attributes.empty()) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if (o == m_attributes.end()) return 0;
-    std::string raw_value = core::stringc(o->second).c_str();
+    const char *v = getAttribute(attribute);
+    if (!v) return 0;
+    // xmlDecode expects one byte per character
+    std::string raw_value = core::stringc(StringUtils::utf8ToWide(v)).c_str();
     *value = StringUtils::xmlDecode(raw_value);
     return 1;
 }   // get
@@ -235,7 +369,7 @@ int XMLNode::get(const std::string &attribute, Vec3 *value) const
     if (v.size() != 3)
     {
         logwarn("[XMLNode]", "WARNING: Expected 3 floating-point values, but found '%s' in file %s",
-                    s.c_str(), m_file_name.c_str());
+                    s.c_str(), getFileName().c_str());
         return 0;
     }
 
@@ -252,7 +386,7 @@ int XMLNode::get(const std::string &attribute, Vec3 *value) const
     else
     {
         logwarn("[XMLNode]", "WARNING: Expected 3 floating-point values, but found '%s' in file %s",
-                    s.c_str(), m_file_name.c_str());
+                    s.c_str(), getFileName().c_str());
         return 0;
     }
 
@@ -317,7 +451,7 @@ int XMLNode::get(const std::string &attribute, int32_t *value) const
     if (!StringUtils::parseString<int>(s, value))
     {
         logwarn("[XMLNode]", "WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name.c_str(), getFileName().c_str());
         return 0;
     }
 
@@ -333,7 +467,7 @@ int XMLNode::get(const std::string &attribute, int64_t *value) const
     if (!StringUtils::parseString<int64_t>(s, value))
     {
         logwarn("[XMLNode]", "WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name.c_str(), getFileName().c_str());
         return 0;
     }
 
@@ -350,7 +484,7 @@ int XMLNode::get(const std::string &attribute, uint16_t *value) const
     if (!StringUtils::parseString<uint16_t>(s, value))
     {
         logwarn("[XMLNode]", "WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name.c_str(), getFileName().c_str());
         return 0;
     }
 
@@ -366,7 +500,7 @@ int XMLNode::get(const std::string &attribute, uint32_t *value) const
     if (!StringUtils::parseString<unsigned int>(s, value))
     {
         logwarn("[XMLNode]", "WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name.c_str(), getFileName().c_str());
         return 0;
     }
 
@@ -382,7 +516,7 @@ int XMLNode::get(const std::string &attribute, float *value) const
     if (!StringUtils::parseString<float>(s, value))
     {
         logwarn("[XMLNode]", "WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name.c_str(), getFileName().c_str());
         return 0;
     }
 
@@ -441,7 +575,7 @@ int XMLNode::get(const std::string &attribute,
         if (!StringUtils::parseString<float>(v[i], &curr))
         {
             logwarn("[XMLNode]", "WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s",
-                        v[i].c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                        v[i].c_str(), attribute.c_str(), m_name.c_str(), getFileName().c_str());
             return 0;
         }
 
@@ -630,4 +764,271 @@ bool XMLNode::hasChildNamed(const char* name) const
         if (m_nodes[i]->getName() == name) return true;
     }
     return false;
-}
+}   // hasChildNamed
+
+// ----------------------------------------------------------------------------
+/** Collects all attribute names used in this node and its children. */
+void XMLNode::collectNames(std::vector<const char*> *names) const
+{
+    for (unsigned int i = 0; i < m_num_attributes; i++)
+    {
+        if (findName(*names, m_attributes[i].m_name) == names->size())
+            names->push_back(m_attributes[i].m_name);
+    }
+    for (unsigned int i = 0; i < m_nodes.size(); i++)
+        m_nodes[i]->collectNames(names);
+}   // collectNames
+
+// ----------------------------------------------------------------------------
+namespace XMLNodeInternal
+{
+    void writeUInt32(std::string *out, uint32_t n)
+    {
+        out->append((const char*)&n, sizeof(n));
+    }   // writeUInt32
+    // ------------------------------------------------------------------------
+    void writeString(std::string *out, const char *s, size_t len)
+    {
+        writeUInt32(out, (uint32_t)len);
+        out->append(s, len);
+    }   // writeString
+    // ------------------------------------------------------------------------
+    bool readUInt32(const char **p, const char *end, uint32_t *n)
+    {
+        if (end - *p < (int)sizeof(uint32_t)) return false;
+        memcpy(n, *p, sizeof(uint32_t));
+        *p += sizeof(uint32_t);
+        return true;
+    }   // readUInt32
+    // ------------------------------------------------------------------------
+    bool readString(const char **p, const char *end, const char **s,
+                    uint32_t *len)
+    {
+        if (!readUInt32(p, end, len) || (uint32_t)(end - *p) < *len)
+            return false;
+        *s  = *p;
+        *p += *len;
+        return true;
+    }   // readString
+}   // namespace XMLNodeInternal
+
+// ----------------------------------------------------------------------------
+/** Appends the binary representation of this node and all its children.
+ *  \param out The string to append the data to.
+ *  \param names The table of attribute names (attributes are stored as
+ *         indices into this table).
+ */
+void XMLNode::writeBinary(std::string *out,
+                          const std::vector<const char*> &names) const
+{
+    writeString(out, m_name.c_str(), m_name.size());
+    writeUInt32(out, m_num_attributes);
+    for (unsigned int i = 0; i < m_num_attributes; i++)
+    {
+        writeUInt32(out, findName(names, m_attributes[i].m_name));
+        writeString(out, m_attributes[i].m_value,
+                    strlen(m_attributes[i].m_value));
+    }
+    writeUInt32(out, (uint32_t)m_nodes.size());
+    for (unsigned int i = 0; i < m_nodes.size(); i++)
+        m_nodes[i]->writeBinary(out, names);
+}   // writeBinary
+
+// ----------------------------------------------------------------------------
+/** Reads this node and all its children from the binary representation.
+ *  \param p Pointer to the current read position, will be updated.
+ *  \param end End of the data.
+ *  \param names The table of attribute names.
+ *  \return False if the data is corrupt.
+ */
+bool XMLNode::readBinary(const char **p, const char *end,
+                         const std::vector<const char*> &names)
+{
+    const char *s;
+    uint32_t len;
+    if (!readString(p, end, &s, &len)) return false;
+    m_name.assign(s, len);
+
+    uint32_t count;
+    if (!readUInt32(p, end, &count) || count > (uint32_t)(end - *p))
+        return false;
+    m_attributes = count ? (Attribute*)m_arena->allocate(count
+                                                         * sizeof(Attribute))
+                         : NULL;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        uint32_t index;
+        if (!readUInt32(p, end, &index) || index >= names.size() ||
+            !readString(p, end, &s, &len))
+            return false;
+        m_attributes[i].m_name  = names[index];
+        m_attributes[i].m_value = m_arena->addString(s, len);
+        m_num_attributes = i+1;
+    }
+
+    if (!readUInt32(p, end, &count) || count > (uint32_t)(end - *p))
+        return false;
+    m_nodes.reserve(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        XMLNode *n = new (m_arena->allocate(sizeof(XMLNode))) XMLNode(m_arena);
+        m_nodes.push_back(n);
+        if (!n->readBinary(p, end, names))
+            return false;
+    }
+    return true;
+}   // readBinary
+
+// ----------------------------------------------------------------------------
+/** Saves this node and all its children in a binary file, which can be read
+ *  much faster than the XML file. The size and modification time of the
+ *  original XML file are stored, and used in loadBinary to detect if the
+ *  binary file is outdated.
+ *  \param filename Name of the binary file.
+ *  \param size Size of the XML file.
+ *  \param mtime Modification time of the XML file.
+ *  \return True if the file was written successfully.
+ */
+bool XMLNode::saveBinary(const std::string &filename, uint64_t size,
+                         uint64_t mtime) const
+{
+    std::vector<const char*> names;
+    collectNames(&names);
+
+    std::string out(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    out.append((const char*)&size, sizeof(size));
+    out.append((const char*)&mtime, sizeof(mtime));
+    writeString(&out, getFileName().c_str(), getFileName().size());
+    writeUInt32(&out, (uint32_t)names.size());
+    for (unsigned int i = 0; i < names.size(); i++)
+        writeString(&out, names[i], strlen(names[i]));
+    writeBinary(&out, names);
+
+    // Write to a temporary file first, so that a concurrent reader never
+    // sees a partially written file.
+    std::string tmp = filename + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = fclose(f) == 0 && ok;
+    if (ok)
+    {
+        remove(filename.c_str());
+        ok = rename(tmp.c_str(), filename.c_str()) == 0;
+    }
+    if (!ok)
+        remove(tmp.c_str());
+    return ok;
+}   // saveBinary
+
+// ----------------------------------------------------------------------------
+/** Loads a node tree from a binary file written by saveBinary.
+ *  \param filename Name of the binary file.
+ *  \param source Name of the original XML file.
+ *  \param size Size of the XML file.
+ *  \param mtime Modification time of the XML file.
+ *  \return The root node, or NULL if the binary file does not exist, is
+ *          corrupt or was created from a different version of the XML file.
+ */
+XMLNode *XMLNode::loadBinary(const std::string &filename,
+                             const std::string &source, uint64_t size,
+                             uint64_t mtime)
+{
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f) return NULL;
+    std::vector<char> data;
+    char buffer[16384];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        data.insert(data.end(), buffer, buffer + n);
+    fclose(f);
+
+    const size_t header = sizeof(BINARY_MAGIC) + 2 * sizeof(uint64_t);
+    if (data.size() < header ||
+        memcmp(data.data(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)
+        return NULL;
+    uint64_t file_size, file_mtime;
+    memcpy(&file_size, data.data() + sizeof(BINARY_MAGIC), sizeof(uint64_t));
+    memcpy(&file_mtime, data.data() + sizeof(BINARY_MAGIC) + sizeof(uint64_t),
+           sizeof(uint64_t));
+    if (file_size != size || file_mtime != mtime)
+        return NULL;
+
+    const char *p   = data.data() + header;
+    const char *end = data.data() + data.size();
+    const char *s;
+    uint32_t len, count;
+    // Different files can map to the same cache name, check the full name
+    if (!readString(&p, end, &s, &len) || source != std::string(s, len))
+        return NULL;
+    if (!readUInt32(&p, end, &count) || count > (uint32_t)(end - p))
+        return NULL;
+
+    // All attributes with the same name share one copy of the name
+    XMLNode *root = new XMLNode(new Arena(source));
+    root->m_owns_arena = true;
+    std::vector<const char*> names;
+    names.reserve(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!readString(&p, end, &s, &len))
+        {
+            delete root;
+            return NULL;
+        }
+        names.push_back(root->m_arena->addString(s, len));
+    }
+
+    if (!root->readBinary(&p, end, names) || p != end)
+    {
+        delete root;
+        return NULL;
+    }
+    return root;
+}   // loadBinary
+
+// ----------------------------------------------------------------------------
+/** Checks that an XML tree can be saved and loaded in binary form without
+ *  any changes.
+ */
+void XMLNode::unitTesting()
+{
+    XMLNode *root = file_manager->createXMLTreeFromString(
+        "<root a=\"1\" b=\"text\">\n"
+        "  <child x=\"1.5\" y=\"2 3 4\"/>\n"
+        "  <child name=\"caf\xc3\xa9\"><inner a=\"true\"/></child>\n"
+        "  <empty/>\n"
+        "</root>");
+    assert(root);
+    int i;
+    assert(root->get("a", &i) == 1 && i == 1);
+    (void)i;   // avoid compiler warning with NDEBUG
+    std::string s;
+    assert(root->get("missing", &s) == 0);
+    assert(root->getNumNodes() == 3);
+    core::stringw w;
+    assert(root->getNode(1)->get("name", &w) == 1);
+    assert(w.size() == 4 && w[3] == 0xe9);
+
+    std::string name = file_manager->getCachedXMLDir() + "unit-test.bin";
+    assert(root->saveBinary(name, 1234, 5678));
+    assert(loadBinary(name, "[unknown]", 1234, 9999) == NULL);   // other time
+    assert(loadBinary(name, "[unknown]", 1235, 5678) == NULL);   // other size
+    XMLNode *copy = loadBinary(name, "[unknown]", 1234, 5678);
+    assert(copy);
+    assert(copy->getName() == "root" && copy->getNumNodes() == 3);
+    assert(copy->get("b", &s) == 1 && s == "text");
+    float f;
+    assert(copy->getNode(0)->get("x", &f) == 1 && f == 1.5f);
+    (void)f;   // avoid compiler warning with NDEBUG
+    std::vector<float> v;
+    assert(copy->getNode(0)->get("y", &v) == 3 && v[2] == 4.0f);
+    assert(copy->getNode(1)->get("name", &s) == 1 && s == "caf\xc3\xa9");
+    bool b = false;
+    assert(copy->getNode(1)->getNode(0)->get("a", &b) == 1 && b);
+    (void)b;   // avoid compiler warning with NDEBUG
+    assert(copy->getNode("empty") && copy->getNode("empty")->getNumNodes()==0);
+    delete copy;
+    delete root;
+    file_manager->removeFile(name);
+}   // unitTesting
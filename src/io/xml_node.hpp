@@ -20,7 +20,6 @@
 #define HEADER_XML_NODE_HPP
 
 #include <string>
-#include <map>
 #include <vector>
 
 #include <irrString.h>
@@ -46,16 +45,40 @@ class Vec3;
 class XMLNode : public NoCopy
 {
 private:
+    /** Memory for all child nodes, attributes and attribute values of one
+     *  XML file. It is owned by the root node. */
+    class Arena;
+
+    /** One attribute. Name and value are 0-terminated UTF-8 strings in the
+     *  arena. */
+    struct Attribute
+    {
+        const char *m_name;
+        const char *m_value;
+    };   // Attribute
+
     /** Name of this element. */
     std::string                          m_name;
-    /** List of all attributes. */
-    std::map<std::string, core::stringw> m_attributes;
-    /** List of all sub nodes. */
+    /** List of all attributes, allocated in the arena. */
+    Attribute                           *m_attributes;
+    /** Number of attributes. */
+    unsigned int                         m_num_attributes;
+    /** List of all sub nodes, which are allocated in the arena. */
     std::vector<XMLNode *>               m_nodes;
+    /** The arena of the file this node belongs to. */
+    Arena                               *m_arena;
+    /** True for the root node, which owns (and deletes) the arena. */
+    bool                                 m_owns_arena;
 
+         XMLNode(Arena *arena);
     void readXML(io::IXMLReader *xml);
-
-    std::string                          m_file_name;
+    bool readBinary(const char **p, const char *end,
+                    const std::vector<const char*> &names);
+    void writeBinary(std::string *out,
+                     const std::vector<const char*> &names) const;
+    void collectNames(std::vector<const char*> *names) const;
+    const char *getAttribute(const std::string &attribute) const;
+    const std::string &getFileName() const;
 
 public:
          LEAK_CHECK();
@@ -66,6 +89,13 @@ public:
 
         ~XMLNode();
 
+    static XMLNode *loadBinary(const std::string &filename,
+                               const std::string &source, uint64_t size,
+                               uint64_t mtime);
+    bool            saveBinary(const std::string &filename, uint64_t size,
+                               uint64_t mtime) const;
+    static void     unitTesting();
+
     const std::string &getName() const {return m_name; }
     const XMLNode     *getNode(const std::string &name) const;
     const void         getNodes(const std::string &s, std::vector<XMLNode*>& out) const;
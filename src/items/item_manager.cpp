@@ -163,6 +163,7 @@ ItemManager::ItemManager()
         // Entries 0 to n-1 are for the quads, entry
         // n is for all items that are not on a quad.
         m_items_in_quads->resize(Graph::get()->getNumNodes()+1);
+        m_live_items.resize(Item::ITEM_COUNT);
     }
     else
     {
@@ -232,8 +233,92 @@ void ItemManager::insertItem(Item *item)
         else  // otherwise store it in the 'outside' index
             (*m_items_in_quads)[m_items_in_quads->size()-1].push_back(item);
     }   // if m_items_in_quads
+    addLiveItem(item);
 }   // insertItem
 
+//-----------------------------------------------------------------------------
+/** Adds an item that is not collected to the list of live items, if it is
+ *  on the graph.
+ *  \param item The item to add.
+ */
+void ItemManager::addLiveItem(Item *item)
+{
+    if(m_live_items.empty() || item->getGraphNode()==Graph::UNKNOWN_SECTOR)
+        return;
+    m_live_items[item->getType()].push_back(item);
+}   // addLiveItem
+
+//-----------------------------------------------------------------------------
+/** Removes an item from the list of live items. The item must have the same
+ *  type as when it was added. Nothing is done if the item is not in the list
+ *  (e.g. it is not on the graph).
+ *  \param item The item to remove.
+ */
+void ItemManager::removeLiveItem(Item *item)
+{
+    if(m_live_items.empty()) return;
+    AllItemTypes &items = m_live_items[item->getType()];
+    AllItemTypes::iterator it = std::find(items.begin(), items.end(), item);
+    if(it==items.end()) return;
+    // The order is not important, so avoid moving all following items
+    *it = items.back();
+    items.pop_back();
+}   // removeLiveItem
+
+//-----------------------------------------------------------------------------
+/** Switches one item to the type it is mapped to, or back to its original
+ *  type, and keeps the list of live items up to date.
+ *  \param item The item to switch.
+ *  \param switch_back True if the item should get its original type again.
+ */
+void ItemManager::switchItem(Item *item, bool switch_back)
+{
+    const bool live = !item->wasCollected();
+    if(live) removeLiveItem(item);
+    if(switch_back)
+        item->switchBack();
+    else
+    {
+        Item::ItemType new_type = m_switch_to[item->getType()];
+        item->switchTo(new_type, m_item_mesh[(int)new_type],
+                       m_item_lowres_mesh[(int)new_type]);
+    }
+    if(live) addLiveItem(item);
+}   // switchItem
+
+//-----------------------------------------------------------------------------
+/** Returns the item that is not collected and has the shortest distance on
+ *  the arena graph to the given node, or NULL if there is no such item. Only
+ *  the live item lists are searched, so the costs depend on the number of
+ *  items and not on the size of the graph.
+ *  \param node The node to measure the distance from.
+ *  \param type_mask Bit i is set if items of type i should be considered.
+ */
+Item* ItemManager::getClosestItem(int node, unsigned int type_mask) const
+{
+    if(m_live_items.empty() || node==Graph::UNKNOWN_SECTOR) return NULL;
+    const ArenaGraph *graph = ArenaGraph::get();
+    if(!graph) return NULL;
+
+    Item *closest  = NULL;
+    float distance = 999999.9f;
+    for(unsigned int type=Item::ITEM_FIRST; type<Item::ITEM_COUNT; type++)
+    {
+        if((type_mask & (1 << type))==0) continue;
+        const AllItemTypes &items = m_live_items[type];
+        for(unsigned int i=0; i<items.size(); i++)
+        {
+            float d = graph->getDistance(items[i]->getGraphNode(), node);
+            if(d<=distance)
+            {
+                closest  = items[i];
+                distance = d;
+            }
+        }
+    }
+    return closest;
+}   // getClosestItem
+
 //-----------------------------------------------------------------------------
 /** Creates a new item.
  *  \param type Type of the item.
@@ -257,11 +342,7 @@ Item* ItemManager::newItem(Item::ItemType type, const Vec3& xyz,
     insertItem(item);
     if(parent != NULL) item->setParent(parent);
     if(m_switch_time>=0)
-    {
-        Item::ItemType new_type = m_switch_to[item->getType()];
-        item->switchTo(new_type, m_item_mesh[(int)new_type],
-                       m_item_lowres_mesh[(int)new_type]);
-    }
+        switchItem(item, /*switch_back*/false);
     return item;
 }   // newItem
 
@@ -294,7 +375,10 @@ void ItemManager::collectedItem(Item *item, AbstractKart *kart, int add_info)
         // shielded karts can simply drive over bubble gums without any effect.
         return;
     }
+    const bool was_collected = item->wasCollected();
     item->collected(kart);
+    if(!was_collected && item->wasCollected())
+        removeLiveItem(item);
     kart->collectedItem(item, add_info);
 }   // collectedItem
 
@@ -378,6 +462,15 @@ void ItemManager::reset()
         }
     }  // whilem_all_items.end() i
 
+    // Resetting items can change their type and makes all of them visible
+    // again, so just rebuild the list of live items.
+    for(unsigned int j=0; j<m_live_items.size(); j++)
+        m_live_items[j].clear();
+    for(i=m_all_items.begin(); i!=m_all_items.end(); i++)
+    {
+        if(*i && !(*i)->wasCollected()) addLiveItem(*i);
+    }
+
     m_switch_time = -1;
 }   // reset
 
@@ -397,7 +490,7 @@ void ItemManager::update(float dt)
             for(AllItemTypes::iterator i =m_all_items.begin();
                 i!=m_all_items.end();  i++)
             {
-                if(*i) (*i)->switchBack();
+                if(*i) switchItem(*i, /*switch_back*/true);
             }   // for m_all_items
         }   // m_switch_time < 0
     }   // m_switch_time>=0
@@ -407,7 +500,11 @@ void ItemManager::update(float dt)
     {
         if(*i)
         {
+            const bool was_collected = (*i)->wasCollected();
             (*i)->update(dt);
+            // A collected item might have reappeared
+            if(was_collected && !(*i)->wasCollected())
+                addLiveItem(*i);
             if( (*i)->isUsedUp())
             {
                 deleteItem( *i );
@@ -435,6 +532,8 @@ void ItemManager::deleteItem(Item *item)
         assert(it!=items.end());
         items.erase(it);
     }   // if m_items_in_quads
+    if(!item->wasCollected())
+        removeLiveItem(item);
 
     int index = item->getItemId();
     m_all_items[index] = NULL;
@@ -460,12 +559,7 @@ void ItemManager::switchItems()
             }
         }
 
-        Item::ItemType new_type = m_switch_to[(*i)->getType()];
-
-        if(m_switch_time<0)
-            (*i)->switchTo(new_type, m_item_mesh[(int)new_type], m_item_lowres_mesh[(int)new_type]);
-        else
-            (*i)->switchBack();
+        switchItem(*i, /*switch_back*/m_switch_time>=0);
     }   // for m_all_items
 
     // if the items are already switched (m_switch_time >=0)
@@ -85,6 +85,12 @@ private:
      *  field is undefined if no Graph exist, e.g. arena without navmesh. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** All items that are on the graph and not collected, one list for
+     *  each item type. This allows the AI to find the closest item without
+     *  testing all quads. It is updated whenever an item is added, deleted,
+     *  collected, reappears or is switched. Empty if there is no graph. */
+    std::vector< AllItemTypes > m_live_items;
+
     /** What item this item is switched to. */
     std::vector<Item::ItemType> m_switch_to;
 
@@ -94,6 +100,9 @@ private:
 
     void  insertItem(Item *item);
     void  deleteItem(Item *item);
+    void  addLiveItem(Item *item);
+    void  removeLiveItem(Item *item);
+    void  switchItem(Item *item, bool switch_back);
 
     // Make those private so only create/destroy functions can call them.
                    ItemManager();
@@ -112,6 +121,7 @@ public:
     void           collectedItem   (Item *item, AbstractKart *kart,
                                     int add_info=-1);
     void           switchItems     ();
+    Item*          getClosestItem  (int node, unsigned int type_mask) const;
     // ------------------------------------------------------------------------
     bool           randomItemsForArena(const AlignedArray<btTransform>& pos);
     // ------------------------------------------------------------------------
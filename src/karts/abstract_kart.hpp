@@ -402,6 +402,12 @@ public:
      *  which includes attaching an anvil to the kart (and detaching). */
     virtual void updateWeight() = 0;
     // ------------------------------------------------------------------------
+    /** Called for all karts before the controllers decide on their actions
+     *  for this time step (see Controller::decide()). It updates the data
+     *  of the kart that the controllers read, e.g. position and speed. If
+     *  it is not called, update() will do this work. */
+    virtual void preUpdate(float dt) {}
+    // ------------------------------------------------------------------------
     /** Multiplies the velocity of the kart by a factor f (both linear
      *  and angular). This is used by anvils, which suddenly slow down the kart
      *  when they are attached. */
@@ -575,7 +575,6 @@ void ArenaAI::useItems(const float dt)
  */
 void ArenaAI::tryCollectItem(Vec3* aim_point, int* target_node) const
 {
-    float distance = 999999.9f;
     Item* selected = (*target_node == Graph::UNKNOWN_SECTOR ? NULL :
         ItemManager::get()->getFirstItemInQuad(*target_node));
 
@@ -589,31 +588,18 @@ void ArenaAI::tryCollectItem(Vec3* aim_point, int* target_node) const
         return;
     }
 
-    for (unsigned int i = 0; i < m_graph->getNumNodes(); i++)
+    unsigned int type_mask = ((1 << Item::ITEM_COUNT) - 1) &
+        ~((1 << Item::ITEM_BANANA) | (1 << Item::ITEM_BUBBLEGUM) |
+          (1 << Item::ITEM_BUBBLEGUM_NOLOK));
+    // Ignore nitro when already has some
+    if (m_kart->getEnergy() >
+        m_kart->getKartProperties()->getNitroSmallContainer())
     {
-        Item* cur_item = ItemManager::get()->getFirstItemInQuad(i);
-        if (cur_item == NULL) continue;
-        if (cur_item->wasCollected() ||
-            cur_item->getType() == Item::ITEM_BANANA ||
-            cur_item->getType() == Item::ITEM_BUBBLEGUM ||
-            cur_item->getType() == Item::ITEM_BUBBLEGUM_NOLOK)
-            continue;
-
-        if ((cur_item->getType() == Item::ITEM_NITRO_BIG ||
-             cur_item->getType() == Item::ITEM_NITRO_SMALL) &&
-            (m_kart->getEnergy() >
-             m_kart->getKartProperties()->getNitroSmallContainer()))
-                continue; // Ignore nitro when already has some
-
-        const int cur_node = cur_item->getGraphNode();
-        assert(cur_node != Graph::UNKNOWN_SECTOR);
-        float test_distance = m_graph->getDistance(cur_node, getCurrentNode());
-        if (test_distance <= distance)
-        {
-            selected = cur_item;
-            distance = test_distance;
-        }
+        type_mask &= ~((1 << Item::ITEM_NITRO_BIG) |
+                       (1 << Item::ITEM_NITRO_SMALL));
     }
+    selected = ItemManager::get()->getClosestItem(getCurrentNode(),
+                                                  type_mask);
 
     if (selected != NULL)
     {
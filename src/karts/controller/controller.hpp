@@ -109,6 +109,17 @@ public:
     // ------------------------------------------------------------------------
     /** Returns the kart controlled by this controller. */
     AbstractKart *getKart() const { return m_kart; }
+    // ------------------------------------------------------------------------
+    /** Returns true if this controller can compute its actions in decide(),
+     *  which is called for all karts (possibly in parallel) before any kart
+     *  is updated. */
+    virtual bool  canDecideInParallel() const { return false; }
+    // ------------------------------------------------------------------------
+    /** Computes the actions for this time step. This is only called if
+     *  canDecideInParallel() returns true. It must only read the world and
+     *  only modify the controller and its kart controls; any changes to the
+     *  world must be done in the following update() call. */
+    virtual void  decide(float dt) {}
 };   // Controller
 
 #endif
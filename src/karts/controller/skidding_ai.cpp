@@ -25,6 +25,7 @@
 #  include "graphics/irr_driver.hpp"
 #  include "graphics/stk_tex_manager.hpp"
 #endif
+#include "config/user_config.hpp"
 #include "graphics/show_curve.hpp"
 #include "graphics/slip_stream.hpp"
 #include "items/attachment.hpp"
@@ -40,11 +41,15 @@
 #include "karts/skidding.hpp"
 #include "modes/linear_world.hpp"
 #include "modes/profile_world.hpp"
+#include "network/rewind_manager.hpp"
 #include "physics/triangle_mesh.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/drive_graph.hpp"
+#include "tracks/racing_line.hpp"
 #include "tracks/track.hpp"
+#include "tracks/track_manager.hpp"
 #include "utils/constants.hpp"
+#include "utils/job_system.hpp"
 #include "utils/log.hpp"
 #include "utils/vs.hpp"
 
@@ -53,6 +58,7 @@
    using namespace irr;
 #endif
 
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
@@ -67,7 +73,10 @@ SkiddingAI::SkiddingAI(AbstractKart *kart)
     // for the final race challenge against nolok.
     m_superpower = race_manager->getAISuperPower();
 
-    m_point_selection_algorithm = PSA_DEFAULT;
+    m_point_selection_algorithm = (PointSelectionAlgorithm)
+                                  UserConfigParams::m_ai_point_selection;
+    m_decision_time = 0;
+    m_num_decisions = 0;
     setControllerName("Skidding");
 
     // Use this define in order to compare the different algorithms that
@@ -82,6 +91,7 @@ SkiddingAI::SkiddingAI(AbstractKart *kart)
     case PSA_FIXED   : name = "Fixed";   break;
     case PSA_NEW     : name = "New";     break;
     case PSA_DEFAULT : name = "Default"; break;
+    case PSA_CACHED  : name = "Cached";  break;
     }
     setControllerName(name);
 #endif
@@ -178,6 +188,10 @@ void SkiddingAI::reset()
     m_avoid_item_close           = false;
     m_skid_probability_state     = SKID_PROBAB_NOT_YET;
     m_last_item_random           = NULL;
+    m_random_seed                = (unsigned int)rand();
+    m_decision_done              = false;
+    m_rescue_requested           = false;
+    m_speed_cap                  = -1.0f;
 
     AIBaseLapController::reset();
     m_track_node               = Graph::UNKNOWN_SECTOR;
@@ -215,13 +229,106 @@ unsigned int SkiddingAI::getNextSector(unsigned int index)
     return m_successor_index[index];
 }   // getNextSector
 
+//-----------------------------------------------------------------------------
+/** Returns a pseudo random number between 0 and n-1 inclusive. Each AI has
+ *  its own generator, so the result does not depend on the order in which
+ *  the AIs decide (or if they decide in parallel).
+ *  \param n Upper bound (exclusive).
+ */
+int SkiddingAI::getRandom(int n)
+{
+    m_random_seed = m_random_seed*1103515245 + 12345;
+    // The lower bits have a short cycle, so only use the higher bits
+    return (int)((m_random_seed >> 8) % (unsigned int)n);
+}   // getRandom
+
+//-----------------------------------------------------------------------------
+/** Returns a pseudo random number between 0 and 1. */
+float SkiddingAI::getRandomFraction()
+{
+    return getRandom(10001) / 10000.0f;
+}   // getRandomFraction
+
+//-----------------------------------------------------------------------------
+/** Returns true if the AI can decide on its actions in parallel with the
+ *  other karts. The Nolok boss gives itself powerups, the AI debug output
+ *  creates scene nodes, and with rewinding enabled each change of the
+ *  kart controls is recorded in the rewind manager: in these cases all
+ *  decisions are done in update().
+ */
+bool SkiddingAI::canDecideInParallel() const
+{
+#ifdef AI_DEBUG
+    return false;
+#else
+    return m_superpower != RaceManager::SUPERPOWER_NOLOK_BOSS &&
+           !m_ai_debug && !RewindManager::isEnabled();
+#endif
+}   // canDecideInParallel
+
 //-----------------------------------------------------------------------------
 /** This is the main entry point for the AI.
- *  It is called once per frame for each AI and determines the behaviour of
- *  the AI, e.g. steering, accelerating/braking, firing.
+ *  It is called once per frame for each AI and applies the decisions of
+ *  decide(), which is done before by the world for all karts. If decide()
+ *  was not called, it is done now.
  */
 void SkiddingAI::update(float dt)
 {
+    if(!m_decision_done)
+        decide(dt);
+    m_decision_done = false;
+
+    // Don't do anything if there is currently a kart animations shown.
+    if(m_kart->getKartAnimation())
+    {
+        m_rescue_requested = false;
+        m_speed_cap        = -1.0f;
+        return;
+    }
+
+    if(m_speed_cap>=0)
+    {
+        m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI, m_speed_cap,
+                            /*fade_in_time*/0.0f);
+        m_speed_cap = -1.0f;
+    }
+
+    if(m_rescue_requested)
+    {
+        new RescueAnimation(m_kart);
+        m_rescue_requested = false;
+    }
+
+    /*And obviously general kart stuff*/
+    AIBaseLapController::update(dt);
+}   // update
+
+//-----------------------------------------------------------------------------
+/** Determines the behaviour of the AI, e.g. steering, accelerating/braking,
+ *  firing, based on the current state of the world. It only sets the kart
+ *  controls and the state of the AI, any changes to the world (rescue,
+ *  rubber-banding) are done in update(). This allows the decisions of all
+ *  AIs to be computed in parallel.
+ *  \param dt Time step size.
+ */
+void SkiddingAI::decide(float dt)
+{
+    using namespace std::chrono;
+    const steady_clock::time_point start = steady_clock::now();
+    decideControls(dt);
+    m_decision_time += duration_cast<microseconds>(steady_clock::now()
+                                                   - start).count();
+    m_num_decisions++;
+}   // decide
+
+//-----------------------------------------------------------------------------
+/** Implements decide(), which only adds the time measurement.
+ *  \param dt Time step size.
+ */
+void SkiddingAI::decideControls(float dt)
+{
+    m_decision_done = true;
+
     // This is used to enable firing an item backwards.
     m_controls->setLookBack(false);
     m_controls->setNitro(false);
@@ -236,7 +343,7 @@ void SkiddingAI::update(float dt)
         {
             if (m_kart->getPosition() > 1)
             {
-                int r = rand() % 5;
+                int r = getRandom(5);
                 if (r == 0 || r == 1)
                     m_kart->setPowerup(PowerupManager::POWERUP_ZIPPER, 1);
                 else if (r == 2 || r == 3)
@@ -246,7 +353,7 @@ void SkiddingAI::update(float dt)
             }
             else if (m_kart->getAttachment()->getType() == Attachment::ATTACH_SWATTER)
             {
-                int r = rand() % 4;
+                int r = getRandom(4);
                 if (r < 3)
                     m_kart->setPowerup(PowerupManager::POWERUP_BUBBLEGUM, 1);
                 else
@@ -254,7 +361,7 @@ void SkiddingAI::update(float dt)
             }
             else
             {
-                int r = rand() % 5;
+                int r = getRandom(5);
                 if (r == 0 || r == 1)
                     m_kart->setPowerup(PowerupManager::POWERUP_BUBBLEGUM, 1);
                 else if (r == 2 || r == 3)
@@ -294,24 +401,20 @@ void SkiddingAI::update(float dt)
     // If the kart needs to be rescued, do it now (and nothing else)
     if(isStuck() && !m_kart->getKartAnimation())
     {
-        new RescueAnimation(m_kart);
-        AIBaseLapController::update(dt);
+        m_rescue_requested = true;
         return;
     }
 
     if( m_world->isStartPhase() )
     {
         handleRaceStart();
-        AIBaseLapController::update(dt);
         return;
     }
 
     // Get information that is needed by more than 1 of the handling funcs
     computeNearestKarts();
 
-    m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI,
-                        m_ai_properties->getSpeedCap(m_distance_to_player),
-                        /*fade_in_time*/0.0f);
+    m_speed_cap = m_ai_properties->getSpeedCap(m_distance_to_player);
     //Detect if we are going to crash with the track and/or kart
     checkCrashes(m_kart->getXYZ());
     determineTrackDirection();
@@ -370,16 +473,13 @@ void SkiddingAI::update(float dt)
         // time in time trial at start up, so during the first 5 seconds
         // this is done at random only.
         if(race_manager->getMinorMode()!=RaceManager::MINOR_MODE_TIME_TRIAL ||
-            (m_world->getTime()<3.0f && rand()%50==1) )
+            (m_world->getTime()<3.0f && getRandom(50)==1) )
         {
             m_controls->setNitro(false);
             m_controls->setFire(true);
         }
     }
-
-    /*And obviously general kart stuff*/
-    AIBaseLapController::update(dt);
-}   // update
+}   // decideControls
 
 //-----------------------------------------------------------------------------
 /** This function decides if the AI should brake.
@@ -542,6 +642,8 @@ void SkiddingAI::handleSteering(float dt)
                          break;
         case PSA_DEFAULT:findNonCrashingPoint(&aim_point, &last_node);
                          break;
+        case PSA_CACHED: findNonCrashingPointCached(&aim_point, &last_node);
+                         break;
         }
 #ifdef AI_DEBUG
         m_debug_sphere[m_point_selection_algorithm]->setPosition(aim_point.toIrrVector());
@@ -734,7 +836,7 @@ void SkiddingAI::handleItemCollectionAndAvoidance(Vec3 *aim_point,
         {
             int p = (int)(100.0f*m_ai_properties->
                           getItemCollectProbability(m_distance_to_player));
-            m_really_collect_item = m_random_collect_item.get(100)<p;
+            m_really_collect_item = getRandom(100)<p;
             m_last_item_random = items_to_collect[0];
         }
         if(!m_really_collect_item)
@@ -1167,7 +1269,7 @@ void SkiddingAI::handleItems(const float dt)
             else
             {
                 // to make things less predictable :)
-                m_time_since_last_shot = (rand() % 1000) / 1000.0f * 3.0f - 2.0f;
+                m_time_since_last_shot = getRandom(1000) / 1000.0f * 3.0f - 2.0f;
             }
         }
         else
@@ -1545,7 +1647,7 @@ void SkiddingAI::handleRaceStart()
         // Each kart starts at a different, random time, and the time is
         // smaller depending on the difficulty.
         m_start_delay = m_ai_properties->m_min_start_delay
-                      + (float) rand() / RAND_MAX
+                      + getRandomFraction()
                       * (m_ai_properties->m_max_start_delay -
                          m_ai_properties->m_min_start_delay);
 
@@ -1554,7 +1656,7 @@ void SkiddingAI::handleRaceStart()
                ? 0.0f  : m_ai_properties->m_false_start_probability;
 
         // Now check for a false start. If so, add 1 second penalty time.
-        if(rand() < RAND_MAX * false_start_probability)
+        if(getRandomFraction() < false_start_probability)
         {
             m_start_delay+=stk_config->m_penalty_time;
             return;
@@ -1575,7 +1677,8 @@ void SkiddingAI::handleRescue(const float dt)
         m_time_since_stuck += dt;
         if(m_time_since_stuck > 2.0f)
         {
-            new RescueAnimation(m_kart);
+            // The rescue is started in update()
+            m_rescue_requested = true;
             m_time_since_stuck=0.0f;
         }   // m_time_since_stuck > 2.0f
     }
@@ -1835,26 +1938,21 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
 */
 void SkiddingAI::findNonCrashingPointNew(Vec3 *result, int *last_node)
 {
-    *last_node = m_next_node_index[m_track_node];
-    const core::vector2df xz = m_kart->getXYZ().toIrrVector2d();
-
-    const DriveNode* dn = DriveGraph::get()->getNode(*last_node);
-
-    // Index of the left and right end of a quad.
-    const unsigned int LEFT_END_POINT  = 0;
-    const unsigned int RIGHT_END_POINT = 1;
-    core::line2df left (xz, (*dn)[LEFT_END_POINT ].toIrrVector2d());
-    core::line2df right(xz, (*dn)[RIGHT_END_POINT].toIrrVector2d());
+    core::line2df left, right;
+    *last_node = findFurthestVisibleNode(m_kart->getXYZ().toIrrVector2d(),
+                                         m_next_node_index[m_track_node],
+                                         m_next_node_index, &left, &right);
 
 #if defined(AI_DEBUG) && defined(AI_DEBUG_NEW_FIND_NON_CRASHING)
     const Vec3 eps1(0,0.5f,0);
+    const float y = m_kart->getXYZ().getY();
     m_curve[CURVE_LEFT]->clear();
     m_curve[CURVE_LEFT]->addPoint(m_kart->getXYZ()+eps1);
-    m_curve[CURVE_LEFT]->addPoint((*dn)[LEFT_END_POINT]+eps1);
+    m_curve[CURVE_LEFT]->addPoint(Vec3(left.end.X, y, left.end.Y)+eps1);
     m_curve[CURVE_LEFT]->addPoint(m_kart->getXYZ()+eps1);
     m_curve[CURVE_RIGHT]->clear();
     m_curve[CURVE_RIGHT]->addPoint(m_kart->getXYZ()+eps1);
-    m_curve[CURVE_RIGHT]->addPoint((*dn)[RIGHT_END_POINT]+eps1);
+    m_curve[CURVE_RIGHT]->addPoint(Vec3(right.end.X, y, right.end.Y)+eps1);
     m_curve[CURVE_RIGHT]->addPoint(m_kart->getXYZ()+eps1);
 #endif
 #if defined(AI_DEBUG_KART_HEADING) || defined(AI_DEBUG_NEW_FIND_NON_CRASHING)
@@ -1864,58 +1962,218 @@ void SkiddingAI::findNonCrashingPointNew(Vec3 *result, int *last_node)
     Vec3 forw(0, 0, 50);
     m_curve[CURVE_KART]->addPoint(m_kart->getTrans()(forw)+eps);
 #endif
+
+    //Vec3 ppp(0.5f*(left.end.X+right.end.X),
+    //         m_kart->getXYZ().getY(),
+    //         0.5f*(left.end.Y+right.end.Y));
+    //*result = ppp;
+
+    *result = DriveGraph::get()->getNode(*last_node)->getCenter();
+}   // findNonCrashingPointNew
+
+//-----------------------------------------------------------------------------
+/** The test of findNonCrashingPointNew(): finds the furthest node that can
+ *  be reached in a straight line from a position, by narrowing down the
+ *  area between a left and a right line till the lines cross. This is
+ *  static so that unitTesting() can compare it with the RacingLine.
+ *  \param xz The position (x and z coordinate).
+ *  \param first_node The node after the node the position is in.
+ *  \param next_node_index The next node of each node on the path.
+ *  \param left On return the left line of the area.
+ *  \param right On return the right line of the area.
+ *  \return The last node that can be reached.
+ */
+int SkiddingAI::findFurthestVisibleNode(const core::vector2df &xz,
+                                        int first_node,
+                                        const std::vector<int> &next_node_index,
+                                        core::line2df *left,
+                                        core::line2df *right)
+{
+    int last_node = first_node;
+    const DriveNode* dn = DriveGraph::get()->getNode(last_node);
+
+    // Index of the left and right end of a quad.
+    const unsigned int LEFT_END_POINT  = 0;
+    const unsigned int RIGHT_END_POINT = 1;
+    left ->setLine(xz, (*dn)[LEFT_END_POINT ].toIrrVector2d());
+    right->setLine(xz, (*dn)[RIGHT_END_POINT].toIrrVector2d());
+
     while(1)
     {
-        unsigned int next_sector = m_next_node_index[*last_node];
+        const int next_sector = next_node_index[last_node];
+        if(next_sector < 0)
+            break;
         const DriveNode* dn_next = DriveGraph::get()->getNode(next_sector);
         // Test if the next left point is to the right of the left
         // line. If so, a new left line is defined.
-        if(left.getPointOrientation((*dn_next)[LEFT_END_POINT].toIrrVector2d())
+        if(left->getPointOrientation((*dn_next)[LEFT_END_POINT].toIrrVector2d())
             < 0 )
         {
             core::vector2df p = (*dn_next)[LEFT_END_POINT].toIrrVector2d();
             // Stop if the new point is to the right of the right line
-            if(right.getPointOrientation(p)<0)
+            if(right->getPointOrientation(p)<0)
                 break;
-            left.end = p;
-#if defined(AI_DEBUG) && defined(AI_DEBUG_NEW_FIND_NON_CRASHING)
-            Vec3 ppp(p.X, m_kart->getXYZ().getY(), p.Y);
-            m_curve[CURVE_LEFT]->addPoint(ppp+eps);
-            m_curve[CURVE_LEFT]->addPoint(m_kart->getXYZ()+eps);
-#endif
+            left->end = p;
         }
         else
             break;
 
         // Test if new right point is to the left of the right line. If
         // so, a new right line is defined.
-        if(right.getPointOrientation((*dn_next)[RIGHT_END_POINT].toIrrVector2d())
+        if(right->getPointOrientation((*dn_next)[RIGHT_END_POINT].toIrrVector2d())
             > 0 )
         {
             core::vector2df p = (*dn_next)[RIGHT_END_POINT].toIrrVector2d();
             // Break if new point is to the left of left line
-            if(left.getPointOrientation(p)>0)
+            if(left->getPointOrientation(p)>0)
                 break;
-#if defined(AI_DEBUG) && defined(AI_DEBUG_NEW_FIND_NON_CRASHING)
-
-            Vec3 ppp(p.X, m_kart->getXYZ().getY(), p.Y);
-            m_curve[CURVE_RIGHT]->addPoint(ppp+eps);
-            m_curve[CURVE_RIGHT]->addPoint(m_kart->getXYZ()+eps);
-#endif
-            right.end = p;
+            right->end = p;
         }
         else
             break;
-        *last_node = next_sector;
+        last_node = next_sector;
     }   // while
+    return last_node;
+}   // findFurthestVisibleNode
 
-    //Vec3 ppp(0.5f*(left.end.X+right.end.X),
-    //         m_kart->getXYZ().getY(),
-    //         0.5f*(left.end.Y+right.end.Y));
-    //*result = ppp;
+//-----------------------------------------------------------------------------
+/** Tests that the look-ahead data of the RacingLine gives the same result as
+ *  the test of findNonCrashingPointNew() for all sampled positions on the
+ *  quads of a track. Only the forward direction is tested, since
+ *  findNonCrashingPointNew() does not handle reverse mode. The test is then
+ *  repeated with the job system, which runs the AI decisions during a race,
+ *  to check that the point selection does not depend on the number of
+ *  threads.
+ */
+void SkiddingAI::unitTesting()
+{
+    Track *track = track_manager->getTrack("lighthouse");
+    if (!track)
+    {
+        logerror("SkiddingAI", "Track 'lighthouse' not found, the racing "
+                 "line is not tested.");
+        return;
+    }
+    // The quads of a track are loaded depending on the direction
+    race_manager->setReverseTrack(false);
+    DriveGraph *dg = new DriveGraph(track->getTrackFile("quads.xml"),
+                                    track->getTrackFile("graph.xml"),
+                                    /*reverse*/false);
+    const RacingLine *racing_line = dg->getRacingLine();
 
-    *result = DriveGraph::get()->getNode(*last_node)->getCenter();
-}   // findNonCrashingPointNew
+    // The racing line follows the main driveline
+    std::vector<int> next_node_index(dg->getNumNodes(), -1);
+    for (unsigned int i = 0; i < dg->getNumNodes(); i++)
+    {
+        if (dg->getNode(i)->getNumberOfSuccessors() > 0)
+            next_node_index[i] = dg->getNode(i)->getSuccessor(0);
+    }
+
+    // Stores the result of both point selections for each sampled point
+    const int num_points = dg->getNumNodes() * RacingLine::NUM_OFFSETS;
+    auto select_points = [dg, racing_line, &next_node_index](int i,
+                                                          int *points)
+    {
+        if (next_node_index[i] < 0) return;
+        const DriveNode *dn = dg->getNode(i);
+        for (unsigned int j = 0; j < RacingLine::NUM_OFFSETS; j++)
+        {
+            const float f = j / (float)(RacingLine::NUM_OFFSETS - 1);
+            const Vec3 xyz = (*dn)[0] + ((*dn)[1] - (*dn)[0]) * f;
+            core::line2df left, right;
+            const int index = 2 * (i * RacingLine::NUM_OFFSETS + j);
+            points[index] =
+                findFurthestVisibleNode(xyz.toIrrVector2d(),
+                                        next_node_index[i], next_node_index,
+                                        &left, &right);
+            points[index + 1] = racing_line->getFurthestVisibleNode(i, xyz);
+        }   // for j < NUM_OFFSETS
+    };   // select_points
+
+    std::vector<int> serial(2 * num_points, -1);
+    for (unsigned int i = 0; i < dg->getNumNodes(); i++)
+        select_points(i, serial.data());
+
+    int error_count = 0;
+    for (int i = 0; i < num_points; i++)
+    {
+        if (serial[2 * i] != serial[2 * i + 1])
+        {
+            logerror("SkiddingAI", "Node %d offset %d: racing line %d, "
+                     "findNonCrashingPointNew %d.",
+                     i / RacingLine::NUM_OFFSETS, i % RacingLine::NUM_OFFSETS,
+                     serial[2 * i + 1], serial[2 * i]);
+            error_count++;
+        }
+    }   // for i < num_points
+
+    // Use worker threads even if the simulation runs in one thread
+    const bool use_workers = JobSystem::get()->getNumThreads() < 2;
+    if (use_workers)
+    {
+        JobSystem::destroy();
+        JobSystem::create(3);
+    }
+    std::vector<int> parallel(2 * num_points, -1);
+    JobSystem::get()->parallelFor(dg->getNumNodes(),
+        [&select_points, &parallel](int i)
+        {
+            select_points(i, parallel.data());
+        });
+    if (parallel != serial)
+    {
+        logerror("SkiddingAI", "The point selection with %u threads differs "
+                 "from the point selection in one thread.",
+                 JobSystem::get()->getNumThreads());
+        error_count++;
+    }
+    if (use_workers)
+    {
+        JobSystem::destroy();
+        JobSystem::create(UserConfigParams::m_simulation_threads);
+    }
+
+    Graph::destroy();
+    assert(error_count == 0);
+    (void)error_count;   // avoid compiler warning with NDEBUG
+}   // unitTesting
+
+//-----------------------------------------------------------------------------
+/** Uses the look-ahead data of the RacingLine instead of testing the quads
+ *  ahead of the kart as findNonCrashingPointNew() does. The data is
+ *  computed for points on the start edge of a node (and not for the actual
+ *  kart position), and it follows the main driveline only. If this AI
+ *  takes a different path, the quads are tested as before.
+ *  \param aim_position The point to aim for, which is on the racing line.
+ *  \param last_node The graph node index in which the aim_position is.
+ */
+void SkiddingAI::findNonCrashingPointCached(Vec3 *aim_position,
+                                            int *last_node)
+{
+    const DriveGraph *dg = DriveGraph::get();
+    const RacingLine *racing_line = dg->getRacingLine();
+    const int target = racing_line->getFurthestVisibleNode(m_track_node,
+                                                         m_kart->getXYZ());
+
+    // Check that the AI will actually drive over the main driveline
+    int node = m_track_node;
+    for(unsigned int i=0; i<100 && node!=target; i++)
+    {
+        const DriveNode *dn = dg->getNode(node);
+        if(dn->getNumberOfSuccessors()==0 ||
+           m_next_node_index[node]!=(int)dn->getSuccessor(0))
+            break;
+        node = m_next_node_index[node];
+    }
+    if(node!=target)
+    {
+        findNonCrashingPointNew(aim_position, last_node);
+        return;
+    }
+
+    *last_node    = target;
+    *aim_position = racing_line->getPoint(target);
+}   // findNonCrashingPointCached
 
 //-----------------------------------------------------------------------------
 /** Find the sector that at the longest distance from the kart, that can be
@@ -2374,7 +2632,7 @@ void SkiddingAI::setSteering(float angle, float dt)
         {
             int prob = (int)(100.0f*m_ai_properties
                                ->getSkiddingProbability(m_distance_to_player));
-            int r = m_random_skid.get(100);
+            int r = getRandom(100);
             m_skid_probability_state = (r<prob)
                                      ? SKID_PROBAB_SKID
                                      : SKID_PROBAB_NO_SKID;
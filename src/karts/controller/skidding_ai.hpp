@@ -46,8 +46,8 @@
 #include "karts/controller/ai_base_lap_controller.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/drive_node.hpp"
-#include "utils/random_generator.hpp"
 
+#include <line2d.h>
 #include <line3d.h>
 
 class LinearWorld;
@@ -182,9 +182,6 @@ private:
     /** Distance to the player, used for rubber-banding. */
     float m_distance_to_player;
 
-    /** A random number generator to decide if the AI should skid or not. */
-    RandomGenerator m_random_skid;
-
     /** This implements a simple finite state machine: it starts in
      *  NOT_YET. The first time the AI decides to skid, the state is changed
      *  randomly (depending on skid probability) to NO_SKID or SKID.
@@ -203,8 +200,20 @@ private:
     /** True if m_last_item_random was randomly selected to be collected. */
     bool m_really_collect_item;
 
-    /** A random number generator for collecting items. */
-    RandomGenerator m_random_collect_item;
+    /** State of the random number generator of this AI. Each AI uses its
+     *  own generator (and not rand()), so that the decisions do not depend
+     *  on the order in which the AIs decide. */
+    unsigned int m_random_seed;
+
+    /** True if decide() was called for the current time step. */
+    bool m_decision_done;
+
+    /** True if decide() requested to rescue the kart. */
+    bool m_rescue_requested;
+
+    /** The speed cap (for rubber-banding) determined in decide(), or a
+     *  negative value if none was determined. */
+    float m_speed_cap;
 
     /** \brief Determines the algorithm to use to select the point-to-aim-for
      *  There are three different Point Selection Algorithms:
@@ -216,12 +225,21 @@ private:
      *  3. findNonCrashingPointNew() A newly designed algorithm, which is
      *     faster than the standard one, but does not give as good results
      *     as the 'buggy' one.
+     *  4. findNonCrashingPointCached() which uses the same test as the new
+     *     algorithm, but takes the result from the precomputed RacingLine
+     *     of the drive graph, and aims at the racing line.
      *
      *  So far the default one has by far the best performance, even though
      *  it has bugs. */
-    enum {PSA_DEFAULT, PSA_FIXED, PSA_NEW}
+    enum PointSelectionAlgorithm {PSA_DEFAULT, PSA_FIXED, PSA_NEW,
+                                  PSA_CACHED}
           m_point_selection_algorithm;
 
+    /** Time spent in decide() in microseconds, and the number of calls,
+     *  used to compare the costs of the AI in profile mode. */
+    uint64_t m_decision_time;
+    unsigned int m_num_decisions;
+
 #ifdef AI_DEBUG
     /** For skidding debugging: shows the estimated turn shape. */
     ShowCurve **m_curve;
@@ -265,11 +283,20 @@ private:
     void  findNonCrashingPointFixed(Vec3 *result, int *last_node);
     void  findNonCrashingPointNew(Vec3 *result, int *last_node);
     void  findNonCrashingPoint(Vec3 *result, int *last_node);
+    void  findNonCrashingPointCached(Vec3 *result, int *last_node);
+    static int findFurthestVisibleNode(const core::vector2df &xz,
+                                       int first_node,
+                                       const std::vector<int> &next_node_index,
+                                       core::line2df *left,
+                                       core::line2df *right);
+    void  decideControls(float dt);
 
     void  determineTrackDirection();
     virtual bool canSkid(float steer_fraction);
     virtual void setSteering(float angle, float dt);
     void handleCurve();
+    int   getRandom(int n);
+    float getRandomFraction();
 
 protected:
     virtual unsigned int getNextSector(unsigned int index);
@@ -278,8 +305,18 @@ public:
                  SkiddingAI(AbstractKart *kart);
                 ~SkiddingAI();
     virtual void update      (float delta) ;
+    virtual void decide      (float delta) ;
+    virtual bool canDecideInParallel() const;
     virtual void reset       ();
     virtual const irr::core::stringw& getNamePostfix() const;
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns the average time of decide() in microseconds. */
+    float getAverageDecisionTime() const
+    {
+        return m_num_decisions ? m_decision_time / (float)m_num_decisions
+                               : 0.0f;
+    }   // getAverageDecisionTime
 };
 
 #endif
@@ -49,6 +49,9 @@ public:
     virtual void  update (float dt);
     virtual void  reset();
     // ------------------------------------------------------------------------
+    /** A ghost kart takes all data from the replay in update(). */
+    virtual void  preUpdate(float dt) {};
+    // ------------------------------------------------------------------------
     /** No physics body for ghost kart, so nothing to adjust. */
     virtual void  updateWeight() {};
     // ------------------------------------------------------------------------
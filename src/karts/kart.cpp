@@ -127,6 +127,7 @@ Kart::Kart (const std::string& ident, unsigned int world_kart_id,
     m_bubblegum_torque     = 0.0f;
     m_invulnerable_time    = 0.0f;
     m_squash_time          = 0.0f;
+    m_pre_update_done      = false;
 
     m_shadow               = NULL;
     m_wheel_box            = NULL;
@@ -176,6 +177,10 @@ Kart::Kart (const std::string& ident, unsigned int world_kart_id,
     m_goo_sound     = SFXManager::get()->createSoundSource( "goo"   );
     m_skid_sound    = SFXManager::get()->createSoundSource( "skid"  );
     m_nitro_sound   = SFXManager::get()->createSoundSource( "nitro" );
+    // The continuous sounds of all karts are the first to be virtualised
+    // if there are not enough voices.
+    m_engine_sound->setPriority(SFXBase::SFX_PRIORITY_LOW);
+    m_skid_sound->setPriority(SFXBase::SFX_PRIORITY_LOW);
     m_terrain_sound          = NULL;
     m_previous_terrain_sound = NULL;
 
@@ -350,6 +355,7 @@ void Kart::reset()
     m_bubblegum_torque     = 0.0f;
     m_invulnerable_time    = 0.0f;
     m_squash_time          = 0.0f;
+    m_pre_update_done      = false;
     m_node->setScale(core::vector3df(1.0f, 1.0f, 1.0f));
     m_collected_energy     = 0;
     m_has_started          = false;
@@ -1185,11 +1191,12 @@ void Kart::eliminate()
 }   // eliminate
 
 //-----------------------------------------------------------------------------
-/** Updates the kart in each time step. It updates the physics setting,
- *  particle effects, camera position, etc.
+/** Updates the kart data that the controllers read before they decide on
+ *  their actions: position and orientation (taken from the physics), speed
+ *  and various timers.
  *  \param dt Time step size.
  */
-void Kart::update(float dt)
+void Kart::preUpdate(float dt)
 {
     // Reset any instand speed increase in the bullet kart
     m_vehicle->resetInstantSpeed();
@@ -1234,7 +1241,23 @@ void Kart::update(float dt)
     // is used furthermore for engine power, camera distance etc
     updateSpeed();
 
-    if(!history->replayHistory() && !RewindManager::get()->isRewinding())
+    m_pre_update_done = true;
+}   // preUpdate
+
+//-----------------------------------------------------------------------------
+/** Updates the kart in each time step. It updates the physics setting,
+ *  particle effects, camera position, etc.
+ *  \param dt Time step size.
+ */
+void Kart::update(float dt)
+{
+    // The world calls preUpdate before the controllers decide on their
+    // actions. If this did not happen (e.g. in a cutscene), do it now.
+    if(!m_pre_update_done)
+        preUpdate(dt);
+    m_pre_update_done = false;
+
+    if(!history->replayControls() && !RewindManager::get()->isRewinding())
         m_controller->update(dt);
 
 #undef DEBUG_CAMERA_SHAKE
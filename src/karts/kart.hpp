@@ -146,6 +146,9 @@ protected:
      *  the kart is squashed. */
     float        m_squash_time;
 
+    /** True if preUpdate() was already called for the current time step. */
+    bool         m_pre_update_done;
+
     /** Current leaning of the kart. */
     float        m_current_lean;
 
@@ -277,6 +280,7 @@ public:
     virtual void   crashed          (AbstractKart *k, bool update_attachments);
     virtual void   crashed          (const Material *m, const Vec3 &normal);
     virtual float  getHoT           () const;
+    virtual void   preUpdate        (float dt);
     virtual void   update           (float dt);
     virtual void   finishedRace     (float time, bool from_server=false);
     virtual void   setPosition      (int p);
@@ -59,8 +59,11 @@ std::string KartProperties::getPerPlayerDifficultyAsString(PerPlayerDifficulty d
  *  then be checked (for STKConfig) that all values are indeed defined.
  *  Otherwise the defaults are taken from STKConfig (and since they are all
  *  defined, it is guaranteed that each kart has well defined physics values).
+ *  \param filename Name of the kart.xml file, or "" for default values.
+ *  \param xml_root Optional, already parsed content of the kart.xml file.
  */
-KartProperties::KartProperties(const std::string &filename)
+KartProperties::KartProperties(const std::string &filename,
+                               const XMLNode *xml_root)
 {
     m_icon_material = NULL;
     m_minimap_icon  = NULL;
@@ -92,7 +95,7 @@ KartProperties::KartProperties(const std::string &filename)
     // The default constructor for stk_config uses filename=""
     if (filename != "")
     {
-        load(filename, "kart");
+        load(filename, "kart", xml_root);
     }
     else
     {
@@ -159,13 +162,16 @@ void KartProperties::copyFrom(const KartProperties *source)
 /** Loads the kart properties from a file.
  *  \param filename Filename to load.
  *  \param node Name of the xml node to load the data from
+ *  \param xml_root If not NULL the already parsed content of filename. The
+ *         caller keeps ownership of this node.
  */
-void KartProperties::load(const std::string &filename, const std::string &node)
+void KartProperties::load(const std::string &filename, const std::string &node,
+                          const XMLNode *xml_root)
 {
     // Get the default values from STKConfig. This will also allocate any
     // pointers used in KartProperties
 
-    const XMLNode* root = new XMLNode(filename);
+    const XMLNode* root = xml_root ? xml_root : new XMLNode(filename);
     std::string kart_type;
 
     if (root->get("type", &kart_type))
@@ -215,7 +221,7 @@ void KartProperties::load(const std::string &filename, const std::string &node)
                    filename.c_str());
         logerror("[KartProperties]", "%s", err.what());
     }
-    if(root) delete root;
+    if(root && root!=xml_root) delete root;
 
     // Set a default group (that has to happen after init_default and load)
     if(m_groups.size()==0)
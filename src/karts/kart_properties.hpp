@@ -209,14 +209,16 @@ private:
 
 
     void  load              (const std::string &filename,
-                             const std::string &node);
+                             const std::string &node,
+                             const XMLNode *xml_root=NULL);
     void combineCharacteristics();
 
 public:
     /** Returns the string representation of a per-player difficulty. */
     static std::string      getPerPlayerDifficultyAsString(PerPlayerDifficulty d);
 
-          KartProperties    (const std::string &filename="");
+          KartProperties    (const std::string &filename="",
+                             const XMLNode *xml_root=NULL);
          ~KartProperties    ();
     void  copyForPlayer     (const KartProperties *source);
     void  copyFrom          (const KartProperties *source);
@@ -27,8 +27,10 @@
 #include "graphics/irr_driver.hpp"
 #include "guiengine/engine.hpp"
 #include "io/file_manager.hpp"
+#include "io/scan_index.hpp"
 #include "karts/kart_properties.hpp"
 #include "karts/xml_characteristic.hpp"
+#include "utils/job_system.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 
@@ -143,36 +145,57 @@ void KartPropertiesManager::removeKart(const std::string &ident)
 }   // removeKart
 
 //-----------------------------------------------------------------------------
-/** Loads all kart properties and models.
+/** Loads all kart properties and models. The directories containing karts
+ *  are taken from the scan index (so that on a warm start no directories
+ *  need to be listed), then all kart.xml files are parsed in parallel.
+ *  Everything that needs the graphics driver (materials, models, icons) is
+ *  then done sequentially.
  */
 void KartPropertiesManager::loadAllKarts(bool loading_icon)
 {
     m_all_kart_dirs.clear();
+
+    // First collect all directories that contain a kart: either the
+    // search directory itself, or any of its subdirectories.
+    // -------------------------------------------------------------
+    std::vector<std::string> kart_dirs;
+    std::vector<bool>        is_subdir;
+    ScanIndex *scan_index = file_manager->getScanIndex();
     std::vector<std::string>::const_iterator dir;
     for(dir = m_kart_search_path.begin(); dir!=m_kart_search_path.end(); dir++)
     {
-        // First check if there is a kart in the current directory
-        // -------------------------------------------------------
-        if(loadKart(*dir)) continue;
-
-        // If not, check each subdir of this directory.
-        // --------------------------------------------
-        std::set<std::string> result;
-        file_manager->listFiles(result, *dir);
-        for(std::set<std::string>::const_iterator subdir=result.begin();
-            subdir!=result.end(); subdir++)
+        std::vector<std::string> found;
+        scan_index->findContentDirs(*dir, "kart.xml", &found);
+        for(unsigned int i=0; i<found.size(); i++)
         {
-            const bool loaded = loadKart(*dir+*subdir);
+            kart_dirs.push_back(*dir+found[i]);
+            is_subdir.push_back(!found[i].empty());
+        }
+    }   // for dir
+    scan_index->save();
+
+    // Now parse all kart.xml files in parallel
+    // ----------------------------------------
+    const int count = (int)kart_dirs.size();
+    std::vector<XMLNode*> roots(count, (XMLNode*)NULL);
+    JobSystem::get()->parallelFor(count, [&roots, &kart_dirs](int i)
+    {
+        roots[i] = file_manager->createXMLTree(kart_dirs[i]+"/kart.xml");
+    });
 
-            if (loaded && loading_icon)
-            {
-                GUIEngine::addLoadingIcon(irr_driver->getTexture(
-                    m_karts_properties[m_karts_properties.size()-1]
-                            .getAbsoluteIconFile()              )
-                                          );
-            }
-        }   // for all files in the currently handled directory
-    }   // for i
+    for(int i=0; i<count; i++)
+    {
+        const bool loaded = loadKart(kart_dirs[i], roots[i]);
+        delete roots[i];
+
+        if (loaded && loading_icon && is_subdir[i])
+        {
+            GUIEngine::addLoadingIcon(irr_driver->getTexture(
+                m_karts_properties[m_karts_properties.size()-1]
+                        .getAbsoluteIconFile()              )
+                                      );
+        }
+    }   // for i < count
 }   // loadAllKarts
 
 //-----------------------------------------------------------------------------
@@ -233,9 +256,11 @@ void KartPropertiesManager::loadCharacteristics(const XMLNode *root)
 
 //-----------------------------------------------------------------------------
 /** Loads a single kart and (if not disabled) the corresponding 3d model.
- *  \param filename Full path to the kart config file.
+ *  \param dir Directory containing the kart config file.
+ *  \param root Optional, the already parsed kart config file.
  */
-bool KartPropertiesManager::loadKart(const std::string &dir)
+bool KartPropertiesManager::loadKart(const std::string &dir,
+                                     const XMLNode *root)
 {
     std::string config_filename = dir + "/kart.xml";
     if(!file_manager->fileExists(config_filename))
@@ -244,7 +269,7 @@ bool KartPropertiesManager::loadKart(const std::string &dir)
     KartProperties* kart_properties;
     try
     {
-        kart_properties = new KartProperties(config_filename);
+        kart_properties = new KartProperties(config_filename, root);
     }
     catch (std::runtime_error& err)
     {
@@ -181,31 +181,39 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "font/font_manager.hpp"
+#include "graphics/2dutils.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/camera_debug.hpp"
+#include "graphics/buffer_allocator.hpp"
 #include "graphics/central_settings.hpp"
 #include "graphics/graphics_restrictions.hpp"
 #include "graphics/irr_driver.hpp"
+#include "graphics/light_culling.hpp"
 #include "graphics/material_manager.hpp"
+#include "graphics/program_binary_cache.hpp"
 #include "graphics/particle_kind_manager.hpp"
 #include "graphics/referee.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/event_handler.hpp"
 #include "guiengine/dialog_queue.hpp"
+#include "guiengine/screen.hpp"
 #include "input/device_manager.hpp"
 #include "input/input_manager.hpp"
 #include "input/keyboard_device.hpp"
 #include "input/wiimote_manager.hpp"
 #include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
 #include "items/attachment_manager.hpp"
 #include "items/item_manager.hpp"
 #include "items/projectile_manager.hpp"
 #include "karts/combined_characteristic.hpp"
 #include "karts/controller/ai_base_lap_controller.hpp"
+#include "karts/controller/skidding_ai.hpp"
 #include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "modes/cutscene_world.hpp"
 #include "modes/demo_world.hpp"
+#include "modes/linear_world.hpp"
 #include "modes/profile_world.hpp"
 #include "network/network_config.hpp"
 #include "network/network_string.hpp"
@@ -215,12 +223,15 @@
 #include "network/protocols/get_public_address.hpp"
 #include "online/profile_manager.hpp"
 #include "online/request_manager.hpp"
+#include "physics/physics.hpp"
+#include "physics/raycast_tree.hpp"
 #include "race/grand_prix_manager.hpp"
 #include "race/highscore_manager.hpp"
 #include "race/history.hpp"
 #include "race/race_manager.hpp"
 #include "replay/replay_play.hpp"
 #include "replay/replay_recorder.hpp"
+#include "scriptengine/script_engine.hpp"
 #include "states_screens/main_menu_screen.hpp"
 #include "states_screens/networking_lobby.hpp"
 #include "states_screens/register_screen.hpp"
@@ -233,8 +244,11 @@
 #include "utils/command_line.hpp"
 #include "utils/constants.hpp"
 #include "utils/crash_reporting.hpp"
+#include "utils/job_system.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/tick_scheduler.hpp"
 #include "utils/translation.hpp"
 
 static void cleanSuperTuxKart();
@@ -558,6 +572,21 @@ void cmdLineHelp()
     "       --profile-time=n   Enable automatic driven profile mode for n "
                               "seconds.\n"
     "       --no-graphics      Do not display the actual race.\n"
+    "       --fixed-ticks      Simulate in fixed steps of 1/60 s, which makes\n"
+    "                          races (e.g. with --no-graphics) reproducible.\n"
+    "       --save-history     Save the history of a profile race in\n"
+    "                          history.dat when it ends.\n"
+    "       --ai-point-selection=n Point selection of the AI: 0 default,\n"
+    "                          1 fixed, 2 new, 3 cached (profile mode prints\n"
+    "                          the AI time per kart).\n"
+    "       --font-benchmark   Measure the text layout speed and exit (can be\n"
+    "                          used with --no-graphics).\n"
+    "       --http-benchmark=URL Download URL repeatedly with the request\n"
+    "                          manager, print the throughput and exit.\n"
+    "       --script-benchmark Measure the cost of calling script functions\n"
+    "                          and exit.\n"
+    "       --raycast-benchmark Measure raycasts against many driveable\n"
+    "                          track objects and exit.\n"
     "       --demo-mode=t      Enables demo mode after t seconds idle time in "
                                "main menu.\n"
     "       --demo-tracks=t1,t2 List of tracks to be used in demo mode. No\n"
@@ -568,6 +597,7 @@ void cmdLineHelp()
     // "       --history=n        Replay history file 'history.dat' using:\n"
     // "                            n=1: recorded positions\n"
     // "                            n=2: recorded key strokes\n"
+    // "                            n=4: check the positions of the karts\n"
     // "       --test-ai=n        Use the test-ai for every n-th AI kart.\n"
     // "                          (so n=1 means all Ais will be the test ai)\n"
     // "
@@ -575,6 +605,7 @@ void cmdLineHelp()
     "       --public-server    Allow direct connection to the server (without stk server)\n"
     "       --lan-server=name  Start a LAN server (not a playing client).\n"
     "       --server-password= Sets a password for a server (both client&server).\n"
+    "       --server-tick-rate=n Ticks per second of a server without graphics.\n"
     "       --connect-now=ip   Connect to a server with IP known now (in format x.x.x.x:xxx(port)).\n"
     "       --login=s          Automatically log in (set the login).\n"
     "       --password=s       Automatically log in (set the password).\n"
@@ -582,12 +613,17 @@ void cmdLineHelp()
     "       --my-address=1.1.1.1:1  Own IP address (can replace stun protocol)\n"
     "       --disable-lan      Disable LAN detection (connect using WAN).\n"
     "       --max-players=n    Maximum number of clients (server only).\n"
+    "       --sim-threads=n    Number of additional threads used to update\n"
+    "                          the karts (-1: one per CPU core).\n"
     "       --no-console       Does not write messages in the console but to\n"
     "                          stdout.log.\n"
     "       --console          Write messages in the console and files\n"
     "  -h,  --help             Show this help.\n"
     "       --log=N            Set the verbosity to a value between\n"
     "                          0 (Debug) and 5 (Only Fatal messages)\n"
+    "       --log-async        Print log messages from a separate thread.\n"
+    "       --log-limit=C:N    Print at most N messages per second of\n"
+    "                          component C (warnings and errors excluded).\n"
     "       --root=DIR         Path to add to the list of STK root directories.\n"
     "                          You can specify more than one by separating them\n"
     "                          with colons (:).\n"
@@ -669,6 +705,21 @@ int handleCmdLineOutputModifier()
         logverbose("main", "Colours disabled.");
     }
 
+    if(CommandLine::has("--log-async"))
+        Log::startAsync();
+
+    std::string limit;
+    while(CommandLine::has("--log-limit", &limit))
+    {
+        std::vector<std::string> l = StringUtils::split(limit, ':');
+        int per_second;
+        if(l.size()==2 && StringUtils::fromString(l[1], per_second))
+            Log::setRateLimit(l[0], per_second);
+        else
+            logwarn("main", "Invalid --log-limit '%s' ignored.",
+                    limit.c_str());
+    }
+
     if(CommandLine::has("--console"))
         UserConfigParams::m_log_errors_to_console=true;
     if(CommandLine::has("--no-console"))
@@ -853,6 +904,8 @@ int handleCmdLinePreliminary()
     }
 
     int n;
+    if(CommandLine::has("--sim-threads", &n))
+        UserConfigParams::m_simulation_threads = n;
     if(CommandLine::has("--xmas", &n))
         UserConfigParams::m_xmas_mode = n;
     if (CommandLine::has("--easter", &n))
@@ -886,6 +939,18 @@ int handleCmdLine()
 
     if (CommandLine::has("--unit-testing"))
         UserConfigParams::m_unit_testing = true;
+    if (CommandLine::has("--font-benchmark"))
+        UserConfigParams::m_font_benchmark = true;
+    if (CommandLine::has("--http-benchmark", &s))
+        UserConfigParams::m_http_benchmark_url = s;
+    if (CommandLine::has("--script-benchmark"))
+        UserConfigParams::m_script_benchmark = true;
+    if (CommandLine::has("--raycast-benchmark"))
+        UserConfigParams::m_raycast_benchmark = true;
+    if (CommandLine::has("--fixed-ticks"))
+        UserConfigParams::m_fixed_ticks = true;
+    if (CommandLine::has("--save-history"))
+        UserConfigParams::m_save_history = true;
     if (CommandLine::has("--gamepad-debug"))
         UserConfigParams::m_gamepad_debug=true;
     if (CommandLine::has("--keyboard-debug"))
@@ -1021,6 +1086,13 @@ int handleCmdLine()
         STKHost::create();
         loginfo("main", "Creating a LAN server '%s'.", s.c_str());
     }
+    if (CommandLine::has("--server-tick-rate", &n))
+    {
+        if (n < 1 || n > 1000)
+            logerror("main", "Invalid server tick rate: %d.", n);
+        else
+            UserConfigParams::m_server_tick_rate = n;
+    }
     if (CommandLine::has("--server-password", &s))
     {
         NetworkConfig::get()->setPassword(s);
@@ -1242,6 +1314,14 @@ int handleCmdLine()
         race_manager->setNumLaps(999999); // profile end depends on time
     }   // --profile-time
 
+    if(CommandLine::has("--ai-point-selection", &n))
+    {
+        if (n < 0 || n > 3)
+            logerror("main", "Invalid AI point selection: %d.", n);
+        else
+            UserConfigParams::m_ai_point_selection = n;
+    }   // --ai-point-selection
+
     if(CommandLine::has("--history",  &n))
     {
         history->doReplayHistory( (History::HistoryReplayMode)n);
@@ -1389,6 +1469,10 @@ void initRest()
     Online::RequestManager::get()->startNetworkThread();
     NewsManager::get();   // this will create the news manager
 
+    // The job system runs parallel work during loading (e.g. parsing the
+    // kart and track configs, decoding the sound effects and reading addon
+    // archives), and during a race (the AI decisions and the light culling)
+    JobSystem::create(UserConfigParams::m_simulation_threads);
     music_manager = new MusicManager();
     SFXManager::create();
     // The order here can be important, e.g. KartPropertiesManager needs
@@ -1626,6 +1710,32 @@ int main(int argc, char *argv[] )
             exit(0);
         }
 
+        if (UserConfigParams::m_font_benchmark)
+        {
+            font_manager->benchmarkLayout(1000);
+            exit(0);
+        }
+
+        if (!UserConfigParams::m_http_benchmark_url.empty())
+        {
+            Online::RequestManager::get()
+                ->benchmark(UserConfigParams::m_http_benchmark_url, 64);
+            exit(0);
+        }
+
+        if (UserConfigParams::m_script_benchmark)
+        {
+            Scripting::ScriptEngine::getInstance<Scripting::ScriptEngine>()
+                ->benchmark(100000);
+            exit(0);
+        }
+
+        if (UserConfigParams::m_raycast_benchmark)
+        {
+            RaycastTree::benchmark(500, 600);
+            exit(0);
+        }
+
         if (!ProfileWorld::isNoGraphics() &&
             GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_DRIVER_RECENT_ENOUGH))
         {
@@ -1860,6 +1970,7 @@ static void cleanSuperTuxKart()
     if(track_manager)           delete track_manager;
     if(material_manager)        delete material_manager;
     if(history)                 delete history;
+    JobSystem::destroy();
     ReplayPlay::destroy();
     ReplayRecorder::destroy();
     delete ParticleKindManager::get();
@@ -1940,12 +2051,36 @@ void runUnitTests()
 {
     loginfo("UnitTest", "Starting unit testing");
     loginfo("UnitTest", "=====================");
+    loginfo("UnitTest", "Log");
+    Log::unitTesting();
     loginfo("UnitTest", "GraphicsRestrictions");
     GraphicsRestrictions::unitTesting();
     loginfo("UnitTest", "NetworkString");
     NetworkString::unitTesting();
     loginfo("UnitTest", "TransportAddress");
     TransportAddress::unitTesting();
+    loginfo("UnitTest", "XMLNode");
+    XMLNode::unitTesting();
+    loginfo("UnitTest", "JobSystem");
+    JobSystem::unitTesting();
+    loginfo("UnitTest", "TickScheduler");
+    TickScheduler::unitTesting();
+    loginfo("UnitTest", "LightCulling");
+    LightCulling::unitTesting();
+    loginfo("UnitTest", "BufferAllocator");
+    BufferAllocator::unitTesting();
+    loginfo("UnitTest", "Race positions");
+    LinearWorld::unitTesting();
+    loginfo("UnitTest", "Scripts in addon archives");
+    Scripting::ScriptEngine::unitTesting();
+#ifndef SERVER_ONLY
+    loginfo("UnitTest", "ProgramBinaryCache");
+    ProgramBinaryCache::unitTesting();
+#endif
+    loginfo("UnitTest", "SFX voices");
+    SFXManager::unitTesting();
+    loginfo("UnitTest", "Physics contacts");
+    Physics::unitTesting();
 
     loginfo("UnitTest", "Easter detection");
     // Test easter mode: in 2015 Easter is 5th of April - check with 0 days
@@ -1985,9 +2120,20 @@ void runUnitTests()
     loginfo("UnitTest", "Arena Graph");
     ArenaGraph::unitTesting();
 
+    loginfo("UnitTest", "AI racing line");
+    SkiddingAI::unitTesting();
+
+#ifndef SERVER_ONLY
+    loginfo("UnitTest", "2D batching");
+    unitTesting2D();
+#endif
+
     loginfo("UnitTest", "Fonts for translation");
     font_manager->unitTesting();
 
+    loginfo("UnitTest", "GUI screens");
+    GUIEngine::Screen::unitTesting();
+
     loginfo("UnitTest", "=====================");
     loginfo("UnitTest", "Testing successful   ");
     loginfo("UnitTest", "=====================");
@@ -39,6 +39,7 @@
 #include "race/race_manager.hpp"
 #include "states_screens/state_manager.hpp"
 #include "utils/profiler.hpp"
+#include "utils/tick_scheduler.hpp"
 
 MainLoop* main_loop = 0;
 
@@ -47,12 +48,15 @@ m_abort(false)
 {
     m_curr_time = 0;
     m_prev_time = 0;
+    m_tick_time = 0;
+    m_tick_scheduler = NULL;
     m_throttle_fps = true;
 }  // MainLoop
 
 //-----------------------------------------------------------------------------
 MainLoop::~MainLoop()
 {
+    delete m_tick_scheduler;
 }   // ~MainLoop
 
 //-----------------------------------------------------------------------------
@@ -64,7 +68,7 @@ float MainLoop::getLimitedDt()
 {
     float dt = 0;
     // If we are doing a replay, use the dt from the history file
-    if (World::getWorld() && history->replayHistory() )
+    if (World::getWorld() && history->replayControls() )
     {
         dt = history->updateReplayAndGetDT();
         return dt;
@@ -138,6 +142,31 @@ float MainLoop::getLimitedDt()
     return dt;
 }   // getLimitedDt
 
+//-----------------------------------------------------------------------------
+/** In fixed tick mode, returns how many ticks must be simulated to catch up
+ *  with the time that has passed. The remainder that is less than a tick is
+ *  kept for the next frame.
+ *  \param dt Time that has passed since the last frame.
+ */
+int MainLoop::getNumberOfTicks(float dt)
+{
+    // Each history entry is one world update, and profile mode without
+    // graphics is using one tick per frame anyway.
+    if (history->replayControls() ||
+        (ProfileWorld::isProfileMode() && ProfileWorld::isNoGraphics()) ||
+        UserConfigParams::m_arena_ai_stats)
+    {
+        m_tick_time = 0;
+        return 1;
+    }
+
+    m_tick_time += dt;
+    int ticks = WorldStatus::timeToTicks((float)m_tick_time);
+    m_tick_time -= WorldStatus::ticksToTime(ticks);
+    if (m_tick_time < 0) m_tick_time = 0;
+    return ticks;
+}   // getNumberOfTicks
+
 //-----------------------------------------------------------------------------
 /** Updates all race related objects.
  *  \param dt Time step size.
@@ -219,18 +248,31 @@ void MainLoop::updateRace(float dt)
  *      firing etc are all set in the corresponding karts depending on
  *      user input).
  *    - Calls Irrlicht's `endScene()`
+ *  In fixed tick mode (see WorldStatus::isFixedTicks()) the race is updated
+ *  in steps of exactly 1/60 s instead: depending on the time that has
+ *  passed, zero or more ticks are simulated in one frame, each followed
+ *  by an update of the world time.
  */
 void MainLoop::run()
 {
     IrrlichtDevice* device = irr_driver->getDevice();
 
+    // A dedicated server without graphics runs at a fixed tick rate
+    if (ProfileWorld::isNoGraphics() && !ProfileWorld::isProfileMode() &&
+        NetworkConfig::get()->isServer() && !m_tick_scheduler)
+    {
+        m_tick_scheduler =
+                      new TickScheduler(UserConfigParams::m_server_tick_rate);
+    }
+
     m_curr_time = device->getTimer()->getRealTime();
     while(!m_abort)
     {
         PROFILER_PUSH_CPU_MARKER("Main loop", 0xFF, 0x00, 0xF7);
 
         m_prev_time = m_curr_time;
-        float dt   = getLimitedDt();
+        float dt   = m_tick_scheduler ? m_tick_scheduler->waitForNextTick()
+                                      : getLimitedDt();
 
         if (!m_abort && !ProfileWorld::isNoGraphics())
         {
@@ -240,12 +282,27 @@ void MainLoop::run()
             PROFILER_POP_CPU_MARKER();
         }
 
+        const bool fixed_ticks = WorldStatus::isFixedTicks();
         if (World::getWorld())  // race is active if world exists
         {
             PROFILER_PUSH_CPU_MARKER("Update race", 0, 255, 255);
-            updateRace(dt);
+            if (fixed_ticks)
+            {
+                const float tick_dt = WorldStatus::ticksToTime(1);
+                int ticks = getNumberOfTicks(dt);
+                for (int i = 0; i < ticks && World::getWorld(); i++)
+                {
+                    updateRace(tick_dt);
+                    if (World::getWorld())
+                        World::getWorld()->updateTime(tick_dt);
+                }
+            }
+            else
+                updateRace(dt);
             PROFILER_POP_CPU_MARKER();
         }   // if race is active
+        else
+            m_tick_time = 0;
 
         // We need to check again because update_race may have requested
         // the main loop to abort; and it's not a good idea to continue
@@ -297,11 +354,14 @@ void MainLoop::run()
             PROFILER_POP_CPU_MARKER();
         }
 
-        if (World::getWorld() )
+        if (World::getWorld() && !fixed_ticks)
         {
             World::getWorld()->updateTime(dt);
         }
 
+        if (m_tick_scheduler)
+            m_tick_scheduler->endTick();
+
         PROFILER_POP_CPU_MARKER();
         PROFILER_SYNC_FRAME();
     }  // while !m_abort
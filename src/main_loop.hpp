@@ -22,6 +22,8 @@
 
 typedef unsigned long Uint32;
 
+class TickScheduler;
+
 
 /** Management class for the whole gameflow, this is where the
     main-loop is */
@@ -36,7 +38,17 @@ private:
 
     Uint32   m_curr_time;
     Uint32   m_prev_time;
+
+    /** In fixed tick mode the real time that has passed, but was not
+     *  yet simulated since it is less than a tick. */
+    double   m_tick_time;
+
+    /** Used instead of getLimitedDt() on a server without graphics, NULL
+     *  otherwise. */
+    TickScheduler *m_tick_scheduler;
+
     float    getLimitedDt();
+    int      getNumberOfTicks(float dt);
     void     updateRace(float dt);
 public:
          MainLoop();
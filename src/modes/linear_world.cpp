@@ -38,6 +38,8 @@
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
+#include <algorithm>
+#include <assert.h>
 #include <iostream>
 
 //-----------------------------------------------------------------------------
@@ -651,9 +653,79 @@ btTransform LinearWorld::getRescueTransform(unsigned int index) const
 }   // getRescueTransform
 
 //-----------------------------------------------------------------------------
-/** Find the position (rank) of every kart. ATM it uses a stable O(n^2)
- *  algorithm by counting for each kart how many other karts are ahead of
- *  it.
+/** Sorts the karts that are still racing by rank: the kart with the largest
+ *  overall distance first, and of two karts with the same distance the one
+ *  that started ahead. The overall distance includes the finished laps.
+ *  Finished karts are ahead of all racing karts, and eliminated karts are
+ *  ignored.
+ *  \param info The rank data of all karts.
+ *  \param order On return the indices of the racing karts sorted by rank.
+ *  \return The position of the first kart in order, i.e. 1 plus the number
+ *          of finished karts.
+ */
+unsigned int LinearWorld::sortByRank(const std::vector<RankInfo> &info,
+                                     std::vector<unsigned int> *order)
+{
+    order->clear();
+    unsigned int first_position = 1;
+    for (unsigned int i = 0; i < info.size(); i++)
+    {
+        if (info[i].m_eliminated) continue;
+        if (info[i].m_finished)
+            first_position++;
+        else
+            order->push_back(i);
+    }
+
+    // The index is only compared to get a strict order if two karts have
+    // the same start position, which does not happen in a race.
+    std::sort(order->begin(), order->end(),
+              [&info](unsigned int a, unsigned int b)
+              {
+                  if (info[a].m_distance != info[b].m_distance)
+                      return info[a].m_distance > info[b].m_distance;
+                  if (info[a].m_initial_position !=
+                      info[b].m_initial_position)
+                  {
+                      return info[a].m_initial_position <
+                             info[b].m_initial_position;
+                  }
+                  return a < b;
+              });
+    return first_position;
+}   // sortByRank
+
+//-----------------------------------------------------------------------------
+/** Computes the position of a racing kart by counting the karts ahead of
+ *  it. This was the ranking before sortByRank, it is kept to test that
+ *  sortByRank results in the same positions.
+ *  \param info The rank data of all karts.
+ *  \param kart_index The kart, which must not be finished or eliminated.
+ */
+unsigned int LinearWorld::getRankPairwise(const std::vector<RankInfo> &info,
+                                          unsigned int kart_index)
+{
+    const RankInfo &kart = info[kart_index];
+    unsigned int p = 1;
+    for (unsigned int j = 0; j < info.size(); j++)
+    {
+        if (j == kart_index || info[j].m_eliminated)
+            continue;
+        if ((!kart.m_finished && info[j].m_finished) ||
+            info[j].m_distance > kart.m_distance     ||
+            (info[j].m_distance == kart.m_distance &&
+             info[j].m_initial_position < kart.m_initial_position))
+        {
+            p++;
+        }
+    }
+    return p;
+}   // getRankPairwise
+
+//-----------------------------------------------------------------------------
+/** Find the position (rank) of every kart. The karts that are still racing
+ *  are sorted by rank (see sortByRank), finished and eliminated karts keep
+ *  their position.
  */
 void LinearWorld::updateRacePosition()
 {
@@ -665,57 +737,43 @@ void LinearWorld::updateRacePosition()
     bool rank_changed = false;
 #endif
 
-    // NOTE: if you do any changes to this loop, the next loop (see
-    // DEBUG_KART_RANK below) needs to have the same changes applied
-    // so that debug output is still correct!!!!!!!!!!!
+    m_rank_info.resize(kart_amount);
     for (unsigned int i=0; i<kart_amount; i++)
     {
         AbstractKart* kart = m_karts[i];
+        RankInfo &info = m_rank_info[i];
+        info.m_distance         = m_kart_info[i].m_overall_distance;
+        info.m_initial_position = kart->getInitialPosition();
+        info.m_finished         = kart->hasFinishedRace();
+        info.m_eliminated       = kart->isEliminated();
         // Karts that are either eliminated or have finished the
         // race already have their (final) position assigned. If
         // these karts would get their rank updated, it could happen
         // that a kart that finished first will be overtaken after
         // crossing the finishing line and become second!
-        if(kart->isEliminated() || kart->hasFinishedRace())
+        if (info.m_eliminated || info.m_finished)
         {
             // This is only necessary to support debugging inconsistencies
             // in kart position parameters.
             setKartPosition(i, kart->getPosition());
-            continue;
         }
-        KartInfo& kart_info = m_kart_info[i];
-
-        int p = 1 ;
-
-        const unsigned int my_id = kart->getWorldKartId();
-        const float my_distance  = m_kart_info[my_id].m_overall_distance;
-
-        // Count karts ahead of the current kart, i.e. kart that are
-        // already finished or have covered a larger overall distance.
-        for (unsigned int j = 0 ; j < kart_amount ; j++)
-        {
-            // don't compare a kart with itself and ignore eliminated karts
-            if(j == my_id || m_karts[j]->isEliminated())
-                continue;
-
-            // If the other kart has:
-            // - finished the race (but this kart hasn't)
-            // - or is ahead
-            // - or has the same distance (very unlikely) but started earlier
-            // it is ahead --> increase position
-            if((!kart->hasFinishedRace() && m_karts[j]->hasFinishedRace()) ||
-                m_kart_info[j].m_overall_distance > my_distance            ||
-               (m_kart_info[j].m_overall_distance == my_distance &&
-                m_karts[j]->getInitialPosition()<kart->getInitialPosition() ) )
-            {
-                p++;
-            }
+    }
 
-        } //next kart
+    // NOTE: if you do any changes to the ranking, the loop below (see
+    // DEBUG_KART_RANK) needs to have the same changes applied
+    // so that debug output is still correct!!!!!!!!!!!
+    const unsigned int first_position = sortByRank(m_rank_info,
+                                                   &m_rank_order);
+    for (unsigned int n = 0; n < m_rank_order.size(); n++)
+    {
+        const unsigned int i = m_rank_order[n];
+        KartInfo& kart_info = m_kart_info[i];
+        const int p = first_position + n;
 
 #ifndef DEBUG
         setKartPosition(i, p);
 #else
+        AbstractKart* kart = m_karts[i];
         rank_changed |= kart->getPosition()!=p;
         if (!setKartPosition(i,p))
         {
@@ -733,10 +791,11 @@ void LinearWorld::updateRacePosition()
             }
 
             logdebug("[LinearWorld]", "Who has each ranking so far :");
-            for (unsigned int d=0; d<i; d++)
+            for (unsigned int d=0; d<n; d++)
             {
-                logdebug("[LinearWorld]", "%s has rank %d", m_karts[d]->getIdent().c_str(),
-                            m_karts[d]->getPosition());
+                const unsigned int k = m_rank_order[d];
+                logdebug("[LinearWorld]", "%s has rank %d", m_karts[k]->getIdent().c_str(),
+                            m_karts[k]->getPosition());
             }
 
             logdebug("[LinearWorld]", "    --> And %s is being set at rank %d",
@@ -756,7 +815,7 @@ void LinearWorld::updateRacePosition()
             music_manager->switchToFastMusic();
             m_faster_music_active=true;
         }
-    }   // for i<kart_amount
+    }   // for n<m_rank_order.size()
 
     // Define this to get a detailled analyses each time a race position
     // changes.
@@ -830,6 +889,111 @@ void LinearWorld::updateRacePosition()
     endSetKartPositions();
 }   // updateRacePosition
 
+//-----------------------------------------------------------------------------
+/** Tests sortByRank with a few karts whose positions are known, then
+ *  replays a race of many karts through the pairwise ranking and through
+ *  sortByRank, and tests that both give each kart the same position in each
+ *  frame. The distances are multiples of 0.5 (and karts can be stuck or
+ *  rescued), so karts often have exactly the same distance. The leading
+ *  kart finishes once it has covered the race distance, and from time to
+ *  time the last kart is eliminated.
+ */
+void LinearWorld::unitTesting()
+{
+    // Two finished karts, one eliminated kart, and a tie in distance that
+    // is decided by the start position. 0 means the kart is not ranked.
+    {
+        const struct
+        {
+            float        m_distance;
+            int          m_initial_position;
+            bool         m_finished, m_eliminated;
+            unsigned int m_expected_position;
+        } karts[] =
+        {
+            { 100.0f, 3, false, false, 5 },
+            { 500.0f, 1, true,  false, 0 },
+            { 100.0f, 2, false, false, 4 },
+            { 300.0f, 7, false, true,  0 },
+            { 250.0f, 5, false, false, 3 },
+            {   0.0f, 4, false, false, 6 },
+            { 450.0f, 6, true,  false, 0 },
+        };
+        const unsigned int num_karts = sizeof(karts) / sizeof(karts[0]);
+        std::vector<RankInfo> info(num_karts);
+        for (unsigned int i = 0; i < num_karts; i++)
+        {
+            info[i].m_distance         = karts[i].m_distance;
+            info[i].m_initial_position = karts[i].m_initial_position;
+            info[i].m_finished         = karts[i].m_finished;
+            info[i].m_eliminated       = karts[i].m_eliminated;
+        }
+        std::vector<unsigned int> order;
+        const unsigned int first_position = sortByRank(info, &order);
+        std::vector<unsigned int> position(num_karts, 0);
+        for (unsigned int n = 0; n < order.size(); n++)
+            position[order[n]] = first_position + n;
+        assert(first_position == 3 && order.size() == 4);
+        for (unsigned int i = 0; i < num_karts; i++)
+            assert(position[i] == karts[i].m_expected_position);
+    }
+
+    const unsigned int num_karts = 24;
+    const float race_distance    = 3000.0f;
+    std::vector<RankInfo> info(num_karts);
+    std::vector<unsigned int> order;
+    for (unsigned int i = 0; i < num_karts; i++)
+    {
+        info[i].m_distance         = 0.0f;
+        // The start order is different from the order of the karts
+        info[i].m_initial_position = (i * 7) % num_karts + 1;
+        info[i].m_finished         = false;
+        info[i].m_eliminated       = false;
+    }
+
+    uint32_t seed = 12345;
+    unsigned int num_ties = 0;
+    for (unsigned int frame = 0; frame < 2000; frame++)
+    {
+        for (unsigned int i = 0; i < num_karts; i++)
+        {
+            if (info[i].m_finished || info[i].m_eliminated) continue;
+            seed = seed * 1103515245 + 12345;
+            const unsigned int r = (seed >> 16) % 16;
+            if (r == 0)
+                info[i].m_distance = std::max(info[i].m_distance - 20.0f,
+                                              0.0f);
+            else if (r > 2)
+                info[i].m_distance += r * 0.5f;
+        }
+
+        const unsigned int first_position = sortByRank(info, &order);
+        for (unsigned int n = 0; n < order.size(); n++)
+        {
+            const unsigned int position = first_position + n;
+            assert(position == getRankPairwise(info, order[n]));
+            (void)position;   // avoid compiler warning with NDEBUG
+            if (n > 0 &&
+                info[order[n]].m_distance == info[order[n - 1]].m_distance)
+                num_ties++;
+        }
+
+        if (!order.empty() && info[order[0]].m_distance >= race_distance)
+            info[order[0]].m_finished = true;
+        if (frame % 400 == 399 && order.size() > 1)
+            info[order.back()].m_eliminated = true;
+    }
+    // Check that the replay covered what it is meant to test
+    assert(num_ties > num_karts);
+    unsigned int num_finished = 0, num_eliminated = 0;
+    for (unsigned int i = 0; i < num_karts; i++)
+    {
+        if (info[i].m_finished)   num_finished++;
+        if (info[i].m_eliminated) num_eliminated++;
+    }
+    assert(num_finished > 1 && num_eliminated > 1);
+}   // unitTesting
+
 //-----------------------------------------------------------------------------
 /** Checks if a kart is going in the wrong direction. This is done only for
  *  player karts to display a message to the player.
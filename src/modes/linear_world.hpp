@@ -91,6 +91,29 @@ private:
         }   // reset
     };
     // ------------------------------------------------------------------------
+    /** The data of a kart that determines its race position. */
+    struct RankInfo
+    {
+        /** Overall distance of the kart. */
+        float m_distance;
+
+        /** Start position, decides if two karts have the same distance. */
+        int   m_initial_position;
+
+        bool  m_finished;
+        bool  m_eliminated;
+    };
+
+    /** The rank data of all karts, and the indices of the karts that are
+     *  still racing sorted by rank. Only kept to avoid allocations in each
+     *  call of updateRacePosition. */
+    std::vector<RankInfo>     m_rank_info;
+    std::vector<unsigned int> m_rank_order;
+
+    static unsigned int sortByRank(const std::vector<RankInfo> &info,
+                                   std::vector<unsigned int> *order);
+    static unsigned int getRankPairwise(const std::vector<RankInfo> &info,
+                                        unsigned int kart_index);
 
 protected:
 
@@ -127,6 +150,7 @@ public:
     virtual btTransform getRescueTransform(unsigned int index) const OVERRIDE;
     virtual void  reset() OVERRIDE;
     virtual void  newLap(unsigned int kart_index) OVERRIDE;
+    static  void  unitTesting();
 
     // ------------------------------------------------------------------------
     /** Returns if this race mode has laps. */
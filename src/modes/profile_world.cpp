@@ -19,10 +19,13 @@
 #include "modes/profile_world.hpp"
 
 #include "main_loop.hpp"
+#include "config/user_config.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/irr_driver.hpp"
 #include "karts/kart_with_stats.hpp"
 #include "karts/controller/controller.hpp"
+#include "karts/controller/skidding_ai.hpp"
+#include "race/history.hpp"
 #include "tracks/track.hpp"
 
 #include <ISceneManager.h>
@@ -167,6 +170,17 @@ void ProfileWorld::update(float dt)
 
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Returns the average time of one AI decision of a kart in microseconds,
+ *  or 0 if the kart is not driven by a SkiddingAI.
+ *  \param kart The kart.
+ */
+static float getAIDecisionTime(AbstractKart *kart)
+{
+    SkiddingAI *ai = dynamic_cast<SkiddingAI*>(kart->getController());
+    return ai ? ai->getAverageDecisionTime() : 0.0f;
+}   // getAIDecisionTime
+
 //-----------------------------------------------------------------------------
 /** This function is called when the race is finished, but end-of-race
  *  animations have still to be played. In the case of profiling,
@@ -174,6 +188,9 @@ void ProfileWorld::update(float dt)
  */
 void ProfileWorld::enterRaceOverState()
 {
+    if (UserConfigParams::m_save_history && !history->replayHistory())
+        history->Save();
+
     // If in timing mode, the number of laps is way too high (which avoids
     // aborting too early). So in this case determine the maximum number
     // of laps and set this +1 as the number of laps to get more meaningful
@@ -223,7 +240,8 @@ void ProfileWorld::enterRaceOverState()
     float min_t=999999.9f, max_t=0.0, av_t=0.0;
     logverbose("profile", "name start_position end_position time average_speed top_speed skid_time rescue_time rescue_count brake_count \
            explosion_time explosion_count bonus_count banana_count \
-           small_nitro_count large_nitro_count bubblegum_count");
+           small_nitro_count large_nitro_count bubblegum_count \
+           off_track_count ai_decision_time_us");
 
     std::set<std::string> all_groups;
 
@@ -251,6 +269,7 @@ void ProfileWorld::enterRaceOverState()
         ss << kart->getBonusCount() << " " << kart->getBananaCount() << " ";
         ss << kart->getSmallNitroCount() << " " << kart->getLargeNitroCount() << " ";
         ss << kart->getBubblegumCount() << " " << kart->getOffTrackCount() << " ";
+        ss << getAIDecisionTime(kart) << " ";
 		logverbose("profile", "%s", ss.str().c_str());
     }
 
@@ -270,7 +289,7 @@ void ProfileWorld::enterRaceOverState()
     std::ostringstream ss;
     logverbose("profile", "");
     ss << "name" << std::setw(max_len-4) << " "
-       << "Strt End  Time    AvSp  Top   Skid  Resc Rsc Brake Expl Exp Itm Ban SNitLNit Bub Off Energy";
+       << "Strt End  Time    AvSp  Top   Skid  Resc Rsc Brake Expl Exp Itm Ban SNitLNit Bub Off Energy AI us";
 	logverbose("profile", "%s", ss.str().c_str());
     for(std::set<std::string>::iterator it = all_groups.begin();
         it !=all_groups.end(); it++)
@@ -280,7 +299,7 @@ void ProfileWorld::enterRaceOverState()
         int   l_nitro_count = 0,    s_nitro_count   = 0,    bubble_count = 0;
         int   expl_count    = 0,    off_track_count = 0;
         float skidding_time = 0.0f, rescue_time     = 0.0f, expl_time    = 0.0f;
-        float av_time       = 0.0f, energy          = 0;
+        float av_time       = 0.0f, energy          = 0,    ai_time      = 0;
         for ( unsigned int i = 0; i < (unsigned int)m_karts.size(); ++i)
         {
             KartWithStats* kart = dynamic_cast<KartWithStats*>(m_karts[i]);
@@ -302,7 +321,7 @@ void ProfileWorld::enterRaceOverState()
             distance *= Track::getCurrentTrack()->getTrackLength();
 
             logverbose("profile",
-                   "%s %4.2f %3.2f %6.2f %4.2f %3d %5d %4.2f %3d %3d %3d %3d %3d %3d %5d %4.2f",
+                   "%s %4.2f %3.2f %6.2f %4.2f %3d %5d %4.2f %3d %3d %3d %3d %3d %3d %5d %4.2f %5.1f",
                    ss.str().c_str(), distance/kart->getFinishTime(),
                    kart->getTopSpeed(),
                    kart->getSkiddingTime(),        kart->getRescueTime(),
@@ -311,7 +330,7 @@ void ProfileWorld::enterRaceOverState()
                    kart->getBonusCount(),          kart->getBananaCount(),
                    kart->getSmallNitroCount(),     kart->getLargeNitroCount(),
                    kart->getBubblegumCount(),      kart->getOffTrackCount(),
-                   kart->getEnergy()
+                   kart->getEnergy(),              getAIDecisionTime(kart)
                    );
             av_time += kart->getFinishTime();
             skidding_time   += kart->getSkiddingTime();
@@ -327,6 +346,7 @@ void ProfileWorld::enterRaceOverState()
             expl_count      += kart->getExplosionCount();
             off_track_count += kart->getOffTrackCount();
             energy          += kart->getEnergy();
+            ai_time         += getAIDecisionTime(kart);
         }    // for i < m_karts.size
 
 		logverbose("[profile]","profile", std::string(max_len + 90, '-').c_str());
@@ -337,11 +357,11 @@ void ProfileWorld::enterRaceOverState()
            << std::noshowpos << std::setw(13) << av_time/count
            << std::string(11,' ');
 
-        logverbose("profile", "%s%6.2f %4.2f %3d %5d %4.2f %3d %3d %3d %3d %3d %3d %5d %4.2f",
+        logverbose("profile", "%s%6.2f %4.2f %3d %5d %4.2f %3d %3d %3d %3d %3d %3d %5d %4.2f %5.1f",
                ss.str().c_str(), skidding_time/count, rescue_time/count,
                rescue_count,brake_count, expl_time, expl_count, bonus_count,
                banana_count, s_nitro_count, l_nitro_count, bubble_count,
-               off_track_count, energy);
+               off_track_count, energy, ai_time/count);
         logverbose("profile", "");
     }   // for it !=all_groups.end
     delete this;
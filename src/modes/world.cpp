@@ -68,6 +68,7 @@
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/constants.hpp"
+#include "utils/job_system.hpp"
 #include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
@@ -266,6 +267,9 @@ void World::reset()
     m_eliminated_players  = 0;
     m_is_network_world = false;
 
+    // Before the AIs are reset, since they seed their own random numbers
+    history->seedRandomNumbers();
+
     for ( KartList::iterator i = m_karts.begin(); i != m_karts.end() ; ++i )
     {
         (*i)->reset();
@@ -855,6 +859,10 @@ void World::updateWorld(float dt)
     {
         history->updateSaving(dt);   // updating the saved state
     }
+    else if (history->checkHistory())
+    {
+        history->updateChecking();
+    }
 
     try
     {
@@ -979,15 +987,46 @@ void World::update(float dt)
     // Update all the karts. This in turn will also update the controller,
     // which causes all AI steering commands set. So in the following 
     // physics update the new steering is taken into account.
+    // This is done in three phases: first the data of all karts that the
+    // controllers read is updated, then all controllers that support it
+    // decide on their actions (possibly in parallel, they only read the
+    // world), then all karts are updated, which applies these decisions.
+    // Since the decisions of all controllers are based on the same state
+    // of the world, the result does not depend on the number of threads.
+    // Note that in the serial loop used before, a controller saw the karts
+    // before it already updated. A history recorded with --save-history
+    // and checked with --history=4 (e.g. with a different --sim-threads)
+    // checks that the karts are at exactly the same positions.
     const int kart_amount = (int)m_karts.size();
+    std::vector<AbstractKart*> active_karts;
+    active_karts.reserve(kart_amount);
     for (int i = 0 ; i < kart_amount; ++i)
     {
         SpareTireAI* sta =
             dynamic_cast<SpareTireAI*>(m_karts[i]->getController());
         // Update all karts that are not eliminated
         if(!m_karts[i]->isEliminated() || (sta && sta->isMoving()))
-            m_karts[i]->update(dt);
+            active_karts.push_back(m_karts[i]);
     }
+
+    for (unsigned int i = 0; i < active_karts.size(); i++)
+        active_karts[i]->preUpdate(dt);
+
+    if (!history->replayControls() && !RewindManager::get()->isRewinding())
+    {
+        PROFILER_PUSH_CPU_MARKER("World::update (decide)", 0x40, 0x40, 0x00);
+        JobSystem::get()->parallelFor((int)active_karts.size(),
+            [&active_karts, dt](int i)
+            {
+                Controller *controller = active_karts[i]->getController();
+                if (controller->canDecideInParallel())
+                    controller->decide(dt);
+            });
+        PROFILER_POP_CPU_MARKER();
+    }
+
+    for (unsigned int i = 0; i < active_karts.size(); i++)
+        active_karts[i]->update(dt);
     PROFILER_POP_CPU_MARKER();
 
     PROFILER_PUSH_CPU_MARKER("World::update (camera)", 0x60, 0x7F, 0x00);
@@ -1032,7 +1071,7 @@ void World::update(float dt)
 void World::updateTime(const float dt)
 {
     WorldStatus::updateTime(dt);
-    RewindManager::get()->setCurrentTime(getTime(), dt);
+    RewindManager::get()->setCurrentTime(getTime(), getTicks(), dt);
 }   // updateTime
 
 // ----------------------------------------------------------------------------
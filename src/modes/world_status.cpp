@@ -61,6 +61,7 @@ WorldStatus::WorldStatus()
 void WorldStatus::reset()
 {
     m_time            = 0.0f;
+    m_ticks           = 0;
     m_auxiliary_timer = 0.0f;
     m_count_up_timer  = 0.0f;
 
@@ -391,6 +392,9 @@ void WorldStatus::updateTime(const float dt)
 
     IrrlichtDevice *device = irr_driver->getDevice();
 
+    if (!device->getTimer()->isStopped())
+        m_ticks++;
+
     switch (m_clock_mode)
     {
         case CLOCK_CHRONO:
@@ -448,6 +452,18 @@ void WorldStatus::setTime(const float time)
     m_time = time;
 }   // setTime
 
+//-----------------------------------------------------------------------------
+/** Returns true if the simulation uses fixed ticks: each world update
+ *  advances the time by exactly 1/TICKS_PER_SECOND seconds, and physics
+ *  does exactly one step per update. This makes rewinds exact, and a
+ *  simulation reproducible. It is enabled with --fixed-ticks (and must
+ *  then be used by all clients and the server of a networked game).
+ */
+bool WorldStatus::isFixedTicks()
+{
+    return UserConfigParams::m_fixed_ticks;
+}   // isFixedTicks
+
 //-----------------------------------------------------------------------------
 /** Pauses the game and switches to the specified phase.
  *  \param phase Phase to switch to.
@@ -87,10 +87,18 @@ public:
         GOAL_PHASE
     };
 
+    /** Number of simulation ticks per second in fixed tick mode. */
+    static const int TICKS_PER_SECOND = 60;
+
 protected:
     /** Elasped/remaining time in seconds. */
     double          m_time;
 
+    /** Number of world time updates since the race was reset. In fixed
+     *  tick mode this identifies a simulation step exactly, and is used
+     *  by rewind and network messages instead of the (float) time. */
+    int             m_ticks;
+
     /** If the start race should be played, disabled in cutscenes. */
     bool            m_play_racestart_sounds;
 
@@ -146,6 +154,20 @@ public:
     virtual void enterRaceOverState();
     virtual void terminateRace();
     void         setTime(const float time);
+    static bool  isFixedTicks();
+
+    // ------------------------------------------------------------------------
+    /** Converts a number of ticks into a time in seconds. */
+    static float ticksToTime(int ticks)
+    {
+        return float(ticks) / TICKS_PER_SECOND;
+    }   // ticksToTime
+    // ------------------------------------------------------------------------
+    /** Converts a time into the number of whole ticks it contains. */
+    static int timeToTicks(float time)
+    {
+        return int(time * TICKS_PER_SECOND);
+    }   // timeToTicks
 
     // ------------------------------------------------------------------------
     // Note: GO_PHASE is both: start phase and race phase
@@ -182,6 +204,14 @@ public:
     /** Returns the current race time. */
     float   getTime() const      { return (float)m_time; }
 
+    // ------------------------------------------------------------------------
+    /** Returns the number of world time updates since the race was reset. */
+    int     getTicks() const     { return m_ticks; }
+
+    // ------------------------------------------------------------------------
+    /** Sets the number of ticks, used when rewinding. */
+    void    setTicks(int ticks)  { m_ticks = ticks; }
+
     // ------------------------------------------------------------------------
     /** Will be called to notify your derived class that the clock,
      *  which is in COUNTDOWN mode, has reached zero. */
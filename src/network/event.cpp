@@ -24,10 +24,92 @@
 
 #include <string.h>
 
+Synchronised<std::vector<void*> > Event::m_pool;
+uint64_t Event::m_pool_hits   = 0;
+uint64_t Event::m_pool_misses = 0;
+
+// ----------------------------------------------------------------------------
+/** Allocates the memory for an event. It reuses the memory of a previously
+ *  deleted event if possible, so that no heap allocation is necessary for
+ *  each received packet once the pool is warmed up.
+ */
+void* Event::operator new(size_t size)
+{
+    assert(size == sizeof(Event));
+    m_pool.lock();
+    if (!m_pool.getData().empty())
+    {
+        void *p = m_pool.getData().back();
+        m_pool.getData().pop_back();
+        m_pool_hits++;
+        m_pool.unlock();
+        return p;
+    }
+    m_pool_misses++;
+    m_pool.unlock();
+    return ::operator new(size);
+}   // operator new
+
+// ----------------------------------------------------------------------------
+/** Returns the memory of an event to the pool. If the pool already contains
+ *  MAX_POOL_SIZE entries, the memory is freed.
+ */
+void Event::operator delete(void *p)
+{
+    if (!p) return;
+    m_pool.lock();
+    std::vector<void*> &pool = m_pool.getData();
+    if (pool.size() < MAX_POOL_SIZE)
+    {
+        // Reserve the full size once so that the pool does not allocate
+        if (pool.capacity() < MAX_POOL_SIZE)
+            pool.reserve(MAX_POOL_SIZE);
+        pool.push_back(p);
+        m_pool.unlock();
+        return;
+    }
+    m_pool.unlock();
+    ::operator delete(p);
+}   // operator delete
+
+// ----------------------------------------------------------------------------
+/** Returns statistics about the event pool. In steady state the number of
+ *  misses should not increase anymore.
+ *  \param hits Number of events allocated from the pool.
+ *  \param misses Number of events that needed a heap allocation.
+ *  \param free_count Number of unused events currently in the pool.
+ */
+void Event::getPoolStatistics(uint64_t *hits, uint64_t *misses,
+                              unsigned int *free_count)
+{
+    m_pool.lock();
+    *hits       = m_pool_hits;
+    *misses     = m_pool_misses;
+    *free_count = (unsigned int)m_pool.getData().size();
+    m_pool.unlock();
+}   // getPoolStatistics
+
+// ----------------------------------------------------------------------------
+/** Frees all memory stored in the pool. Called when the network is shut
+ *  down.
+ */
+void Event::clearPool()
+{
+    m_pool.lock();
+    for (unsigned int i = 0; i < m_pool.getData().size(); i++)
+        ::operator delete(m_pool.getData()[i]);
+    m_pool.getData().clear();
+    m_pool.unlock();
+}   // clearPool
+
+// ----------------------------------------------------------------------------
 /** \brief Constructor
+ *  The event takes ownership of the packet in the ENet event, the data of
+ *  the packet is not copied.
  *  \param event : The event that needs to be translated.
  */
 Event::Event(ENetEvent* event)
+     : m_data(event->type == ENET_EVENT_TYPE_RECEIVE ? event->packet : NULL)
 {
     m_arrival_time = (double)StkTime::getTimeSinceEpoch();
 
@@ -46,29 +128,20 @@ Event::Event(ENetEvent* event)
         return;
         break;
     }
-    if (m_type == EVENT_TYPE_MESSAGE)
-    {
-        m_data = new NetworkString(event->packet->data, 
-                                      event->packet->dataLength);
-    }
-    else
-        m_data = NULL;
-
-    if (event->packet)
-    {
-        // we got all we need, just remove the data.
+    // The packet of a received message is now owned by m_data. Other
+    // events should not have a packet, but make sure it is not leaked.
+    if (m_type != EVENT_TYPE_MESSAGE && event->packet)
         enet_packet_destroy(event->packet);
-    }
 
     m_peer = STKHost::get()->getPeer(event->peer);
     if(m_type == EVENT_TYPE_MESSAGE && m_peer->isClientServerTokenSet() &&
-        m_data->getToken()!=m_peer->getClientServerToken() )
+        m_data.getToken()!=m_peer->getClientServerToken() )
     {
         logerror("Event", "Received event with invalid token!");
         logerror("Event", "HostID %d Token %d message token %d",
             m_peer->getHostId(), m_peer->getClientServerToken(),
-            m_data->getToken());
-        logerror("Event","%s", m_data->getLogMessage().c_str());
+            m_data.getToken());
+        logerror("Event","%s", m_data.getLogMessage().c_str());
     }
 }   // Event(ENetEvent)
 
@@ -80,6 +153,5 @@ Event::~Event()
     // Do not delete m_peer, it's a pointer to the enet data structure
     // which is persistent.
     m_peer = NULL;
-    delete m_data;
 }   // ~Event
 
@@ -26,10 +26,13 @@
 
 #include "network/network_string.hpp"
 #include "utils/leak_check.hpp"
+#include "utils/synchronised.hpp"
 #include "utils/types.hpp"
 
 #include "enet/enet.h"
 
+#include <vector>
+
 class STKPeer;
 
 /*!
@@ -52,14 +55,18 @@ enum EVENT_TYPE
  * Indeed, when packets are logged, the state of the peer cannot be stored at
  * all times, and then the user of this class can rely only on the address/port
  * of the peer, and not on values that might change over time.
+ * Since one event is created for each received packet, events are
+ * allocated from a pool of recycled objects, and the message data is
+ * not copied: the NetworkString keeps a reference to the ENet packet.
  */
 class Event
 {
 private:
     LEAK_CHECK()
 
-    /** Copy of the data passed by the event. */
-    NetworkString *m_data;
+    /** The data passed by the event. This is a view of the received ENet
+     *  packet, and is empty for events like connection or disconnections. */
+    NetworkString m_data;
 
     /**  Type of the event. */
     EVENT_TYPE m_type;
@@ -70,10 +77,30 @@ private:
     /** Arrivial time of the event, for timeouts. */
     double m_arrival_time;
 
+    /** Maximum number of unused event objects kept for reuse. */
+    static const unsigned int MAX_POOL_SIZE = 256;
+
+    /** Memory of deleted events which can be reused for new events. */
+    static Synchronised<std::vector<void*> > m_pool;
+
+    /** Number of events that were allocated from the pool. Protected
+     *  by the m_pool mutex. */
+    static uint64_t m_pool_hits;
+
+    /** Number of events that needed a new heap allocation. Protected
+     *  by the m_pool mutex. */
+    static uint64_t m_pool_misses;
+
 public:
          Event(ENetEvent* event);
         ~Event();
 
+    static void* operator new(size_t size);
+    static void  operator delete(void *p);
+    static void  getPoolStatistics(uint64_t *hits, uint64_t *misses,
+                                   unsigned int *free_count);
+    static void  clearPool();
+
     // ------------------------------------------------------------------------
     /** Returns the type of this event. */
     EVENT_TYPE getType() const { return m_type; }
@@ -85,17 +112,17 @@ public:
     /** \brief Get a const reference to the received data.
      *  This is empty for events like connection or disconnections. 
      */
-    const NetworkString& data() const { return *m_data; }
+    const NetworkString& data() const { return m_data; }
     // ------------------------------------------------------------------------
     /** \brief Get a non-const reference to the received data.
-     *  A copy of the message data. This is empty for events like
-     *  connection or disconnections. */
-    NetworkString& data() { return *m_data; }
+     *  The message data. This is empty for events like connection or
+     *  disconnections. */
+    NetworkString& data() { return m_data; }
     // ------------------------------------------------------------------------
     /** Determines if this event should be delivered synchronous or not.
      *  Only messages can be delivered synchronous. */
     bool isSynchronous() const { return m_type==EVENT_TYPE_MESSAGE &&
-                                        m_data->isSynchronous();     }
+                                        m_data.isSynchronous();      }
     // ------------------------------------------------------------------------
     /** Returns the arrival time of this event. */
     double getArrivalTime() const { return m_arrival_time; }
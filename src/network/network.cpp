@@ -171,6 +171,14 @@ void Network::broadcastPacket(NetworkString *data, bool reliable)
 void Network::openLog()
 {
     m_log_file.setAtomic(NULL);
+    if (UserConfigParams::m_log_packets &&
+        UserConfigParams::m_log_packets_binary)
+    {
+        std::string s = file_manager
+            ->getUserConfigFile(FileManager::getStdoutName()+".trace");
+        if (Log::openBinaryTrace(s))
+            return;
+    }
     if (UserConfigParams::m_log_packets)
     {
         std::string s = file_manager
@@ -189,6 +197,12 @@ void Network::openLog()
  */
 void Network::logPacket(const BareNetworkString &ns, bool incoming)
 {
+    if (Log::isTracing())
+    {
+        Log::trace(incoming ? Log::TRACE_PACKET_IN : Log::TRACE_PACKET_OUT,
+                   ns.getData(), ns.getTotalSize());
+        return;
+    }
     if (m_log_file.getData() == NULL) // read only access, no need to lock
         return;
 
@@ -206,6 +220,7 @@ void Network::logPacket(const BareNetworkString &ns, bool incoming)
 // ----------------------------------------------------------------------------
 void Network::closeLog()
 {
+    Log::closeBinaryTrace();
     if (m_log_file.getData())
     {
         m_log_file.lock();
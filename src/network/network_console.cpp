@@ -19,6 +19,7 @@
 #include "network/network_console.hpp"
 
 #include "main_loop.hpp"
+#include "network/event.hpp"
 #include "network/network_config.hpp"
 #include "network/network_player_profile.hpp"
 #include "network/stk_host.hpp"
@@ -76,6 +77,14 @@ void* NetworkConsole::mainLoop(void* data)
         {
             me->kickAllPlayers();
         }
+        else if (str == "eventpool")
+        {
+            uint64_t hits, misses;
+            unsigned int free_count;
+            Event::getPoolStatistics(&hits, &misses, &free_count);
+            loginfo("Console", "Event pool: %lu hits, %lu misses, %u free.",
+                    (unsigned long)hits, (unsigned long)misses, free_count);
+        }
         else if (str == "start" && NetworkConfig::get()->isServer())
         {
             ServerLobby* protocol = 
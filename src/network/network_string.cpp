@@ -19,6 +19,8 @@
 
 #include "utils/string_utils.hpp"
 
+#include "enet/enet.h"
+
 #include <algorithm>   // for std::min
 #include <iomanip>
 #include <ostream>
@@ -66,9 +68,109 @@ void NetworkString::unitTesting()
     std::string log = slog.getLogMessage();
     assert(log=="0x000 | 00 01 02 03 04 05 06 07  08 09 0a 0b 0c 0d 0e 0f   | ................\n"
                 "0x010 | 10 11 12 13 14 15 16 17  18 19 1a 1b               | ............\n");
+
+    // Check that a string created from an ENet packet is only a view of
+    // the packet data, and that it is copied before it gets modified.
+    NetworkString orig(PROTOCOL_LOBBY_ROOM);
+    orig.setToken(token);
+    orig.addUInt16(4321).addFloat(2.5f);
+    ENetPacket *packet = enet_packet_create(orig.getData(),
+                                            orig.getTotalSize(),
+                                            ENET_PACKET_FLAG_RELIABLE);
+    NetworkString view(packet);
+    assert(view.isPacketView());
+    const NetworkString &const_view = view;
+    assert(const_view.getData()==(const char*)packet->data);
+    (void)const_view;   // avoid compiler warning with NDEBUG
+    assert(view.getProtocolType() == PROTOCOL_LOBBY_ROOM);
+    assert(view.getToken() == token);
+    assert(view.size() == 6);
+    assert(view.getUInt16() == 4321);
+    assert(view.getFloat() == 2.5f);
+    // A copy must not share the packet, otherwise it would be freed twice.
+    NetworkString view_copy(view);
+    assert(!view_copy.isPacketView());
+    assert(view_copy.getTotalSize() == view.getTotalSize());
+    view.setToken(new_token);
+    assert(!view.isPacketView());
+    assert(view.getToken() == new_token);
+    assert(view_copy.getToken() == token);
 }   // unitTesting
 
 // ============================================================================
+/** Creates a read-only view of the data in the given ENet packet. The
+ *  string takes ownership of the packet, and will destroy it when it is
+ *  deleted itself (or when it needs to be modified). A NULL packet results
+ *  in an empty string.
+ *  \param packet The ENet packet, can be NULL.
+ */
+BareNetworkString::BareNetworkString(ENetPacket *packet)
+{
+    m_current_offset = 0;
+    m_packet         = packet;
+    m_packet_data    = packet ? packet->data              : NULL;
+    m_packet_size    = packet ? (unsigned int)packet->dataLength : 0;
+}   // BareNetworkString(ENetPacket)
+
+// ----------------------------------------------------------------------------
+/** Copy constructor. A copy never shares an ENet packet with the original,
+ *  the data is always copied into the buffer of the new string.
+ */
+BareNetworkString::BareNetworkString(const BareNetworkString &other)
+{
+    m_buffer.assign(other.getBytes(),
+                    other.getBytes()+other.getBufferSize());
+    m_current_offset = other.m_current_offset;
+    m_packet         = NULL;
+    m_packet_data    = NULL;
+    m_packet_size    = 0;
+}   // BareNetworkString(const BareNetworkString&)
+
+// ----------------------------------------------------------------------------
+/** Assignment operator, which (like the copy constructor) copies the data
+ *  instead of sharing an ENet packet.
+ */
+BareNetworkString& BareNetworkString::operator=(const BareNetworkString &other)
+{
+    if (this == &other) return *this;
+    // Copy first, other might be using our packet data in some way
+    std::vector<uint8_t> buffer(other.getBytes(),
+                                other.getBytes()+other.getBufferSize());
+    releasePacket();
+    m_buffer.swap(buffer);
+    m_current_offset = other.m_current_offset;
+    return *this;
+}   // operator=
+
+// ----------------------------------------------------------------------------
+BareNetworkString::~BareNetworkString()
+{
+    releasePacket();
+}   // ~BareNetworkString
+
+// ----------------------------------------------------------------------------
+/** Destroys the ENet packet this string is a view of (if any).
+ */
+void BareNetworkString::releasePacket()
+{
+    if (!m_packet) return;
+    enet_packet_destroy(m_packet);
+    m_packet      = NULL;
+    m_packet_data = NULL;
+    m_packet_size = 0;
+}   // releasePacket
+
+// ----------------------------------------------------------------------------
+/** Converts a view of an ENet packet into a normal string by copying the
+ *  packet data into the buffer. This is called before any modification of
+ *  a string, so received packets are only copied if they are changed.
+ */
+void BareNetworkString::makeWritable()
+{
+    assert(m_packet);
+    m_buffer.assign(m_packet_data, m_packet_data+m_packet_size);
+    releasePacket();
+}   // makeWritable
 
 // ----------------------------------------------------------------------------
 /** Adds one byte for the length of the string, and then (up to 255 of)
@@ -130,15 +232,17 @@ int BareNetworkString::decodeStringW(irr::core::stringw *out) const
 std::string BareNetworkString::getLogMessage(const std::string &indent) const
 {
     std::ostringstream oss;
-    for(unsigned int line=0; line<m_buffer.size(); line+=16)
+    const uint8_t *bytes = getBytes();
+    unsigned int buffer_size = getBufferSize();
+    for(unsigned int line=0; line<buffer_size; line+=16)
     {
         oss << "0x" << std::hex << std::setw(3) << std::setfill('0') 
             << line << " | ";
-        unsigned int upper_limit = std::min(line+16, (unsigned int)m_buffer.size());
+        unsigned int upper_limit = std::min(line+16, buffer_size);
         for(unsigned int i=line; i<upper_limit; i++)
         {
             oss << std::hex << std::setfill('0') << std::setw(2) 
-                << int(m_buffer[i])<< ' ';
+                << int(bytes[i])<< ' ';
             if(i%8==7) oss << " ";
         }   // for i
         // fill with spaces if necessary to properly align ascii columns
@@ -152,7 +256,7 @@ std::string BareNetworkString::getLogMessage(const std::string &indent) const
         oss << " | ";
         for(unsigned int i=line; i<upper_limit; i++)
         {
-            uint8_t c = m_buffer[i];
+            uint8_t c = bytes[i];
             // Don't print tabs, and characters >=128, which are often shown
             // as more than one character.
             if(isprint(c) && c!=0x09 && c<=0x80)
@@ -163,7 +267,7 @@ std::string BareNetworkString::getLogMessage(const std::string &indent) const
         oss << "\n";
         // If it's not the last line, add the indentation in front
         // of the next line
-        if(line+16<m_buffer.size())
+        if(line+16<buffer_size)
             oss << indent;
     }   // for line
 
@@ -40,6 +40,8 @@
 
 typedef unsigned char uchar;
 
+struct _ENetPacket;
+
 /** \class BareNetworkString
  *  \brief Describes a chain of 8-bit unsigned integers.
  *  This class allows you to easily create and parse 8-bit strings, has 
@@ -58,6 +60,20 @@ protected:
     /** The actual buffer. */
     std::vector<uint8_t> m_buffer;
 
+    /** If not NULL, this string is a read-only view of the data of this
+     *  ENet packet (which is then owned by this string), and m_buffer is
+     *  not used. This avoids copying the data of each received packet.
+     *  Any attempt to modify the string will first copy the packet data
+     *  into m_buffer and release the packet (see makeWritable). */
+    _ENetPacket *m_packet;
+
+    /** Pointer to the data of m_packet, cached to avoid having to include
+     *  enet.h here. Only valid if m_packet is not NULL. */
+    const uint8_t *m_packet_data;
+
+    /** Number of bytes in m_packet_data. */
+    unsigned int m_packet_size;
+
     /** To avoid copying the buffer when bytes are deleted (which only
     *  happens at the front), use an offset index. All positions given
     *  by the user will be relative to this index. Note that the type
@@ -66,6 +82,22 @@ protected:
     */
     mutable int m_current_offset;
 
+    void makeWritable();
+    void releasePacket();
+    // ------------------------------------------------------------------------
+    /** Returns a pointer to the bytes of this string, independent of whether
+     *  the data is stored in m_buffer or in an ENet packet. */
+    const uint8_t* getBytes() const
+    {
+        return m_packet ? m_packet_data : m_buffer.data();
+    }   // getBytes
+    // ------------------------------------------------------------------------
+    /** Returns the total number of bytes stored in this string. */
+    unsigned int getBufferSize() const
+    {
+        return m_packet ? m_packet_size : (unsigned int)m_buffer.size();
+    }   // getBufferSize
+
     // ------------------------------------------------------------------------
     /** Returns a part of the network string as a std::string. This is an
     *  internal function only, the user should call decodeString(W) instead.
@@ -74,8 +106,7 @@ protected:
     */
     std::string getString(int len) const
     {
-        std::string a(m_buffer.begin() + (m_current_offset      ),
-                      m_buffer.begin() + (m_current_offset + len));
+        std::string a((const char*)getBytes() + m_current_offset, len);
         m_current_offset += len;
         return a;
     }   // getString
@@ -83,6 +114,7 @@ protected:
     /** Adds a std::string. Internal use only. */
     BareNetworkString& addString(const std::string& value)
     {
+        if (m_packet) makeWritable();
         for (unsigned int i = 0; i < value.size(); i++)
             m_buffer.push_back((uint8_t)(value[i]));
         return *this;
@@ -97,11 +129,12 @@ protected:
         T result = 0;
         m_current_offset += n;
         int offset = m_current_offset -1;
+        const uint8_t *bytes = getBytes();
         while (a--)
         {
             result <<= 8; // offset one byte
                           // add the data to result
-            result += m_buffer[offset - a];
+            result += bytes[offset - a];
         }
         return result;
     }   // get(int pos)
@@ -110,7 +143,7 @@ protected:
     template<typename T>
     T get() const
     {
-        return m_buffer[m_current_offset++];
+        return getBytes()[m_current_offset++];
     }   // get
 
 public:
@@ -120,12 +153,18 @@ public:
     {
         m_buffer.reserve(capacity);
         m_current_offset = 0;
+        m_packet         = NULL;
+        m_packet_data    = NULL;
+        m_packet_size    = 0;
     }   // BareNetworkString
 
     // ------------------------------------------------------------------------
     BareNetworkString(const std::string &s)
     {
         m_current_offset = 0;
+        m_packet         = NULL;
+        m_packet_data    = NULL;
+        m_packet_size    = 0;
         encodeString(s);
     }   // BareNetworkString
     // ------------------------------------------------------------------------
@@ -133,10 +172,18 @@ public:
     BareNetworkString(const char *data, int len)
     {
         m_current_offset = 0;
+        m_packet         = NULL;
+        m_packet_data    = NULL;
+        m_packet_size    = 0;
         m_buffer.resize(len);
         memcpy(m_buffer.data(), data, len);
     }   // BareNetworkString
 
+    BareNetworkString(_ENetPacket *packet);
+    BareNetworkString(const BareNetworkString &other);
+    BareNetworkString& operator=(const BareNetworkString &other);
+    ~BareNetworkString();
+
     // ------------------------------------------------------------------------
     /** Allows to read a buffer from the beginning again. */
     void reset() { m_current_offset = 0; }
@@ -148,15 +195,19 @@ public:
     std::string getLogMessage(const std::string &indent="") const;
     // ------------------------------------------------------------------------
     /** Returns a byte pointer to the content of the network string. */
-    char* getData() { return (char*)(m_buffer.data()); };
+    char* getData()
+    {
+        if (m_packet) makeWritable();
+        return (char*)(m_buffer.data());
+    }   // getData
 
     // ------------------------------------------------------------------------
     /** Returns a byte pointer to the content of the network string. */
-    const char* getData() const { return (char*)(m_buffer.data()); };
+    const char* getData() const { return (const char*)getBytes(); };
 
     // ------------------------------------------------------------------------
     /** Returns the remaining length of the network string. */
-    unsigned int size() const { return (int)m_buffer.size()-m_current_offset; }
+    unsigned int size() const { return getBufferSize()-m_current_offset; }
 
     // ------------------------------------------------------------------------
     /** Skips the specified number of bytes when reading. */
@@ -164,19 +215,24 @@ public:
     {
         m_current_offset += n;
         assert(m_current_offset >=0 &&
-               m_current_offset < (int)m_buffer.size());
+               m_current_offset < (int)getBufferSize());
     }   // skip
     // ------------------------------------------------------------------------
     /** Returns the send size, which is the full length of the buffer. A 
      *  difference to size() happens if the string to be sent was previously
      *  read, and has m_current_offset != 0. Even in this case the whole
      *  string must be sent. */
-    unsigned int getTotalSize() const { return m_buffer.size(); }
+    unsigned int getTotalSize() const { return getBufferSize(); }
+    // ------------------------------------------------------------------------
+    /** Returns true if this string is still a view of a received ENet
+     *  packet, i.e. no copy of the data was made. */
+    bool isPacketView() const { return m_packet != NULL; }
     // ------------------------------------------------------------------------
     // All functions related to adding data to a network string
     /** Add 8 bit unsigned int. */
     BareNetworkString& addUInt8(const uint8_t value)
     {
+        if (m_packet) makeWritable();
         m_buffer.push_back(value);
         return *this;
     }   // addUInt8
@@ -185,6 +241,7 @@ public:
     /** Adds a single character to the string. */
     BareNetworkString& addChar(const char value)
     {
+        if (m_packet) makeWritable();
         m_buffer.push_back((uint8_t)(value));
         return *this;
     }   // addChar
@@ -192,6 +249,7 @@ public:
     /** Adds 16 bit unsigned int. */
     BareNetworkString& addUInt16(const uint16_t value)
     {
+        if (m_packet) makeWritable();
         m_buffer.push_back((value >> 8) & 0xff);
         m_buffer.push_back(value & 0xff);
         return *this;
@@ -201,6 +259,7 @@ public:
     /** Adds unsigned 32 bit integer. */
     BareNetworkString& addUInt32(const uint32_t& value)
     {
+        if (m_packet) makeWritable();
         m_buffer.push_back((value >> 24) & 0xff);
         m_buffer.push_back((value >> 16) & 0xff);
         m_buffer.push_back((value >>  8) & 0xff);
@@ -221,9 +280,10 @@ public:
      *  has not been 'removed' (i.e. skipped). */
     BareNetworkString& operator+=(BareNetworkString const& value)
     {
+        if (m_packet) makeWritable();
         m_buffer.insert(m_buffer.end(),
-                       value.m_buffer.begin()+value.m_current_offset,
-                       value.m_buffer.end()   );
+                        value.getBytes()+value.m_current_offset,
+                        value.getBytes()+value.getBufferSize() );
         return *this;
     }   // operator+=
 
@@ -259,7 +319,7 @@ public:
     /** Returns an unsigned 8-bit integer. */
     inline uint8_t getUInt8() const
     {
-        return m_buffer[m_current_offset++];
+        return getBytes()[m_current_offset++];
     }   // getUInt8
 
     // ------------------------------------------------------------------------
@@ -353,18 +413,30 @@ public:
         m_current_offset = 5;   // ignore type and token
     }   // NetworkString
 
+    // ------------------------------------------------------------------------
+    /** Constructor for a received message which keeps a reference to the
+     *  ENet packet instead of copying its data. The string takes ownership
+     *  of the packet, which is destroyed together with the string. Like
+     *  the constructor above it skips the type and token. */
+    NetworkString(_ENetPacket *packet) : BareNetworkString(packet)
+    {
+        // ignore type and token
+        m_current_offset = packet ? 5 : 0;
+    }   // NetworkString
+
     // ------------------------------------------------------------------------
     /** Returns the protocol type of this message. */
     ProtocolType getProtocolType() const
     {
-        assert(!m_buffer.empty());
-        return (ProtocolType)(m_buffer[0] & ~PROTOCOL_SYNCHRONOUS);
+        assert(getBufferSize()>0);
+        return (ProtocolType)(getBytes()[0] & ~PROTOCOL_SYNCHRONOUS);
     }   // getProtocolType
 
     // ------------------------------------------------------------------------
     /** Sets if this message is to be sent synchronous or asynchronous. */
     void setSynchronous(bool b)
     {
+        if (m_packet) makeWritable();
         if(b)
             m_buffer[0] |= PROTOCOL_SYNCHRONOUS;
         else
@@ -374,7 +446,7 @@ public:
     /** Returns if this message is synchronous or not. */
     bool isSynchronous() const
     {
-        return (m_buffer[0] & PROTOCOL_SYNCHRONOUS) == PROTOCOL_SYNCHRONOUS;
+        return (getBytes()[0] & PROTOCOL_SYNCHRONOUS) == PROTOCOL_SYNCHRONOUS;
     }   // isSynchronous
     // ------------------------------------------------------------------------
     /** Sets a token for a message. Note that the token in an already
@@ -382,6 +454,7 @@ public:
     *  from the server to a set of clients). */
     void setToken(uint32_t token)
     {
+        if (m_packet) makeWritable();
         // Make sure there is enough space for the token:
         if(m_buffer.size()<5)
             m_buffer.resize(5);
@@ -27,14 +27,28 @@
 #include "utils/vs.hpp"
 
 #include <assert.h>
+#include <bitset>
+#include <chrono>
 #include <cstdlib>
 #include <errno.h>
+#include <string.h>
 #include <typeinfo>
 
+/** The maximum time the ProtocolManager thread sleeps if no event or
+ *  request arrives, since protocols are also updated in this thread. */
+static const int ASYNCHRONOUS_UPDATE_USEC = 2000;
+
 
 ProtocolManager::ProtocolManager()
 {
     pthread_mutex_init(&m_asynchronous_protocols_mutex, NULL);
+    pthread_mutex_init(&m_synchronous_events.m_mutex, NULL);
+    pthread_mutex_init(&m_asynchronous_events.m_mutex, NULL);
+    memset(&m_synchronous_events.m_statistics, 0, sizeof(EventStatistics));
+    memset(&m_asynchronous_events.m_statistics, 0, sizeof(EventStatistics));
+    pthread_mutex_init(&m_wakeup_mutex, NULL);
+    pthread_cond_init(&m_wakeup_cond, NULL);
+    m_wakeup_pending = false;
     m_exit.setAtomic(false);
     m_next_protocol_id.setAtomic(0);
 
@@ -53,11 +67,52 @@ void* ProtocolManager::mainLoop(void* data)
     while(manager && !manager->m_exit.getAtomic())
     {
         manager->asynchronousUpdate();
-        StkTime::sleep(2);
+
+        // Sleep till an event or request arrives, but update the
+        // protocols at least every ASYNCHRONOUS_UPDATE_USEC.
+        pthread_mutex_lock(&manager->m_wakeup_mutex);
+        if (!manager->m_wakeup_pending)
+        {
+            // The timeout is an absolute time based on the system clock
+            using namespace std::chrono;
+            uint64_t usec = duration_cast<microseconds>(
+                            system_clock::now().time_since_epoch()).count()
+                          + ASYNCHRONOUS_UPDATE_USEC;
+            struct timespec timeout;
+            timeout.tv_sec  = (time_t)(usec / 1000000);
+            timeout.tv_nsec = (long)(usec % 1000000) * 1000;
+            pthread_cond_timedwait(&manager->m_wakeup_cond,
+                                   &manager->m_wakeup_mutex, &timeout);
+        }
+        manager->m_wakeup_pending = false;
+        pthread_mutex_unlock(&manager->m_wakeup_mutex);
     }
     return NULL;
 }   // protocolManagerAsynchronousUpdate
 
+// ----------------------------------------------------------------------------
+/** Wakes up the ProtocolManager thread, so that new events or requests are
+ *  handled immediately.
+ */
+void ProtocolManager::wakeUp()
+{
+    pthread_mutex_lock(&m_wakeup_mutex);
+    m_wakeup_pending = true;
+    pthread_cond_signal(&m_wakeup_cond);
+    pthread_mutex_unlock(&m_wakeup_mutex);
+}   // wakeUp
+
+// ----------------------------------------------------------------------------
+/** Returns a monotonic time in microseconds, used to measure how long events
+ *  are queued.
+ */
+uint64_t ProtocolManager::getMicroseconds()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now()
+                                       .time_since_epoch()).count();
+}   // getMicroseconds
+
 
 // ----------------------------------------------------------------------------
 ProtocolManager::~ProtocolManager()
@@ -70,6 +125,24 @@ ProtocolManager::~ProtocolManager()
 void ProtocolManager::abort()
 {
     m_exit.setAtomic(true);
+    wakeUp();
+    pthread_join(*m_asynchronous_update_thread, NULL); // wait the thread to finish
+
+    EventStatistics sync  = getEventStatistics(/*synchronous*/true);
+    EventStatistics async = getEventStatistics(/*synchronous*/false);
+    loginfo("ProtocolManager", "Synchronous events: %d, average latency %d "
+            "us, max latency %d us, max queue depth %d.",
+            (int)sync.m_num_events,
+            sync.m_num_events ? (int)(sync.m_total_latency/sync.m_num_events)
+                              : 0,
+            (int)sync.m_max_latency, sync.m_max_depth);
+    loginfo("ProtocolManager", "Asynchronous events: %d, average latency %d "
+            "us, max latency %d us, max queue depth %d.",
+            (int)async.m_num_events,
+            async.m_num_events ? (int)(async.m_total_latency
+                                       / async.m_num_events) : 0,
+            (int)async.m_max_latency, async.m_max_depth);
+
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
 
     m_protocols.lock();
@@ -78,13 +151,9 @@ void ProtocolManager::abort()
     m_protocols.getData().clear();
     m_protocols.unlock();
 
-    m_events_to_process.lock();
-    for (unsigned int i = 0; i < m_events_to_process.getData().size() ; i++)
-        delete m_events_to_process.getData()[i];
-    m_events_to_process.getData().clear();
-    m_events_to_process.unlock();
-    
-    
+    clearEvents(&m_synchronous_events);
+    clearEvents(&m_asynchronous_events);
+
     m_requests.lock();
     m_requests.getData().clear();
     m_requests.unlock();
@@ -92,22 +161,144 @@ void ProtocolManager::abort()
     pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
 
     pthread_mutex_destroy(&m_asynchronous_protocols_mutex);
-    pthread_join(*m_asynchronous_update_thread, NULL); // wait the thread to finish
+    pthread_mutex_destroy(&m_synchronous_events.m_mutex);
+    pthread_mutex_destroy(&m_asynchronous_events.m_mutex);
+    pthread_cond_destroy(&m_wakeup_cond);
+    pthread_mutex_destroy(&m_wakeup_mutex);
 }   // abort
 
+// ----------------------------------------------------------------------------
+/** Deletes all queued events of a lane.
+ *  \param lane The lane to clear.
+ */
+void ProtocolManager::clearEvents(EventLane *lane)
+{
+    pthread_mutex_lock(&lane->m_mutex);
+    for (unsigned int i = 0; i < lane->m_queue.size(); i++)
+        delete lane->m_queue[i].m_event;
+    lane->m_queue.clear();
+    lane->m_statistics.m_depth = 0;
+    pthread_mutex_unlock(&lane->m_mutex);
+}   // clearEvents
+
 // ----------------------------------------------------------------------------
 /** \brief Function that processes incoming events.
  *  This function is called by the network manager each time there is an
- *  incoming packet.
+ *  incoming packet. The event is added to the queue of its lane, and if it
+ *  is asynchronous the ProtocolManager thread is woken up.
  */
 void ProtocolManager::propagateEvent(Event* event)
 {
-    m_events_to_process.lock();
-    m_events_to_process.getData().push_back(event); 
-    m_events_to_process.unlock();
-    return;
+    EventLane *lane = event->isSynchronous() ? &m_synchronous_events
+                                             : &m_asynchronous_events;
+    QueuedEvent queued;
+    queued.m_event = event;
+    queued.m_time  = getMicroseconds();
+
+    pthread_mutex_lock(&lane->m_mutex);
+    lane->m_queue.push_back(queued);
+    EventStatistics &statistics = lane->m_statistics;
+    statistics.m_depth++;
+    if (statistics.m_depth > statistics.m_max_depth)
+        statistics.m_max_depth = statistics.m_depth;
+    pthread_mutex_unlock(&lane->m_mutex);
+
+    if (lane == &m_asynchronous_events)
+        wakeUp();
 }   // propagateEvent
 
+// ----------------------------------------------------------------------------
+/** Delivers all queued events of a lane to their protocols in the order in
+ *  which they arrived. The queue is swapped with a second vector, so that
+ *  other threads can queue new events while the events are delivered, and
+ *  neither vector is reallocated in the next dispatch.
+ *  Events that could not be delivered (because the protocol has not started
+ *  yet) are put back at the front of the queue. All later events of the
+ *  same protocol type are kept as well, so that the events of one protocol
+ *  are never reordered. Connect and disconnect events are delivered to all
+ *  protocols, so they are only delivered once all earlier events are, and
+ *  all events after a kept connect or disconnect event are kept, too. This
+ *  way a disconnect is never delivered before the earlier messages of its
+ *  peer.
+ *  \param lane The lane whose events are delivered.
+ */
+void ProtocolManager::dispatchEvents(EventLane *lane)
+{
+    std::vector<QueuedEvent> &events = lane->m_delivering;
+    assert(events.empty());
+    pthread_mutex_lock(&lane->m_mutex);
+    if (lane->m_queue.empty())
+    {
+        pthread_mutex_unlock(&lane->m_mutex);
+        return;
+    }
+    events.swap(lane->m_queue);
+    pthread_mutex_unlock(&lane->m_mutex);
+
+    unsigned int delivered = 0;
+    uint64_t total_latency = 0, max_latency = 0;
+    // The protocol types of which an event was kept
+    std::bitset<256> blocked_types;
+    // True if a connect or disconnect event was kept
+    bool blocked_all = false;
+    unsigned int num_kept = 0;
+    for (unsigned int i = 0; i < events.size(); i++)
+    {
+        const QueuedEvent &queued = events[i];
+        bool is_message = queued.m_event->getType() == EVENT_TYPE_MESSAGE;
+        int type = is_message ? queued.m_event->data().getProtocolType()
+                              : PROTOCOL_NONE;
+        bool keep = blocked_all ||
+                    (is_message ? blocked_types.test(type) : num_kept > 0);
+        if (!keep)
+        {
+            uint64_t latency = getMicroseconds() - queued.m_time;
+            if (sendEvent(queued.m_event))
+            {
+                delivered++;
+                total_latency += latency;
+                if (latency > max_latency) max_latency = latency;
+                continue;
+            }
+        }
+        if (is_message)
+            blocked_types.set(type);
+        else
+            blocked_all = true;
+        events[num_kept++] = queued;
+    }   // for i < events.size()
+    events.resize(num_kept);
+
+    pthread_mutex_lock(&lane->m_mutex);
+    // Events that arrived in the meantime are queued after the
+    // events that were not delivered.
+    lane->m_queue.insert(lane->m_queue.begin(), events.begin(), events.end());
+    events.clear();
+    EventStatistics &statistics = lane->m_statistics;
+    statistics.m_depth         -= delivered;
+    statistics.m_num_events    += delivered;
+    statistics.m_total_latency += total_latency;
+    if (max_latency > statistics.m_max_latency)
+        statistics.m_max_latency = max_latency;
+    pthread_mutex_unlock(&lane->m_mutex);
+}   // dispatchEvents
+
+// ----------------------------------------------------------------------------
+/** Returns the statistics about the events of one lane.
+ *  \param synchronous True for the events delivered in update(), false for
+ *         the events delivered by the ProtocolManager thread.
+ */
+ProtocolManager::EventStatistics
+                       ProtocolManager::getEventStatistics(bool synchronous)
+{
+    EventLane *lane = synchronous ? &m_synchronous_events
+                                  : &m_asynchronous_events;
+    pthread_mutex_lock(&lane->m_mutex);
+    EventStatistics statistics = lane->m_statistics;
+    pthread_mutex_unlock(&lane->m_mutex);
+    return statistics;
+}   // getEventStatistics
+
 // ----------------------------------------------------------------------------
 /** \brief Asks the manager to start a protocol.
  * This function will store the request, and process it at a time it is
@@ -125,6 +316,7 @@ uint32_t ProtocolManager::requestStart(Protocol* protocol)
     m_requests.lock();
     m_requests.getData().push_back(req);
     m_requests.unlock();
+    wakeUp();
 
     return req.getProtocol()->getId();
 }   // requestStart
@@ -145,6 +337,7 @@ void ProtocolManager::requestPause(Protocol* protocol)
     m_requests.lock();
     m_requests.getData().push_back(req);
     m_requests.unlock();
+    wakeUp();
 }   // requestPause
 
 // ----------------------------------------------------------------------------
@@ -163,6 +356,7 @@ void ProtocolManager::requestUnpause(Protocol* protocol)
     m_requests.lock();
     m_requests.getData().push_back(req);
     m_requests.unlock();
+    wakeUp();
 }   // requestUnpause
 
 // ----------------------------------------------------------------------------
@@ -190,6 +384,7 @@ void ProtocolManager::requestTerminate(Protocol* protocol)
     }
     m_requests.getData().push_back(req);
     m_requests.unlock();
+    wakeUp();
 }   // requestTerminate
 
 // ----------------------------------------------------------------------------
@@ -324,23 +519,8 @@ bool ProtocolManager::sendEvent(Event* event)
 void ProtocolManager::update(float dt)
 {
     // before updating, notify protocols that they have received events
-    m_events_to_process.lock();
-    int size = (int)m_events_to_process.getData().size();
-    int offset = 0;
-    for (int i = 0; i < size; i++)
-    {
-        // Don't handle asynchronous events here.
-        if(!m_events_to_process.getData()[i+offset]->isSynchronous()) continue;
-        bool result = sendEvent(m_events_to_process.getData()[i+offset]);
-        if (result)
-        {
-            m_events_to_process.getData()
-                               .erase(m_events_to_process.getData().begin()+(i+offset),
-                                      m_events_to_process.getData().begin()+(i+offset+1));
-            offset --;
-        }
-    }
-    m_events_to_process.unlock();
+    dispatchEvents(&m_synchronous_events);
+
     // now update all protocols
     m_protocols.lock();
     for (unsigned int i = 0; i < m_protocols.getData().size(); i++)
@@ -363,23 +543,7 @@ void ProtocolManager::update(float dt)
 void ProtocolManager::asynchronousUpdate()
 {
     // before updating, notice protocols that they have received information
-    m_events_to_process.lock();
-    int size = (int)m_events_to_process.getData().size();
-    int offset = 0;
-    for (int i = 0; i < size; i++)
-    {
-        // Don't handle synchronous events here.
-        if(m_events_to_process.getData()[i+offset]->isSynchronous()) continue;
-        bool result = sendEvent(m_events_to_process.getData()[i+offset]);
-        if (result)
-        {
-            m_events_to_process.getData()
-                               .erase(m_events_to_process.getData().begin()+(i+offset),
-                                      m_events_to_process.getData().begin()+(i+offset+1));
-            offset --;
-        }
-    }
-    m_events_to_process.unlock();
+    dispatchEvents(&m_asynchronous_events);
 
     // now update all protocols that need to be updated in asynchronous mode
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
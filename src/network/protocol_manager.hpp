@@ -89,21 +89,76 @@ public:
  *  special thread, to ensure that they are processed independently from the
  *  frames per second. Then, the management of protocols is thread-safe: any
  *  object can start/pause/... protocols whithout problems.
+ *  Received events are stored in one queue per protocol type, in one of
+ *  two lanes: synchronous events are delivered in update() by the main
+ *  thread, asynchronous events by the protocol manager thread, which is
+ *  woken up as soon as an event or a request arrives.
  */ 
 class ProtocolManager : public AbstractSingleton<ProtocolManager>,
                         public NoCopy
 {
     friend class AbstractSingleton<ProtocolManager>;
+public:
+    /** Statistics about the events of one lane. */
+    struct EventStatistics
+    {
+        /** Number of events delivered to protocols. */
+        uint64_t     m_num_events;
+        /** Sum of the times between receiving and delivering an event,
+         *  in microseconds. */
+        uint64_t     m_total_latency;
+        /** Maximum time between receiving and delivering an event, in
+         *  microseconds. */
+        uint64_t     m_max_latency;
+        /** Number of events currently queued. */
+        unsigned int m_depth;
+        /** Maximum number of queued events. */
+        unsigned int m_max_depth;
+    };   // EventStatistics
+
 private:
+    /** An event together with the time it was queued (in microseconds). */
+    struct QueuedEvent
+    {
+        Event   *m_event;
+        uint64_t m_time;
+    };   // QueuedEvent
+
+    /** All queued events that are delivered by one thread. Events can be
+     *  added by any thread, and are taken out of the queue by the thread
+     *  that delivers the events of this lane. */
+    struct EventLane
+    {
+        /** Protects m_queue and the statistics. */
+        pthread_mutex_t m_mutex;
+        /** The queued events in the order in which they arrived. */
+        std::vector<QueuedEvent> m_queue;
+        /** The events that are currently delivered. This is only used by
+         *  the delivering thread, it is swapped with m_queue so that both
+         *  vectors keep their memory between dispatches. */
+        std::vector<QueuedEvent> m_delivering;
+        EventStatistics m_statistics;
+    };   // EventLane
+
 
     /** Contains the running protocols.
      *  This stores the protocols that are either running or paused, their
      *  state and their unique id. */
     Synchronised<std::vector<Protocol*> >m_protocols;
 
-    /** Contains the network events to pass asynchronously to protocols
-     *  (i.e. from the separate ProtocolManager thread). */
-    Synchronised<std::vector<Event*> > m_events_to_process;
+    /** The events delivered by update() in the main thread. */
+    EventLane m_synchronous_events;
+
+    /** The events delivered by the separate ProtocolManager thread. */
+    EventLane m_asynchronous_events;
+
+    /** Used to wake up the ProtocolManager thread when an asynchronous
+     *  event or a request arrives. */
+    pthread_mutex_t m_wakeup_mutex;
+    pthread_cond_t  m_wakeup_cond;
+
+    /** True if the thread was woken up, protected by m_wakeup_mutex. */
+    bool m_wakeup_pending;
 
     /** Contains the requests to start/pause etc... protocols. */
     Synchronised< std::vector<ProtocolRequest> > m_requests;
@@ -130,6 +185,10 @@ private:
     static void* mainLoop(void *data);
     uint32_t     getNextProtocolId();
     bool         sendEvent(Event* event);
+    void         wakeUp();
+    void         dispatchEvents(EventLane *lane);
+    void         clearEvents(EventLane *lane);
+    static uint64_t getMicroseconds();
 
     virtual void startProtocol(Protocol *protocol);
     virtual void terminateProtocol(Protocol *protocol);
@@ -147,6 +206,7 @@ public:
     virtual void      update(float dt);
     virtual Protocol* getProtocol(uint32_t id);
     virtual Protocol* getProtocol(ProtocolType type);
+    EventStatistics   getEventStatistics(bool synchronous);
 };   // class ProtocolManager
 
 #endif // PROTOCOL_MANAGER_HPP
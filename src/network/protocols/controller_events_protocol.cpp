@@ -50,7 +50,8 @@ bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
     if(!checkDataSize(event, 13)) return true;
 
     NetworkString &data = event->data();
-    float time = data.getFloat();
+    // World ticks at which the event was triggered on the sender
+    int ticks = data.getUInt32();
 
     uint8_t client_index = -1;
     while (data.size() >= 9)
@@ -67,6 +68,17 @@ bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
         uint8_t serialized_3   = data.getUInt8();
         PlayerAction action    = (PlayerAction)(data.getUInt8());
         int action_value       = data.getUInt32();
+        if (kart_id >= m_last_ticks.size())
+            m_last_ticks.resize(kart_id + 1, -1);
+        if (ticks < m_last_ticks[kart_id])
+        {
+            logverbose("ControllerEventsProtocol",
+                       "Discarding event of kart %d from tick %d, last "
+                       "applied event is from tick %d.",
+                       kart_id, ticks, m_last_ticks[kart_id]);
+            continue;
+        }
+        m_last_ticks[kart_id]  = ticks;
         loginfo("ControllerEventsProtocol", "KartID %d action %d value %d",
                   kart_id, action, action_value);
         Controller *controller = World::getWorld()->getKart(kart_id)
@@ -125,7 +137,7 @@ void ControllerEventsProtocol::controllerAction(Controller* controller,
     uint8_t serialized_3 = (uint8_t)(controls->getSteer()*127.0);
 
     NetworkString *ns = getNetworkString(13);
-    ns->addFloat(World::getWorld()->getTime());
+    ns->addUInt32(World::getWorld()->getTicks());
     ns->addUInt8(controller->getKart()->getWorldKartId());
     ns->addUInt8(serialized_1).addUInt8(serialized_2).addUInt8(serialized_3);
     ns->addUInt8((uint8_t)(action)).addUInt32(value);
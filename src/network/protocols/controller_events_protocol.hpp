@@ -24,11 +24,17 @@
 #include "input/input.hpp"
 #include "utils/cpp2011.hpp"
 
+#include <vector>
+
 class Controller;
 class STKPeer;
 
 class ControllerEventsProtocol : public Protocol
 {
+    /** The world ticks of the last event applied to each kart. The events
+     *  are sent unreliably, so an older event that arrives late would
+     *  override the newer controls, and is discarded instead. */
+    std::vector<int> m_last_ticks;
 
 public:
              ControllerEventsProtocol();
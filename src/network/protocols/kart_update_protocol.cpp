@@ -24,6 +24,7 @@ void KartUpdateProtocol::setup()
     // (which is the update information from the server to the client).
     m_next_positions.resize(World::getWorld()->getNumKarts());
     m_next_quaternions.resize(World::getWorld()->getNumKarts());
+    m_next_ticks.resize(World::getWorld()->getNumKarts(), -1);
 
     // This flag keeps track if valid data for an update is in
     // the arrays
@@ -48,12 +49,16 @@ bool KartUpdateProtocol::notifyEvent(Event* event)
         loginfo("KartUpdateProtocol", "Message too short.");
         return true;
     }
-    float time = ns.getFloat();
+    // World ticks at which the positions were sent
+    int ticks = ns.getUInt32();
     while(ns.size() >= 29)
     {
         uint8_t kart_id             = ns.getUInt8();
         Vec3 xyz                    = ns.getVec3();
         btQuaternion quat           = ns.getQuat();
+        if (ticks < m_next_ticks[kart_id])
+            continue;
+        m_next_ticks      [kart_id] = ticks;
         m_next_positions  [kart_id] = xyz;
         m_next_quaternions[kart_id] = quat;
     }   // while ns.size()>29
@@ -85,7 +90,7 @@ void KartUpdateProtocol::update(float dt)
             World *world = World::getWorld();
             NetworkString *ns = getNetworkString(4+world->getNumKarts()*29);
             ns->setSynchronous(true);
-            ns->addFloat( world->getTime() );
+            ns->addUInt32(world->getTicks());
             for (unsigned int i = 0; i < world->getNumKarts(); i++)
             {
                 AbstractKart* kart = world->getKart(i);
@@ -104,7 +109,7 @@ void KartUpdateProtocol::update(float dt)
             NetworkString *ns =
                      getNetworkString(4+29*race_manager->getNumLocalPlayers());
             ns->setSynchronous(true);
-            ns->addFloat(World::getWorld()->getTime());
+            ns->addUInt32(World::getWorld()->getTicks());
             for(unsigned int i=0; i<race_manager->getNumLocalPlayers(); i++)
             {
                 AbstractKart *kart = World::getWorld()->getLocalPlayerKart(i);
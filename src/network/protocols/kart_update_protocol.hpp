@@ -22,6 +22,11 @@ private:
     /** Stores the last updated rotation for a kart. */
     std::vector<btQuaternion> m_next_quaternions;
 
+    /** The world ticks at which the last update for a kart was sent. The
+     *  updates are sent unreliably, so an older update that arrives late
+     *  is discarded. */
+    std::vector<int> m_next_ticks;
+
     /** True if a new update for the kart positions was received. */
     bool m_was_updated;
 
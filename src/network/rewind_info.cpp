@@ -24,31 +24,33 @@
  *  for all state info.
  *  \param size Necessary buffer size for a state.
  */
-RewindInfo::RewindInfo(float time, bool is_confirmed)
+RewindInfo::RewindInfo(float time, int ticks, bool is_confirmed)
 {
     m_time         = time;
+    m_ticks        = ticks;
     m_is_confirmed = is_confirmed;
 }   // RewindInfo
 
 // ============================================================================
-RewindInfoTime::RewindInfoTime(float time)
-              : RewindInfo(time, /*is_confirmed*/true)
+RewindInfoTime::RewindInfoTime(float time, int ticks)
+              : RewindInfo(time, ticks, /*is_confirmed*/true)
 {
 }   // RewindInfoTime
 
 // ============================================================================
-RewindInfoState::RewindInfoState(float time, Rewinder *rewinder, 
+RewindInfoState::RewindInfoState(float time, int ticks, Rewinder *rewinder,
                                  BareNetworkString *buffer, bool is_confirmed)
-    : RewindInfoRewinder(time, rewinder, buffer, is_confirmed)
+    : RewindInfoRewinder(time, ticks, rewinder, buffer, is_confirmed)
 {
     m_local_physics_time = Physics::getInstance()->getPhysicsWorld()
                                                  ->getLocalTime();
 }   // RewindInfoState
 
 // ============================================================================
-RewindInfoEvent::RewindInfoEvent(float time, EventRewinder *event_rewinder,
+RewindInfoEvent::RewindInfoEvent(float time, int ticks,
+                                 EventRewinder *event_rewinder,
                                  BareNetworkString *buffer, bool is_confirmed)
-    : RewindInfo(time, is_confirmed)
+    : RewindInfo(time, ticks, is_confirmed)
 {
     m_event_rewinder = event_rewinder;
     m_buffer         = buffer;
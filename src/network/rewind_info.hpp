@@ -47,13 +47,17 @@ private:
     /** Time when this state was taken. */
     float m_time;
 
+    /** World ticks when this state was taken. The rewind infos are sorted
+     *  by ticks, and replayed at the tick they were taken at. */
+    int m_ticks;
+
     /** A confirmed event is one that was sent from the server. When
      *  rewinding we have to start with a confirmed state for each
      *  object.  */
     bool m_is_confirmed;
 
 public:
-    RewindInfo(float time, bool is_confirmed);
+    RewindInfo(float time, int ticks, bool is_confirmed);
 
     /** Called when going back in time to undo any rewind information. */
     virtual void undo() = 0;
@@ -68,6 +72,9 @@ public:
     /** Returns the time at which this rewind state was saved. */
     float getTime() const { return m_time; }
     // ------------------------------------------------------------------------
+    /** Returns the world ticks at which this rewind info was saved. */
+    int getTicks() const { return m_ticks; }
+    // ------------------------------------------------------------------------
     /** Sets if this RewindInfo is confirmed or not. */
     void setConfirmed(bool b) { m_is_confirmed = b; }
     // ------------------------------------------------------------------------
@@ -100,9 +107,9 @@ protected:
     Rewinder *m_rewinder;
 
 public:
-    RewindInfoRewinder(float time, Rewinder *rewinder,
+    RewindInfoRewinder(float time, int ticks, Rewinder *rewinder,
                        BareNetworkString *buffer, bool is_confirmed)
-        : RewindInfo(time, is_confirmed)
+        : RewindInfo(time, ticks, is_confirmed)
     {
         m_rewinder = rewinder;
         m_buffer = buffer;
@@ -123,7 +130,7 @@ class RewindInfoTime : public RewindInfo
 private:
 
 public:
-             RewindInfoTime(float time);
+             RewindInfoTime(float time, int ticks);
     virtual ~RewindInfoTime() {};
 
     // ------------------------------------------------------------------------
@@ -145,7 +152,7 @@ private:
     float m_local_physics_time;
 
 public:
-             RewindInfoState(float time, Rewinder *rewinder, 
+             RewindInfoState(float time, int ticks, Rewinder *rewinder,
                              BareNetworkString *buffer, bool is_confirmed);
     virtual ~RewindInfoState() {};
 
@@ -187,7 +194,8 @@ private:
     /** Buffer with the event data. */
     BareNetworkString *m_buffer;
 public:
-             RewindInfoEvent(float time, EventRewinder *event_rewinder,
+             RewindInfoEvent(float time, int ticks,
+                             EventRewinder *event_rewinder,
                              BareNetworkString *buffer, bool is_confirmed);
     virtual ~RewindInfoEvent()
     {
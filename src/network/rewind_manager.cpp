@@ -82,7 +82,11 @@ void RewindManager::reset()
     m_is_rewinding         = false;
     m_overall_state_size   = 0;
     m_state_frequency      = 0.1f;   // save 10 states a second
+    m_state_ticks          = WorldStatus::TICKS_PER_SECOND / 10;
     m_last_saved_state     = -9999.9f;  // forces initial state save
+    m_last_saved_ticks     = -9999;
+    m_current_time         = 0.0f;
+    m_current_ticks        = 0;
 
     if(!m_enable_rewind_manager) return;
 
@@ -113,15 +117,15 @@ void RewindManager::insertRewindInfo(RewindInfo *ri)
 #ifdef REWIND_SEARCH_STATS
     m_count_of_searches++;
 #endif
-    float t = ri->getTime();
+    int ticks = ri->getTicks();
 
     if(ri->isEvent())
     {
-        // If there are several infos for the same time t,
+        // If there are several infos for the same ticks,
         // events must be inserted at the end 
         AllRewindInfo::reverse_iterator i = m_rewind_info.rbegin();
         while(i!=m_rewind_info.rend() && 
-            (*i)->getTime() > t)
+            (*i)->getTicks() > ticks)
         {
 #ifdef REWIND_SEARCH_STATS
             m_count_of_comparisons++;
@@ -135,10 +139,10 @@ void RewindManager::insertRewindInfo(RewindInfo *ri)
     }
     else   // is a state
     {
-        // If there are several infos for the same time t,
+        // If there are several infos for the same ticks,
         // a state must be inserted first
         AllRewindInfo::reverse_iterator i = m_rewind_info.rbegin();
-        while(i!=m_rewind_info.rend() && (*i)->getTime() >= t)
+        while(i!=m_rewind_info.rend() && (*i)->getTicks() >= ticks)
         {
 #ifdef REWIND_SEARCH_STATS
             m_count_of_comparisons++;
@@ -153,13 +157,13 @@ void RewindManager::insertRewindInfo(RewindInfo *ri)
 
 // ----------------------------------------------------------------------------
 /** Returns the first (i.e. lowest) index i in m_rewind_info which fulfills 
- *  time(i) < target_time <= time(i+1) and is a state. This is the state
+ *  ticks(i) < target_ticks <= ticks(i+1) and is a state. This is the state
  *  from which a rewind can start - all states for the karts will be well
  *  defined.
- *  \param time Time for which an index is searched.
+ *  \param target_ticks World ticks for which an index is searched.
  *  \return Index in m_rewind_info after which to add rewind data.
  */
-unsigned int RewindManager::findFirstIndex(float target_time) const
+unsigned int RewindManager::findFirstIndex(int target_ticks) const
 {
     // For now do a linear search, even though m_rewind_info is sorted
     // I would expect that most insertions will be towards the (very)
@@ -181,7 +185,7 @@ unsigned int RewindManager::findFirstIndex(float target_time) const
 #endif
         if(m_rewind_info[index]->isState())
         {
-            if(m_rewind_info[index]->getTime()<target_time)
+            if(m_rewind_info[index]->getTicks()<target_ticks)
             {
                 return index;
             }
@@ -193,14 +197,14 @@ unsigned int RewindManager::findFirstIndex(float target_time) const
     if(index_last_state<0)
     {
         logfatal("RewindManager",
-                   "Can't find any state when rewinding to %f - aborting.",
-                   target_time);
+                   "Can't find any state when rewinding to tick %d - "
+                   "aborting.", target_ticks);
     }
 
     // Otherwise use the last found state - not much we can do in this case.
     logerror("RewindManager",
-               "Can't find state to rewind to for time %f, using %f.",
-               target_time, m_rewind_info[index_last_state]->getTime());
+               "Can't find state to rewind to for tick %d, using %d.",
+               target_ticks, m_rewind_info[index_last_state]->getTicks());
     return index_last_state;  // avoid compiler warning
 }   // findFirstIndex
 
@@ -219,8 +223,9 @@ void RewindManager::addEvent(EventRewinder *event_rewinder,
         logerror("RewindManager", "Adding event when rewinding");
         return;
     }
-    RewindInfo *ri = new RewindInfoEvent(getCurrentTime(), event_rewinder,
-                                         buffer, /*is confirmed*/true);
+    RewindInfo *ri = new RewindInfoEvent(getCurrentTime(), getCurrentTicks(),
+                                         event_rewinder, buffer,
+                                         /*is confirmed*/true);
     insertRewindInfo(ri);
 }   // addEvent
 
@@ -236,11 +241,21 @@ void RewindManager::saveStates()
         m_is_rewinding              )  return;
    
     float time = World::getWorld()->getTime();
-    if(time - m_last_saved_state < m_state_frequency)
+    if (WorldStatus::isFixedTicks())
+    {
+        // With fixed ticks each replayed step has the same size anyway,
+        // so no time entries are needed between states.
+        int ticks = World::getWorld()->getTicks();
+        if (ticks - m_last_saved_ticks < m_state_ticks)
+            return;
+        m_last_saved_ticks = ticks;
+    }
+    else if(time - m_last_saved_state < m_state_frequency)
     {
         // No full state necessary, add a dummy entry for the time
         // which increases replay precision (same time step size)
-        RewindInfo *ri = new RewindInfoTime(getCurrentTime());
+        RewindInfo *ri = new RewindInfoTime(getCurrentTime(),
+                                            getCurrentTicks());
         insertRewindInfo(ri);
         return;
     }
@@ -253,6 +268,7 @@ void RewindManager::saveStates()
         {
             m_overall_state_size += buffer->size();
             RewindInfo *ri = new RewindInfoState(getCurrentTime(),
+                                                 getCurrentTicks(),
                                                  m_all_rewinder[i], buffer,
                                                  /*is_confirmed*/true);
             assert(ri);
@@ -271,24 +287,31 @@ void RewindManager::saveStates()
 }   // saveStates
 
 // ----------------------------------------------------------------------------
-/** Rewinds to the specified time.
- *  \param t Time to rewind to.
+/** Rewinds to the specified world ticks. The rewind starts with the last
+ *  state before the given ticks, and then replays one world update per
+ *  tick until the ticks at which the rewind was started are reached.
+ *  All events of a tick are applied before that tick is simulated. In
+ *  fixed tick mode each step is exactly one tick, so the replay gives
+ *  exactly the same result as the original simulation (if no events
+ *  changed). Otherwise the time step sizes of the original frames are
+ *  used.
+ *  \param rewind_ticks World ticks to rewind to.
  */
-void RewindManager::rewindTo(float rewind_time)
+void RewindManager::rewindTo(int rewind_ticks)
 {
     assert(!m_is_rewinding);
     m_is_rewinding = true;
-    loginfo("rewind", "Rewinding to %f", rewind_time);
+    loginfo("rewind", "Rewinding to tick %d", rewind_ticks);
     history->doReplayHistory(History::HISTORY_NONE);
 
     // First find the state to which we need to rewind
     // ------------------------------------------------
-    unsigned int index = findFirstIndex(rewind_time);
+    unsigned int index = findFirstIndex(rewind_ticks);
 
     if(!m_rewind_info[index]->isState())
     {
-        logerror("RewindManager", "No state for rewind to %f, state %d.",
-                   rewind_time, index);
+        logerror("RewindManager", "No state for rewind to tick %d, state %d.",
+                   rewind_ticks, index);
         return;
     }
 
@@ -302,7 +325,7 @@ void RewindManager::rewindTo(float rewind_time)
         // anymore. They need to be rewritten when going forward during
         // the rewind.
         if(m_rewind_info[i]->isState() && 
-            m_rewind_info[i]->getTime() > m_rewind_info[index]->getTime() )
+            m_rewind_info[i]->getTicks() > m_rewind_info[index]->getTicks() )
             m_rewind_info[i]->setConfirmed(false);
     }   // for i>state
 
@@ -311,23 +334,30 @@ void RewindManager::rewindTo(float rewind_time)
     // ----------------------------
     World *world = World::getWorld();
     float current_time = world->getTime();
+    int current_ticks  = world->getTicks();
 
     // Get the (first) full state to which we have to rewind
     RewindInfoState *state =
                     dynamic_cast<RewindInfoState*>(m_rewind_info[index]);
 
-    // Store the time to which we have to replay to
-    float exact_rewind_time = state->getTime();
+    // Store the ticks to which we have to replay to
+    int exact_rewind_ticks = state->getTicks();
 
     // Now start the rewind with the full state:
-    world->setTime(exact_rewind_time);
-    float local_physics_time = state->getLocalPhysicsTime();
-    Physics::getInstance()->getPhysicsWorld()->setLocalTime(local_physics_time);
+    world->setTime(state->getTime());
+    world->setTicks(exact_rewind_ticks);
+    const bool fixed_ticks = WorldStatus::isFixedTicks();
+    if (!fixed_ticks)
+    {
+        float local_physics_time = state->getLocalPhysicsTime();
+        Physics::getInstance()->getPhysicsWorld()
+                              ->setLocalTime(local_physics_time);
+    }
 
-    // Restore all states from the current time - the full state of a race
+    // Restore all states from the current ticks - the full state of a race
     // will be potentially stored in several state objects. State can be NULL
     // if the next event is not a state
-    while(state && state->getTime()==exact_rewind_time)
+    while(state && state->getTicks()==exact_rewind_ticks)
     {
         state->rewind();
         index++;
@@ -335,15 +365,17 @@ void RewindManager::rewindTo(float rewind_time)
         state = dynamic_cast<RewindInfoState*>(m_rewind_info[index]);
     }
 
-    // Now go forward through the list of rewind infos:
+    // Now go forward through the list of rewind infos. With fixed ticks
+    // the step size is known, otherwise it is taken from the rewind infos,
+    // so the replay must stop when there are no more infos.
     // ------------------------------------------------
-    while( world->getTime() < current_time &&
-          index < (int)m_rewind_info.size()                 )
+    while( world->getTicks() < current_ticks &&
+          (fixed_ticks || index < m_rewind_info.size()) )
     {
-        // Now handle all states and events at the current time before
+        // Now handle all states and events at the current ticks before
         // updating the world:
-        while(index < (int)m_rewind_info.size() &&
-              m_rewind_info[index]->getTime()<=world->getTime()+0.001f)
+        while(index < m_rewind_info.size() &&
+              m_rewind_info[index]->getTicks()<=world->getTicks())
         {
             if(m_rewind_info[index]->isState())
             {
@@ -357,7 +389,8 @@ void RewindManager::rewindTo(float rewind_time)
             }
             index++;
         }
-        float dt = determineTimeStepSize(index, current_time);
+        float dt = fixed_ticks ? WorldStatus::ticksToTime(1)
+                               : determineTimeStepSize(index, current_time);
         world->updateWorld(dt);
 #define SHOW_ROLLBACK
 #ifdef SHOW_ROLLBACK
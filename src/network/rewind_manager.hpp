@@ -43,10 +43,10 @@ class EventRewinder;
  *  declared (usually inside of the object it can rewind). This instance
  *  is automatically registered with the RewindManager.
  *  All states and events are stored in a RewindInfo object. All RewindInfo
- *  objects are stored in a list sorted by time.
- *  When a rewind to time T is requested, the following takes place:
+ *  objects are stored in a list sorted by world ticks.
+ *  When a rewind to ticks T is requested, the following takes place:
  *  1. Go back in time:
- *     Determine the latest time t_min < T so that each rewindable objects
+ *     Determine the latest ticks t_min < T so that each rewindable objects
  *     has at least one state before T. For each state that is skipped during
  *     this process `undoState()` is being called, and for each event
  *     `undoEvent()` of the Rewinder.
@@ -105,12 +105,22 @@ private:
     /** Time at which the last state was saved. */
     float m_last_saved_state;
 
+    /** Number of ticks between consecutive state saves (fixed tick mode
+     *  only). */
+    int m_state_ticks;
+
+    /** Ticks at which the last state was saved (fixed tick mode only). */
+    int m_last_saved_ticks;
+
     /** The current time to be used in all states/events. This is used to
      *  give all states and events during one frame the same time, even
      *  if e.g. states are saved before world time is increased, other
      *  events later. */
     float m_current_time;
 
+    /** The current world ticks, used in the same way as m_current_time. */
+    int m_current_ticks;
+
     /** The current time step size. */
     float m_time_step;
 
@@ -125,7 +135,7 @@ private:
 
     RewindManager();
     ~RewindManager();
-    unsigned int findFirstIndex(float time) const;
+    unsigned int findFirstIndex(int target_ticks) const;
     void insertRewindInfo(RewindInfo *ri);
     float determineTimeStepSize(int state, float max_time);
 public:
@@ -138,18 +148,23 @@ public:
      *  and the time step size. This is necessary so that states/events before 
      *  and after World::m_time is increased have the same time stamp. 
      *  \param t Time.
+     *  \param ticks World ticks.
      *  \param dt Time step size.
      */
-    void setCurrentTime(float t, float dt)
+    void setCurrentTime(float t, int ticks, float dt)
     {
-        m_current_time = t;
-        m_time_step    = dt;
+        m_current_time  = t;
+        m_current_ticks = ticks;
+        m_time_step     = dt;
     }   // setCurrentTime
 
     // ------------------------------------------------------------------------
     /** Returns the current time. */
     float getCurrentTime() const { return m_current_time; }
     // ------------------------------------------------------------------------
+    /** Returns the current world ticks. */
+    int getCurrentTicks() const { return m_current_ticks; }
+    // ------------------------------------------------------------------------
     float getCurrentTimeStep() const { return m_time_step; }
     // ------------------------------------------------------------------------
     /** En- or disables rewinding. */
@@ -172,7 +187,7 @@ public:
 
     void reset();
     void saveStates();
-    void rewindTo(float target_time);
+    void rewindTo(int rewind_ticks);
     void addEvent(EventRewinder *event_rewinder, BareNetworkString *buffer);
     // ------------------------------------------------------------------------
     /** Adds a Rewinder to the list of all rewinders.
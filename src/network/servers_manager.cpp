@@ -202,6 +202,10 @@ Online::XMLRequest* ServersManager::getLANRefreshRequest() const
          *  functions are called, which will cause a crash. */
         virtual void afterOperation() OVERRIDE {}
         // --------------------------------------------------------------------
+        /** This request does not use curl, so it can not be executed by the
+         *  curl multi interface. */
+        virtual bool canRunConcurrently() const OVERRIDE { return false; }
+        // --------------------------------------------------------------------
     };   // LANRefreshRequest
     // ========================================================================
 
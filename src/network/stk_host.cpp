@@ -354,6 +354,7 @@ STKHost::~STKHost()
     stopListening();
 
     delete m_network;
+    Event::clearPool();
 }   // ~STKHost
 
 //-----------------------------------------------------------------------------
@@ -93,6 +93,8 @@ namespace Online
         m_filename      = "";
         m_parameters    = "";
         m_curl_code     = CURLE_OK;
+        m_curl_session  = NULL;
+        m_file          = NULL;
         m_progress.setAtomic(0);
     }   // init
 
@@ -171,6 +173,11 @@ namespace Online
         curl_easy_setopt(m_curl_session, CURLOPT_LOW_SPEED_LIMIT, 10);
         curl_easy_setopt(m_curl_session, CURLOPT_LOW_SPEED_TIME, 20);
         curl_easy_setopt(m_curl_session, CURLOPT_NOSIGNAL, 1);
+        // Share connections, DNS and SSL sessions with all other requests,
+        // so that consecutive requests to the same host avoid new handshakes
+        CURLSH *share = RequestManager::get()->getCurlShare();
+        if (share)
+            curl_easy_setopt(m_curl_session, CURLOPT_SHARE, share);
         //curl_easy_setopt(m_curl_session, CURLOPT_VERBOSE, 1L);
         if (m_url.substr(0, 8) == "https://")
         {
@@ -201,22 +208,73 @@ namespace Online
      */
     void HTTPRequest::operation()
     {
-        if (!m_curl_session)
+        if (!setupTransfer())
             return;
 
-        FILE *fout = NULL;
+        m_curl_code = curl_easy_perform(m_curl_session);
+        Request::operation();
+        finishTransfer();
+    }   // operation
+
+    // ------------------------------------------------------------------------
+    /** Executes the first part of this request when it is handled by the
+     *  curl multi interface of the request manager: it prepares the curl
+     *  session and returns it, so that the request manager can start the
+     *  transfer. If the request was aborted, or if the transfer can not be
+     *  started, NULL is returned. In the latter case the request is finished
+     *  as if the transfer had been done.
+     */
+    CURL* HTTPRequest::beginExecute()
+    {
+        assert(isBusy());
+        // Abort as early as possible if abort is requested
+        if (RequestManager::get()->getAbort() && isAbortable()) return NULL;
+        prepareOperation();
+        if (RequestManager::get()->getAbort() && isAbortable()) return NULL;
+        if (setupTransfer())
+            return m_curl_session;
+        endExecute(m_curl_code);
+        return NULL;
+    }   // beginExecute
+
+    // ------------------------------------------------------------------------
+    /** Finishes a request started with beginExecute() once its transfer is
+     *  done. This does the same as the end of Request::execute().
+     *  \param code The curl result of the transfer.
+     */
+    void HTTPRequest::endExecute(CURLcode code)
+    {
+        m_curl_code = code;
+        finishTransfer();
+        if (RequestManager::get()->getAbort() && isAbortable()) return;
+        setExecuted();
+        if (RequestManager::get()->getAbort() && isAbortable()) return;
+        afterOperation();
+    }   // endExecute
+
+    // ------------------------------------------------------------------------
+    /** Sets up the curl session for the transfer: where to write the data to,
+     *  the parameters to post and the user agent.
+     *  \return False if the transfer can not be started.
+     */
+    bool HTTPRequest::setupTransfer()
+    {
+        if (!m_curl_session)
+            return false;
+
+        m_file = NULL;
         if (m_filename.size() > 0)
         {
-            fout = fopen((m_filename+".part").c_str(), "wb");
+            m_file = fopen((m_filename+".part").c_str(), "wb");
 
-            if (!fout)
+            if (!m_file)
             {
                 logerror("HTTPRequest",
                            "Can't open '%s' for writing, ignored.",
                            (m_filename+".part").c_str());
-                return;
+                return false;
             }
-            curl_easy_setopt(m_curl_session,  CURLOPT_WRITEDATA,     fout  );
+            curl_easy_setopt(m_curl_session,  CURLOPT_WRITEDATA,     m_file);
             curl_easy_setopt(m_curl_session,  CURLOPT_WRITEFUNCTION, fwrite);
         }
         else
@@ -280,13 +338,19 @@ namespace Online
                     // Unknown system type
             #endif
         curl_easy_setopt(m_curl_session, CURLOPT_USERAGENT, uagent.c_str());
+        return true;
+    }   // setupTransfer
 
-        m_curl_code = curl_easy_perform(m_curl_session);
-        Request::operation();
-
-        if (fout)
+    // ------------------------------------------------------------------------
+    /** Called once the transfer is finished. If the data was downloaded into
+     *  a file, the file is closed and, on success, renamed to its final name.
+     */
+    void HTTPRequest::finishTransfer()
+    {
+        if (m_file)
         {
-            fclose(fout);
+            fclose(m_file);
+            m_file = NULL;
             if (m_curl_code == CURLE_OK)
             {
                 if(UserConfigParams::logAddons())
@@ -312,8 +376,8 @@ namespace Online
                     m_curl_code = CURLE_WRITE_ERROR;
                 }
             }   // m_curl_code ==CURLE_OK
-        }   // if fout
-    }   // operation
+        }   // if m_file
+    }   // finishTransfer
 
     // ------------------------------------------------------------------------
     /** Cleanup once the download is finished. The value of progress is
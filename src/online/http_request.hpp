@@ -30,6 +30,7 @@
 #endif
 #include <curl/curl.h>
 #include <assert.h>
+#include <stdio.h>
 #include <string>
 
 namespace Online
@@ -71,6 +72,13 @@ namespace Online
         /** String to store the received data in. */
         std::string m_string_buffer;
 
+        /** The file the data is written to while downloading into a file,
+         *  NULL otherwise. */
+        FILE *m_file;
+
+        bool setupTransfer();
+        void finishTransfer();
+
     protected:
         virtual void prepareOperation() OVERRIDE;
         virtual void operation() OVERRIDE;
@@ -94,6 +102,15 @@ namespace Online
         virtual bool       isAllowedToAdd() const OVERRIDE;
         void               setApiURL(const std::string& url, const std::string &action);
         void               setAddonsURL(const std::string& path);
+        CURL*              beginExecute();
+        void               endExecute(CURLcode code);
+
+        // ------------------------------------------------------------------------
+        /** Returns true if the request manager can execute this request
+         *  concurrently with other requests using the curl multi interface.
+         *  Requests that replace operation() with something that is not a
+         *  plain curl transfer must return false. */
+        virtual bool canRunConcurrently() const { return true; }
 
         // ------------------------------------------------------------------------
         /** Returns true if there was an error downloading the file. */
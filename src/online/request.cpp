@@ -43,6 +43,7 @@ namespace Online
         m_cancel.setAtomic(false);
         m_state.setAtomic(S_PREPARING);
         m_is_abortable.setAtomic(true);
+        m_queue_time = 0;
     }   // Request
 
     // ------------------------------------------------------------------------
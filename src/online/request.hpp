@@ -77,6 +77,10 @@ namespace Online
         important this request is. */
         const int m_priority;
 
+        /** Real time at which this request was added to the queue of the
+         *  request manager, used to measure the queue waiting time. */
+        double m_queue_time;
+
         /** The different state of the requst:
          *  - S_PREPARING:\n The request is created and can be configured, it
          *      is not yet started.
@@ -162,6 +166,14 @@ namespace Online
         /** Returns the priority of this request. */
         int getPriority() const   { return m_priority; }
 
+        // --------------------------------------------------------------------
+        /** Returns the real time at which this request was queued. */
+        double getQueueTime() const { return m_queue_time; }
+
+        // --------------------------------------------------------------------
+        /** Sets the real time at which this request was queued. */
+        void setQueueTime(double t) { m_queue_time = t; }
+
         // --------------------------------------------------------------------
         /** Signals that this request should be canceled. */
         void cancel() { m_cancel.setAtomic(true); }
@@ -23,8 +23,10 @@
 #include "config/player_manager.hpp"
 #include "config/user_config.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/time.hpp"
 #include "utils/vs.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <stdio.h>
 #include <memory.h>
@@ -75,6 +77,35 @@ namespace Online
         curl_global_init(CURL_GLOBAL_DEFAULT);
         pthread_cond_init(&m_cond_request, NULL);
         m_abort.setAtomic(false);
+        m_current_request         = NULL;
+        m_max_concurrent_requests = 1;
+        m_busy_start              = 0;
+        memset(&m_statistics.getData(), 0, sizeof(Statistics));
+
+        m_curl_multi = curl_multi_init();
+        if (!m_curl_multi)
+            logwarn("HTTP Manager", "Can not create curl multi handle, "
+                    "requests will be executed one at a time.");
+
+        for (unsigned int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+            pthread_mutex_init(&m_share_mutex[i], NULL);
+        m_curl_share = curl_share_init();
+        if (m_curl_share)
+        {
+            curl_share_setopt(m_curl_share, CURLSHOPT_LOCKFUNC,
+                              &RequestManager::lockShare);
+            curl_share_setopt(m_curl_share, CURLSHOPT_UNLOCKFUNC,
+                              &RequestManager::unlockShare);
+            curl_share_setopt(m_curl_share, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(m_curl_share, CURLSHOPT_SHARE,
+                              CURL_LOCK_DATA_DNS);
+            curl_share_setopt(m_curl_share, CURLSHOPT_SHARE,
+                              CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+            curl_share_setopt(m_curl_share, CURLSHOPT_SHARE,
+                              CURL_LOCK_DATA_CONNECT);
+#endif
+        }
     }   // RequestManager
 
     // ------------------------------------------------------------------------
@@ -85,9 +116,50 @@ namespace Online
         delete m_thread_id.getData();
         m_thread_id.unlock();
         pthread_cond_destroy(&m_cond_request);
+
+        Statistics statistics = getStatistics();
+        if (statistics.m_num_requests > 0)
+        {
+            loginfo("HTTP Manager", "%d requests, at most %d at the same "
+                    "time, average queue wait %.1f ms (max %.1f ms), "
+                    "%.1f KB/s while busy.", statistics.m_num_requests,
+                    statistics.m_max_active,
+                    statistics.m_total_wait*1000.0/statistics.m_num_requests,
+                    statistics.m_max_wait*1000.0,
+                    statistics.m_busy_time > 0
+                    ? statistics.m_bytes/1024.0/statistics.m_busy_time : 0);
+        }
+
+        if (m_curl_multi)
+            curl_multi_cleanup(m_curl_multi);
+        if (m_curl_share)
+            curl_share_cleanup(m_curl_share);
+        for (unsigned int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+            pthread_mutex_destroy(&m_share_mutex[i]);
         curl_global_cleanup();
     }   // ~RequestManager
 
+    // ------------------------------------------------------------------------
+    /** Called by curl to lock data in the share handle, which can be used by
+     *  the request manager thread and the main thread at the same time.
+     */
+    void RequestManager::lockShare(CURL *handle, curl_lock_data data,
+                                   curl_lock_access access, void *userptr)
+    {
+        RequestManager *me = (RequestManager*)userptr;
+        pthread_mutex_lock(&me->m_share_mutex[data]);
+    }   // lockShare
+
+    // ------------------------------------------------------------------------
+    /** Called by curl to unlock data in the share handle.
+     */
+    void RequestManager::unlockShare(CURL *handle, curl_lock_data data,
+                                     void *userptr)
+    {
+        RequestManager *me = (RequestManager*)userptr;
+        pthread_mutex_unlock(&me->m_share_mutex[data]);
+    }   // unlockShare
+
     // ------------------------------------------------------------------------
     /** Start the actual network thread. This can not be done as part of
      *  the constructor, since the assignment to the global network_http
@@ -166,12 +238,18 @@ namespace Online
     {
         assert(request->isPreparing());
         request->setBusy();
+        request->setQueueTime(StkTime::getRealTime());
         m_request_queue.lock();
         m_request_queue.getData().push(request);
 
         // Wake up the network http thread
         pthread_cond_signal(&m_cond_request);
         m_request_queue.unlock();
+#if LIBCURL_VERSION_NUM >= 0x074400
+        // The thread might be waiting for active transfers instead
+        if (m_curl_multi)
+            curl_multi_wakeup(m_curl_multi);
+#endif
     }   // addRequest
 
     // ------------------------------------------------------------------------
@@ -186,36 +264,72 @@ namespace Online
         RequestManager *me = (RequestManager*) obj;
 
         me->m_current_request = NULL;
-        me->m_request_queue.lock();
-        while (me->m_request_queue.getData().empty() ||
-               me->m_request_queue.getData().top()->getType() != Request::RT_QUIT)
+        me->m_max_concurrent_requests =
+            std::max(1, (int)UserConfigParams::m_max_concurrent_requests);
+        if (me->m_curl_multi)
+        {
+            curl_multi_setopt(me->m_curl_multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                              (long)me->m_max_concurrent_requests);
+            curl_multi_setopt(me->m_curl_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                              (long)me->m_max_concurrent_requests);
+        }
+
+        bool quit = false;
+        while (!quit)
         {
-            bool empty = me->m_request_queue.getData().empty();
+            me->m_request_queue.lock();
 
-            // Wait in cond_wait for a request to arrive. The 'while' is necessary
-            // since "spurious wakeups from the pthread_cond_wait ... may occur"
+            // Wait in cond_wait for a request to arrive, but only if no
+            // transfer is active. The 'while' is necessary since "spurious
+            // wakeups from the pthread_cond_wait ... may occur"
             // (pthread_cond_wait man page)!
-            while (empty)
+            while (me->m_active_requests.empty() &&
+                   me->m_request_queue.getData().empty())
             {
-                pthread_cond_wait(&me->m_cond_request, me->m_request_queue.getMutex());
-                empty = me->m_request_queue.getData().empty();
+                pthread_cond_wait(&me->m_cond_request,
+                                  me->m_request_queue.getMutex());
             }
-            me->m_current_request = me->m_request_queue.getData().top();
-            me->m_request_queue.getData().pop();
 
-            if (me->m_current_request->getType() == Request::RT_QUIT)
+            // Start requests in order of priority as long as there are free
+            // transfer slots.
+            while (!me->m_request_queue.getData().empty() &&
+                   me->m_active_requests.size() <
+                                              me->m_max_concurrent_requests)
             {
-                delete me->m_current_request;
-                break;
-            }
-
+                Request *request = me->m_request_queue.getData().top();
+                HTTPRequest *http = NULL;
+                if (me->m_curl_multi && request->getType() == 0)
+                    http = dynamic_cast<HTTPRequest*>(request);
+                if (http && !http->canRunConcurrently())
+                    http = NULL;
+
+                // Other requests are only started once all active transfers
+                // are done, so they are still executed in priority order.
+                if (!http && !me->m_active_requests.empty())
+                    break;
+
+                me->m_request_queue.getData().pop();
+                if (request->getType() == Request::RT_QUIT)
+                {
+                    delete request;
+                    quit = true;
+                    break;
+                }
+
+                me->m_request_queue.unlock();
+                if (http)
+                    me->startTransfer(http);
+                else
+                    me->executeRequest(request);
+                me->m_request_queue.lock();
+            }   // while free transfer slots
             me->m_request_queue.unlock();
-            me->m_current_request->execute();
-            // This test is necessary in case that execute() was aborted
-            // (otherwise the assert in addResult will be triggered).
-            if (!me->getAbort()) me->addResult(me->m_current_request);
-            me->m_request_queue.lock();
-        } // while handle all requests
+
+            if (!quit && !me->m_active_requests.empty())
+                me->handleTransfers();
+        } // while !quit
+
+        me->m_request_queue.lock();
 
         // Signal that the request manager can now be deleted.
         // We signal this even before cleaning up memory, since there's no
@@ -238,6 +352,150 @@ namespace Online
         return 0;
     }   // mainLoop
 
+    // ------------------------------------------------------------------------
+    /** Executes a request that can not be handled by the curl multi interface
+     *  in the request manager thread.
+     *  \param request The request to execute.
+     */
+    void RequestManager::executeRequest(Request *request)
+    {
+        recordStart(request);
+        m_current_request = request;
+        request->execute();
+        m_current_request = NULL;
+        recordFinish(0);
+        // This test is necessary in case that execute() was aborted
+        // (otherwise the assert in addResult will be triggered).
+        if (!getAbort()) addResult(request);
+    }   // executeRequest
+
+    // ------------------------------------------------------------------------
+    /** Starts the transfer of a HTTP request using the curl multi handle.
+     *  \param request The request to start.
+     */
+    void RequestManager::startTransfer(HTTPRequest *request)
+    {
+        recordStart(request);
+        CURL *session = request->beginExecute();
+        if (!session)
+        {
+            // Aborted, or finished without a transfer
+            recordFinish(0);
+            if (!getAbort()) addResult(request);
+            return;
+        }
+        curl_easy_setopt(session, CURLOPT_PRIVATE, request);
+        CURLMcode error = curl_multi_add_handle(m_curl_multi, session);
+        if (error != CURLM_OK)
+        {
+            logerror("HTTP Manager", "Can not start transfer: %s.",
+                     curl_multi_strerror(error));
+            recordFinish(0);
+            request->endExecute(CURLE_FAILED_INIT);
+            if (!getAbort()) addResult(request);
+            return;
+        }
+        m_active_requests.push_back(request);
+    }   // startTransfer
+
+    // ------------------------------------------------------------------------
+    /** Lets curl continue all active transfers, and finishes all requests
+     *  whose transfer is done. If no transfer is done, this waits for a short
+     *  time for network activity (or for a new request to be queued).
+     */
+    void RequestManager::handleTransfers()
+    {
+        int running = 0;
+        curl_multi_perform(m_curl_multi, &running);
+
+        CURLMsg *message;
+        int messages_left = 0;
+        bool finished_any = false;
+        while ((message = curl_multi_info_read(m_curl_multi, &messages_left)))
+        {
+            if (message->msg != CURLMSG_DONE)
+                continue;
+            // The message is invalid once the handle is removed
+            CURL *session = message->easy_handle;
+            CURLcode code = message->data.result;
+            curl_multi_remove_handle(m_curl_multi, session);
+
+            HTTPRequest *request = NULL;
+            curl_easy_getinfo(session, CURLINFO_PRIVATE, (char**)&request);
+            m_active_requests.erase(std::find(m_active_requests.begin(),
+                                              m_active_requests.end(),
+                                              request));
+#if LIBCURL_VERSION_NUM >= 0x073700
+            curl_off_t bytes = 0;
+            curl_easy_getinfo(session, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+#else
+            double bytes = 0;
+            curl_easy_getinfo(session, CURLINFO_SIZE_DOWNLOAD, &bytes);
+#endif
+            recordFinish((uint64_t)bytes);
+
+            request->endExecute(code);
+            if (!getAbort()) addResult(request);
+            finished_any = true;
+        }   // while messages
+
+        if (finished_any || m_active_requests.empty())
+            return;
+#if LIBCURL_VERSION_NUM >= 0x074200
+        curl_multi_poll(m_curl_multi, NULL, 0, 100, NULL);
+#else
+        // Without curl_multi_wakeup a new request is only noticed after the
+        // timeout, so keep it short.
+        curl_multi_wait(m_curl_multi, NULL, 0, 20, NULL);
+#endif
+    }   // handleTransfers
+
+    // ------------------------------------------------------------------------
+    /** Updates the statistics when the execution of a request starts.
+     *  \param request The request.
+     */
+    void RequestManager::recordStart(Request *request)
+    {
+        double now = StkTime::getRealTime();
+        double wait = now - request->getQueueTime();
+        m_statistics.lock();
+        Statistics &s = m_statistics.getData();
+        if (m_active_requests.empty())
+            m_busy_start = now;
+        s.m_num_requests++;
+        s.m_total_wait += wait;
+        s.m_max_wait    = std::max(s.m_max_wait, wait);
+        s.m_max_active  = std::max(s.m_max_active,
+                                   (unsigned int)m_active_requests.size() + 1);
+        m_statistics.unlock();
+    }   // recordStart
+
+    // ------------------------------------------------------------------------
+    /** Updates the statistics when a request is finished. Must be called
+     *  after the request was removed from the list of active requests.
+     *  \param bytes Number of bytes downloaded by this request.
+     */
+    void RequestManager::recordFinish(uint64_t bytes)
+    {
+        m_statistics.lock();
+        Statistics &s = m_statistics.getData();
+        s.m_bytes += bytes;
+        if (m_active_requests.empty())
+            s.m_busy_time += StkTime::getRealTime() - m_busy_start;
+        m_statistics.unlock();
+    }   // recordFinish
+
+    // ------------------------------------------------------------------------
+    /** Returns a copy of the current statistics.
+     */
+    RequestManager::Statistics RequestManager::getStatistics()
+    {
+        m_statistics.lock();
+        Statistics s = m_statistics.getData();
+        m_statistics.unlock();
+        return s;
+    }   // getStatistics
+
     // ------------------------------------------------------------------------
     /** Inserts a request into the queue of results.
      *  \param request The pointer to the request to insert.
@@ -278,6 +536,60 @@ namespace Online
         }
     }   // handleResultQueue
 
+    // ------------------------------------------------------------------------
+    /** Downloads the same URL a number of times and prints the throughput and
+     *  the time the requests waited in the queue. This is used to test the
+     *  request manager against a local test server (see
+     *  tools/http_test_server.py), which can add latency to each reply.
+     *  \param url The URL to download (a counter is appended as parameter,
+     *         so that each request is different).
+     *  \param count Number of requests.
+     */
+    void RequestManager::benchmark(const std::string &url, int count)
+    {
+        Statistics before = getStatistics();
+        double start = StkTime::getRealTime();
+        std::vector<HTTPRequest*> requests;
+        for (int i = 0; i < count; i++)
+        {
+            HTTPRequest *request = new HTTPRequest(/*manage memory*/false);
+            request->setURL(url + (url.find('?') == std::string::npos ? "?" : "&")
+                            + "n=" + StringUtils::toString(i));
+            request->queue();
+            requests.push_back(request);
+        }
+
+        unsigned int done = 0;
+        while (done < requests.size())
+        {
+            handleResultQueue();
+            done = 0;
+            for (unsigned int i = 0; i < requests.size(); i++)
+                if (requests[i]->isDone()) done++;
+            if (done < requests.size())
+                StkTime::sleep(1);
+        }
+        double duration = StkTime::getRealTime() - start;
+
+        unsigned int failed = 0;
+        for (unsigned int i = 0; i < requests.size(); i++)
+        {
+            if (requests[i]->hadDownloadError()) failed++;
+            delete requests[i];
+        }
+
+        Statistics after = getStatistics();
+        unsigned int num = after.m_num_requests - before.m_num_requests;
+        loginfo("HTTP Manager", "%d requests (%d failed) in %.3f s: "
+                "%.1f requests/s, %.1f KB/s.", count, failed, duration,
+                count/duration,
+                (after.m_bytes - before.m_bytes)/1024.0/duration);
+        loginfo("HTTP Manager", "At most %d requests at the same time, "
+                "average queue wait %.1f ms.", after.m_max_active,
+                num > 0 ? (after.m_total_wait-before.m_total_wait)*1000.0/num
+                        : 0);
+    }   // benchmark
+
     // ------------------------------------------------------------------------
     /** Should be called every frame and takes care of processing the result
      *  queue and polling the database server if a user is signed in.
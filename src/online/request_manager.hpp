@@ -22,6 +22,7 @@
 #define HEADER_REQUEST_MANAGER_HPP
 
 #include "io/xml_node.hpp"
+#include "online/http_request.hpp"
 #include "online/request.hpp"
 #include "utils/can_be_deleted.hpp"
 #include "utils/string_utils.hpp"
@@ -38,6 +39,7 @@
 #include <curl/curl.h>
 #include <queue>
 #include <pthread.h>
+#include <vector>
 
 namespace Online
 {
@@ -73,6 +75,13 @@ namespace Online
      *  on first start of stk (which will trigger downloading of all addon
      *  icons) is it possible that actually a download request is running,
      *  which might take a bit before it can be deleted.
+     *  HTTP requests are executed with the curl multi interface, so up to
+     *  m_max_concurrent_requests transfers are active at the same time (and
+     *  are started in order of priority). Requests that can not be executed
+     *  concurrently (and the quit request) are only started once all active
+     *  transfers are finished. All curl sessions use a shared connection
+     *  cache, so consecutive requests to the same host reuse the connection
+     *  (and avoid a new TLS handshake).
      * \ingroup online
      */
     class RequestManager : public CanBeDeleted
@@ -90,6 +99,22 @@ namespace Online
             IPERM_ALLOWED     = 1,
             IPERM_NOT_ALLOWED = 2
         };
+
+        /** Statistics about the executed requests. */
+        struct Statistics
+        {
+            /** Number of executed requests. */
+            unsigned int m_num_requests;
+            /** Maximum number of requests executed at the same time. */
+            unsigned int m_max_active;
+            /** Total and maximum time requests waited in the queue. */
+            double       m_total_wait, m_max_wait;
+            /** Time during which at least one request was executed. */
+            double       m_busy_time;
+            /** Number of bytes downloaded. */
+            uint64_t     m_bytes;
+        };   // Statistics
+
     private:
             /** Time passed since the last poll request. */
             float                     m_time_since_poll;
@@ -121,6 +146,29 @@ namespace Online
                                                >
                         >  m_request_queue;
 
+            /** The curl multi handle used to execute HTTP requests
+             *  concurrently. Only used by the request manager thread. */
+            CURLM                    *m_curl_multi;
+
+            /** Connection, DNS and SSL session cache shared by all curl
+             *  sessions. */
+            CURLSH                   *m_curl_share;
+
+            /** Protects the data shared in m_curl_share. */
+            pthread_mutex_t           m_share_mutex[CURL_LOCK_DATA_LAST];
+
+            /** The HTTP requests whose transfer is currently active. */
+            std::vector<HTTPRequest*> m_active_requests;
+
+            /** Maximum number of HTTP requests executed at the same time. */
+            unsigned int              m_max_concurrent_requests;
+
+            /** Real time at which the current busy period started. */
+            double                    m_busy_start;
+
+            /** Statistics about executed requests. */
+            Synchronised<Statistics>  m_statistics;
+
             /** The list of pointers to all requests that are already executed
              *  by the networking thread, but still need to be processed by the
              *  main thread. */
@@ -128,6 +176,16 @@ namespace Online
 
             void addResult(Online::Request *request);
             void handleResultQueue();
+            void startTransfer(HTTPRequest *request);
+            void executeRequest(Request *request);
+            void handleTransfers();
+            void recordStart(Request *request);
+            void recordFinish(uint64_t bytes);
+
+            static void lockShare(CURL *handle, curl_lock_data data,
+                                  curl_lock_access access, void *userptr);
+            static void unlockShare(CURL *handle, curl_lock_data data,
+                                    void *userptr);
 
             static void *mainLoop(void *obj);
 
@@ -158,8 +216,15 @@ namespace Online
             void addRequest(Online::Request *request);
             void startNetworkThread();
             void stopNetworkThread();
+            void benchmark(const std::string &url, int count);
+            Statistics getStatistics();
 
             bool getAbort() { return m_abort.getAtomic(); }
+            // ----------------------------------------------------------------
+            /** Returns the curl share handle all curl sessions should use,
+             *  or NULL if it could not be created. */
+            CURLSH *getCurlShare() { return m_curl_share; }
+            // ----------------------------------------------------------------
             void update(float dt);
 
             // ----------------------------------------------------------------
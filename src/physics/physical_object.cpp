@@ -160,6 +160,8 @@ PhysicalObject::PhysicalObject(bool is_dynamic,
     m_reset_height       = settings.m_reset_height;
     m_on_kart_collision  = settings.m_on_kart_collision;
     m_on_item_collision  = settings.m_on_item_collision;
+    m_kart_collision_callback.set(m_on_kart_collision);
+    m_item_collision_callback.set(m_on_item_collision);
     m_body_added = false;
 
     m_init_pos.setIdentity();
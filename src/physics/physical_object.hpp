@@ -24,6 +24,7 @@
 #include "btBulletDynamicsCommon.h"
 
 #include "physics/user_pointer.hpp"
+#include "scriptengine/script_callback.hpp"
 #include "utils/vec3.hpp"
 #include "utils/leak_check.hpp"
 
@@ -173,6 +174,14 @@ private:
     * when a (flyable) item collides with this object
     */
     std::string           m_on_item_collision;
+    /** The script function m_on_kart_collision, called with the kart id,
+     *  the id of the library object and the id of this object. */
+    Scripting::ScriptCallback<int, std::string, std::string>
+                          m_kart_collision_callback;
+    /** The script function m_on_item_collision, called with the item type,
+     *  the id of the owner kart and the id of this object. */
+    Scripting::ScriptCallback<int, int, std::string>
+                          m_item_collision_callback;
     /** If this body is a bullet dynamic body, i.e. affected by physics
      *  or not (static (not moving) or kinematic (animated outside
      *  of physics). */
@@ -232,6 +241,14 @@ public:
     // ------------------------------------------------------------------------
     const std::string& getOnItemCollisionFunction() const { return m_on_item_collision; }
     // ------------------------------------------------------------------------
+    /** Returns the script function to call when a kart hits this object. */
+    Scripting::ScriptCallback<int, std::string, std::string>&
+        getKartCollisionCallback() { return m_kart_collision_callback; }
+    // ------------------------------------------------------------------------
+    /** Returns the script function to call when an item hits this object. */
+    Scripting::ScriptCallback<int, int, std::string>&
+        getItemCollisionCallback() { return m_item_collision_callback; }
+    // ------------------------------------------------------------------------
     TrackObject* getTrackObject() { return m_object; }
 
     // Methods usable by scripts
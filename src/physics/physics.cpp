@@ -22,6 +22,7 @@
 #include "animations/three_d_animation.hpp"
 #include "config/player_manager.hpp"
 #include "config/player_profile.hpp"
+#include "config/user_config.hpp"
 #include "karts/abstract_kart.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/stars.hpp"
@@ -51,6 +52,8 @@ Physics::Physics() : btSequentialImpulseConstraintSolver()
 {
     m_collision_conf      = new btDefaultCollisionConfiguration();
     m_dispatcher          = new btCollisionDispatcher(m_collision_conf);
+    m_kart_kart_collision_callback.set("onKartKartCollision",
+                                       /*warn_if_not_found*/false);
 }   // Physics
 
 //-----------------------------------------------------------------------------
@@ -73,6 +76,10 @@ void Physics::init(const Vec3 &world_min, const Vec3 &world_max)
                   0.0f));
     m_debug_drawer = new IrrDebugDrawer();
     m_dynamics_world->setDebugDrawer(m_debug_drawer);
+    m_dynamics_world->setInternalTickCallback(&Physics::preTickCallback,
+                                              this, /*is_pre_tick*/true);
+    m_contacts_extracted = false;
+    memset(&m_contact_statistics, 0, sizeof(m_contact_statistics));
 }   // init
 
 //-----------------------------------------------------------------------------
@@ -149,10 +156,32 @@ void Physics::update(float dt)
     // are stored in a vector, but only one entry per collision pair
     // of objects.
     m_all_collisions.clear();
+    memset(&m_contact_statistics, 0, sizeof(m_contact_statistics));
 
-    // Maximum of three substeps. This will work for framerate down to
-    // 20 FPS (bullet default frequency is 60 HZ).
-    m_dynamics_world->stepSimulation(dt, 3);
+    // In fixed tick mode dt is exactly one tick, so do exactly one step
+    // without bullet's interpolation (and the left-over local time that
+    // would need to be saved for a rewind).
+    if (WorldStatus::isFixedTicks())
+        m_dynamics_world->stepSimulation(dt, 0);
+    else
+    {
+        // Maximum of three substeps. This will work for framerate down to
+        // 20 FPS (bullet default frequency is 60 HZ).
+        m_dynamics_world->stepSimulation(dt, 3);
+    }
+
+    m_contact_statistics.m_num_collisions = (unsigned int)m_all_collisions.size();
+    m_contact_statistics.m_num_duplicates = m_all_collisions.getNumDuplicates();
+    if(UserConfigParams::m_physics_debug)
+    {
+        logdebug("Physics", "%u steps: %u manifolds, %u track contacts, "
+                 "%u collisions, %u duplicates.",
+                 m_contact_statistics.m_num_steps,
+                 m_contact_statistics.m_num_manifolds,
+                 m_contact_statistics.m_num_track_contacts,
+                 m_contact_statistics.m_num_collisions,
+                 m_contact_statistics.m_num_duplicates);
+    }
 
     // Now handle the actual collision. Note: flyables can not be removed
     // inside of this loop, since the same flyables might hit more than one
@@ -163,51 +192,34 @@ void Physics::update(float dt)
     {
         // Kart-kart collision
         // --------------------
-        if(p->getUserPointer(0)->is(UserPointer::UP_KART))
+        if(p->getType()==CT_KART_KART)
         {
             KartKartCollision(p->getUserPointer(0)->getPointerKart(),
                               p->getContactPointCS(0),
                               p->getUserPointer(1)->getPointerKart(),
                               p->getContactPointCS(1)                );
-            Scripting::ScriptEngine* script_engine =
-                                            Scripting::ScriptEngine::getInstance();
             int kartid1 = p->getUserPointer(0)->getPointerKart()->getWorldKartId();
             int kartid2 = p->getUserPointer(1)->getPointerKart()->getWorldKartId();
-            script_engine->runFunction(false, "void onKartKartCollision(int, int)",
-                [=](asIScriptContext* ctx) {
-                    ctx->SetArgDWord(0, kartid1);
-                    ctx->SetArgDWord(1, kartid2);
-                });
+            m_kart_kart_collision_callback(kartid1, kartid2);
             continue;
         }  // if kart-kart collision
 
-        if(p->getUserPointer(0)->is(UserPointer::UP_PHYSICAL_OBJECT))
+        if(p->getType()==CT_KART_OBJECT)
         {
             // Kart hits physical object
             // -------------------------
-            Scripting::ScriptEngine* script_engine = Scripting::ScriptEngine::getInstance();
             AbstractKart *kart = p->getUserPointer(1)->getPointerKart();
             int kartId = kart->getWorldKartId();
             PhysicalObject* obj = p->getUserPointer(0)->getPointerPhysicalObject();
-            std::string obj_id = obj->getID();
-            std::string scripting_function = obj->getOnKartCollisionFunction();
-
-            TrackObject* to = obj->getTrackObject();
-            TrackObject* library = to->getParentLibrary();
-            std::string lib_id;
-            std::string* lib_id_ptr = NULL;
-            if (library != NULL)
-                lib_id = library->getID();
-            lib_id_ptr = &lib_id;
-
-            if (scripting_function.size() > 0)
+
+            if (obj->getKartCollisionCallback().isSet())
             {
-                script_engine->runFunction(true, "void " + scripting_function + "(int, const string, const string)",
-                    [&](asIScriptContext* ctx) {
-                        ctx->SetArgDWord(0, kartId);
-                        ctx->SetArgObject(1, lib_id_ptr);
-                        ctx->SetArgObject(2, &obj_id);
-                    });
+                TrackObject* to = obj->getTrackObject();
+                TrackObject* library = to->getParentLibrary();
+                std::string lib_id;
+                if (library != NULL)
+                    lib_id = library->getID();
+                obj->getKartCollisionCallback()(kartId, lib_id, obj->getID());
             }
             if (obj->isCrashReset())
             {
@@ -232,7 +244,7 @@ void Physics::update(float dt)
             continue;
         }
 
-        if (p->getUserPointer(0)->is(UserPointer::UP_ANIMATION))
+        if (p->getType()==CT_KART_ANIMATION)
         {
             // Kart hits animation
             ThreeDAnimation *anim=p->getUserPointer(0)->getPointerAnimation();
@@ -258,30 +270,21 @@ void Physics::update(float dt)
         }
         // now the first object must be a projectile
         // =========================================
-        if(p->getUserPointer(1)->is(UserPointer::UP_TRACK))
+        if(p->getType()==CT_FLYABLE_TRACK)
         {
             // Projectile hits track
             // ---------------------
             p->getUserPointer(0)->getPointerFlyable()->hitTrack();
         }
-        else if(p->getUserPointer(1)->is(UserPointer::UP_PHYSICAL_OBJECT))
+        else if(p->getType()==CT_FLYABLE_OBJECT)
         {
             // Projectile hits physical object
             // -------------------------------
-            Scripting::ScriptEngine* script_engine = Scripting::ScriptEngine::getInstance();
             Flyable* flyable = p->getUserPointer(0)->getPointerFlyable();
             PhysicalObject* obj = p->getUserPointer(1)->getPointerPhysicalObject();
-            std::string obj_id = obj->getID();
-            std::string scripting_function = obj->getOnItemCollisionFunction();
-            if (scripting_function.size() > 0)
-            {
-                script_engine->runFunction(true, "void " + scripting_function + "(int, int, const string)",
-                        [&](asIScriptContext* ctx) {
-                        ctx->SetArgDWord(0, (int)flyable->getType());
-                        ctx->SetArgDWord(1, flyable->getOwnerId());
-                        ctx->SetArgObject(2, &obj_id);
-                    });
-            }
+            obj->getItemCollisionCallback()((int)flyable->getType(),
+                                            (int)flyable->getOwnerId(),
+                                            obj->getID());
             flyable->hit(NULL, obj);
 
             if (obj->isSoccerBall() && 
@@ -293,7 +296,7 @@ void Physics::update(float dt)
             }
 
         }
-        else if(p->getUserPointer(1)->is(UserPointer::UP_KART))
+        else if(p->getType()==CT_FLYABLE_KART)
         {
             // Projectile hits kart
             // --------------------
@@ -485,15 +488,29 @@ void Physics::KartKartCollision(AbstractKart *kart_a,
 }   // KartKartCollision
 
 //-----------------------------------------------------------------------------
-/** This function is called at each internal bullet timestep. It is used
- *  here to do the collision handling: using the contact manifolds after a
- *  physics time step might miss some collisions (when more than one internal
- *  time step was done, and the collision is added and removed). So this
- *  function stores all collisions in a list, which is then handled after the
- *  actual physics timestep. This list only stores a collision if it's not
- *  already in the list, so a collisions which is reported more than once is
- *  nevertheless only handled once.
- *  The list of collision
+/** Called by bullet at the start of each internal time step, before the
+ *  collision detection. Allows solveGroup() to extract the contacts of the
+ *  new time step.
+ */
+void Physics::preTickCallback(btDynamicsWorld *world, btScalar time_step)
+{
+    Physics *physics = (Physics*)world->getWorldUserInfo();
+    physics->m_contacts_extracted = false;
+    physics->m_contact_statistics.m_num_steps++;
+}   // preTickCallback
+
+//-----------------------------------------------------------------------------
+/** This function is called by bullet to solve the constraints, possibly
+ *  more than once in each internal time step (once for each group of
+ *  objects). It is used here to do the collision handling: using the
+ *  contact manifolds after a physics time step might miss some collisions
+ *  (when more than one internal time step was done, and the collision is
+ *  added and removed). So at the first call in each internal time step all
+ *  contacts are extracted: contacts with the track are handled immediately,
+ *  all other collisions are stored in a list, which is then handled after
+ *  the actual physics timestep. This list only stores a collision if it's
+ *  not already in the list, so a collisions which is reported more than
+ *  once is nevertheless only handled once.
  *  Parameters: see bullet documentation for details.
  */
 btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
@@ -513,7 +530,38 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
                                                         debugDrawer,
                                                         stackAlloc,
                                                         dispatcher);
-    int currentNumManifolds = m_dispatcher->getNumManifolds();
+    // The manifolds of the dispatcher do not change between the calls in
+    // one time step, so they only need to be examined once.
+    if(!m_contacts_extracted)
+    {
+        m_contacts_extracted = true;
+        extractContacts(m_dispatcher, &m_all_collisions, &m_track_contacts,
+                        &m_contact_statistics);
+        handleTrackContacts();
+    }
+    return returnValue;
+}   // solveGroup
+
+//-----------------------------------------------------------------------------
+/** Examines all contact manifolds of a dispatcher once, and sorts the
+ *  contacts into contacts with the track (which are handled in the time
+ *  step in which they happen) and collisions (which are handled after the
+ *  time step).
+ *  \param dispatcher The dispatcher with all manifolds.
+ *  \param collisions Collisions are added to this list (which ignores
+ *         collisions already in the list).
+ *  \param track_contacts Will contain all track contacts of this step.
+ *  \param statistics Statistics are increased.
+ */
+void Physics::extractContacts(btDispatcher *dispatcher,
+                              CollisionList *collisions,
+                              std::vector<TrackContact> *track_contacts,
+                              ContactStatistics *statistics)
+{
+    track_contacts->clear();
+    TrackContact tc;
+
+    int currentNumManifolds = dispatcher->getNumManifolds();
     // We can't explode a rocket in a loop, since a rocket might collide with
     // more than one object, and/or more than once with each object (if there
     // is more than one collision point). So keep a list of rockets that will
@@ -521,7 +569,7 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
     for(int i=0; i<currentNumManifolds; i++)
     {
         btPersistentManifold* contact_manifold =
-            m_dynamics_world->getDispatcher()->getManifoldByIndexInternal(i);
+            dispatcher->getManifoldByIndexInternal(i);
 
         const btCollisionObject* objA =
             static_cast<const btCollisionObject*>(contact_manifold->getBody0());
@@ -535,47 +583,48 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
         const UserPointer *upB = (UserPointer*)(objB->getUserPointer());
 
         if(!upA || !upB) continue;
+        statistics->m_num_manifolds++;
+
+        const btManifoldPoint &cp = contact_manifold->getContactPoint(0);
 
         // 1) object A is a track
         // =======================
         if(upA->is(UserPointer::UP_TRACK))
         {
             if(upB->is(UserPointer::UP_FLYABLE))   // 1.1 projectile hits track
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
+                collisions->push_back(upB, cp.m_localPointB,
+                                      upA, cp.m_localPointA);
             else if(upB->is(UserPointer::UP_KART))
             {
-                AbstractKart *kart=upB->getPointerKart();
-                int n = contact_manifold->getContactPoint(0).m_index0;
-                const Material *m
-                    = n>=0 ? upA->getPointerTriangleMesh()->getMaterial(n)
-                           : NULL;
+                tc.m_type     = TrackContact::TC_KART_TRACK;
+                tc.m_object   = upB;
+                tc.m_track    = upA;
+                tc.m_triangle = cp.m_index0;
                 // I assume that the normal needs to be flipped in this case,
                 // but  I can't verify this since it appears that bullet
                 // always has the kart as object A, not B.
-                const btVector3 &normal = -contact_manifold->getContactPoint(0)
-                                                            .m_normalWorldOnB;
-                kart->crashed(m, normal);
+                tc.m_normal   = -cp.m_normalWorldOnB;
+                track_contacts->push_back(tc);
             }
             else if(upB->is(UserPointer::UP_PHYSICAL_OBJECT))
             {
-                std::vector<int> used;
-                for(int i=0; i< contact_manifold->getNumContacts(); i++)
+                size_t first = track_contacts->size();
+                for(int j=0; j< contact_manifold->getNumContacts(); j++)
                 {
-                    int n = contact_manifold->getContactPoint(i).m_index0;
+                    const btManifoldPoint &p = contact_manifold->getContactPoint(j);
                     // Make sure to call the callback function only once
                     // per triangle.
-                    if(std::find(used.begin(), used.end(), n)!=used.end())
-                        continue;
-                    used.push_back(n);
-                    const Material *m
-                        = n >= 0 ? upB->getPointerTriangleMesh()->getMaterial(n)
-                        : NULL;
-                    const btVector3 &normal = contact_manifold->getContactPoint(i)
-                        .m_normalWorldOnB;
-                    upA->getPointerPhysicalObject()->hit(m, normal);
-                }   // for i in getNumContacts()
+                    bool used = false;
+                    for(size_t k=first; k<track_contacts->size(); k++)
+                        used |= (*track_contacts)[k].m_triangle==p.m_index0;
+                    if(used) continue;
+                    tc.m_type     = TrackContact::TC_OBJECT_TRACK;
+                    tc.m_object   = upB;
+                    tc.m_track    = upA;
+                    tc.m_triangle = p.m_index0;
+                    tc.m_normal   = p.m_normalWorldOnB;
+                    track_contacts->push_back(tc);
+                }   // for j in getNumContacts()
             }   // upB is physical object
         }   // upA is track
         // 2) object a is a kart
@@ -584,45 +633,42 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
         {
             if(upB->is(UserPointer::UP_TRACK))
             {
-                AbstractKart *kart = upA->getPointerKart();
-                int n = contact_manifold->getContactPoint(0).m_index1;
-                const Material *m
-                    = n>=0 ? upB->getPointerTriangleMesh()->getMaterial(n)
-                           : NULL;
-                const btVector3 &normal = contact_manifold->getContactPoint(0)
-                                                           .m_normalWorldOnB;
-                kart->crashed(m, normal);   // Kart hit track
+                // Kart hit track
+                tc.m_type     = TrackContact::TC_KART_TRACK;
+                tc.m_object   = upA;
+                tc.m_track    = upB;
+                tc.m_triangle = cp.m_index1;
+                tc.m_normal   = cp.m_normalWorldOnB;
+                track_contacts->push_back(tc);
             }
             else if(upB->is(UserPointer::UP_FLYABLE))
                 // 2.1 projectile hits kart
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
+                collisions->push_back(upB, cp.m_localPointB,
+                                      upA, cp.m_localPointA);
             else if(upB->is(UserPointer::UP_KART))
                 // 2.2 kart hits kart
-                m_all_collisions.push_back(
-                    upA, contact_manifold->getContactPoint(0).m_localPointA,
-                    upB, contact_manifold->getContactPoint(0).m_localPointB);
+                collisions->push_back(upA, cp.m_localPointA,
+                                      upB, cp.m_localPointB);
             else if(upB->is(UserPointer::UP_PHYSICAL_OBJECT))
             {
                 // 2.3 kart hits physical object
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
+                collisions->push_back(upB, cp.m_localPointB,
+                                      upA, cp.m_localPointA);
                 // If the object is a statical object (e.g. a door in
                 // overworld) add a push back to avoid that karts get stuck
                 if (objB->isStaticObject())
                 {
-                    AbstractKart *kart = upA->getPointerKart();
-                    const btVector3 &normal = contact_manifold->getContactPoint(0)
-                        .m_normalWorldOnB;
-                    kart->crashed((Material*)NULL, normal);
+                    tc.m_type     = TrackContact::TC_KART_STATIC_OBJECT;
+                    tc.m_object   = upA;
+                    tc.m_track    = NULL;
+                    tc.m_triangle = -1;
+                    tc.m_normal   = cp.m_normalWorldOnB;
+                    track_contacts->push_back(tc);
                 }   // isStatiObject
             }
             else if(upB->is(UserPointer::UP_ANIMATION))
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
+                collisions->push_back(upB, cp.m_localPointB,
+                                      upA, cp.m_localPointA);
         }
         // 3) object is a projectile
         // =========================
@@ -637,9 +683,8 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
                upB->is(UserPointer::UP_PHYSICAL_OBJECT) ||
                upB->is(UserPointer::UP_KART           )   )
             {
-                m_all_collisions.push_back(
-                    upA, contact_manifold->getContactPoint(0).m_localPointA,
-                    upB, contact_manifold->getContactPoint(0).m_localPointB);
+                collisions->push_back(upA, cp.m_localPointA,
+                                      upB, cp.m_localPointB);
             }
         }
         // Object is a physical object
@@ -647,46 +692,74 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
         else if(upA->is(UserPointer::UP_PHYSICAL_OBJECT))
         {
             if(upB->is(UserPointer::UP_FLYABLE))
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
+                collisions->push_back(upB, cp.m_localPointB,
+                                      upA, cp.m_localPointA);
             else if(upB->is(UserPointer::UP_KART))
-                m_all_collisions.push_back(
-                    upA, contact_manifold->getContactPoint(0).m_localPointA,
-                    upB, contact_manifold->getContactPoint(0).m_localPointB);
+                collisions->push_back(upA, cp.m_localPointA,
+                                      upB, cp.m_localPointB);
             else if(upB->is(UserPointer::UP_TRACK))
             {
-                std::vector<int> used;
-                for(int i=0; i< contact_manifold->getNumContacts(); i++)
+                size_t first = track_contacts->size();
+                for(int j=0; j< contact_manifold->getNumContacts(); j++)
                 {
-                    int n = contact_manifold->getContactPoint(i).m_index1;
+                    const btManifoldPoint &p = contact_manifold->getContactPoint(j);
                     // Make sure to call the callback function only once
                     // per triangle.
-                    if(std::find(used.begin(), used.end(), n)!=used.end())
-                        continue;
-                    used.push_back(n);
-                    const Material *m
-                        = n >= 0 ? upB->getPointerTriangleMesh()->getMaterial(n)
-                        : NULL;
-                    const btVector3 &normal = contact_manifold->getContactPoint(i)
-                                             .m_normalWorldOnB;
-                    upA->getPointerPhysicalObject()->hit(m, normal);
-                }   // for i in getNumContacts()
+                    bool used = false;
+                    for(size_t k=first; k<track_contacts->size(); k++)
+                        used |= (*track_contacts)[k].m_triangle==p.m_index1;
+                    if(used) continue;
+                    tc.m_type     = TrackContact::TC_OBJECT_TRACK;
+                    tc.m_object   = upA;
+                    tc.m_track    = upB;
+                    tc.m_triangle = p.m_index1;
+                    tc.m_normal   = p.m_normalWorldOnB;
+                    track_contacts->push_back(tc);
+                }   // for j in getNumContacts()
             }   // upB is track
         }   // upA is physical object
         else if (upA->is(UserPointer::UP_ANIMATION))
         {
             if(upB->is(UserPointer::UP_KART))
-                m_all_collisions.push_back(
-                    upA, contact_manifold->getContactPoint(0).m_localPointA,
-                    upB, contact_manifold->getContactPoint(0).m_localPointB);
+                collisions->push_back(upA, cp.m_localPointA,
+                                      upB, cp.m_localPointB);
         }
         else
             assert("Unknown user pointer");           // 4) Should never happen
     }   // for i<numManifolds
 
-    return returnValue;
-}   // solveGroup
+    statistics->m_num_track_contacts += (unsigned int)track_contacts->size();
+}   // extractContacts
+
+//-----------------------------------------------------------------------------
+/** Handles the contacts with the track found in the current internal time
+ *  step: a kart crashing into the track, or a physical object hitting the
+ *  track.
+ */
+void Physics::handleTrackContacts()
+{
+    for(unsigned int i=0; i<m_track_contacts.size(); i++)
+    {
+        const TrackContact &tc = m_track_contacts[i];
+        const Material *m = NULL;
+        if(tc.m_track && tc.m_triangle>=0)
+            m = tc.m_track->getPointerTriangleMesh()->getMaterial(tc.m_triangle);
+
+        switch(tc.m_type)
+        {
+        case TrackContact::TC_KART_TRACK:
+            tc.m_object->getPointerKart()->crashed(m, tc.m_normal);
+            break;
+        case TrackContact::TC_KART_STATIC_OBJECT:
+            tc.m_object->getPointerKart()->crashed((Material*)NULL,
+                                                   tc.m_normal);
+            break;
+        case TrackContact::TC_OBJECT_TRACK:
+            tc.m_object->getPointerPhysicalObject()->hit(m, tc.m_normal);
+            break;
+        }   // switch
+    }
+}   // handleTrackContacts
 
 // ----------------------------------------------------------------------------
 /** A debug draw function to show the track and all karts.
@@ -712,6 +785,118 @@ void Physics::draw()
 }   // draw
 
 // ----------------------------------------------------------------------------
+/** Tests the contact extraction with manifolds as bullet can report them:
+ *  each collision must be stored exactly once and in the order in which it
+ *  was found first, however often the manifolds are examined, and the
+ *  track contacts must be the same in each time step. Since the extracted
+ *  collisions decide which crash, explosion and scripting callbacks are
+ *  called, this makes sure that they are called as before.
+ */
+void Physics::unitTesting()
+{
+    btDefaultCollisionConfiguration conf;
+    btCollisionDispatcher dispatcher(&conf);
+    btSphereShape shape(1.0f);
+
+    // The objects are never accessed, only the pointers are compared.
+    char dummy[6];
+    UserPointer up[6];
+    up[0].set((AbstractKart*)&dummy[0]);
+    up[1].set((AbstractKart*)&dummy[1]);
+    up[2].set((Flyable*)&dummy[2]);
+    up[3].set((TriangleMesh*)&dummy[3]);
+    up[4].set((PhysicalObject*)&dummy[4]);
+    up[5].set((ThreeDAnimation*)&dummy[5]);
+    btCollisionObject obj[6];
+    for(unsigned int i=0; i<6; i++)
+    {
+        obj[i].setCollisionShape(&shape);
+        obj[i].setUserPointer(&up[i]);
+    }
+    obj[4].setCollisionFlags(btCollisionObject::CF_STATIC_OBJECT);
+
+    // Kart-kart (reported twice), kart-track, flyable-kart, kart-static
+    // object, object-track (three contacts, two on the same triangle),
+    // kart-animation, flyable-track.
+    const int pairs[][2] = { {1, 0}, {0, 1}, {0, 3}, {2, 1}, {0, 4}, {4, 3},
+                             {1, 5}, {2, 3} };
+    const int num_pairs = sizeof(pairs)/sizeof(pairs[0]);
+    std::vector<btPersistentManifold*> manifolds;
+    for(int i=0; i<num_pairs; i++)
+    {
+        btPersistentManifold *m = dispatcher.getNewManifold(&obj[pairs[i][0]],
+                                                            &obj[pairs[i][1]]);
+        const int num_points = pairs[i][0]==4 && pairs[i][1]==3 ? 3 : 1;
+        for(int j=0; j<num_points; j++)
+        {
+            btManifoldPoint point(btVector3(0, 0, 0), btVector3(0, 0, 0),
+                                  btVector3(0, 1, 0), -0.01f);
+            point.m_index0 = 5;
+            point.m_index1 = j<2 ? 7 : 8;
+            m->addManifoldPoint(point);
+        }
+        manifolds.push_back(m);
+    }
+
+    CollisionList collisions;
+    std::vector<TrackContact> track_contacts;
+    ContactStatistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+    for(int step=0; step<3; step++)
+    {
+        extractContacts(&dispatcher, &collisions, &track_contacts,
+                        &statistics);
+        assert(track_contacts.size()==4);
+        assert(track_contacts[0].m_type==TrackContact::TC_KART_TRACK);
+        assert(track_contacts[0].m_object==&up[0]);
+        assert(track_contacts[0].m_triangle==7);
+        assert(track_contacts[1].m_type==TrackContact::TC_KART_STATIC_OBJECT);
+        assert(track_contacts[2].m_type==TrackContact::TC_OBJECT_TRACK);
+        assert(track_contacts[2].m_object==&up[4]);
+        assert(track_contacts[2].m_triangle==7);
+        assert(track_contacts[3].m_triangle==8);
+    }
+    assert(collisions.size()==5);
+    const UserPointer *kart_a = &up[0] < &up[1] ? &up[0] : &up[1];
+    assert(collisions[0].getType()==CT_KART_KART);
+    assert(collisions[0].getUserPointer(0)==kart_a);
+    (void)kart_a;   // avoid compiler warning with NDEBUG
+    assert(collisions[1].getType()==CT_FLYABLE_KART);
+    assert(collisions[1].getUserPointer(0)==&up[2]);
+    assert(collisions[2].getType()==CT_KART_OBJECT);
+    assert(collisions[2].getUserPointer(0)==&up[4]);
+    assert(collisions[3].getType()==CT_KART_ANIMATION);
+    assert(collisions[4].getType()==CT_FLYABLE_TRACK);
+    assert(collisions.getNumDuplicates()==1 + 2*6);
+    assert(statistics.m_num_manifolds==3*num_pairs);
+    assert(statistics.m_num_track_contacts==3*4);
+
+    for(unsigned int i=0; i<manifolds.size(); i++)
+        dispatcher.releaseManifold(manifolds[i]);
+
+    // Compare the hashed list with a linear search in random sequences
+    unsigned int seed = 12345;
+    for(int run=0; run<10; run++)
+    {
+        CollisionList list;
+        std::vector<CollisionPair> reference;
+        for(int i=0; i<50; i++)
+        {
+            seed = seed*1103515245 + 12345;
+            const UserPointer *a = &up[(seed>>16) % 6];
+            seed = seed*1103515245 + 12345;
+            const UserPointer *b = &up[(seed>>16) % 6];
+            CollisionPair p(a, btVector3(0, 0, 0), b, btVector3(0, 0, 0));
+            if(std::find(reference.begin(), reference.end(), p)
+                == reference.end())
+                reference.push_back(p);
+            list.push_back(a, btVector3(0, 0, 0), b, btVector3(0, 0, 0));
+        }
+        assert(list.size()==reference.size());
+        for(unsigned int i=0; i<list.size(); i++)
+            assert(list[i]==reference[i]);
+    }
+}   // unitTesting
 
 /* EOF */
 
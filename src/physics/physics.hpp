@@ -25,6 +25,8 @@
   */
 
 #include <set>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "btBulletDynamicsCommon.h"
@@ -32,6 +34,7 @@
 #include "physics/irr_debug_drawer.hpp"
 #include "physics/stk_dynamics_world.hpp"
 #include "physics/user_pointer.hpp"
+#include "scriptengine/script_callback.hpp"
 #include "utils/singleton.hpp"
 
 class AbstractKart;
@@ -44,17 +47,38 @@ class Vec3;
 class Physics : public btSequentialImpulseConstraintSolver
               , public AbstractSingleton<Physics>
 {
+public:
+    /** The types of collisions that are collected during a time step and
+     *  handled after the time step. */
+    enum CollisionType { CT_KART_KART, CT_KART_OBJECT, CT_KART_ANIMATION,
+                         CT_FLYABLE_TRACK, CT_FLYABLE_OBJECT,
+                         CT_FLYABLE_KART, CT_FLYABLE_FLYABLE };
+
+    /** Statistics about the contacts found in the physics time steps. */
+    struct ContactStatistics
+    {
+        /** Number of internal bullet time steps. */
+        unsigned int m_num_steps;
+        /** Number of manifolds (with at least one contact) examined. */
+        unsigned int m_num_manifolds;
+        /** Number of contacts with the track, which are handled
+         *  immediately. */
+        unsigned int m_num_track_contacts;
+        /** Number of different collisions stored for handling after the
+         *  time step. */
+        unsigned int m_num_collisions;
+        /** Number of collisions which were found again in a later
+         *  internal time step. */
+        unsigned int m_num_duplicates;
+    };   // ContactStatistics
+
 private:
     /** Bullet can report the same collision more than once (up to 4
      *  contact points per collision. Additionally, more than one internal
      *  substep might be taken, resulting in potentially even more
      *  duplicates. To handle this, all collisions (i.e. pair of objects)
      *  are stored in a vector, but only one entry per collision pair
-     *  of objects.
-     *  While this is a natural application of std::set, the set has some
-     *  overhead (since it will likely use a tree to sort the entries).
-     *  Considering that the number of collisions is usually rather small
-     *  a simple list and linear search is faster is is being used here. */
+     *  of objects. */
     class CollisionPair
     {
     private:
@@ -63,6 +87,9 @@ private:
 
         /** The contact point for each object (in local coordincates). */
         Vec3               m_contact_point[2];
+
+        /** The type of this collision, determined by the user pointers. */
+        CollisionType      m_type;
     public:
         /** The entries in Collision Pairs are sorted: if a projectile
          * is included, it's always 'a'. If only two karts are reported
@@ -78,16 +105,32 @@ private:
                 m_up[0]=a; m_contact_point[0] = contact_point_a;
                 m_up[1]=b; m_contact_point[1] = contact_point_b;
             }
+            if(m_up[0]->is(UserPointer::UP_KART))
+                m_type = CT_KART_KART;
+            else if(m_up[0]->is(UserPointer::UP_PHYSICAL_OBJECT))
+                m_type = CT_KART_OBJECT;
+            else if(m_up[0]->is(UserPointer::UP_ANIMATION))
+                m_type = CT_KART_ANIMATION;
+            else if(m_up[1]->is(UserPointer::UP_TRACK))
+                m_type = CT_FLYABLE_TRACK;
+            else if(m_up[1]->is(UserPointer::UP_PHYSICAL_OBJECT))
+                m_type = CT_FLYABLE_OBJECT;
+            else if(m_up[1]->is(UserPointer::UP_KART))
+                m_type = CT_FLYABLE_KART;
+            else
+                m_type = CT_FLYABLE_FLYABLE;
         };  //    CollisionPair
         // --------------------------------------------------------------------
         /** Tests if two collision pairs involve the same objects. This test
          *  is simplified (i.e. no test if p.b==a and p.a==b) since the
          *  elements are sorted. */
-        bool operator==(const CollisionPair &p)
+        bool operator==(const CollisionPair &p) const
         {
             return (p.m_up[0]==m_up[0] && p.m_up[1]==m_up[1]);
         }   // operator==
         // --------------------------------------------------------------------
+        CollisionType getType() const { return m_type; }
+        // --------------------------------------------------------------------
         const UserPointer *getUserPointer(unsigned int n) const
         {
             assert(n<=1);
@@ -105,25 +148,77 @@ private:
 
     // ========================================================================
     // This class is the list of collision objects, where each collision
-    // pair is stored as most once.
+    // pair is stored as most once. The list keeps the order in which the
+    // collisions were found, a hash set of the pairs is used to detect
+    // duplicates.
     class CollisionList : public std::vector<CollisionPair>
     {
     private:
-        void push_back(CollisionPair p) {
+        typedef std::pair<const UserPointer*, const UserPointer*> Key;
+        struct KeyHash
+        {
+            size_t operator()(const Key &k) const
+            {
+                return std::hash<const void*>()(k.first)*31
+                     + std::hash<const void*>()(k.second);
+            }
+        };   // KeyHash
+
+        /** All pairs in this list. */
+        std::unordered_set<Key, KeyHash> m_pairs;
+
+        /** Number of pairs that were not added since they were already
+         *  in the list. */
+        unsigned int m_num_duplicates;
+
+        void push_back(const CollisionPair &p) {
             // only add a pair if it's not already in there
-            for(iterator i=begin(); i!=end(); i++) {
-                if((*i)==p) return;
+            if(!m_pairs.insert(Key(p.getUserPointer(0),
+                                   p.getUserPointer(1))).second)
+            {
+                m_num_duplicates++;
+                return;
             }
             std::vector<CollisionPair>::push_back(p);
         };  // push_back
     public:
+        CollisionList() { m_num_duplicates = 0; }
+        // --------------------------------------------------------------------
         /** Adds information about a collision to this vector. */
         void push_back(const UserPointer *a, const btVector3 &contact_point_a,
                        const UserPointer *b, const btVector3 &contact_point_b)
         {
             push_back(CollisionPair(a, contact_point_a, b, contact_point_b));
         }
+        // --------------------------------------------------------------------
+        void clear()
+        {
+            std::vector<CollisionPair>::clear();
+            m_pairs.clear();
+            m_num_duplicates = 0;
+        }   // clear
+        // --------------------------------------------------------------------
+        unsigned int getNumDuplicates() const { return m_num_duplicates; }
     };  // CollisionList
+
+    // ========================================================================
+    /** A kart or physical object touching the track, or a kart touching a
+     *  static physical object. These contacts are handled in the time step
+     *  in which they happen. */
+    struct TrackContact
+    {
+        enum TrackContactType { TC_KART_TRACK, TC_KART_STATIC_OBJECT,
+                                TC_OBJECT_TRACK };
+        TrackContactType   m_type;
+        /** The kart or physical object. */
+        const UserPointer *m_object;
+        /** The track, NULL for TC_KART_STATIC_OBJECT. */
+        const UserPointer *m_track;
+        /** Index of the triangle of the track hit (can be -1). */
+        int                m_triangle;
+        /** The normal of the contact (pointing away from the track). */
+        btVector3          m_normal;
+    };   // TrackContact
     // ========================================================================
 
     /** This flag is set while bullets time step processing is taking
@@ -149,6 +244,20 @@ private:
     btDefaultCollisionConfiguration *m_collision_conf;
     CollisionList                    m_all_collisions;
 
+    /** The track contacts of the current internal time step. */
+    std::vector<TrackContact>        m_track_contacts;
+
+    /** Set once the contacts of the current internal time step have been
+     *  extracted, since bullet can call solveGroup() more than once in
+     *  each internal time step. */
+    bool                             m_contacts_extracted;
+
+    /** Contact statistics of the last call of update(). */
+    ContactStatistics                m_contact_statistics;
+
+    /** The script function called when two karts collide. */
+    Scripting::ScriptCallback<int, int> m_kart_kart_collision_callback;
+
     /** Singleton. */
     static Physics                  *m_physics;
 
@@ -158,6 +267,13 @@ private:
     // Give the singleton access to the constructor
     friend class AbstractSingleton<Physics>;
 
+    static void extractContacts(btDispatcher *dispatcher,
+                                CollisionList *collisions,
+                                std::vector<TrackContact> *track_contacts,
+                                ContactStatistics *statistics);
+    void        handleTrackContacts();
+    static void preTickCallback(btDynamicsWorld *world, btScalar time_step);
+
 public:
     void  init             (const Vec3 &min_world, const Vec3 &max_world);
     void  addKart          (const AbstractKart *k);
@@ -177,6 +293,12 @@ public:
     /** Returns true if the debug drawer is enabled. */
     bool  isDebug() const     {return m_debug_drawer->debugEnabled(); }
     IrrDebugDrawer* getDebugDrawer() { return m_debug_drawer; }
+    /** Returns statistics about the contacts of the last update() call. */
+    const ContactStatistics& getContactStatistics() const
+    {
+        return m_contact_statistics;
+    }   // getContactStatistics
+    static void unitTesting();
     virtual btScalar solveGroup(btCollisionObject** bodies, int numBodies,
                                 btPersistentManifold** manifold,int numManifolds,
                                 btTypedConstraint** constraints,int numConstraints,
@@ -0,0 +1,234 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "physics/raycast_tree.hpp"
+
+#include "physics/triangle_mesh.hpp"
+#include "utils/log.hpp"
+
+#include <chrono>
+#include <cmath>
+
+/** Added to each side of the box of an object. */
+static const float RAYCAST_TREE_MARGIN = 0.25f;
+
+// ----------------------------------------------------------------------------
+/** Returns the bounding box of a collision object at its current position.
+ */
+btDbvtVolume RaycastTree::getVolume(const btCollisionObject *object)
+{
+    btVector3 min, max;
+    object->getCollisionShape()->getAabb(object->getWorldTransform(),
+                                         min, max);
+    return btDbvtVolume::FromMM(min, max);
+}   // getVolume
+
+// ----------------------------------------------------------------------------
+/** Removes all objects. */
+void RaycastTree::clear()
+{
+    m_tree.clear();
+    m_objects.clear();
+    m_leaves.clear();
+    m_unbounded.clear();
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Adds an object, its index is the number of objects added before.
+ *  \param object The collision object (e.g. a rigid body) that determines
+ *         the box of the object. If it is NULL (or has no shape), the
+ *         object is returned by each raycast.
+ */
+void RaycastTree::addObject(const btCollisionObject *object)
+{
+    const unsigned int index = (unsigned int)m_objects.size();
+    m_objects.push_back(object);
+    if (!object || !object->getCollisionShape())
+    {
+        m_leaves.push_back(NULL);
+        m_unbounded.push_back(index);
+        return;
+    }
+    btDbvtVolume volume = getVolume(object);
+    volume.Expand(btVector3(RAYCAST_TREE_MARGIN, RAYCAST_TREE_MARGIN,
+                            RAYCAST_TREE_MARGIN));
+    m_leaves.push_back(m_tree.insert(volume, (void*)(size_t)index));
+}   // addObject
+
+// ----------------------------------------------------------------------------
+/** Updates the boxes of all objects that have moved out of their box. The
+ *  new box is extended by the movement of a rigid body in the next time
+ *  step.
+ *  \param dt Time step size.
+ */
+void RaycastTree::refit(float dt)
+{
+    for (unsigned int i = 0; i < m_objects.size(); i++)
+    {
+        if (!m_leaves[i]) continue;
+        btDbvtVolume volume = getVolume(m_objects[i]);
+        btVector3 motion(0, 0, 0);
+        const btRigidBody *body = btRigidBody::upcast(m_objects[i]);
+        if (body)
+            motion = body->getLinearVelocity() * dt;
+        m_tree.update(m_leaves[i], volume, motion, RAYCAST_TREE_MARGIN);
+    }
+}   // refit
+
+// ----------------------------------------------------------------------------
+/** Measures raycasts against a synthetic track of many driveable platforms,
+ *  half of which move up and down, once by testing all objects and once with
+ *  the tree, and checks that both find the same hits.
+ *  \param num_objects Number of platforms.
+ *  \param num_frames Number of frames, in each frame the platforms move and
+ *         64 rays are cast down from random positions.
+ */
+void RaycastTree::benchmark(unsigned int num_objects, unsigned int num_frames)
+{
+    const unsigned int grid = (unsigned int)ceilf(sqrtf((float)num_objects));
+    const float spacing = 10.0f;
+    const float dt      = 1.0f / 60.0f;
+
+    // Each platform is 8x8 m and made of 4x4 squares
+    std::vector<TriangleMesh*> meshes;
+    std::vector<btRigidBody*> bodies;
+    const btVector3 up(0, 1, 0);
+    RaycastTree tree;
+    for (unsigned int i = 0; i < num_objects; i++)
+    {
+        TriangleMesh *mesh = new TriangleMesh();
+        for (unsigned int x = 0; x < 4; x++)
+        {
+            for (unsigned int z = 0; z < 4; z++)
+            {
+                btVector3 p0(x * 2.0f - 4.0f, 0, z * 2.0f - 4.0f);
+                btVector3 p1 = p0 + btVector3(2, 0, 0);
+                btVector3 p2 = p0 + btVector3(0, 0, 2);
+                btVector3 p3 = p0 + btVector3(2, 0, 2);
+                mesh->addTriangle(p0, p2, p1, up, up, up, NULL);
+                mesh->addTriangle(p1, p2, p3, up, up, up, NULL);
+            }
+        }
+        mesh->createCollisionShape(/*create_collision_object*/false);
+        btRigidBody::btRigidBodyConstructionInfo info(0, NULL,
+                                                &mesh->getCollisionShape());
+        btRigidBody *body = new btRigidBody(info);
+        body->setCollisionFlags(body->getCollisionFlags() |
+                                btCollisionObject::CF_KINEMATIC_OBJECT);
+        btTransform t;
+        t.setIdentity();
+        t.setOrigin(btVector3((i % grid) * spacing, (i % 7) * 0.5f,
+                              (i / grid) * spacing));
+        body->setWorldTransform(t);
+        mesh->setBody(body);
+        meshes.push_back(mesh);
+        bodies.push_back(body);
+        tree.addObject(body);
+    }
+
+    uint32_t seed = 12345;
+    unsigned int num_rays = 0, num_hits = 0, num_errors = 0;
+    unsigned int num_tested = 0;
+    using namespace std::chrono;
+    steady_clock::duration linear_time(0), tree_time(0), refit_time(0);
+    for (unsigned int frame = 0; frame < num_frames; frame++)
+    {
+        const float time = frame * dt;
+        for (unsigned int i = 1; i < num_objects; i += 2)
+        {
+            btTransform t = bodies[i]->getWorldTransform();
+            btVector3 origin = t.getOrigin();
+            origin.setY((i % 7) * 0.5f + 2.0f * sinf(time + i));
+            t.setOrigin(origin);
+            bodies[i]->setWorldTransform(t);
+            bodies[i]->setLinearVelocity(btVector3(0, 2.0f*cosf(time+i), 0));
+        }
+        steady_clock::time_point start = steady_clock::now();
+        tree.refit(dt);
+        refit_time += steady_clock::now() - start;
+
+        for (unsigned int r = 0; r < 64; r++)
+        {
+            seed = seed * 1103515245 + 12345;
+            const float x = ((seed >> 8) % 10000) * 0.0001f * grid * spacing;
+            seed = seed * 1103515245 + 12345;
+            const float z = ((seed >> 8) % 10000) * 0.0001f * grid * spacing;
+            const btVector3 from(x, 5.0f, z), to(x, -5.0f, z);
+            num_rays++;
+
+            start = steady_clock::now();
+            int linear_index = -1;
+            float linear_distance = 9999.9f;
+            for (unsigned int i = 0; i < num_objects; i++)
+            {
+                btVector3 hit_point;
+                const Material *material;
+                if (meshes[i]->castRay(from, to, &hit_point, &material) &&
+                    hit_point.distance(from) < linear_distance)
+                {
+                    linear_distance = hit_point.distance(from);
+                    linear_index    = i;
+                }
+            }
+            linear_time += steady_clock::now() - start;
+
+            start = steady_clock::now();
+            int tree_index = -1;
+            float tree_distance = 9999.9f;
+            auto test = [&](unsigned int i)
+            {
+                num_tested++;
+                btVector3 hit_point;
+                const Material *material;
+                if (!meshes[i]->castRay(from, to, &hit_point, &material))
+                    return;
+                const float distance = hit_point.distance(from);
+                if (distance < tree_distance ||
+                    (distance == tree_distance && (int)i < tree_index))
+                {
+                    tree_distance = distance;
+                    tree_index    = i;
+                }
+            };
+            tree.rayTest(from, to, test);
+            tree_time += steady_clock::now() - start;
+
+            if (linear_index != tree_index) num_errors++;
+            if (linear_index != -1) num_hits++;
+        }
+    }
+
+    loginfo("RaycastTree", "%u objects, %u rays (%u hits): all objects "
+            "%.2f us, tree %.2f us per ray (%.1f objects tested), refit "
+            "%.2f us per frame.", num_objects, num_rays, num_hits,
+            duration<double, std::micro>(linear_time).count() / num_rays,
+            duration<double, std::micro>(tree_time).count() / num_rays,
+            (float)num_tested / num_rays,
+            duration<double, std::micro>(refit_time).count() / num_frames);
+    if (num_errors > 0)
+    {
+        logerror("RaycastTree", "%u rays hit a different object with the "
+                 "tree.", num_errors);
+    }
+
+    tree.clear();
+    for (unsigned int i = 0; i < num_objects; i++)
+    {
+        delete meshes[i];
+        delete bodies[i];
+    }
+}   // benchmark
@@ -0,0 +1,99 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_RAYCAST_TREE_HPP
+#define HEADER_RAYCAST_TREE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletCollision/BroadphaseCollision/btDbvt.h"
+
+#include <vector>
+
+/**
+  * \brief A dynamic bounding box tree of collision objects, used to find the
+  *  objects a ray can hit without testing each object.
+  *  The objects are identified by the index in the order in which they were
+  *  added. The tree is Bullet's btDbvt, which is also used by the broadphase.
+  *  The boxes in the tree are made larger by a small margin and by the
+  *  movement of the object in one time step, so objects that move slowly
+  *  (or not at all) rarely change the tree in refit. Objects without a
+  *  collision object have no box, and are returned by each raycast.
+  * \ingroup physics
+  */
+class RaycastTree : public NoCopy
+{
+private:
+    /** The tree, the data of each leaf is the index of the object. */
+    btDbvt m_tree;
+
+    /** All objects in the order they were added. */
+    std::vector<const btCollisionObject*> m_objects;
+
+    /** The leaf of each object, NULL if the object has no box. */
+    std::vector<btDbvtNode*> m_leaves;
+
+    /** The objects without box. */
+    std::vector<unsigned int> m_unbounded;
+
+    // ------------------------------------------------------------------------
+    /** Calls a function for each leaf the ray touches. */
+    template<typename F>
+    class Collector : public btDbvt::ICollide
+    {
+    private:
+        F *m_f;
+    public:
+        Collector(F *f) : m_f(f) {}
+        virtual void Process(const btDbvtNode *leaf)
+        {
+            (*m_f)((unsigned int)(size_t)leaf->data);
+        }   // Process
+    };   // Collector
+
+    static btDbvtVolume getVolume(const btCollisionObject *object);
+
+public:
+    void clear();
+    void addObject(const btCollisionObject *object);
+    void refit(float dt);
+    static void benchmark(unsigned int num_objects, unsigned int num_frames);
+    // ------------------------------------------------------------------------
+    /** Returns the number of objects. */
+    unsigned int getNumObjects() const
+    {
+        return (unsigned int)m_objects.size();
+    }   // getNumObjects
+    // ------------------------------------------------------------------------
+    /** Calls f(index) for each object whose box the ray from 'from' to 'to'
+     *  touches, and for each object without box, in no particular order.
+     *  This does not change the tree, so it can be called from several
+     *  threads at the same time. */
+    template<typename F>
+    void rayTest(const btVector3 &from, const btVector3 &to, F &f) const
+    {
+        for (unsigned int i = 0; i < m_unbounded.size(); i++)
+            f(m_unbounded[i]);
+        // A ray of length 0 hits nothing (and has no direction)
+        if (m_tree.empty() || from == to) return;
+        Collector<F> collector(&f);
+        btDbvt::rayTest(m_tree.m_root, from, to, collector);
+    }   // rayTest
+};   // RaycastTree
+
+#endif
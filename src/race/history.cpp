@@ -19,7 +19,9 @@
 #include "race/history.hpp"
 
 #include <stdio.h>
+#include <stdlib.h>
 
+#include "config/user_config.hpp"
 #include "io/file_manager.hpp"
 #include "modes/world.hpp"
 #include "karts/abstract_kart.hpp"
@@ -37,6 +39,8 @@ History* history = 0;
 History::History()
 {
     m_replay_mode = HISTORY_NONE;
+    m_seed        = 0;
+    m_num_different_frames = 0;
 }   // History
 
 //-----------------------------------------------------------------------------
@@ -61,6 +65,19 @@ void History::initRecording()
     m_size    = 0;
 }   // initRecording
 
+//-----------------------------------------------------------------------------
+/** Seeds the random number generator at the start of a race. When recording
+ *  a new seed is used (and saved with the history), when replaying or
+ *  checking a history the recorded seed is used, so that items and AIs
+ *  make the same random choices as in the recorded race.
+ */
+void History::seedRandomNumbers()
+{
+    if (!replayHistory())
+        m_seed = (unsigned int)rand();
+    srand(m_seed);
+}   // seedRandomNumbers
+
 //-----------------------------------------------------------------------------
 /** Allocates memory for the history. This is used when recording as well
  *  as when replaying (since in replay the data is read into memory first).
@@ -69,6 +86,7 @@ void History::initRecording()
 void History::allocateMemory(int number_of_frames)
 {
     m_all_deltas.resize   (number_of_frames);
+    m_all_ticks.resize    (number_of_frames);
     unsigned int num_karts = race_manager->getNumberOfKarts();
     m_all_controls.resize (number_of_frames*num_karts);
     m_all_xyz.resize      (number_of_frames*num_karts);
@@ -93,9 +111,10 @@ void History::updateSaving(float dt)
         if(m_size<(int)m_all_deltas.size())
             m_size ++;
     }
+    World *world = World::getWorld();
     m_all_deltas[m_current] = dt;
+    m_all_ticks[m_current]  = world->getTicks();
 
-    World *world = World::getWorld();
     unsigned int num_karts = world->getNumKarts();
     unsigned int index     = m_current*num_karts;
     for(unsigned int i=0; i<num_karts; i++)
@@ -107,6 +126,63 @@ void History::updateSaving(float dt)
     }   // for i
 }   // updateSaving
 
+//-----------------------------------------------------------------------------
+/** Compares the position and rotation of all karts with the recorded values
+ *  of the next frame (in HISTORY_CHECK mode). This is called at the same
+ *  place at which the values are recorded, so when the race is simulated in
+ *  exactly the same way, all values are identical. After the last recorded
+ *  frame the result is printed and STK exits, with exit code 0 if no
+ *  difference was found.
+ */
+void History::updateChecking()
+{
+    m_current++;
+    if (m_current >= m_size)
+        return;
+
+    World *world = World::getWorld();
+    const unsigned int num_karts = world->getNumKarts();
+    bool different = false;
+    for (unsigned int k = 0; k < num_karts; k++)
+    {
+        const AbstractKart *kart = world->getKart(k);
+        const unsigned int index = m_current*num_karts + k;
+        const Vec3 &xyz          = kart->getXYZ();
+        const btQuaternion &rot  = kart->getVisualRotation();
+        if (xyz == m_all_xyz[index] && rot == m_all_rotations[index])
+            continue;
+        if (m_num_different_frames == 0 && !different)
+        {
+            logerror("History", "Frame %d: kart %d '%s' is at "
+                     "%.9g %.9g %.9g (%.9g %.9g %.9g %.9g), recorded "
+                     "%.9g %.9g %.9g (%.9g %.9g %.9g %.9g).",
+                     m_current, k, kart->getIdent().c_str(),
+                     xyz.getX(), xyz.getY(), xyz.getZ(),
+                     rot.getX(), rot.getY(), rot.getZ(), rot.getW(),
+                     m_all_xyz[index].getX(), m_all_xyz[index].getY(),
+                     m_all_xyz[index].getZ(), m_all_rotations[index].getX(),
+                     m_all_rotations[index].getY(),
+                     m_all_rotations[index].getZ(),
+                     m_all_rotations[index].getW());
+        }
+        different = true;
+    }
+    if (different)
+        m_num_different_frames++;
+
+    if (m_current < m_size - 1)
+        return;
+    if (m_num_different_frames > 0)
+    {
+        logerror("History", "Check failed: %d of %d frames differ from the "
+                 "history.", m_num_different_frames, m_size);
+        exit(1);
+    }
+    loginfo("History", "Check passed: all %d frames are identical to the "
+            "history.", m_size);
+    exit(0);
+}   // updateChecking
+
 //-----------------------------------------------------------------------------
 /** Sets the kart position and controls to the recorded history value.
  *  \param dt Time step size.
@@ -123,7 +199,7 @@ float History::updateReplayAndGetDT()
         // replay it with history, for debugging only
 #undef DO_REWIND_AT_END_OF_HISTORY
 #ifdef DO_REWIND_AT_END_OF_HISTORY
-        RewindManager::get()->rewindTo(5.0f);
+        RewindManager::get()->rewindTo(5*WorldStatus::TICKS_PER_SECOND);
         exit(-1);
 #else
         // Note that for physics replay all physics parameters
@@ -146,6 +222,9 @@ float History::updateReplayAndGetDT()
             kart->getControls().set(m_all_controls[index]);
         }
     }
+    // A history recorded with fixed ticks has one entry per tick.
+    if (WorldStatus::isFixedTicks())
+        return WorldStatus::ticksToTime(1);
     return m_all_deltas[m_current];
 }   // updateReplayAndGetDT
 
@@ -180,6 +259,8 @@ void History::Save()
     fprintf(fd, "numplayers: %d\n", race_manager->getNumPlayers());
     fprintf(fd, "difficulty: %d\n", race_manager->getDifficulty());
     fprintf(fd, "reverse: %c\n", race_manager->getReverseTrack() ? 'y' : 'n');
+    fprintf(fd, "seed: %u\n", m_seed);
+    fprintf(fd, "laps: %d\n", race_manager->getNumLaps());
 
     fprintf(fd, "track: %s\n",      Track::getCurrentTrack()->getIdent().c_str());
 
@@ -195,7 +276,10 @@ void History::Save()
     int index = m_wrapped ? m_current : 0;
     for(int i=0; i<m_size; i++)
     {
-        fprintf(fd, "delta: %f\n",m_all_deltas[index]);
+        if (WorldStatus::isFixedTicks())
+            fprintf(fd, "ticks: %d\n", m_all_ticks[index]);
+        else
+            fprintf(fd, "delta: %.9g\n",m_all_deltas[index]);
         index=(index+1)%m_size;
     }
 
@@ -204,7 +288,8 @@ void History::Save()
     {
         for(int k=0; k<num_karts; k++)
         {
-            fprintf(fd, "%f %f %d  %f %f %f  %f %f %f %f\n",
+            // Enough digits to read back exactly the same floats
+            fprintf(fd, "%.9g %.9g %d  %.9g %.9g %.9g  %.9g %.9g %.9g %.9g\n",
                     m_all_controls[index+k].getSteer(),
                     m_all_controls[index+k].getAccel(),
                     m_all_controls[index+k].getButtonsCompressed(),
@@ -278,13 +363,23 @@ void History::Load()
         race_manager->setReverseTrack(r == 'y');
     }
 
+    // Optional: the seed of the random number generator
+    if (sscanf(s, "seed: %u", &m_seed) == 1)
+        fgets(s, 1023, fd);
+
+    // Optional: the number of laps. If it is not known, the value doesn't
+    // really matter, but should be defined, otherwise the racing phase can
+    // switch to 'ending'
+    if (sscanf(s, "laps: %d", &n) == 1)
+        fgets(s, 1023, fd);
+    else
+        n = 10;
+    race_manager->setNumLaps(n);
+
 
     if(sscanf(s, "track: %1023s",s1)!=1)
         logwarn("History", "Track not found in history file.");
     race_manager->setTrack(s1);
-    // This value doesn't really matter, but should be defined, otherwise
-    // the racing phase can switch to 'ending'
-    race_manager->setNumLaps(10);
 
     for(unsigned int i=0; i<num_karts; i++)
     {
@@ -304,11 +399,28 @@ void History::Load()
 
     allocateMemory(m_size);
     m_current = -1;
+    m_num_different_frames = 0;
 
+    // A history recorded with fixed ticks stores the ticks of each entry
+    // instead of the delta, and must be replayed with fixed ticks,
+    // otherwise the physics would not be identical.
+    bool fixed_ticks = false;
     for(int i=0; i<m_size; i++)
     {
         fgets(s, 1023, fd);
-        sscanf(s, "delta: %f\n",&m_all_deltas[i]);
+        if (sscanf(s, "ticks: %d\n", &m_all_ticks[i]) == 1)
+        {
+            fixed_ticks = true;
+            m_all_deltas[i] = WorldStatus::ticksToTime(1);
+        }
+        else
+            sscanf(s, "delta: %f\n",&m_all_deltas[i]);
+    }
+    UserConfigParams::m_fixed_ticks = fixed_ticks;
+    if (!fixed_ticks && m_replay_mode == HISTORY_CHECK)
+    {
+        logwarn("History", "The history was not recorded with fixed ticks, "
+                "so the karts will not be at the same positions.");
     }
 
     // We need to disable the rewind manager here (otherwise setting the
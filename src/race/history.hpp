@@ -41,11 +41,15 @@ public:
      *  HISTORY_POSITION: replay the positions and orientations of the karts,
      *                    but don't simulate the physics.
      *  HISTORY_PHYSICS:  Simulate the phyics based on the recorded actions.
+     *  HISTORY_CHECK:    Let the controllers drive the karts again, and
+     *                    check that all karts are at the recorded positions
+     *                    with the recorded rotations in each frame.
      *  These values can be used together, e.g. HISTORY_POSITION|HISTORY_CONTROL
      */
     enum HistoryReplayMode { HISTORY_NONE     = 0,
                              HISTORY_POSITION = 1,
-                             HISTORY_PHYSICS  = 2 };
+                             HISTORY_PHYSICS  = 2,
+                             HISTORY_CHECK    = 4 };
 private:
     /** maximum number of history events to store. */
     HistoryReplayMode          m_replay_mode;
@@ -64,6 +68,10 @@ private:
     /** Stores all time step sizes. */
     std::vector<float>         m_all_deltas;
 
+    /** Stores the world ticks of each entry. A history recorded in fixed
+     *  tick mode is saved and replayed by ticks instead of by deltas. */
+    std::vector<int>           m_all_ticks;
+
     /** Stores the kart controls being used (for physics replay). */
     std::vector<KartControl>   m_all_controls;
 
@@ -76,6 +84,13 @@ private:
     /** The identities of the karts to use. */
     std::vector<std::string>  m_kart_ident;
 
+    /** The seed of the random number generator at the start of the race. */
+    unsigned int               m_seed;
+
+    /** Number of frames in which a kart was not at the recorded position
+     *  (in HISTORY_CHECK mode). */
+    int                        m_num_different_frames;
+
     void  allocateMemory(int number_of_frames);
 public:
           History        ();
@@ -84,7 +99,9 @@ public:
     void  Save           ();
     void  Load           ();
     void  updateSaving(float dt);
+    void  updateChecking();
     float updateReplayAndGetDT();
+    void  seedRandomNumbers();
 
     // -------------------I-----------------------------------------------------
     /** Returns the identifier of the n-th kart. */
@@ -96,6 +113,16 @@ public:
     /** Returns if a history is replayed, i.e. the history mode is not none. */
     bool  replayHistory  () const { return m_replay_mode != HISTORY_NONE;    }
     // ------------------------------------------------------------------------
+    /** Returns if the karts are driven by the history, i.e. the controllers
+     *  must not change the controls of the karts. */
+    bool  replayControls () const
+    {
+        return (m_replay_mode & (HISTORY_POSITION | HISTORY_PHYSICS)) != 0;
+    }   // replayControls
+    // ------------------------------------------------------------------------
+    /** Returns if the race is compared with the history. */
+    bool  checkHistory   () const { return m_replay_mode == HISTORY_CHECK;   }
+    // ------------------------------------------------------------------------
     /** Enable replaying a history, enabled from the command line. */
     void  doReplayHistory(HistoryReplayMode m) {m_replay_mode = m;           }
     // ------------------------------------------------------------------------
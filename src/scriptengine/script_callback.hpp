@@ -0,0 +1,153 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SCRIPT_CALLBACK_HPP
+#define HEADER_SCRIPT_CALLBACK_HPP
+
+#include <angelscript.h>
+#include <string>
+
+namespace Scripting
+{
+    /** Maps the C++ type of a callback argument to its AngelScript type
+     *  and to the function used to pass it to a context. */
+    template<typename T> struct ScriptArgument;
+
+    template<> struct ScriptArgument<int>
+    {
+        static const char *getType() { return "int"; }
+        static void set(asIScriptContext *ctx, asUINT i, int value)
+        {
+            ctx->SetArgDWord(i, (asDWORD)value);
+        }
+    };   // ScriptArgument<int>
+
+    template<> struct ScriptArgument<std::string>
+    {
+        static const char *getType() { return "const string"; }
+        static void set(asIScriptContext *ctx, asUINT i,
+                        const std::string &value)
+        {
+            // The string must stay valid till the function is executed,
+            // which is the case since it is an argument of operator().
+            ctx->SetArgObject(i, (void*)&value);
+        }
+    };   // ScriptArgument<std::string>
+
+    // ========================================================================
+    /** The part of a ScriptCallback that does not depend on the argument
+     *  types. It keeps the script function once it was looked up, and only
+     *  looks it up again if the scripts were changed (which is detected
+     *  with ScriptEngine::getGeneration()).
+     */
+    class ScriptCallbackBase
+    {
+    private:
+        /** The full declaration of the function, e.g. "void f(int)". Empty
+         *  if no function is set. */
+        std::string m_declaration;
+
+        /** The function, or NULL if the scripts do not contain it. Only
+         *  valid if m_generation is the generation of the script engine. */
+        asIScriptFunction *m_function;
+
+        /** Generation of the script engine in which m_function was found. */
+        unsigned int m_generation;
+
+        /** If a warning should be printed if the function does not exist. */
+        bool m_warn_if_not_found;
+
+    protected:
+        ScriptCallbackBase()
+        {
+            m_function          = NULL;
+            m_generation        = 0;
+            m_warn_if_not_found = true;
+        }   // ScriptCallbackBase
+        // --------------------------------------------------------------------
+        void setDeclaration(const std::string &name, const std::string &args,
+                            bool warn_if_not_found);
+        asIScriptContext *prepare();
+        void execute(asIScriptContext *ctx);
+
+    public:
+        /** Returns true if a function name was set. */
+        bool isSet() const { return !m_declaration.empty(); }
+        // --------------------------------------------------------------------
+        /** Returns the declaration of the function. */
+        const std::string &getDeclaration() const { return m_declaration; }
+    };   // ScriptCallbackBase
+
+    // ========================================================================
+    /** A handle to a script function with the arguments Args, which returns
+     *  void. The declaration of the function is built once when the name is
+     *  set, and the function is looked up at the first call. Calling it
+     *  then only needs a context from the pool of the script engine, so it
+     *  is much cheaper than ScriptEngine::runFunction(), which needs a
+     *  declaration string and std::function objects for each call.
+     *  Supported argument types are int and std::string.
+     */
+    template<typename... Args>
+    class ScriptCallback : public ScriptCallbackBase
+    {
+    private:
+        void setArgs(asIScriptContext *ctx, asUINT i) {}
+        // --------------------------------------------------------------------
+        template<typename T, typename... Rest>
+        void setArgs(asIScriptContext *ctx, asUINT i, const T &first,
+                     const Rest&... rest)
+        {
+            ScriptArgument<T>::set(ctx, i, first);
+            setArgs(ctx, i + 1, rest...);
+        }   // setArgs
+
+    public:
+        ScriptCallback() {}
+        // --------------------------------------------------------------------
+        ScriptCallback(const std::string &name, bool warn_if_not_found = true)
+        {
+            set(name, warn_if_not_found);
+        }   // ScriptCallback
+        // --------------------------------------------------------------------
+        /** Sets the name of the function to call. An empty name means that
+         *  calling this callback does nothing. */
+        void set(const std::string &name, bool warn_if_not_found = true)
+        {
+            const char *types[] = { ScriptArgument<Args>::getType()..., NULL };
+            std::string args;
+            for (unsigned int i = 0; types[i] != NULL; i++)
+            {
+                if (i > 0) args += ", ";
+                args += types[i];
+            }
+            setDeclaration(name, args, warn_if_not_found);
+        }   // set
+        // --------------------------------------------------------------------
+        /** Calls the script function (if it exists). */
+        void operator()(const Args&... args)
+        {
+            asIScriptContext *ctx = prepare();
+            if (ctx == NULL) return;
+            setArgs(ctx, 0, args...);
+            execute(ctx);
+        }   // operator()
+    };   // ScriptCallback
+
+}   // namespace Scripting
+
+#endif
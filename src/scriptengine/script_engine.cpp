@@ -18,6 +18,7 @@
 
 #include <assert.h>
 #include <angelscript.h>
+#include "config/user_config.hpp"
 #include "io/file_manager.hpp"
 #include "karts/kart.hpp"
 #include "modes/world.hpp"
@@ -36,7 +37,16 @@
 #include "states_screens/dialogs/tutorial_message_dialog.hpp"
 #include "tracks/track_object_manager.hpp"
 #include "tracks/track.hpp"
+#include "utils/constants.hpp"
+#include "utils/hash.hpp"
 #include "utils/profiler.hpp"
+#include "utils/time.hpp"
+
+#include <IFileSystem.h>
+#include <IReadFile.h>
+#include <sstream>
+#include <stdio.h>
+#include <zlib.h>
 
 
 using namespace Scripting;
@@ -56,6 +66,42 @@ namespace Scripting
         logwarn("Scripting", "%s (%d, %d) : %s : %s\n", msg->section, msg->row, msg->col, type, msg->message);
     }
 
+    unsigned int ScriptEngine::m_generation = 1;
+
+    /** Magic string at the start of cached byte code files. */
+    const char CACHED_BYTE_CODE_MAGIC[8] = "STKASBC";
+
+    /** Reads and writes byte code from/to a file. */
+    class ByteCodeFile : public asIBinaryStream
+    {
+    private:
+        FILE *m_file;
+        bool  m_failed;
+    public:
+        ByteCodeFile(FILE *file) { m_file = file; m_failed = false; }
+        // --------------------------------------------------------------------
+        virtual void Read(void *ptr, asUINT size)
+        {
+            if (size == 0) return;
+            if (m_failed || fread(ptr, size, 1, m_file) != 1)
+            {
+                // AngelScript does not check for errors, so make sure that
+                // it gets defined (if wrong) data.
+                memset(ptr, 0, size);
+                m_failed = true;
+            }
+        }   // Read
+        // --------------------------------------------------------------------
+        virtual void Write(const void *ptr, asUINT size)
+        {
+            if (size == 0) return;
+            if (m_failed || fwrite(ptr, size, 1, m_file) != 1)
+                m_failed = true;
+        }   // Write
+        // --------------------------------------------------------------------
+        bool hasFailed() const { return m_failed; }
+    };   // ByteCodeFile
+
 
     //Constructor, creates a new Scripting Engine using AngelScript
     ScriptEngine::ScriptEngine()
@@ -70,6 +116,13 @@ namespace Scripting
         // The script compiler will write any compiler messages to the callback.
         m_engine->SetMessageCallback(asFUNCTION(AngelScript_ErrorCallback), 0, asCALL_CDECL);
 
+        // Contexts are taken from a pool instead of being created for each
+        // call of a script function.
+        m_engine->SetContextCallbacks(requestContextCallback,
+                                      returnContextCallback, this);
+        m_loaded_scripts_hash = 0;
+        m_generation++;
+
         // Configure the script engine with all the functions, 
         // and variables that the script should be able to use.
         configureEngine(m_engine);
@@ -79,10 +132,45 @@ namespace Scripting
     {
         // Release the engine
         m_pending_timeouts.clearAndDeleteAll();
+        clearFunctionsCache();
         m_engine->DiscardModule(MODULE_ID_MAIN_SCRIPT_FILE);
+        for (unsigned int i = 0; i < m_context_pool.size(); i++)
+            m_context_pool[i]->Release();
+        m_context_pool.clear();
         m_engine->Release();
+        m_generation++;
     }
 
+    //-----------------------------------------------------------------------------
+    /** Called by AngelScript when it needs a context, either for one of the
+     *  run functions or internally (e.g. to initialise global variables).
+     *  Returns a context from the pool, or creates a new one if the pool
+     *  is empty (e.g. if a script calls a function which runs a script).
+     */
+    asIScriptContext* ScriptEngine::requestContextCallback(asIScriptEngine *engine,
+                                                           void *param)
+    {
+        ScriptEngine *me = (ScriptEngine*)param;
+        if (me->m_context_pool.empty())
+            return engine->CreateContext();
+        asIScriptContext *ctx = me->m_context_pool.back();
+        me->m_context_pool.pop_back();
+        return ctx;
+    }   // requestContextCallback
+
+    //-----------------------------------------------------------------------------
+    /** Called by AngelScript when a context is not needed anymore. The
+     *  context is unprepared (which releases all objects it still references)
+     *  and put back into the pool.
+     */
+    void ScriptEngine::returnContextCallback(asIScriptEngine *engine,
+                                             asIScriptContext *ctx, void *param)
+    {
+        ScriptEngine *me = (ScriptEngine*)param;
+        ctx->Unprepare();
+        me->m_context_pool.push_back(ctx);
+    }   // returnContextCallback
+
 
 
     /** Get Script By it's file name
@@ -91,26 +179,24 @@ namespace Scripting
     */
     std::string getScript(std::string script_path)
     {
-        //std::string script_path = World::getWorld()->getTrack()->getTrackFile(fileName);
-
-        FILE *f = fopen(script_path.c_str(), "rb");
-        if (f == NULL)
+        // The script can be in a mounted addon archive, so it must be read
+        // through irrlicht's file system
+        irr::io::IReadFile *file = file_manager->getFileSystem()
+                                 ->createAndOpenFile(script_path.c_str());
+        if (file == NULL)
         {
             logdebug("Scripting", "File does not exist : %s", script_path.c_str());
             return "";
         }
 
-        // Determine the size of the file   
-        fseek(f, 0, SEEK_END);
-        int len = ftell(f);
-        fseek(f, 0, SEEK_SET);
-
         // Read the entire file
         std::string script;
-        script.resize(len);
-        int c = fread(&script[0], len, 1, f);
-        fclose(f);
-        if (c != 1)
+        script.resize(file->getSize());
+        const irr::s32 len = script.size() > 0
+                           ? file->read(&script[0], (irr::u32)script.size())
+                           : 0;
+        file->drop();
+        if (len != (irr::s32)script.size())
         {
             logerror("Scripting", "Failed to load script file.");
             return "";
@@ -134,42 +220,12 @@ namespace Scripting
             return;
         }
 
-        asIScriptContext *ctx = m_engine->CreateContext();
-        if (ctx == NULL)
+        asIScriptContext *ctx = prepareContext(func);
+        if (ctx != NULL)
         {
-            logerror("Scripting", "evalScript: Failed to create the context.");
-            //m_engine->Release();
-            return;
-        }
-
-        r = ctx->Prepare(func);
-        if (r < 0)
-        {
-            logerror("Scripting", "evalScript: Failed to prepare the context.");
-            ctx->Release();
-            return;
+            executeContext(ctx);
+            returnContext(ctx);
         }
-
-        // Execute the function
-        r = ctx->Execute();
-        if (r != asEXECUTION_FINISHED)
-        {
-            // The execution didn't finish as we had planned. Determine why.
-            if (r == asEXECUTION_ABORTED)
-            {
-                logerror("Scripting", "The script was aborted before it could finish. Probably it timed out.");
-            }
-            else if (r == asEXECUTION_EXCEPTION)
-            {
-                logerror("Scripting", "The script ended with an exception.");
-            }
-            else
-            {
-                logerror("Scripting", "The script ended for some unforeseen reason (%i)", r);
-            }
-        }
-
-        ctx->Release();
         func->Release();
     }
 
@@ -177,45 +233,76 @@ namespace Scripting
 
     void ScriptEngine::runDelegate(asIScriptFunction* delegate)
     {
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = prepareContext(delegate);
         if (ctx == NULL)
-        {
-            logerror("Scripting", "runMethod: Failed to create the context.");
-            //m_engine->Release();
             return;
+        executeContext(ctx);
+        returnContext(ctx);
+    }
+
+    //-----------------------------------------------------------------------------
+    /** Gets a context from the pool and prepares it to execute a function.
+    *  \param func The function to execute.
+    *  \return The context, or NULL if an error happened.
+    */
+    asIScriptContext* ScriptEngine::prepareContext(asIScriptFunction *func)
+    {
+        asIScriptContext *ctx = m_engine->RequestContext();
+        if (ctx == NULL)
+        {
+            logerror("Scripting", "Failed to create the context.");
+            return NULL;
         }
 
-        int r = ctx->Prepare(delegate);
+        // Prepare the script context with the function we wish to execute. Prepare()
+        // must be called on the context before each new script function that will be
+        // executed.
+        int r = ctx->Prepare(func);
         if (r < 0)
         {
-            logerror("Scripting", "runMethod: Failed to prepare the context.");
-            ctx->Release();
-            return;
+            logerror("Scripting", "Failed to prepare the context.");
+            m_engine->ReturnContext(ctx);
+            return NULL;
         }
+        return ctx;
+    }   // prepareContext
 
-        // Execute the function
-        r = ctx->Execute();
-        if (r != asEXECUTION_FINISHED)
+    //-----------------------------------------------------------------------------
+    /** Executes a prepared context, and logs the reason if the script did not
+    *  finish.
+    *  \return True if the script finished.
+    */
+    bool ScriptEngine::executeContext(asIScriptContext *ctx)
+    {
+        int r = ctx->Execute();
+        if (r == asEXECUTION_FINISHED)
+            return true;
+
+        // The execution didn't finish as we had planned. Determine why.
+        if (r == asEXECUTION_ABORTED)
         {
-            // The execution didn't finish as we had planned. Determine why.
-            if (r == asEXECUTION_ABORTED)
-            {
-                logerror("Scripting", "The script was aborted before it could finish. Probably it timed out.");
-            }
-            else if (r == asEXECUTION_EXCEPTION)
-            {
-                logerror("Scripting", "The script ended with an exception : (line %i) %s",
-                    ctx->GetExceptionLineNumber(), 
-                    ctx->GetExceptionString());
-            }
-            else
-            {
-                logerror("Scripting", "The script ended for some unforeseen reason (%i)", r);
-            }
+            logerror("Scripting", "The script was aborted before it could finish. Probably it timed out.");
+        }
+        else if (r == asEXECUTION_EXCEPTION)
+        {
+            logerror("Scripting", "The script ended with an exception : (line %i) %s",
+                ctx->GetExceptionLineNumber(),
+                ctx->GetExceptionString());
+        }
+        else
+        {
+            logerror("Scripting", "The script ended for some unforeseen reason (%i)", r);
         }
+        return false;
+    }   // executeContext
 
-        ctx->Release();
-    }
+    //-----------------------------------------------------------------------------
+    /** Returns a context to the pool once the return value (if any) was read.
+    */
+    void ScriptEngine::returnContext(asIScriptContext *ctx)
+    {
+        m_engine->ReturnContext(ctx);
+    }   // returnContext
 
     //-----------------------------------------------------------------------------
     
@@ -296,13 +383,49 @@ namespace Scripting
         std::function<void(asIScriptContext*)> callback,
         std::function<void(asIScriptContext*)> get_return_value)
     {
-        int r; //int for error checking
+        asIScriptFunction *func = getFunction(function_name, warn_if_not_found);
+        if (func == NULL)
+            return; // function unavailable
 
-        asIScriptFunction *func;
+        asIScriptContext *ctx = prepareContext(func);
+        if (ctx == NULL)
+            return;
+
+        // Here, we can pass parameters to the script functions. 
+        //ctx->setArgType(index, value);
+        //for example : ctx->SetArgFloat(0, 3.14159265359f);
+
+        if (callback)
+            callback(ctx);
 
-        // TODO: allow splitting in multiple files
-        std::string script_filename = "scripting.as";
-        auto cached_function = m_functions_cache.find(function_name);
+        // Execute the function
+        if (executeContext(ctx))
+        {
+            // Retrieve the return value from the context here (for scripts that return values)
+            // <type> returnValue = ctx->getReturnType(); for example
+            //float returnValue = ctx->GetReturnFloat();
+
+            if (get_return_value)
+                get_return_value(ctx);
+        }
+
+        // The context goes back into the pool
+        returnContext(ctx);
+    }
+
+    //-----------------------------------------------------------------------------
+    /** Returns the script function with the given declaration. The result
+    *  (including NULL if the function does not exist) is cached till the
+    *  scripts are compiled again or discarded.
+    *  \param declaration Declaration of the function, e.g. "void onStart()".
+    *  \param warn_if_not_found If a missing function should be warned about
+    *         (otherwise it is only logged in debug mode).
+    */
+    asIScriptFunction* ScriptEngine::getFunction(const std::string &declaration,
+                                                 bool warn_if_not_found)
+    {
+        asIScriptFunction *func;
+        auto cached_function = m_functions_cache.find(declaration);
         if (cached_function == m_functions_cache.end())
         {
             // Find the function for the function we want to execute.
@@ -313,114 +436,51 @@ namespace Scripting
             if (module == NULL)
             {
                 if (warn_if_not_found)
-                    logwarn("Scripting", "Scripting function was not found : %s (module not found)", function_name.c_str());
+                    logwarn("Scripting", "Scripting function was not found : %s (module not found)", declaration.c_str());
                 else
-                    logdebug("Scripting", "Scripting function was not found : %s (module not found)", function_name.c_str());
-                m_functions_cache[function_name] = NULL; // remember that this function is unavailable
-                return;
+                    logdebug("Scripting", "Scripting function was not found : %s (module not found)", declaration.c_str());
+                m_functions_cache[declaration] = NULL; // remember that this function is unavailable
+                return NULL;
             }
 
-            func = module->GetFunctionByDecl(function_name.c_str());
-            
+            func = module->GetFunctionByDecl(declaration.c_str());
+
             if (func == NULL)
             {
                 if (warn_if_not_found)
-                    logwarn("Scripting", "Scripting function was not found : %s", function_name.c_str());
+                    logwarn("Scripting", "Scripting function was not found : %s", declaration.c_str());
                 else
-                    logdebug("Scripting", "Scripting function was not found : %s", function_name.c_str());
-                m_functions_cache[function_name] = NULL; // remember that this function is unavailable
-                return;
+                    logdebug("Scripting", "Scripting function was not found : %s", declaration.c_str());
+                m_functions_cache[declaration] = NULL; // remember that this function is unavailable
+                return NULL;
             }
 
-            m_functions_cache[function_name] = func;
+            m_functions_cache[declaration] = func;
             func->AddRef();
         }
         else
         {
             // Script present in cache
             func = cached_function->second;
+            if (func == NULL && warn_if_not_found)
+                logwarn("Scripting", "Scripting function was not found : %s", declaration.c_str());
         }
+        return func;
+    }   // getFunction
 
-        if (func == NULL)
-        {
-            if (warn_if_not_found)
-                logwarn("Scripting", "Scripting function was not found : %s", function_name.c_str());
-            return; // function unavailable
-        }
-
-        // Create a context that will execute the script.
-        asIScriptContext *ctx = m_engine->CreateContext();
-        if (ctx == NULL)
-        {
-            logerror("Scripting", "Failed to create the context.");
-            //m_engine->Release();
-            return;
-        }
-
-        // Prepare the script context with the function we wish to execute. Prepare()
-        // must be called on the context before each new script function that will be
-        // executed. Note, that if because we intend to execute the same function 
-        // several times, we will store the function returned by 
-        // GetFunctionByDecl(), so that this relatively slow call can be skipped.
-        r = ctx->Prepare(func);
-        if (r < 0)
-        {
-            logerror("Scripting", "Failed to prepare the context.");
-            ctx->Release();
-            //m_engine->Release();
-            return;
-        }
-
-        // Here, we can pass parameters to the script functions. 
-        //ctx->setArgType(index, value);
-        //for example : ctx->SetArgFloat(0, 3.14159265359f);
-
-        if (callback)
-            callback(ctx);
-
-        // Execute the function
-        r = ctx->Execute();
-        if (r != asEXECUTION_FINISHED)
-        {
-            // The execution didn't finish as we had planned. Determine why.
-            if (r == asEXECUTION_ABORTED)
-            {
-                logerror("Scripting", "The script was aborted before it could finish. Probably it timed out.");
-            }
-            else if (r == asEXECUTION_EXCEPTION)
-            {
-                logerror("Scripting", "The script ended with an exception.");
-
-                // Write some information about the script exception
-                //asIScriptFunction *func = ctx->GetExceptionFunction();
-                //std::cout << "func: " << func->GetDeclaration() << std::endl;
-                //std::cout << "modl: " << func->GetModuleName() << std::endl;
-                //std::cout << "sect: " << func->GetScriptSectionName() << std::endl;
-                //std::cout << "line: " << ctx->GetExceptionLineNumber() << std::endl;
-                //std::cout << "desc: " << ctx->GetExceptionString() << std::endl;
-            }
-            else
-            {
-                logerror("Scripting", "The script ended for some unforeseen reason (%i)", r);
-            }
-        }
-        else
-        {
-            // Retrieve the return value from the context here (for scripts that return values)
-            // <type> returnValue = ctx->getReturnType(); for example
-            //float returnValue = ctx->GetReturnFloat();
-
-            if (get_return_value)
-                get_return_value(ctx);
-        }
+    //-----------------------------------------------------------------------------
 
-        // We must release the contexts when no longer using them
-        ctx->Release();
+    void ScriptEngine::cleanupCache()
+    {
+        clearFunctionsCache();
+        m_engine->DiscardModule(MODULE_ID_MAIN_SCRIPT_FILE);
     }
 
     //-----------------------------------------------------------------------------
-
-    void ScriptEngine::cleanupCache()
+    /** Releases all cached functions. This invalidates all functions stored
+    *  in ScriptCallback objects, which will look them up again.
+    */
+    void ScriptEngine::clearFunctionsCache()
     {
         for (auto curr : m_functions_cache)
         {
@@ -428,8 +488,8 @@ namespace Scripting
                 curr.second->Release();
         }
         m_functions_cache.clear();
-        m_engine->DiscardModule(MODULE_ID_MAIN_SCRIPT_FILE);
-    }
+        m_generation++;
+    }   // clearFunctionsCache
 
     //-----------------------------------------------------------------------------
     /** Configures the script engine by binding functions, enums
@@ -462,9 +522,16 @@ namespace Scripting
 
     //-----------------------------------------------------------------------------
 
+    /** Loads a script file. The script is only compiled (together with all
+    *  other loaded scripts) by compileLoadedScripts().
+    *  \param script_path Full path of the script file.
+    *  \param clear_previous If all scripts loaded before should be removed.
+    *  \return False if the file does not exist.
+    */
     bool ScriptEngine::loadScript(std::string script_path, bool clear_previous)
     {
-        int r;
+        if (clear_previous)
+            m_loaded_scripts.clear();
 
         std::string script = getScript(script_path);
         if (script.size() == 0)
@@ -473,29 +540,138 @@ namespace Scripting
             return false;
         }
 
-        // Add the script sections that will be compiled into executable code.
-        // If we want to combine more than one file into the same script, then 
-        // we can call AddScriptSection() several times for the same module and
-        // the script engine will treat them all as if they were one. The script
-        // section name, will allow us to localize any errors in the script code.
-        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE,
-            clear_previous ? asGM_ALWAYS_CREATE : asGM_CREATE_IF_NOT_EXISTS);
-        r = mod->AddScriptSection("script", &script[0], script.size());
-        if (r < 0)
-        {
-            logerror("Scripting", "AddScriptSection() failed");
-            return false;
-        }
-    
+        m_loaded_scripts.push_back(std::make_pair(script_path, script));
         return true;
     }
 
     //-----------------------------------------------------------------------------
+    /** Returns the name of the file in which the byte code of the currently
+    *  loaded scripts is cached, or "" if scripts should not be cached. The
+    *  name is a hash of the names and contents of all scripts and of the
+    *  AngelScript and STK versions, since the byte code depends on the
+    *  registered application interface.
+    */
+    std::string ScriptEngine::getByteCodeCacheName() const
+    {
+        if (!UserConfigParams::m_cache_scripts ||
+            file_manager->getCachedScriptsDir().empty())
+            return "";
+
+        std::string key = std::string(ANGELSCRIPT_VERSION_STRING) + "\n" +
+                          STK_VERSION + "\n";
+        for (unsigned int i = 0; i < m_loaded_scripts.size(); i++)
+            key += m_loaded_scripts[i].first + "\n" + m_loaded_scripts[i].second;
+        const uint64_t hash = Hash::fnv1a(key);
+
+        std::ostringstream oss;
+        oss << file_manager->getCachedScriptsDir() << std::hex << hash
+            << ".asbc";
+        return oss.str();
+    }   // getByteCodeCacheName
+
+    //-----------------------------------------------------------------------------
+    /** Loads the byte code of a module from the cache.
+    *  \param mod The (empty) module to load the byte code into.
+    *  \param name Name of the cache file.
+    *  \return True if the byte code was loaded.
+    */
+    bool ScriptEngine::loadByteCode(asIScriptModule *mod, const std::string &name)
+    {
+        FILE *file = fopen(name.c_str(), "rb");
+        if (!file)
+            return false;
 
+        char magic[sizeof(CACHED_BYTE_CODE_MAGIC)];
+        bool ok = fread(magic, sizeof(magic), 1, file) == 1 &&
+                  memcmp(magic, CACHED_BYTE_CODE_MAGIC, sizeof(magic)) == 0;
+        if (ok)
+        {
+            ByteCodeFile stream(file);
+            ok = mod->LoadByteCode(&stream) >= 0 && !stream.hasFailed();
+        }
+        fclose(file);
+        if (!ok)
+            logwarn("Scripting", "Can not load cached byte code '%s'.",
+                    name.c_str());
+        return ok;
+    }   // loadByteCode
+
+    //-----------------------------------------------------------------------------
+    /** Saves the byte code of a compiled module. Debug information is kept,
+    *  so that error messages still contain line numbers.
+    *  \param mod The compiled module.
+    *  \param name Name of the cache file.
+    */
+    void ScriptEngine::saveByteCode(asIScriptModule *mod, const std::string &name)
+    {
+        // Write to a temporary file first, so that an interrupted write
+        // can not leave a broken cache file.
+        const std::string tmp_name = name + ".tmp";
+        FILE *file = fopen(tmp_name.c_str(), "wb");
+        if (!file)
+            return;
+
+        bool ok = fwrite(CACHED_BYTE_CODE_MAGIC,
+                         sizeof(CACHED_BYTE_CODE_MAGIC), 1, file) == 1;
+        if (ok)
+        {
+            ByteCodeFile stream(file);
+            ok = mod->SaveByteCode(&stream, /*strip debug info*/false) >= 0 &&
+                 !stream.hasFailed();
+        }
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename(tmp_name.c_str(), name.c_str()) != 0)
+        {
+            remove(tmp_name.c_str());
+            logwarn("Scripting", "Can not write cached byte code '%s'.",
+                    name.c_str());
+        }
+    }   // saveByteCode
+
+    //-----------------------------------------------------------------------------
+    /** Compiles all scripts loaded with loadScript() into the main module.
+    *  If the same scripts were compiled before, the byte code is loaded from
+    *  the cache instead.
+    */
     bool ScriptEngine::compileLoadedScripts()
     {
         int r;
-        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_CREATE_IF_NOT_EXISTS);
+        clearFunctionsCache();
+
+        const std::string cache_name = m_loaded_scripts.empty()
+                                     ? "" : getByteCodeCacheName();
+        asIScriptModule *mod;
+        if (!cache_name.empty())
+        {
+            mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_ALWAYS_CREATE);
+            if (loadByteCode(mod, cache_name))
+            {
+                logdebug("Scripting", "Loaded cached byte code '%s'.",
+                         cache_name.c_str());
+                return true;
+            }
+        }
+
+        // Start again with an empty module, a failed LoadByteCode() can
+        // leave a partially loaded module.
+        mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_ALWAYS_CREATE);
+
+        // Add the script sections that will be compiled into executable code.
+        // If we want to combine more than one file into the same script, then 
+        // we can call AddScriptSection() several times for the same module and
+        // the script engine will treat them all as if they were one. The script
+        // section name, will allow us to localize any errors in the script code.
+        for (unsigned int i = 0; i < m_loaded_scripts.size(); i++)
+        {
+            const std::string &script = m_loaded_scripts[i].second;
+            r = mod->AddScriptSection(m_loaded_scripts[i].first.c_str(),
+                                      &script[0], script.size());
+            if (r < 0)
+            {
+                logerror("Scripting", "AddScriptSection() failed");
+                return false;
+            }
+        }
 
         // Compile the script. If there are any compiler messages they will
         // be written to the message stream that we set right after creating the 
@@ -518,6 +694,9 @@ namespace Scripting
         // scope, so function names, and global variables will not conflict with
         // each other.
 
+        if (!cache_name.empty())
+            saveByteCode(mod, cache_name);
+
         return true;
     }
 
@@ -569,11 +748,223 @@ namespace Scripting
                 }
                 else
                 {
-                    runFunction(true, "void " + curr.m_callback_name + "()");
+                    curr.m_callback();
                 }
 
                 m_pending_timeouts.erase(i);
             }
         }
     }
+
+    //-----------------------------------------------------------------------------
+    /** Measures the cost of calling a script function with two int arguments
+    *  (like onKartKartCollision): with a new context for each call, with
+    *  runFunction(), and with a ScriptCallback handle.
+    *  \param count Number of calls for each measurement.
+    */
+    void ScriptEngine::benchmark(int count)
+    {
+        const char *code = "int benchmark_sum = 0;\n"
+                           "void onBenchmark(int a, int b)\n"
+                           "{\n"
+                           "    benchmark_sum += a + b;\n"
+                           "}\n";
+        cleanupCache();
+        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE,
+                                                   asGM_ALWAYS_CREATE);
+        if (mod->AddScriptSection("benchmark", code) < 0 || mod->Build() < 0)
+        {
+            logerror("Scripting", "Can not compile the benchmark script.");
+            return;
+        }
+        clearFunctionsCache();
+
+        const std::string name = "onBenchmark";
+        asIScriptFunction *func = getFunction("void onBenchmark(int, int)",
+                                              /*warn*/true);
+        if (func == NULL)
+            return;
+
+        // A new context for each call, which is what all functions did
+        // before contexts were pooled.
+        double start = StkTime::getRealTime();
+        for (int i = 0; i < count; i++)
+        {
+            asIScriptContext *ctx = m_engine->CreateContext();
+            ctx->Prepare(func);
+            ctx->SetArgDWord(0, i);
+            ctx->SetArgDWord(1, 1);
+            ctx->Execute();
+            ctx->Release();
+        }
+        const double create_context = StkTime::getRealTime() - start;
+
+        // runFunction() with a declaration string built for each call
+        start = StkTime::getRealTime();
+        for (int i = 0; i < count; i++)
+        {
+            runFunction(true, "void " + name + "(int, int)",
+                [=](asIScriptContext* ctx) {
+                    ctx->SetArgDWord(0, i);
+                    ctx->SetArgDWord(1, 1);
+                });
+        }
+        const double run_function = StkTime::getRealTime() - start;
+
+        // A pre-resolved callback handle
+        ScriptCallback<int, int> callback(name);
+        start = StkTime::getRealTime();
+        for (int i = 0; i < count; i++)
+            callback(i, 1);
+        const double handle = StkTime::getRealTime() - start;
+
+        loginfo("Scripting", "%d calls: new context %.1f ns, runFunction() "
+                "%.1f ns, ScriptCallback %.1f ns per call, %d pooled "
+                "context(s).", count, create_context * 1.0e9 / count,
+                run_function * 1.0e9 / count, handle * 1.0e9 / count,
+                (int)m_context_pool.size());
+        cleanupCache();
+    }   // benchmark
+
+    //-----------------------------------------------------------------------------
+    /** Writes a zip file with a deflated script, mounts it like an addon
+    *  archive and checks that the script is read from the archive.
+    */
+    void ScriptEngine::unitTesting()
+    {
+        const std::string dir =
+            file_manager->createTemporaryDirectory("stk-script-test");
+        if (dir.empty())
+            return;
+
+        const std::string script = "void onStart()\n{\n    int a = 1;\n}\n";
+        std::vector<uint8_t> compressed(compressBound((uLong)script.size()));
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        // Negative window bits: raw deflate data as used in zip files
+        int result = deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED,
+                                  -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        assert(result == Z_OK);
+        stream.next_in   = (Bytef*)script.data();
+        stream.avail_in  = (uInt)script.size();
+        stream.next_out  = compressed.data();
+        stream.avail_out = (uInt)compressed.size();
+        result = deflate(&stream, Z_FINISH);
+        assert(result == Z_STREAM_END);
+        (void)result;   // avoid compiler warning with NDEBUG
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        const uint32_t crc = crc32(0, (const Bytef*)script.data(),
+                                   (uInt)script.size());
+
+        // The script is in a subdirectory of the archive, like in most
+        // addon archives
+        const std::string name = "track/scripting.as";
+        std::string zip;
+        auto put16 = [&zip](uint32_t v)
+        {
+            zip += (char)(v & 0xff);
+            zip += (char)((v >> 8) & 0xff);
+        };
+        auto put32 = [&zip, &put16](uint32_t v)
+        {
+            put16(v & 0xffff);
+            put16(v >> 16);
+        };
+        put32(0x04034b50);                       // local header
+        put16(20); put16(0); put16(8);           // version, flags, deflate
+        put16(0);  put16(0);                     // time, date
+        put32(crc); put32((uint32_t)compressed.size());
+        put32((uint32_t)script.size());
+        put16((uint32_t)name.size()); put16(0);
+        zip += name;
+        zip.append((const char*)compressed.data(), compressed.size());
+        const uint32_t cd_offset = (uint32_t)zip.size();
+        put32(0x02014b50);                       // central directory
+        put16(20); put16(20); put16(0); put16(8);
+        put16(0);  put16(0);
+        put32(crc); put32((uint32_t)compressed.size());
+        put32((uint32_t)script.size());
+        put16((uint32_t)name.size()); put16(0); put16(0);
+        put16(0); put16(0); put32(0);            // disk, attributes
+        put32(0);                                // offset of local header
+        zip += name;
+        const uint32_t cd_size = (uint32_t)zip.size() - cd_offset;
+        put32(0x06054b50);                       // end of central directory
+        put16(0); put16(0); put16(1); put16(1);
+        put32(cd_size); put32(cd_offset); put16(0);
+
+        const std::string archive = dir + "stk-addon.zip";
+        FILE *f = fopen(archive.c_str(), "wb");
+        assert(f);
+        fwrite(zip.data(), 1, zip.size(), f);
+        fclose(f);
+
+        // The mount directory does not exist, so the script can only be
+        // found in the archive
+        const std::string mount_dir = dir + "track/";
+        const bool mounted = file_manager->mountArchive(archive, mount_dir);
+        assert(mounted);
+        (void)mounted;   // avoid compiler warning with NDEBUG
+        assert(file_manager->fileExists(mount_dir + "scripting.as"));
+        assert(getScript(mount_dir + "scripting.as") == script);
+        // The second time the script is taken from the cache of the archive
+        assert(getScript(mount_dir + "scripting.as") == script);
+        assert(getScript(mount_dir + "missing.as").empty());
+        file_manager->unmountArchive(mount_dir);
+        assert(getScript(mount_dir + "scripting.as").empty());
+
+        file_manager->removeFile(archive);
+        file_manager->removeDirectory(dir);
+    }   // unitTesting
+
+    // ============================================================================
+    /** Sets the function of a callback.
+    *  \param name Name of the function, an empty name disables the callback.
+    *  \param args The comma separated AngelScript argument types.
+    *  \param warn_if_not_found If a warning should be printed (once) if the
+    *         scripts do not contain this function.
+    */
+    void ScriptCallbackBase::setDeclaration(const std::string &name,
+                                            const std::string &args,
+                                            bool warn_if_not_found)
+    {
+        m_declaration = name.empty() ? "" : "void " + name + "(" + args + ")";
+        m_function          = NULL;
+        m_generation        = 0;
+        m_warn_if_not_found = warn_if_not_found;
+    }   // setDeclaration
+
+    //-----------------------------------------------------------------------------
+    /** Looks up the function if the scripts have changed since the last
+    *  call, and returns a prepared context for it.
+    *  \return The context, or NULL if the function does not exist.
+    */
+    asIScriptContext* ScriptCallbackBase::prepare()
+    {
+        ScriptEngine *engine = ScriptEngine::getInstance();
+        if (m_declaration.empty() || engine == NULL)
+            return NULL;
+
+        if (m_generation != ScriptEngine::getGeneration())
+        {
+            m_function   = engine->getFunction(m_declaration,
+                                               m_warn_if_not_found);
+            m_generation = ScriptEngine::getGeneration();
+        }
+        if (m_function == NULL)
+            return NULL;
+        return engine->prepareContext(m_function);
+    }   // prepare
+
+    //-----------------------------------------------------------------------------
+    /** Executes a context returned by prepare() and puts it back into the
+    *  pool.
+    */
+    void ScriptCallbackBase::execute(asIScriptContext *ctx)
+    {
+        ScriptEngine *engine = ScriptEngine::getInstance();
+        engine->executeContext(ctx);
+        engine->returnContext(ctx);
+    }   // execute
 }
@@ -19,15 +19,18 @@
 #ifndef HEADER_SCRIPT_ENGINE_HPP
 #define HEADER_SCRIPT_ENGINE_HPP
 
+#include "scriptengine/script_callback.hpp"
 #include "scriptengine/script_utils.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/ptr_vector.hpp"
 #include "utils/singleton.hpp"
+#include "utils/types.hpp"
 
 #include <angelscript.h>
 #include <functional>
 #include <map>
 #include <string>
+#include <vector>
 
 class TrackObjectPresentation;
 
@@ -38,17 +41,17 @@ namespace Scripting
     {
         double m_time;
 
-        /** We have two callback types: a string containing the name of the function
-          * to call (simple callback) or a "TimeoutBase" object (advanced callback)
+        /** We have two callback types: the name of the function to call
+          * (simple callback) or a "TimeoutBase" object (advanced callback)
           */
-        std::string m_callback_name;
+        ScriptCallback<> m_callback;
         asIScriptFunction* m_callback_delegate;
 
         PendingTimeout(double time, const std::string& callback_name)
         {
             m_callback_delegate = NULL;
             m_time = time;
-            m_callback_name = callback_name;
+            m_callback.set(callback_name);
         }
 
         PendingTimeout(double time, asIScriptFunction* callback_delegate);
@@ -84,14 +87,50 @@ namespace Scripting
         void addPendingTimeout(double time, asIScriptFunction* delegate_fn);
         void update(double dt);
 
+        asIScriptFunction* getFunction(const std::string &declaration,
+                                       bool warn_if_not_found);
+        asIScriptContext* prepareContext(asIScriptFunction *func);
+        bool executeContext(asIScriptContext *ctx);
+        void returnContext(asIScriptContext *ctx);
+        void benchmark(int count);
+        static void unitTesting();
+
         asIScriptEngine* getEngine() { return m_engine; }
 
+        /** Returns a number that changes each time scripts are compiled or
+         *  discarded, i.e. each time cached script functions become invalid.
+         */
+        static unsigned int getGeneration() { return m_generation; }
+
     private:
         asIScriptEngine *m_engine;
         std::map<std::string, asIScriptFunction*> m_functions_cache;
         PtrVector<PendingTimeout> m_pending_timeouts;
 
+        /** Contexts which are not used at the moment. Creating a context is
+         *  expensive, so the engine requests contexts from this pool. */
+        std::vector<asIScriptContext*> m_context_pool;
+
+        /** The script sections loaded with loadScript() which will be
+         *  compiled by compileLoadedScripts(): file name and content. */
+        std::vector<std::pair<std::string, std::string> > m_loaded_scripts;
+
+        /** Hash of the names and contents of all loaded scripts, used to
+         *  find the cached byte code. */
+        uint64_t m_loaded_scripts_hash;
+
+        /** See getGeneration(). */
+        static unsigned int m_generation;
+
         void configureEngine(asIScriptEngine *engine);
+        void clearFunctionsCache();
+        std::string getByteCodeCacheName() const;
+        bool loadByteCode(asIScriptModule *mod, const std::string &name);
+        void saveByteCode(asIScriptModule *mod, const std::string &name);
+        static asIScriptContext* requestContextCallback(asIScriptEngine *engine,
+                                                        void *param);
+        static void returnContextCallback(asIScriptEngine *engine,
+                                          asIScriptContext *ctx, void *param);
     };   // class ScriptEngine
 
 }
@@ -26,6 +26,7 @@
 #include "tracks/check_line.hpp"
 #include "tracks/check_manager.hpp"
 #include "tracks/drive_node.hpp"
+#include "tracks/racing_line.hpp"
 #include "tracks/track.hpp"
 
 // ----------------------------------------------------------------------------
@@ -42,8 +43,15 @@ DriveGraph::DriveGraph(const std::string &quad_file_name,
     m_quad_filename = quad_file_name;
     Graph::setGraph(this);
     load(quad_file_name, graph_file_name);
+    m_racing_line = new RacingLine(this);
 }   // DriveGraph
 
+// ----------------------------------------------------------------------------
+DriveGraph::~DriveGraph()
+{
+    delete m_racing_line;
+}   // ~DriveGraph
+
 // ----------------------------------------------------------------------------
 void DriveGraph::addSuccessor(unsigned int from, unsigned int to)
 {
@@ -29,6 +29,7 @@
 #include "LinearMath/btTransform.h"
 
 class DriveNode;
+class RacingLine;
 class XMLNode;
 
 /**
@@ -47,6 +48,9 @@ private:
     /** Wether the graph should be reverted or not */
     bool m_reverse;
 
+    /** Precomputed data for the AI, created after loading the graph. */
+    RacingLine *m_racing_line;
+
     // ------------------------------------------------------------------------
     void setDefaultSuccessors();
     // ------------------------------------------------------------------------
@@ -79,7 +83,7 @@ public:
     DriveGraph(const std::string &quad_file_name,
                const std::string &graph_file_name, const bool reverse);
     // ------------------------------------------------------------------------
-    virtual ~DriveGraph() {}
+    virtual ~DriveGraph();
     // ------------------------------------------------------------------------
     void getSuccessors(int node_number, std::vector<unsigned int>& succ,
                        bool for_ai=false) const;
@@ -119,6 +123,9 @@ public:
     float getLapLength() const                         { return m_lap_length; }
     // ------------------------------------------------------------------------
     bool isReverse() const                                { return m_reverse; }
+    // ------------------------------------------------------------------------
+    /** Returns the precomputed racing line and look-ahead data. */
+    const RacingLine* getRacingLine() const           { return m_racing_line; }
 
 };   // DriveGraph
 
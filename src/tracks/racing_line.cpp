@@ -0,0 +1,179 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "tracks/racing_line.hpp"
+
+#include "tracks/drive_graph.hpp"
+#include "tracks/drive_node.hpp"
+
+#include <line2d.h>
+
+/** Maximum number of nodes tested when looking for the furthest visible
+ *  node, to make sure that the search ends on very straight tracks. */
+static const unsigned int MAX_LOOK_AHEAD = 100;
+
+/** Number of smoothing iterations for the racing line. */
+static const unsigned int NUM_SMOOTHING_STEPS = 100;
+
+/** The racing line keeps this fraction of the track width from the edges. */
+static const float EDGE_MARGIN = 0.15f;
+
+// ----------------------------------------------------------------------------
+/** Computes all data from the drive graph.
+ *  \param graph The drive graph of the current track.
+ */
+RacingLine::RacingLine(const DriveGraph *graph)
+{
+    const unsigned int n = graph->getNumNodes();
+    m_left.resize(n);
+    m_right.resize(n);
+    m_successor.resize(n, -1);
+
+    // In reverse mode the karts drive from the upper to the lower end of a
+    // quad, so left and right are swapped as well.
+    const int left_index  = graph->isReverse() ? 2 : 0;
+    const int right_index = graph->isReverse() ? 3 : 1;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const DriveNode *node = graph->getNode(i);
+        m_left[i]  = (*node)[left_index];
+        m_right[i] = (*node)[right_index];
+        if (node->getNumberOfSuccessors() > 0)
+            m_successor[i] = node->getSuccessor(0);
+    }
+
+    m_furthest_visible.resize(n * NUM_OFFSETS);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = 0; j < NUM_OFFSETS; j++)
+        {
+            m_furthest_visible[i * NUM_OFFSETS + j] =
+                computeFurthestVisible(i, j / (float)(NUM_OFFSETS - 1));
+        }
+    }
+
+    computeRacingLine();
+}   // RacingLine
+
+// ----------------------------------------------------------------------------
+/** Returns the furthest node that can be reached in a straight line from a
+ *  point on the start edge of a node. The area that can be reached is a
+ *  corridor between a left and a right line, which is narrowed down by the
+ *  edges of the following nodes till the lines cross.
+ *  \param node The node on whose start edge the point is.
+ *  \param fraction Position of the point on the start edge, 0 is the left
+ *         and 1 the right end point.
+ */
+int RacingLine::computeFurthestVisible(unsigned int node, float fraction) const
+{
+    int last_node = m_successor[node];
+    if (last_node < 0) return node;
+
+    const Vec3 start = m_left[node] + (m_right[node] - m_left[node])*fraction;
+    const core::vector2df xz = start.toIrrVector2d();
+    core::line2df left (xz, m_left [last_node].toIrrVector2d());
+    core::line2df right(xz, m_right[last_node].toIrrVector2d());
+
+    for (unsigned int i = 0; i < MAX_LOOK_AHEAD; i++)
+    {
+        const int next = m_successor[last_node];
+        if (next < 0) break;
+
+        core::vector2df p = m_left[next].toIrrVector2d();
+        if (left.getPointOrientation(p) >= 0 ||
+            right.getPointOrientation(p) < 0)
+            break;
+        left.end = p;
+
+        p = m_right[next].toIrrVector2d();
+        if (right.getPointOrientation(p) <= 0 ||
+            left.getPointOrientation(p) > 0)
+            break;
+        right.end = p;
+
+        last_node = next;
+    }
+    return last_node;
+}   // computeFurthestVisible
+
+// ----------------------------------------------------------------------------
+/** Computes the racing line. Each point starts in the middle of the start
+ *  edge of its node, and is then repeatedly moved to the point on the edge
+ *  that is closest to the middle of its predecessor and successor point.
+ *  This straightens the line, which then cuts the corners.
+ */
+void RacingLine::computeRacingLine()
+{
+    const unsigned int n = (unsigned int)m_left.size();
+    std::vector<int> predecessor(n, -1);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        if (m_successor[i] >= 0 && predecessor[m_successor[i]] < 0)
+            predecessor[m_successor[i]] = i;
+    }
+
+    m_line.resize(n);
+    for (unsigned int i = 0; i < n; i++)
+        m_line[i] = (m_left[i] + m_right[i]) * 0.5f;
+
+    for (unsigned int step = 0; step < NUM_SMOOTHING_STEPS; step++)
+    {
+        for (unsigned int i = 0; i < n; i++)
+        {
+            if (predecessor[i] < 0 || m_successor[i] < 0) continue;
+            const Vec3 target = (m_line[predecessor[i]] +
+                                 m_line[m_successor[i]]) * 0.5f;
+            float f = getEdgeFraction(i, target);
+            if (f < EDGE_MARGIN)        f = EDGE_MARGIN;
+            else if (f > 1-EDGE_MARGIN) f = 1-EDGE_MARGIN;
+            m_line[i] = m_left[i] + (m_right[i] - m_left[i]) * f;
+        }
+    }
+}   // computeRacingLine
+
+// ----------------------------------------------------------------------------
+/** Projects a point onto the start edge of a node, and returns its position
+ *  on the edge: 0 is the left and 1 the right end point (the result is not
+ *  clamped).
+ *  \param node The node.
+ *  \param xyz The point to project.
+ */
+float RacingLine::getEdgeFraction(unsigned int node, const Vec3 &xyz) const
+{
+    const Vec3 edge = m_right[node] - m_left[node];
+    const float length2 = edge.length2();
+    if (length2 <= 0.0f) return 0.5f;
+    return (xyz - m_left[node]).dot(edge) / length2;
+}   // getEdgeFraction
+
+// ----------------------------------------------------------------------------
+/** Returns the furthest node that can be reached in a straight line from a
+ *  position in a node. The position is projected onto the start edge of the
+ *  node, and the precomputed value for the closest sampled position is used.
+ *  \param node The node the position is in.
+ *  \param xyz The position.
+ */
+int RacingLine::getFurthestVisibleNode(unsigned int node,
+                                       const Vec3 &xyz) const
+{
+    float f = getEdgeFraction(node, xyz);
+    if (f < 0) f = 0;
+    else if (f > 1) f = 1;
+    const unsigned int offset = (unsigned int)(f * (NUM_OFFSETS - 1) + 0.5f);
+    return m_furthest_visible[node * NUM_OFFSETS + offset];
+}   // getFurthestVisibleNode
@@ -0,0 +1,74 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_RACING_LINE_HPP
+#define HEADER_RACING_LINE_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
+
+#include <vector>
+
+class DriveGraph;
+
+/**
+  * \brief Track data for the AI that only depends on the drive graph.
+  *  For each node the start edge (in driving direction, so it takes
+  *  reverse mode into account) is sampled at NUM_OFFSETS positions, and
+  *  for each of these positions the furthest node is stored that can be
+  *  reached in a straight line without leaving the track (using the same
+  *  corridor test as SkiddingAI::findNonCrashingPointNew). Additionally a
+  *  smoothed racing line is computed, which contains one point on the start
+  *  edge of each node. All data follows the main driveline (successor 0),
+  *  and is computed once when the drive graph is loaded.
+  * \ingroup tracks
+  */
+class RacingLine : public NoCopy
+{
+public:
+    /** Number of sampled positions on the start edge of each node. */
+    static const unsigned int NUM_OFFSETS = 5;
+
+private:
+    /** Left and right end point of the start edge of each node. */
+    std::vector<Vec3> m_left;
+    std::vector<Vec3> m_right;
+
+    /** The successor on the main driveline of each node, or -1. */
+    std::vector<int> m_successor;
+
+    /** NUM_OFFSETS entries for each node: the furthest node visible from
+     *  the corresponding position on the start edge. */
+    std::vector<int> m_furthest_visible;
+
+    /** One point of the racing line for each node. */
+    std::vector<Vec3> m_line;
+
+    int   computeFurthestVisible(unsigned int node, float fraction) const;
+    void  computeRacingLine();
+    float getEdgeFraction(unsigned int node, const Vec3 &xyz) const;
+
+public:
+         RacingLine(const DriveGraph *graph);
+    int  getFurthestVisibleNode(unsigned int node, const Vec3 &xyz) const;
+    // ------------------------------------------------------------------------
+    /** Returns the point of the racing line on the start edge of a node. */
+    const Vec3& getPoint(unsigned int node) const { return m_line[node]; }
+};   // RacingLine
+
+#endif
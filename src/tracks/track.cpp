@@ -77,6 +77,8 @@
 #include <SMeshBuffer.h>
 
 #include <iostream>
+#include <map>
+#include <set>
 #include <stdexcept>
 #include <sstream>
 #include <wchar.h>
@@ -89,7 +91,12 @@ bool        Track::m_dont_load_navmesh = false;
 Track      *Track::m_current_track = NULL;
 
 // ----------------------------------------------------------------------------
-Track::Track(const std::string &filename)
+/** Creates a track and reads the basic track information.
+ *  \param filename Name of the track.xml file.
+ *  \param xml_root Optional, the already parsed content of the track.xml
+ *         file. The caller keeps ownership of this node.
+ */
+Track::Track(const std::string &filename, const XMLNode *xml_root)
 {
 #ifdef DEBUG
     m_magic_number          = 0x17AC3802;
@@ -153,7 +160,7 @@ Track::Track(const std::string &filename)
     m_all_nodes.clear();
     m_static_physics_only_nodes.clear();
     m_all_cached_meshes.clear();
-    loadTrackInfo();
+    loadTrackInfo(xml_root);
 }   // Track
 
 //-----------------------------------------------------------------------------
@@ -293,7 +300,14 @@ void Track::cleanup()
     Graph::destroy();
     ItemManager::destroy();
 #ifndef SERVER_ONLY
-    VAOManager::kill();
+    // The space of the track meshes in the VAOManager is freed when their
+    // scene nodes are removed, and reused by the next track. Ranges of
+    // meshes that were deleted without releasing them are freed here.
+    if (VAOManager::isCreated())
+    {
+        VAOManager::getInstance()->releaseUnusedBases();
+        VAOManager::getInstance()->printStatistics();
+    }
     ParticleKindManager::get()->cleanUpTrackSpecificGfx();
 #endif
 
@@ -470,7 +484,10 @@ void Track::cleanup()
 }   // cleanup
 
 //-----------------------------------------------------------------------------
-void Track::loadTrackInfo()
+/** Reads the basic track information from the track.xml file.
+ *  \param xml_root If not NULL, the already parsed track.xml file.
+ */
+void Track::loadTrackInfo(const XMLNode *xml_root)
 {
     // Default values
     m_use_fog               = false;
@@ -493,11 +510,12 @@ void Track::loadTrackInfo()
     irr_driver->setSSAORadius(1.);
     irr_driver->setSSAOK(1.5);
     irr_driver->setSSAOSigma(1.);
-    XMLNode *root           = file_manager->createXMLTree(m_filename);
+    const XMLNode *root     = xml_root ? xml_root
+                                       : file_manager->createXMLTree(m_filename);
 
     if(!root || root->getName()!="track")
     {
-        delete root;
+        if(root!=xml_root) delete root;
         std::ostringstream o;
         o<<"Can't load track '"<<m_filename<<"', no track element.";
         throw std::runtime_error(o.str());
@@ -572,7 +590,7 @@ void Track::loadTrackInfo()
 
     // Set the correct paths
     m_screenshot = m_root+m_screenshot;
-    delete root;
+    if(root!=xml_root) delete root;
 
     std::string dir = StringUtils::getPath(m_filename);
     std::string easter_name = dir + "/easter_eggs.xml";
@@ -1620,6 +1638,9 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     file_manager->pushTextureSearchPath(m_root, unique_id);
     file_manager->pushModelSearchPath(m_root);
 
+    // If the track is an addon archive, decompress all its files in parallel
+    file_manager->preloadArchive(m_root);
+
     // First read the temporary materials.xml file if it exists
     try
     {
@@ -1914,8 +1935,38 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         easter_world->readData(dir+"/easter_eggs.xml");
     }
 
+    file_manager->releasePreloadedArchive(m_root);
     STKTexManager::getInstance()->unsetTextureErrorMessage();
 #ifndef SERVER_ONLY
+    if (CVS->isGLSL() && CVS->isARBBaseInstanceUsable())
+    {
+        // Make the buffers of the VAOManager large enough for all track
+        // meshes now, instead of growing (and copying) them while the track
+        // is drawn for the first time.
+        std::map<video::E_VERTEX_TYPE, std::pair<size_t, size_t> > totals;
+        std::set<scene::IMeshBuffer*> counted;
+        for (unsigned int i = 0; i < m_all_cached_meshes.size(); i++)
+        {
+            scene::IMesh *mesh = m_all_cached_meshes[i];
+            for (unsigned int j = 0; j < mesh->getMeshBufferCount(); j++)
+            {
+                scene::IMeshBuffer *mb = mesh->getMeshBuffer(j);
+                if (!mb || !counted.insert(mb).second)
+                    continue;
+                std::pair<size_t, size_t> &total =
+                    totals[mb->getVertexType()];
+                total.first  += mb->getVertexCount();
+                total.second += mb->getIndexCount();
+            }
+        }
+        std::map<video::E_VERTEX_TYPE,
+                 std::pair<size_t, size_t> >::const_iterator it;
+        for (it = totals.begin(); it != totals.end(); it++)
+        {
+            VAOManager::getInstance()->reserve(it->first, it->second.first,
+                                               it->second.second);
+        }
+    }
     if (CVS->isGLSL())
     {
         for (video::ITexture* t : m_sky_textures)
@@ -21,7 +21,9 @@
 #include "config/stk_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "io/file_manager.hpp"
+#include "io/scan_index.hpp"
 #include "tracks/track.hpp"
+#include "utils/job_system.hpp"
 
 #include <algorithm>
 #include <iostream>
@@ -132,7 +134,9 @@ std::vector<std::string> TrackManager::getAllTrackIdentifiers()
 }   // getAllTrackNames
 
 //-----------------------------------------------------------------------------
-/** Loads all tracks from the track directory (data/track).
+/** Loads all tracks from the track directory (data/track). The directories
+ *  containing tracks are taken from the scan index, then all track.xml
+ *  files are parsed in parallel before the tracks are created.
  */
 void TrackManager::loadTrackList()
 {
@@ -146,33 +150,40 @@ void TrackManager::loadTrackList()
     m_track_avail.clear();
     m_tracks.clear();
 
+    // Either the directory itself contains a track, or any of its subdirs
+    std::vector<std::string> track_dirs;
+    ScanIndex *scan_index = file_manager->getScanIndex();
     for(unsigned int i=0; i<m_track_search_path.size(); i++)
     {
         const std::string &dir = m_track_search_path[i];
+        std::vector<std::string> found;
+        scan_index->findContentDirs(dir, "track.xml", &found);
+        for(unsigned int j=0; j<found.size(); j++)
+            track_dirs.push_back(found[j].empty() ? dir : dir+found[j]+"/");
+    }   // for i <m_track_search_path.size()
+    scan_index->save();
 
-        // First test if the directory itself contains a track:
-        // ----------------------------------------------------
-        if(loadTrack(dir)) continue;  // track found, no more tests
+    const int count = (int)track_dirs.size();
+    std::vector<XMLNode*> roots(count, (XMLNode*)NULL);
+    JobSystem::get()->parallelFor(count, [&roots, &track_dirs](int i)
+    {
+        roots[i] = file_manager->createXMLTree(track_dirs[i]+"track.xml");
+    });
 
-        // Then see if a subdir of this dir contains tracks
-        // ------------------------------------------------
-        std::set<std::string> dirs;
-        file_manager->listFiles(dirs, dir);
-        for(std::set<std::string>::iterator subdir = dirs.begin();
-            subdir != dirs.end(); subdir++)
-        {
-            if(*subdir=="." || *subdir=="..") continue;
-            loadTrack(dir+*subdir+"/");
-        }   // for dir in dirs
-    }   // for i <m_track_search_path.size()
+    for(int i=0; i<count; i++)
+    {
+        loadTrack(track_dirs[i], roots[i]);
+        delete roots[i];
+    }
 }  // loadTrackList
 
 // ----------------------------------------------------------------------------
 /** Tries to load a track from a single directory. Returns true if a track was
  *  successfully loaded.
  *  \param dirname Name of the directory to load the track from.
+ *  \param root Optional, the already parsed track.xml file.
  */
-bool TrackManager::loadTrack(const std::string& dirname)
+bool TrackManager::loadTrack(const std::string& dirname, const XMLNode *root)
 {
     std::string config_file = dirname+"track.xml";
     if(!file_manager->fileExists(config_file))
@@ -182,7 +193,7 @@ bool TrackManager::loadTrack(const std::string& dirname)
 
     try
     {
-        track = new Track(config_file);
+        track = new Track(config_file, root);
     }
     catch (std::exception& e)
     {
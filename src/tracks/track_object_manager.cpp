@@ -52,7 +52,10 @@ void TrackObjectManager::add(const XMLNode &xml_node, scene::ISceneNode* parent,
         TrackObject *obj = new TrackObject(xml_node, parent, model_def_loader, parent_library);
         m_all_objects.push_back(obj);
         if(obj->isDriveable())
+        {
             m_driveable_objects.push_back(obj);
+            addToDriveableTree(obj);
+        }
     }
     catch (std::exception& e)
     {
@@ -61,6 +64,16 @@ void TrackObjectManager::add(const XMLNode &xml_node, scene::ISceneNode* parent,
     }
 }   // add
 
+// ----------------------------------------------------------------------------
+/** Adds a driveable object to the raycast tree. Objects without physical
+ *  body are tested by each raycast (which then prints a warning).
+ */
+void TrackObjectManager::addToDriveableTree(TrackObject *object)
+{
+    PhysicalObject *po = object->getPhysicalObject();
+    m_driveable_tree.addObject(po ? po->getBody() : NULL);
+}   // addToDriveableTree
+
 // ----------------------------------------------------------------------------
 /** Initialises all track objects.
  */
@@ -70,7 +83,8 @@ void TrackObjectManager::init()
     {
         curr->onWorldReady();
     }
-}   // reset
+    m_driveable_tree.refit(0);
+}   // init
 // ----------------------------------------------------------------------------
 /** Initialises all track objects.
  */
@@ -81,6 +95,7 @@ void TrackObjectManager::reset()
         curr->reset();
         curr->resetEnabled();
     }
+    m_driveable_tree.refit(0);
 }   // reset
 // ----------------------------------------------------------------------------
 /** returns a reference to the track object
@@ -148,13 +163,18 @@ void TrackObjectManager::update(float dt)
     {
         curr->update(dt);
     }
+    // The physics step of this frame was done before the track is updated,
+    // so the boxes now match the positions used by raycasts until the next
+    // physics step, and they include the movement in that step.
+    m_driveable_tree.refit(dt);
 }   // update
 
 // ----------------------------------------------------------------------------
 /** Does a raycast against all driveable objects. This way part of the track
  *  can be a physical object, and can e.g. be animated. A separate list of all
  *  driveable objects is maintained (in one case there were over 2000 bodies,
- *  but only one is driveable). The result of the raycast against the track
+ *  but only one is driveable), and only the objects whose bounding box is
+ *  hit by the ray are tested. The result of the raycast against the track
  *  mesh are the input parameter. It is then tested if the raycast against 
  *  a track object gives a 'closer' result. If so, the parameters hit_point,
  *  normal, and material will be updated.
@@ -182,26 +202,36 @@ void TrackObjectManager::castRay(const btVector3 &from,
     {
         distance = hit_point->distance(from);
     }
-    for (const TrackObject* curr : m_driveable_objects)
+    // The objects are not tested in the order of m_driveable_objects, so if
+    // two objects are hit at the same distance the one with the lower index
+    // is used (which is the one that was used when all objects were tested
+    // in order).
+    int hit_index = -1;
+    auto test = [&](unsigned int i)
     {
         btVector3 new_hit_point;
         const Material *new_material;
         btVector3 new_normal;
-        if(curr->castRay(from, to, &new_hit_point, &new_material, &new_normal,
-                      interpolate_normal))
+        if(m_driveable_objects[i].castRay(from, to, &new_hit_point,
+                                          &new_material, &new_normal,
+                                          interpolate_normal))
         {
             float new_distance = new_hit_point.distance(from);
             // If the new hit is closer than the current hit, save
             // the data.
-            if (new_distance < distance)
+            if (new_distance < distance ||
+                (new_distance == distance && hit_index > (int)i))
             {
                 *material  = new_material;
                 *hit_point = new_hit_point;
-                *normal    = new_normal;
+                if (normal)
+                    *normal = new_normal;
                 distance   = new_distance;
+                hit_index  = i;
             }   // if new_distance < distance
         }   // if hit
-    }   // for all track objects.
+    };
+    m_driveable_tree.rayTest(from, to, test);
 }   // castRay
 
 // ----------------------------------------------------------------------------
@@ -285,6 +315,13 @@ void TrackObjectManager::insertObject(TrackObject* object)
 void TrackObjectManager::removeObject(TrackObject* obj)
 {
     m_all_objects.remove(obj);
+    if (m_driveable_objects.contains(obj))
+    {
+        m_driveable_objects.remove(obj);
+        m_driveable_tree.clear();
+        for (TrackObject* curr : m_driveable_objects)
+            addToDriveableTree(curr);
+    }
     delete obj;
 }   // removeObject
 
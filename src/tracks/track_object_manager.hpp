@@ -20,6 +20,7 @@
 #define HEADER_TRACK_OBJECT_MANAGER_HPP
 
 #include "physics/physical_object.hpp"
+#include "physics/raycast_tree.hpp"
 #include "tracks/track_object.hpp"
 #include "utils/ptr_vector.hpp"
 
@@ -51,6 +52,12 @@ protected:
     /** A second list which holds all objects that karts can drive on. */
     PtrVector<TrackObject, REF> m_driveable_objects;
 
+    /** The bodies of the driveable objects (in the same order), so that a
+     *  raycast only tests the objects it can hit. */
+    RaycastTree m_driveable_tree;
+
+    void addToDriveableTree(TrackObject *object);
+
 public:
          TrackObjectManager();
         ~TrackObjectManager();
@@ -0,0 +1,59 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_HASH_HPP
+#define HEADER_HASH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/** The 64 bit FNV-1a hash, which is used to name and validate the files in
+ *  the various caches. It is not a cryptographic hash.
+ */
+namespace Hash
+{
+    /** The hash of no data. */
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+    // ------------------------------------------------------------------------
+    /** Adds data to a hash.
+     *  \param data The data to add.
+     *  \param size Number of bytes.
+     *  \param previous The hash of the previous data. */
+    inline uint64_t fnv1a(const void *data, size_t size,
+                          uint64_t previous = FNV_OFFSET_BASIS)
+    {
+        const uint8_t *p = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++)
+            previous = (previous ^ p[i]) * 1099511628211ULL;
+        return previous;
+    }   // fnv1a
+
+    // ------------------------------------------------------------------------
+    /** Adds a string to a hash.
+     *  \param s The string to add.
+     *  \param previous The hash of the previous data. */
+    inline uint64_t fnv1a(const std::string &s,
+                          uint64_t previous = FNV_OFFSET_BASIS)
+    {
+        return fnv1a(s.data(), s.size(), previous);
+    }   // fnv1a
+}   // namespace Hash
+
+#endif
@@ -0,0 +1,314 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/job_system.hpp"
+
+#include "utils/log.hpp"
+#include "utils/vs.hpp"
+
+#include <algorithm>
+#if defined(WIN32)
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+JobSystem *JobSystem::m_job_system = NULL;
+
+/** How many jobs each thread gets per parallelFor() call. More jobs than
+ *  threads allow a better load balance through stealing. */
+static const int JOBS_PER_THREAD = 4;
+
+// ----------------------------------------------------------------------------
+/** Creates the singleton.
+ *  \param num_workers Number of worker threads to start. If negative, one
+ *         worker for each additional CPU core is started. 0 means that all
+ *         jobs are executed in the calling thread.
+ */
+JobSystem *JobSystem::create(int num_workers)
+{
+    assert(!m_job_system);
+    if (num_workers < 0)
+    {
+        long cores = 1;
+#if defined(WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        cores = info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+        cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        num_workers = cores > 1 ? (int)cores - 1 : 0;
+    }
+    m_job_system = new JobSystem(num_workers);
+    return m_job_system;
+}   // create
+
+// ----------------------------------------------------------------------------
+/** Destroys the singleton, which stops all worker threads. */
+void JobSystem::destroy()
+{
+    delete m_job_system;
+    m_job_system = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+/** Starts the worker threads.
+ *  \param num_workers Number of worker threads.
+ */
+JobSystem::JobSystem(unsigned int num_workers)
+{
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_jobs_available, NULL);
+    pthread_cond_init(&m_jobs_done, NULL);
+    m_generation = 0;
+    m_abort      = false;
+    m_pending    = 0;
+    m_num_jobs   = 0;
+    m_num_steals = 0;
+    m_num_calls  = 0;
+
+    for (unsigned int i = 0; i <= num_workers; i++)
+    {
+        Queue *queue = new Queue();
+        pthread_mutex_init(&queue->m_mutex, NULL);
+        queue->m_job_system = this;
+        queue->m_index      = i;
+        m_queues.push_back(queue);
+        // Queue 0 is used by the thread calling parallelFor
+        if (i == 0) continue;
+
+        if (pthread_create(&queue->m_thread, NULL, &JobSystem::mainLoop,
+                           queue))
+        {
+            logerror("JobSystem", "Could not create worker thread, "
+                     "using %d threads.", i);
+            pthread_mutex_destroy(&queue->m_mutex);
+            delete queue;
+            m_queues.pop_back();
+            break;
+        }
+    }
+    loginfo("JobSystem", "Using %d thread(s) for jobs.", (int)m_queues.size());
+}   // JobSystem
+
+// ----------------------------------------------------------------------------
+/** Stops and joins all worker threads. */
+JobSystem::~JobSystem()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_abort = true;
+    pthread_cond_broadcast(&m_jobs_available);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (unsigned int i = 0; i < m_queues.size(); i++)
+    {
+        if (i > 0)
+            pthread_join(m_queues[i]->m_thread, NULL);
+        pthread_mutex_destroy(&m_queues[i]->m_mutex);
+        delete m_queues[i];
+    }
+    m_queues.clear();
+
+    pthread_cond_destroy(&m_jobs_done);
+    pthread_cond_destroy(&m_jobs_available);
+    pthread_mutex_destroy(&m_mutex);
+}   // ~JobSystem
+
+// ----------------------------------------------------------------------------
+/** Gets the next job for a thread: the last job of its own queue, or if
+ *  this queue is empty, the first job of any other queue.
+ *  \param index Index of the queue of the thread.
+ *  \param job On return the job to execute.
+ *  \return False if no job was found.
+ */
+bool JobSystem::getJob(unsigned int index, Job *job)
+{
+    Queue *own = m_queues[index];
+    pthread_mutex_lock(&own->m_mutex);
+    if (!own->m_jobs.empty())
+    {
+        *job = own->m_jobs.back();
+        own->m_jobs.pop_back();
+        pthread_mutex_unlock(&own->m_mutex);
+        return true;
+    }
+    pthread_mutex_unlock(&own->m_mutex);
+
+    // Try to steal from the other queues, starting with the next one
+    // so that not all threads try to steal from the same queue.
+    const unsigned int n = (unsigned int)m_queues.size();
+    for (unsigned int i = 1; i < n; i++)
+    {
+        Queue *victim = m_queues[(index + i) % n];
+        pthread_mutex_lock(&victim->m_mutex);
+        if (!victim->m_jobs.empty())
+        {
+            *job = victim->m_jobs.front();
+            victim->m_jobs.pop_front();
+            pthread_mutex_unlock(&victim->m_mutex);
+            m_num_steals++;
+            return true;
+        }
+        pthread_mutex_unlock(&victim->m_mutex);
+    }
+    return false;
+}   // getJob
+
+// ----------------------------------------------------------------------------
+/** Executes a job, and wakes up the thread waiting in parallelFor() if this
+ *  was the last job.
+ */
+void JobSystem::executeJob(const Job &job)
+{
+    for (int i = job.m_first; i < job.m_last; i++)
+        (*job.m_function)(i);
+    m_num_jobs++;
+
+    if (--m_pending == 0)
+    {
+        pthread_mutex_lock(&m_mutex);
+        pthread_cond_signal(&m_jobs_done);
+        pthread_mutex_unlock(&m_mutex);
+    }
+}   // executeJob
+
+// ----------------------------------------------------------------------------
+/** The main loop of a worker thread: waits for new jobs, and then executes
+ *  jobs (its own or stolen ones) till no more jobs are available.
+ *  \param obj The queue of this worker thread.
+ */
+void *JobSystem::mainLoop(void *obj)
+{
+    Queue *queue = (Queue*)obj;
+    JobSystem *me = queue->m_job_system;
+    VS::setThreadName("JobSystem");
+
+    unsigned int generation = 0;
+    while (true)
+    {
+        pthread_mutex_lock(&me->m_mutex);
+        while (!me->m_abort && me->m_generation == generation)
+            pthread_cond_wait(&me->m_jobs_available, &me->m_mutex);
+        generation = me->m_generation;
+        bool abort = me->m_abort;
+        pthread_mutex_unlock(&me->m_mutex);
+        if (abort) break;
+
+        Job job;
+        while (me->getJob(queue->m_index, &job))
+            me->executeJob(job);
+    }
+    return NULL;
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Calls f(i) for all 0 <= i < count, distributed over all threads, and
+ *  returns when all calls are done. The order in which the calls are done
+ *  is undefined, so f must not depend on other calls of the same loop.
+ *  \param count Number of indices.
+ *  \param f The function to call for each index.
+ */
+void JobSystem::parallelFor(int count, const std::function<void(int)> &f)
+{
+    if (count <= 0) return;
+    m_num_calls++;
+
+    const int num_threads = (int)m_queues.size();
+    if (num_threads == 1 || count == 1)
+    {
+        for (int i = 0; i < count; i++)
+            f(i);
+        return;
+    }
+
+    assert(m_pending == 0);
+    const int num_jobs = std::min(count, num_threads*JOBS_PER_THREAD);
+    m_pending = num_jobs;
+    for (int j = 0; j < num_jobs; j++)
+    {
+        Job job;
+        job.m_function = &f;
+        job.m_first    = (int)((long long)count * j       / num_jobs);
+        job.m_last     = (int)((long long)count * (j + 1) / num_jobs);
+        Queue *queue = m_queues[j % num_threads];
+        pthread_mutex_lock(&queue->m_mutex);
+        queue->m_jobs.push_back(job);
+        pthread_mutex_unlock(&queue->m_mutex);
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    m_generation++;
+    pthread_cond_broadcast(&m_jobs_available);
+    pthread_mutex_unlock(&m_mutex);
+
+    // The calling thread helps executing jobs
+    Job job;
+    while (getJob(0, &job))
+        executeJob(job);
+
+    // Wait for jobs still executed by worker threads
+    pthread_mutex_lock(&m_mutex);
+    while (m_pending > 0)
+        pthread_cond_wait(&m_jobs_done, &m_mutex);
+    pthread_mutex_unlock(&m_mutex);
+}   // parallelFor
+
+// ----------------------------------------------------------------------------
+/** Returns statistics about the job system.
+ *  \param calls Number of parallelFor() calls.
+ *  \param jobs Number of jobs executed by several threads.
+ *  \param steals Number of jobs that were stolen from another thread.
+ */
+void JobSystem::getStatistics(uint64_t *calls, uint64_t *jobs,
+                              uint64_t *steals) const
+{
+    *calls  = m_num_calls;
+    *jobs   = m_num_jobs;
+    *steals = m_num_steals;
+}   // getStatistics
+
+// ----------------------------------------------------------------------------
+/** Tests that parallelFor() calls the function exactly once for each index,
+ *  and that the result is identical for any number of threads.
+ */
+void JobSystem::unitTesting()
+{
+    std::vector<int> reference;
+    for (int workers = 0; workers < 4; workers++)
+    {
+        JobSystem job_system(workers);
+        for (int count = 0; count < 100; count += 7)
+        {
+            std::vector<int> result(count, 0);
+            job_system.parallelFor(count, [&result](int i)
+                                          {
+                                              result[i] += i*i + 1;
+                                          });
+            for (int i = 0; i < count; i++)
+                assert(result[i] == i*i + 1);
+            if (count == 98)
+            {
+                if (workers == 0)
+                    reference = result;
+                else
+                    assert(result == reference);
+            }
+        }
+    }
+}   // unitTesting
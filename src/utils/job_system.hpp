@@ -0,0 +1,132 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_JOB_SYSTEM_HPP
+#define HEADER_JOB_SYSTEM_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <assert.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <pthread.h>
+#include <vector>
+
+/**
+  * \brief A small work-stealing job scheduler.
+  *  The job system owns a fixed number of worker threads. parallelFor()
+  *  splits an index range into jobs, which are distributed over the queues
+  *  of all threads (including the calling thread, which helps executing
+  *  jobs). Each thread takes jobs from the back of its own queue, and if
+  *  its queue is empty steals jobs from the front of the other queues.
+  *  If the job system has no worker threads, all jobs are executed in the
+  *  calling thread in index order.
+  *  parallelFor() must only be called from one thread at a time, and the
+  *  jobs must not call parallelFor() again.
+  * \ingroup utils
+  */
+class JobSystem : public NoCopy
+{
+private:
+    /** A job: a contiguous sub-range of a parallelFor() call. */
+    struct Job
+    {
+        const std::function<void(int)> *m_function;
+        int m_first;
+        int m_last;
+    };   // Job
+
+    /** The job queue of one thread. Index 0 is used by the thread calling
+     *  parallelFor(), the other entries belong to the worker threads. */
+    struct Queue
+    {
+        pthread_mutex_t  m_mutex;
+        std::deque<Job>  m_jobs;
+        pthread_t        m_thread;
+        JobSystem       *m_job_system;
+        unsigned int     m_index;
+    };   // Queue
+
+    /** The singleton. */
+    static JobSystem *m_job_system;
+
+    /** All queues, the first one belongs to the calling thread. */
+    std::vector<Queue*> m_queues;
+
+    /** Protects m_generation and m_abort, and is used with the condition
+     *  variables below. */
+    pthread_mutex_t m_mutex;
+
+    /** Signaled when new jobs are available. */
+    pthread_cond_t m_jobs_available;
+
+    /** Signaled when the last job of a parallelFor() call is done. */
+    pthread_cond_t m_jobs_done;
+
+    /** Increased each time new jobs are queued, so that workers can
+     *  detect new work. */
+    unsigned int m_generation;
+
+    /** Set to stop all worker threads. */
+    bool m_abort;
+
+    /** Number of jobs of the current parallelFor() call not yet done. */
+    std::atomic<int> m_pending;
+
+    /** Statistics: number of executed and of stolen jobs. */
+    std::atomic<uint64_t> m_num_jobs, m_num_steals;
+
+    /** Statistics: number of parallelFor() calls. */
+    uint64_t m_num_calls;
+
+         JobSystem(unsigned int num_workers);
+        ~JobSystem();
+    bool getJob(unsigned int index, Job *job);
+    void executeJob(const Job &job);
+    static void *mainLoop(void *obj);
+
+public:
+    static JobSystem *create(int num_workers);
+    static void       destroy();
+    static void       unitTesting();
+    void parallelFor(int count, const std::function<void(int)> &f);
+    void getStatistics(uint64_t *calls, uint64_t *jobs,
+                       uint64_t *steals) const;
+    // ------------------------------------------------------------------------
+    /** Returns the singleton. This function will not automatically create
+     *  the singleton. */
+    static JobSystem *get()
+    {
+        assert(m_job_system);
+        return m_job_system;
+    }   // get
+    // ------------------------------------------------------------------------
+    /** Returns true if the job system exists. */
+    static bool isCreated() { return m_job_system != NULL; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of threads executing jobs (including the thread
+     *  calling parallelFor()). */
+    unsigned int getNumThreads() const
+    {
+        return (unsigned int)m_queues.size();
+    }   // getNumThreads
+};   // JobSystem
+
+#endif
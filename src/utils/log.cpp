@@ -19,9 +19,20 @@
 #include "utils/log.hpp"
 
 #include "config/user_config.hpp"
+#include "io/file_manager.hpp"
+#include "utils/synchronised.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdio>
+#include <ctime>
+#include <cwchar>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <thread>
+#include <vector>
 
 #ifdef ANDROID
 #  include <android/log.h>
@@ -34,6 +45,12 @@
 
 #if defined(_MSC_VER)
 #include "tchar.h"
+#else
+#  define _vtprintf   vprintf
+#  define _vftprintf  vfprintf
+#  define _vsntprintf vsnprintf
+#  define _sntprintf  snprintf
+#  define _tfopen     fopen
 #endif
 
 #if !defined(TEXT)
@@ -77,6 +94,604 @@ std::wstring s2ws(std::string s)
 Log::LogLevel Log::m_min_log_level = Log::LL_VERBOSE;
 bool          Log::m_no_colors     = false;
 FILE*         Log::m_file_stdout   = NULL;
+std::atomic<FILE*> Log::m_file_trace(NULL);
+std::atomic<bool>  Log::m_async(false);
+std::atomic<int>   Log::m_num_rate_limits(0);
+
+namespace
+{
+    /** Number of entries in the asynchronous message queue. Must be a
+     *  power of 2. */
+    const unsigned int LOG_QUEUE_SIZE = 1024;
+
+    /** Number of bytes stored in an entry itself: the format and arguments
+     *  of a message, or the data of a trace record. Larger data is stored
+     *  in allocated memory, which is freed by the writer thread. */
+    const unsigned int LOG_ENTRY_SIZE = 480;
+
+    /** Maximum length of a component name in the queue and in the rate
+     *  limits. */
+    const unsigned int LOG_COMPONENT_SIZE = 32;
+
+    /** Maximum number of components with a rate limit. */
+    const unsigned int MAX_RATE_LIMITS = 16;
+
+    /** One entry in the lock-free queue. This is a bounded multi-producer
+     *  queue: m_sequence is used to hand over an entry from a producer to
+     *  the writer thread and back, so no mutex is needed for queueing. */
+    struct LogEntry
+    {
+        std::atomic<uint32_t> m_sequence;
+        int                   m_level;
+        /** Trace record type, or 0 for a text message. */
+        uint16_t              m_trace_type;
+        uint32_t              m_size;
+        uint64_t              m_time;
+        irr::fschar_t         m_component[LOG_COMPONENT_SIZE];
+        /** The data if it does not fit into m_data, otherwise NULL. */
+        char                 *m_heap;
+        char                  m_data[LOG_ENTRY_SIZE];
+        // --------------------------------------------------------------------
+        /** Returns the data of this entry. */
+        char *getData() { return m_heap ? m_heap : m_data; }
+    };   // LogEntry
+
+    LogEntry             *g_log_queue = NULL;
+    std::atomic<uint32_t> g_enqueue_pos(0);
+    uint32_t              g_dequeue_pos = 0;
+
+    /** Number of threads that might be writing into the queue. The queue
+     *  is only freed once this is 0 with asynchronous logging disabled. */
+    std::atomic<int>      g_num_producers(0);
+
+    /** Used to wake up the writer thread when it is idle. */
+    pthread_mutex_t       g_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t        g_writer_cond  = PTHREAD_COND_INITIALIZER;
+    std::atomic<bool>     g_writer_idle(false);
+    std::atomic<bool>     g_writer_quit(false);
+    pthread_t             g_writer_thread;
+
+    /** Protects adding rate limits, and the trace file. */
+    pthread_mutex_t       g_rate_mutex  = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_t       g_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    /** Statistics. */
+    std::atomic<uint64_t> g_num_queued(0);
+    std::atomic<uint64_t> g_num_overflows(0);
+    std::atomic<uint64_t> g_num_suppressed(0);
+
+    /** Per component rate limit: at most m_per_second messages of the
+     *  component are printed in each second, the rest is counted and
+     *  reported once the next second starts. Entries are only added (and
+     *  m_component is not changed afterwards), so they can be read without
+     *  a lock. The counters are atomics, since all threads update them. */
+    struct RateLimit
+    {
+        irr::fschar_t         m_component[LOG_COMPONENT_SIZE];
+        /** Messages per second, negative if the limit was removed. */
+        std::atomic<int>      m_per_second;
+        std::atomic<int>      m_count;
+        std::atomic<int>      m_suppressed;
+        std::atomic<int64_t>  m_second;
+    };   // RateLimit
+
+    RateLimit g_rate_limits[MAX_RATE_LIMITS];
+
+    /** Returns a monotonic time stamp in microseconds. */
+    uint64_t getTraceTime()
+    {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(
+                      steady_clock::now().time_since_epoch()).count();
+    }   // getTraceTime
+
+    // ------------------------------------------------------------------------
+    /** Returns true if two component names are equal. */
+    bool isSameComponent(const irr::fschar_t *a, const irr::fschar_t *b)
+    {
+        for (unsigned int i = 0; i < LOG_COMPONENT_SIZE; i++)
+        {
+            if (a[i] != b[i]) return false;
+            if (!a[i])        return true;
+        }
+        return false;
+    }   // isSameComponent
+
+    // ------------------------------------------------------------------------
+    /** Creates an empty queue. */
+    void createQueue()
+    {
+        g_log_queue = new LogEntry[LOG_QUEUE_SIZE];
+        for (unsigned int i = 0; i < LOG_QUEUE_SIZE; i++)
+            g_log_queue[i].m_sequence.store(i, std::memory_order_relaxed);
+        g_enqueue_pos.store(0);
+        g_dequeue_pos = 0;
+    }   // createQueue
+
+    // ------------------------------------------------------------------------
+    /** Wakes up the writer thread if it is idle. */
+    void wakeWriter()
+    {
+        if (g_writer_idle.load(std::memory_order_acquire))
+        {
+            pthread_mutex_lock(&g_writer_mutex);
+            pthread_cond_signal(&g_writer_cond);
+            pthread_mutex_unlock(&g_writer_mutex);
+        }
+    }   // wakeWriter
+
+    // ------------------------------------------------------------------------
+    /** Reserves the next free entry in the queue. Returns NULL if the queue
+     *  is full. */
+    LogEntry* reserveEntry(uint32_t *pos)
+    {
+        uint32_t p = g_enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            LogEntry *entry = &g_log_queue[p & (LOG_QUEUE_SIZE - 1)];
+            uint32_t seq = entry->m_sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)seq - (int32_t)p;
+            if (diff == 0)
+            {
+                if (g_enqueue_pos.compare_exchange_weak(p, p + 1,
+                                                std::memory_order_relaxed))
+                {
+                    *pos = p;
+                    return entry;
+                }
+            }
+            else if (diff < 0)
+                return NULL;   // queue is full
+            else
+                p = g_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }   // reserveEntry
+
+    // ------------------------------------------------------------------------
+    /** Reserves the next free entry in the queue. If the queue is full, the
+     *  calling thread waits till the writer thread has printed a message,
+     *  so that messages are never printed out of order. */
+    LogEntry* reserveEntryWaiting(uint32_t *pos)
+    {
+        LogEntry *entry = reserveEntry(pos);
+        if (entry) return entry;
+        g_num_overflows++;
+        do
+        {
+            wakeWriter();
+            std::this_thread::yield();
+            entry = reserveEntry(pos);
+        } while (!entry);
+        return entry;
+    }   // reserveEntryWaiting
+
+    // ------------------------------------------------------------------------
+    /** Hands a filled entry over to the writer thread, and wakes the writer
+     *  thread up if it is idle. */
+    void publishEntry(LogEntry *entry, uint32_t pos)
+    {
+        entry->m_sequence.store(pos + 1, std::memory_order_release);
+        g_num_queued++;
+        wakeWriter();
+    }   // publishEntry
+
+    // ------------------------------------------------------------------------
+    /** Returns the oldest published entry, or NULL if there is none. Only
+     *  one thread (the writer) may take entries out of the queue. */
+    LogEntry* peekEntry()
+    {
+        LogEntry *entry = &g_log_queue[g_dequeue_pos & (LOG_QUEUE_SIZE - 1)];
+        uint32_t seq = entry->m_sequence.load(std::memory_order_acquire);
+        if ((int32_t)seq - (int32_t)(g_dequeue_pos + 1) < 0)
+            return NULL;   // queue is empty
+        return entry;
+    }   // peekEntry
+
+    // ------------------------------------------------------------------------
+    /** Hands the entry returned by peekEntry back to the producers, and frees
+     *  its data if it was allocated. */
+    void releaseEntry(LogEntry *entry)
+    {
+        delete [] entry->m_heap;
+        entry->m_heap = NULL;
+        entry->m_sequence.store(g_dequeue_pos + LOG_QUEUE_SIZE,
+                                std::memory_order_release);
+        g_dequeue_pos++;
+    }   // releaseEntry
+
+    // ------------------------------------------------------------------------
+    /** Copies data into an entry, into allocated memory if it does not fit
+     *  into the entry. */
+    void setEntryData(LogEntry *entry, const void *data, size_t size)
+    {
+        entry->m_heap = size > LOG_ENTRY_SIZE ? new char[size] : NULL;
+        entry->m_size = (uint32_t)size;
+        memcpy(entry->getData(), data, size);
+    }   // setEntryData
+
+    // ========================================================================
+    /** A buffer for the format and the arguments of a message. It uses a
+     *  fixed array for the usual small messages, and allocates memory only
+     *  for long ones. */
+    class ArgumentBuffer
+    {
+    private:
+        char              m_fixed[LOG_ENTRY_SIZE];
+        std::vector<char> m_large;
+        size_t            m_size;
+    public:
+        ArgumentBuffer() : m_size(0) {}
+        // --------------------------------------------------------------------
+        void append(const void *data, size_t size)
+        {
+            if (m_large.empty() && m_size + size <= LOG_ENTRY_SIZE)
+            {
+                memcpy(m_fixed + m_size, data, size);
+            }
+            else
+            {
+                if (m_large.empty())
+                    m_large.assign(m_fixed, m_fixed + m_size);
+                m_large.insert(m_large.end(), (const char*)data,
+                               (const char*)data + size);
+            }
+            m_size += size;
+        }   // append
+        // --------------------------------------------------------------------
+        template<typename T> void appendValue(T value)
+        {
+            append(&value, sizeof(T));
+        }   // appendValue
+        // --------------------------------------------------------------------
+        const char *getData() const
+        {
+            return m_large.empty() ? m_fixed : &m_large[0];
+        }   // getData
+        // --------------------------------------------------------------------
+        size_t getSize() const { return m_size; }
+    };   // ArgumentBuffer
+
+    // ========================================================================
+    /** Reads the values that ArgumentBuffer stored. */
+    class ArgumentReader
+    {
+    private:
+        const char *m_data;
+        const char *m_end;
+    public:
+        ArgumentReader(const char *data, size_t size)
+            : m_data(data), m_end(data + size) {}
+        // --------------------------------------------------------------------
+        template<typename T> T readValue()
+        {
+            T value;
+            assert(m_data + sizeof(T) <= m_end);
+            memcpy(&value, m_data, sizeof(T));
+            m_data += sizeof(T);
+            return value;
+        }   // readValue
+        // --------------------------------------------------------------------
+        /** Returns a pointer to the next n bytes, and skips them. */
+        const char *skip(size_t n)
+        {
+            const char *p = m_data;
+            assert(m_data + n <= m_end);
+            m_data += n;
+            return p;
+        }   // skip
+    };   // ArgumentReader
+
+    // ========================================================================
+    /** A conversion specification of a printf format, i.e. the part of the
+     *  format from '%' up to and including the conversion character. */
+    struct FormatSpec
+    {
+        /** Length modifier: 0, 'h', 'H' (hh), 'l', 'q' (ll), 'L', 'j',
+         *  'z' or 't'. */
+        char          m_length;
+        irr::fschar_t m_conversion;
+        /** True if the width or the precision is an int argument ('*'). */
+        bool          m_width_star, m_precision_star;
+        /** The precision if it is part of the format, otherwise -1. */
+        int           m_precision;
+        /** Points after the conversion character. */
+        const irr::fschar_t *m_end;
+    };   // FormatSpec
+
+    // ------------------------------------------------------------------------
+    /** Parses the conversion specification that starts at p, which points
+     *  to the character after the '%'. */
+    void parseFormatSpec(const irr::fschar_t *p, FormatSpec *spec)
+    {
+        spec->m_length         = 0;
+        spec->m_width_star     = false;
+        spec->m_precision_star = false;
+        spec->m_precision      = -1;
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+            p++;
+        if (*p == '*')
+        {
+            spec->m_width_star = true;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') p++;
+        if (*p == '.')
+        {
+            p++;
+            if (*p == '*')
+            {
+                spec->m_precision_star = true;
+                p++;
+            }
+            else
+            {
+                spec->m_precision = 0;
+                while (*p >= '0' && *p <= '9')
+                    spec->m_precision = spec->m_precision * 10 + (*p++ - '0');
+            }
+        }
+        switch (*p)
+        {
+        case 'h': p++; spec->m_length = 'h';
+                  if (*p == 'h') { p++; spec->m_length = 'H'; }
+                  break;
+        case 'l': p++; spec->m_length = 'l';
+                  if (*p == 'l') { p++; spec->m_length = 'q'; }
+                  break;
+        case 'L': case 'j': case 'z': case 't':
+                  spec->m_length = (char)*p++; break;
+        case 'I':   // Microsoft: I64, I32 and I (size_t)
+            if (p[1] == '6' && p[2] == '4')      { p += 3; spec->m_length = 'q'; }
+            else if (p[1] == '3' && p[2] == '2') { p += 3; }
+            else                                 { p++;    spec->m_length = 'z'; }
+            break;
+        default: break;
+        }
+        spec->m_conversion = *p;
+        spec->m_end        = *p ? p + 1 : p;
+    }   // parseFormatSpec
+
+    // ------------------------------------------------------------------------
+    /** Stores a string argument (with its length), or a marker for NULL. At
+     *  most max_length characters are stored if max_length is not negative,
+     *  since with a precision the string does not need to be 0 terminated. */
+    template<typename C>
+    void storeString(const C *s, int max_length, ArgumentBuffer *buffer)
+    {
+        if (!s)
+        {
+            buffer->appendValue<uint32_t>(0xffffffff);
+            return;
+        }
+        uint32_t n = 0;
+        while ((max_length < 0 || n < (uint32_t)max_length) && s[n]) n++;
+        buffer->appendValue<uint32_t>(n);
+        buffer->append(s, n * sizeof(C));
+    }   // storeString
+
+    // ------------------------------------------------------------------------
+    /** Stores a copy of the format and of all arguments it uses in a buffer,
+     *  so that the message can be formatted later, when the arguments (e.g.
+     *  the c_str() of a temporary string) do not exist anymore. The
+     *  arguments are read from args, so the caller must pass a copy if it
+     *  needs them again.
+     */
+    void storeArguments(const irr::fschar_t *format, VALIST args,
+                        ArgumentBuffer *buffer)
+    {
+        uint32_t length = 0;
+        while (format[length]) length++;
+        buffer->appendValue<uint32_t>(length);
+        buffer->append(format, (length + 1) * sizeof(irr::fschar_t));
+
+        for (const irr::fschar_t *p = format; *p; )
+        {
+            if (*p++ != '%') continue;
+            FormatSpec spec;
+            parseFormatSpec(p, &spec);
+            p = spec.m_end;
+            if (spec.m_width_star)
+                buffer->appendValue<int>(va_arg(args, int));
+            int precision = spec.m_precision;
+            if (spec.m_precision_star)
+            {
+                precision = va_arg(args, int);
+                buffer->appendValue<int>(precision);
+            }
+            switch (spec.m_conversion)
+            {
+            case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+                switch (spec.m_length)
+                {
+                case 'l': buffer->appendValue(va_arg(args, long));      break;
+                case 'q': buffer->appendValue(va_arg(args, long long)); break;
+                case 'j': buffer->appendValue(va_arg(args, intmax_t));  break;
+                case 'z': buffer->appendValue(va_arg(args, size_t));    break;
+                case 't': buffer->appendValue(va_arg(args, ptrdiff_t)); break;
+                default:  buffer->appendValue(va_arg(args, int));       break;
+                }
+                break;
+            case 'c':
+                if (spec.m_length == 'l')
+                    buffer->appendValue(va_arg(args, wint_t));
+                else
+                    buffer->appendValue(va_arg(args, int));
+                break;
+            case 'e': case 'E': case 'f': case 'F':
+            case 'g': case 'G': case 'a': case 'A':
+                if (spec.m_length == 'L')
+                    buffer->appendValue(va_arg(args, long double));
+                else
+                    buffer->appendValue(va_arg(args, double));
+                break;
+            case 's':
+                if (spec.m_length == 'l')
+                    storeString(va_arg(args, const wchar_t*), precision,
+                                buffer);
+                else if (spec.m_length == 'h')
+                    storeString(va_arg(args, const char*), precision, buffer);
+                else
+                    storeString(va_arg(args, const irr::fschar_t*), precision,
+                                buffer);
+                break;
+            case 'p':
+                buffer->appendValue(va_arg(args, void*));
+                break;
+            case 'n':
+                // Nothing is written into the argument
+                va_arg(args, void*);
+                break;
+            default:
+                // '%%', or an unknown conversion which is printed as it is
+                break;
+            }
+        }
+    }   // storeArguments
+
+    // ------------------------------------------------------------------------
+    /** Appends a value formatted with a conversion specification. */
+    template<typename T>
+    void appendFormatted(std::basic_string<irr::fschar_t> *out,
+                         const irr::fschar_t *spec, T value)
+    {
+        irr::fschar_t fixed[256];
+        int n = _sntprintf(fixed, 256, spec, value);
+        if (n >= 0 && n < 256)
+        {
+            out->append(fixed, n);
+            return;
+        }
+        // Only long strings (or huge widths) get here
+        std::vector<irr::fschar_t> large;
+        for (size_t size = 4096; size <= (1 << 24); size *= 4)
+        {
+            large.resize(size);
+            n = _sntprintf(&large[0], size, spec, value);
+            if (n >= 0 && (size_t)n < size)
+            {
+                out->append(&large[0], n);
+                return;
+            }
+        }
+    }   // appendFormatted
+
+    // ------------------------------------------------------------------------
+    /** Appends a string that was stored with storeString. */
+    template<typename C>
+    void appendString(std::basic_string<irr::fschar_t> *out,
+                      const irr::fschar_t *spec, ArgumentReader *reader)
+    {
+        uint32_t n = reader->readValue<uint32_t>();
+        if (n == 0xffffffff)
+        {
+            appendFormatted(out, spec, (const C*)NULL);
+            return;
+        }
+        std::basic_string<C> s(n, 0);
+        if (n > 0)
+            memcpy(&s[0], reader->skip(n * sizeof(C)), n * sizeof(C));
+        appendFormatted(out, spec, s.c_str());
+    }   // appendString
+
+    // ------------------------------------------------------------------------
+    /** Formats a message from the format and arguments stored by
+     *  storeArguments.
+     */
+    void formatArguments(const char *data, size_t size,
+                         std::basic_string<irr::fschar_t> *out)
+    {
+        ArgumentReader reader(data, size);
+        const uint32_t length = reader.readValue<uint32_t>();
+        const irr::fschar_t *format =
+            (const irr::fschar_t*)reader.skip((length + 1)
+                                              * sizeof(irr::fschar_t));
+        std::basic_string<irr::fschar_t> spec_string;
+        for (const irr::fschar_t *p = format; *p; )
+        {
+            if (*p != '%')
+            {
+                const irr::fschar_t *start = p;
+                while (*p && *p != '%') p++;
+                out->append(start, p - start);
+                continue;
+            }
+            FormatSpec spec;
+            parseFormatSpec(p + 1, &spec);
+            // Copy the specification, with the '*' replaced by the values
+            spec_string.clear();
+            for (const irr::fschar_t *q = p; q < spec.m_end; q++)
+            {
+                if (*q != '*')
+                {
+                    spec_string.push_back(*q);
+                    continue;
+                }
+                char number[16];
+                snprintf(number, 16, "%d", reader.readValue<int>());
+                for (const char *c = number; *c; c++)
+                    spec_string.push_back(*c);
+            }
+            p = spec.m_end;
+            const irr::fschar_t *s = spec_string.c_str();
+            switch (spec.m_conversion)
+            {
+            case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+                switch (spec.m_length)
+                {
+                case 'l': appendFormatted(out, s, reader.readValue<long>());
+                          break;
+                case 'q': appendFormatted(out, s,
+                                          reader.readValue<long long>());
+                          break;
+                case 'j': appendFormatted(out, s,
+                                          reader.readValue<intmax_t>());
+                          break;
+                case 'z': appendFormatted(out, s, reader.readValue<size_t>());
+                          break;
+                case 't': appendFormatted(out, s,
+                                          reader.readValue<ptrdiff_t>());
+                          break;
+                default:  appendFormatted(out, s, reader.readValue<int>());
+                          break;
+                }
+                break;
+            case 'c':
+                if (spec.m_length == 'l')
+                    appendFormatted(out, s, reader.readValue<wint_t>());
+                else
+                    appendFormatted(out, s, reader.readValue<int>());
+                break;
+            case 'e': case 'E': case 'f': case 'F':
+            case 'g': case 'G': case 'a': case 'A':
+                if (spec.m_length == 'L')
+                    appendFormatted(out, s, reader.readValue<long double>());
+                else
+                    appendFormatted(out, s, reader.readValue<double>());
+                break;
+            case 's':
+                if (spec.m_length == 'l')
+                    appendString<wchar_t>(out, s, &reader);
+                else if (spec.m_length == 'h')
+                    appendString<char>(out, s, &reader);
+                else
+                    appendString<irr::fschar_t>(out, s, &reader);
+                break;
+            case 'p':
+                appendFormatted(out, s, reader.readValue<void*>());
+                break;
+            case 'n':
+                break;
+            case '%':
+                out->push_back('%');
+                break;
+            default:
+                // Unknown conversion: print it as it is
+                out->append(spec_string);
+                break;
+            }
+        }
+    }   // formatArguments
+}   // namespace
 
 // ----------------------------------------------------------------------------
 /** Selects background/foreground colors for the message depending on
@@ -165,8 +780,10 @@ void Log::resetTerminalColor()
 }   // resetTerminalColor
 
 // ----------------------------------------------------------------------------
-/** This actually prints the log message. If log messages are not redirected
- *  to a file, it tries to select a terminal colour.
+/** Prints a log message. Depending on the settings the message is either
+ *  printed immediately, or queued to be formatted and printed by the writer
+ *  thread. Messages of components that have exceeded their rate limit are
+ *  discarded.
  *  \param level Log level of the message to print.
  *  \param format A printf-like format string.
  *  \param va_list The values to be printed for the format.
@@ -178,6 +795,385 @@ void Log::printMessage(int level, const irr::fschar_t *component, const irr::fsc
 
     if(level<m_min_log_level) return;
 
+    if (level < LL_WARN && m_num_rate_limits.load() > 0 &&
+        !checkRateLimit(component))
+        return;
+
+    outputMessage(level, component, format, args);
+}   // printMessage
+
+// ----------------------------------------------------------------------------
+/** Prints a message immediately, or queues it in asynchronous mode. Rate
+ *  limits are not checked.
+ */
+void Log::outputMessage(int level, const irr::fschar_t *component,
+                        const irr::fschar_t *format, VALIST args)
+{
+    // The program is aborted after a fatal message, so print all queued
+    // messages first, and then the fatal message immediately.
+    if (level == LL_FATAL)
+    {
+        stopAsync();
+        printMessageNow(level, component, format, args);
+        return;
+    }
+
+    // Counting this thread as producer first keeps stopAsync from
+    // freeing the queue between the test of m_async and queueing.
+    g_num_producers++;
+    if (m_async.load())
+    {
+        queueMessage(level, component, format, args);
+        g_num_producers--;
+        return;
+    }
+    g_num_producers--;
+    printMessageNow(level, component, format, args);
+}   // outputMessage
+
+// ----------------------------------------------------------------------------
+/** Prints or queues a message without checking the rate limits. */
+void Log::output(int level, const irr::fschar_t *component,
+                 const irr::fschar_t *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    outputMessage(level, component, format, args);
+    va_end(args);
+}   // output
+
+// ----------------------------------------------------------------------------
+/** Prints a message immediately, independent of the asynchronous mode. */
+void Log::printNow(int level, const irr::fschar_t *component,
+                   const irr::fschar_t *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    printMessageNow(level, component, format, args);
+    va_end(args);
+}   // printNow
+
+// ----------------------------------------------------------------------------
+/** Puts a message into the queue for the writer thread. Only the format and
+ *  the arguments are copied, the writer thread formats the message. If the
+ *  queue is full, this waits till there is space, so that messages are
+ *  always printed in the order in which they were logged.
+ */
+void Log::queueMessage(int level, const irr::fschar_t *component,
+                       const irr::fschar_t *format, VALIST args)
+{
+    ArgumentBuffer buffer;
+    VALIST copy;
+    va_copy(copy, args);
+    storeArguments(format, copy, &buffer);
+    va_end(copy);
+
+    uint32_t pos;
+    LogEntry *entry = reserveEntryWaiting(&pos);
+    entry->m_level      = level;
+    entry->m_trace_type = 0;
+    unsigned int i;
+    for (i = 0; i < LOG_COMPONENT_SIZE - 1 && component[i]; i++)
+        entry->m_component[i] = component[i];
+    entry->m_component[i] = 0;
+    setEntryData(entry, buffer.getData(), buffer.getSize());
+    publishEntry(entry, pos);
+}   // queueMessage
+
+// ----------------------------------------------------------------------------
+/** Checks if a message of the given component can be printed, or if the
+ *  rate limit for this component is exceeded. This does not lock anything,
+ *  each limit only uses atomic counters.
+ *  \param component The component of the message.
+ *  \param second The current time in seconds, or -1 to use the monotonic
+ *         clock (the time is only read if the component has a limit).
+ */
+bool Log::checkRateLimit(const irr::fschar_t *component, int64_t second)
+{
+    const int num_limits = m_num_rate_limits.load(std::memory_order_acquire);
+    for (int i = 0; i < num_limits; i++)
+    {
+        RateLimit &rl = g_rate_limits[i];
+        if (!isSameComponent(rl.m_component, component)) continue;
+
+        const int per_second = rl.m_per_second.load();
+        if (per_second < 0) return true;
+
+        if (second < 0)
+            second = (int64_t)(getTraceTime() / 1000000);
+        int64_t last = rl.m_second.load();
+        // Only one thread starts the new second and reports the number of
+        // messages that were suppressed in the last one.
+        if (last != second && rl.m_second.compare_exchange_strong(last,
+                                                                  second))
+        {
+            rl.m_count.store(0);
+            const int report = rl.m_suppressed.exchange(0);
+            if (report > 0)
+            {
+                output(LL_INFO, component, TEXT("%d messages suppressed."),
+                       report);
+            }
+        }
+        if (rl.m_count.fetch_add(1) < per_second)
+            return true;
+        rl.m_suppressed++;
+        g_num_suppressed++;
+        return false;
+    }
+    return true;
+}   // checkRateLimit
+
+// ----------------------------------------------------------------------------
+/** Limits the number of messages of a component that are printed per
+ *  second. Warnings and errors are never limited.
+ *  \param component The component name as used in the log calls.
+ *  \param per_second Maximum number of messages per second, a negative
+ *         value removes an existing limit.
+ */
+void Log::setRateLimit(const std::string &component, int per_second)
+{
+    if (component.size() >= LOG_COMPONENT_SIZE)
+    {
+        warn(TEXT("Log"), TEXT("Component name too long for a rate limit."));
+        return;
+    }
+    irr::fschar_t name[LOG_COMPONENT_SIZE];
+    for (unsigned int i = 0; i <= component.size(); i++)
+        name[i] = component.c_str()[i];
+
+    pthread_mutex_lock(&g_rate_mutex);
+    const int num_limits = m_num_rate_limits.load();
+    for (int i = 0; i < num_limits; i++)
+    {
+        if (!isSameComponent(g_rate_limits[i].m_component, name)) continue;
+        // A limit is never removed, so other threads can read the limits
+        // without a lock
+        g_rate_limits[i].m_per_second.store(per_second);
+        pthread_mutex_unlock(&g_rate_mutex);
+        return;
+    }
+    if (per_second >= 0)
+    {
+        if (num_limits < (int)MAX_RATE_LIMITS)
+        {
+            RateLimit &rl = g_rate_limits[num_limits];
+            memcpy(rl.m_component, name, sizeof(name));
+            rl.m_per_second.store(per_second);
+            rl.m_count.store(0);
+            rl.m_suppressed.store(0);
+            rl.m_second.store(-1);
+            m_num_rate_limits.store(num_limits + 1,
+                                    std::memory_order_release);
+        }
+        else
+            warn(TEXT("Log"), TEXT("Too many rate limits."));
+    }
+    pthread_mutex_unlock(&g_rate_mutex);
+}   // setRateLimit
+
+// ----------------------------------------------------------------------------
+/** Starts the writer thread. From now on all messages (except fatal ones)
+ *  are queued by the calling thread, and formatted and printed by the
+ *  writer thread.
+ */
+void Log::startAsync()
+{
+    if (m_async.load()) return;
+    createQueue();
+    g_writer_quit.store(false);
+    if (pthread_create(&g_writer_thread, NULL, &Log::writerThread, NULL))
+    {
+        delete [] g_log_queue;
+        g_log_queue = NULL;
+        warn(TEXT("Log"), TEXT("Could not create log thread, using synchronous logging."));
+        return;
+    }
+    m_async.store(true);
+}   // startAsync
+
+// ----------------------------------------------------------------------------
+/** Stops the writer thread after printing all queued messages. Messages are
+ *  printed synchronously afterwards.
+ */
+void Log::stopAsync()
+{
+    if (!m_async.exchange(false)) return;
+    // Wait for threads that have seen m_async set and might still be
+    // writing into the queue.
+    while (g_num_producers.load() > 0)
+        std::this_thread::yield();
+    g_writer_quit.store(true);
+    pthread_mutex_lock(&g_writer_mutex);
+    pthread_cond_signal(&g_writer_cond);
+    pthread_mutex_unlock(&g_writer_mutex);
+    pthread_join(g_writer_thread, NULL);
+    // Another thread might have queued a message after the writer
+    // thread finished its last check.
+    drainQueue();
+    delete [] g_log_queue;
+    g_log_queue = NULL;
+}   // stopAsync
+
+// ----------------------------------------------------------------------------
+/** Formats and prints all messages currently in the queue. Only called from
+ *  the writer thread (or after it was stopped).
+ */
+void Log::drainQueue()
+{
+    std::basic_string<irr::fschar_t> message;
+    while (LogEntry *entry = peekEntry())
+    {
+        if (entry->m_trace_type)
+        {
+            writeTrace(entry->m_time, entry->m_trace_type, entry->getData(),
+                       entry->m_size);
+        }
+        else
+        {
+            message.clear();
+            formatArguments(entry->getData(), entry->m_size, &message);
+            printNow(entry->m_level, entry->m_component, TEXT("%s"),
+                     message.c_str());
+        }
+        releaseEntry(entry);
+    }
+}   // drainQueue
+
+// ----------------------------------------------------------------------------
+/** The writer thread: prints all queued messages, and waits to be woken up
+ *  if the queue is empty.
+ */
+void* Log::writerThread(void *data)
+{
+    while (!g_writer_quit.load())
+    {
+        drainQueue();
+        pthread_mutex_lock(&g_writer_mutex);
+        g_writer_idle.store(true);
+        // A producer might have added an entry before it could see that
+        // this thread is idle, so use a timeout to not wait forever.
+        struct timespec ts;
+        ts.tv_sec  = std::time(0) + 1;
+        ts.tv_nsec = 0;
+        if (!g_writer_quit.load())
+            pthread_cond_timedwait(&g_writer_cond, &g_writer_mutex, &ts);
+        g_writer_idle.store(false);
+        pthread_mutex_unlock(&g_writer_mutex);
+    }
+    drainQueue();
+    return NULL;
+}   // writerThread
+
+// ----------------------------------------------------------------------------
+/** Returns statistics about the asynchronous logging.
+ *  \param queued Number of messages and records passed to the writer thread.
+ *  \param overflows Number of times a thread had to wait because the queue
+ *         was full.
+ *  \param suppressed Number of messages discarded because of rate limits.
+ */
+void Log::getAsyncStatistics(uint64_t *queued, uint64_t *overflows,
+                             uint64_t *suppressed)
+{
+    *queued     = g_num_queued.load();
+    *overflows  = g_num_overflows.load();
+    *suppressed = g_num_suppressed.load();
+}   // getAsyncStatistics
+
+// ----------------------------------------------------------------------------
+/** Opens a file for binary trace records. The file starts with the 8 byte
+ *  magic "STKTRACE" and a 4 byte version number, followed by records of
+ *  an 8 byte time stamp (microseconds), a 2 byte record type, a 4 byte
+ *  data length and the data (all in host byte order).
+ *  \param filename Name of the trace file.
+ *  \return True if the file could be opened.
+ */
+bool Log::openBinaryTrace(const std::string &filename)
+{
+    FILE *f = fopen(filename.c_str(), "wb");
+    if (!f)
+    {
+        error(TEXT("Log"), TEXT("Can not open trace file."));
+        return false;
+    }
+    uint32_t version = 1;
+    fwrite("STKTRACE", 1, 8, f);
+    fwrite(&version, sizeof(version), 1, f);
+    pthread_mutex_lock(&g_trace_mutex);
+    m_file_trace.store(f);
+    pthread_mutex_unlock(&g_trace_mutex);
+    return true;
+}   // openBinaryTrace
+
+// ----------------------------------------------------------------------------
+/** Closes the binary trace file. */
+void Log::closeBinaryTrace()
+{
+    if (!m_file_trace.load()) return;
+    // Records still in the queue will be discarded by writeTrace.
+    pthread_mutex_lock(&g_trace_mutex);
+    FILE *f = m_file_trace.exchange(NULL);
+    if (f)
+        fclose(f);
+    pthread_mutex_unlock(&g_trace_mutex);
+}   // closeBinaryTrace
+
+// ----------------------------------------------------------------------------
+/** Adds a record to the binary trace file. In asynchronous mode records are
+ *  copied into the queue and written by the writer thread, in the same
+ *  order as they were added.
+ *  \param type Type of the record (see TraceType).
+ *  \param data The data to store.
+ *  \param size Number of bytes in data.
+ */
+void Log::trace(uint16_t type, const void *data, unsigned int size)
+{
+    if (!m_file_trace.load()) return;
+    uint64_t time = getTraceTime();
+    g_num_producers++;
+    if (m_async.load())
+    {
+        uint32_t pos;
+        LogEntry *entry = reserveEntryWaiting(&pos);
+        entry->m_trace_type = type;
+        entry->m_time       = time;
+        setEntryData(entry, data, size);
+        publishEntry(entry, pos);
+        g_num_producers--;
+        return;
+    }
+    g_num_producers--;
+    writeTrace(time, type, data, size);
+}   // trace
+
+// ----------------------------------------------------------------------------
+/** Writes one record to the trace file. */
+void Log::writeTrace(uint64_t time, uint16_t type, const void *data,
+                     unsigned int size)
+{
+    uint32_t size32 = size;
+    pthread_mutex_lock(&g_trace_mutex);
+    FILE *f = m_file_trace.load();
+    if (f)
+    {
+        fwrite(&time,   sizeof(time),   1, f);
+        fwrite(&type,   sizeof(type),   1, f);
+        fwrite(&size32, sizeof(size32), 1, f);
+        fwrite(data, 1, size, f);
+    }
+    pthread_mutex_unlock(&g_trace_mutex);
+}   // writeTrace
+
+// ----------------------------------------------------------------------------
+/** This actually prints the log message. If log messages are not redirected
+ *  to a file, it tries to select a terminal colour.
+ *  \param level Log level of the message to print.
+ *  \param format A printf-like format string.
+ *  \param va_list The values to be printed for the format.
+ */
+void Log::printMessageNow(int level, const irr::fschar_t *component,
+                          const irr::fschar_t *format, VALIST args)
+{
 #ifdef ANDROID
     android_LogPriority alp;
     switch (level)
@@ -279,9 +1275,9 @@ void Log::printMessage(int level, const irr::fschar_t *component, const irr::fsc
         MessageBox(NULL, message.c_str(), TEXT("SuperTuxKart - Fatal error"), MB_OK);
     }
 #endif
-}   // printMessage
-
+}   // printMessageNow
 
+// ----------------------------------------------------------------------------
 void Log::setLogLevel(int n)
 {
 	if (n<0 || n>LL_FATAL)
@@ -316,6 +1312,237 @@ void Log::openOutputFiles(const irr::fschar_t* &logout)
 /** Function to close output files */
 void Log::closeOutputFiles()
 {
+    // Print all queued messages before closing the file
+    stopAsync();
+    closeBinaryTrace();
     fclose(m_file_stdout);
 } // closeOutputFiles
 
+
+// ----------------------------------------------------------------------------
+namespace
+{
+    /** Number of threads that fill the queue at the same time in the test. */
+    const unsigned int TEST_NUM_THREADS = 4;
+
+    /** Number of entries each thread adds, together they fill the queue. */
+    const unsigned int TEST_ENTRIES_PER_THREAD =
+                                           LOG_QUEUE_SIZE / TEST_NUM_THREADS;
+
+    /** Adds entries with the thread id and a counter to the queue, and
+     *  returns the number of entries that could be added. */
+    void* fillQueue(void *data)
+    {
+        const uint32_t thread_id = (uint32_t)(size_t)data;
+        size_t num_added = 0;
+        for (uint32_t i = 0; i < TEST_ENTRIES_PER_THREAD; i++)
+        {
+            uint32_t pos;
+            LogEntry *entry = reserveEntry(&pos);
+            if (!entry) break;
+            entry->m_trace_type = Log::TRACE_PACKET_IN;
+            char record[8];
+            memcpy(record,     &thread_id, 4);
+            memcpy(record + 4, &i,         4);
+            setEntryData(entry, record, 8);
+            publishEntry(entry, pos);
+            num_added++;
+        }
+        return (void*)num_added;
+    }   // fillQueue
+
+    // ------------------------------------------------------------------------
+    /** Stores the format and arguments of a test message. */
+    void storeTestArguments(ArgumentBuffer *buffer,
+                            const irr::fschar_t *format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        storeArguments(format, args, buffer);
+        va_end(args);
+    }   // storeTestArguments
+
+    // ------------------------------------------------------------------------
+    /** Formats a test message immediately. */
+    std::basic_string<irr::fschar_t> formatNow(const irr::fschar_t *format,
+                                               ...)
+    {
+        irr::fschar_t buffer[1024];
+        va_list args;
+        va_start(args, format);
+        _vsntprintf(buffer, 1024, format, args);
+        va_end(args);
+        buffer[1023] = 0;
+        return buffer;
+    }   // formatNow
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Tests the queue with several producers, formatting a message from the
+ *  stored arguments, queueing long messages, the rate limits, and the
+ *  format of the binary trace file.
+ */
+void Log::unitTesting()
+{
+    // The test uses the queue itself, so the writer thread must not run
+    const bool was_async = m_async.load();
+    stopAsync();
+
+    // Several threads fill the queue, the entries of each thread must come
+    // out in the order they were added
+    createQueue();
+    pthread_t threads[TEST_NUM_THREADS];
+    for (unsigned int i = 0; i < TEST_NUM_THREADS; i++)
+        pthread_create(&threads[i], NULL, &fillQueue, (void*)(size_t)i);
+    for (unsigned int i = 0; i < TEST_NUM_THREADS; i++)
+    {
+        void *num_added;
+        pthread_join(threads[i], &num_added);
+        assert((size_t)num_added == TEST_ENTRIES_PER_THREAD);
+    }
+    uint32_t pos;
+    assert(reserveEntry(&pos) == NULL);   // the queue is full
+
+    uint32_t next[TEST_NUM_THREADS] = { 0 };
+    for (unsigned int n = 0; n < LOG_QUEUE_SIZE; n++)
+    {
+        LogEntry *entry = peekEntry();
+        assert(entry != NULL && entry->m_size == 8);
+        uint32_t thread_id, counter;
+        memcpy(&thread_id, entry->getData(),     4);
+        memcpy(&counter,   entry->getData() + 4, 4);
+        assert(thread_id < TEST_NUM_THREADS);
+        assert(counter == next[thread_id]);
+        next[thread_id]++;
+        releaseEntry(entry);
+    }
+    assert(peekEntry() == NULL);
+
+    // The queue can be used again once the position wraps around
+    LogEntry *entry = reserveEntry(&pos);
+    assert(entry != NULL && pos == LOG_QUEUE_SIZE);
+    entry->m_trace_type = TRACE_PACKET_OUT;
+    setEntryData(entry, "", 0);
+    publishEntry(entry, pos);
+    assert(peekEntry() == entry);
+    releaseEntry(entry);
+    assert(peekEntry() == NULL);
+
+    // A message formatted from the stored format and arguments is the same
+    // as the message formatted immediately, even if a string argument is
+    // changed after it was stored.
+    irr::fschar_t name[] = TEXT("kart");
+    int value = 42;
+    const irr::fschar_t *format =
+        TEXT("%d|%-6s|%5.2f|%c|%x|%lu|%lld|%p|%%|%.*s|%*d|%e|%hhd");
+    ArgumentBuffer arguments;
+    storeTestArguments(&arguments, format, -7, name, 3.14159, 'Z', 255u,
+                       123456789ul, -5ll, (void*)&value, 3, TEXT("abcdef"),
+                       6, 12, 1.0e-20, 300);
+    name[0] = 'X';
+    std::basic_string<irr::fschar_t> message;
+    formatArguments(arguments.getData(), arguments.getSize(), &message);
+    assert(message == formatNow(format, -7, TEXT("kart"), 3.14159, 'Z', 255u,
+                                123456789ul, -5ll, (void*)&value, 3,
+                                TEXT("abcdef"), 6, 12, 1.0e-20, 300));
+
+    // A long message is queued with allocated data, in order with the
+    // other messages.
+    struct Queue
+    {
+        static void message(int level, const irr::fschar_t *component,
+                            const irr::fschar_t *format, ...)
+        {
+            va_list args;
+            va_start(args, format);
+            queueMessage(level, component, format, args);
+            va_end(args);
+        }   // message
+    };   // Queue
+    std::basic_string<irr::fschar_t> long_string(2 * LOG_ENTRY_SIZE, 'a');
+    Queue::message(LL_INFO, TEXT("UnitTest"), TEXT("%s|%d"),
+                   long_string.c_str(), 5);
+    Queue::message(LL_WARN, TEXT("UnitTest2"), TEXT("%d"), 1);
+    entry = peekEntry();
+    assert(entry != NULL && entry->m_heap != NULL);
+    assert(entry->m_level == LL_INFO);
+    assert(isSameComponent(entry->m_component, TEXT("UnitTest")));
+    message.clear();
+    formatArguments(entry->getData(), entry->m_size, &message);
+    assert(message == long_string + TEXT("|5"));
+    releaseEntry(entry);
+    entry = peekEntry();
+    assert(entry != NULL && entry->m_heap == NULL);
+    assert(entry->m_level == LL_WARN);
+    message.clear();
+    formatArguments(entry->getData(), entry->m_size, &message);
+    assert(message == TEXT("1"));
+    releaseEntry(entry);
+    assert(peekEntry() == NULL);
+    delete [] g_log_queue;
+    g_log_queue = NULL;
+
+    // Rate limits: only the given number of messages per second, warnings
+    // are not affected (they are never checked), other components neither
+    const uint64_t num_suppressed = g_num_suppressed.load();
+    setRateLimit("UnitTest", 3);
+    for (unsigned int i = 0; i < 3; i++)
+        assert(checkRateLimit(TEXT("UnitTest"), 100));
+    assert(!checkRateLimit(TEXT("UnitTest"), 100));
+    assert(!checkRateLimit(TEXT("UnitTest"), 100));
+    assert(checkRateLimit(TEXT("UnitTest2"), 100));
+    assert(g_num_suppressed.load() == num_suppressed + 2);
+    // The next second starts a new count
+    assert(checkRateLimit(TEXT("UnitTest"), 101));
+    setRateLimit("UnitTest", 0);
+    assert(!checkRateLimit(TEXT("UnitTest"), 101));
+    setRateLimit("UnitTest", -1);
+    for (unsigned int i = 0; i < 10; i++)
+        assert(checkRateLimit(TEXT("UnitTest"), 101));
+    (void)num_suppressed;   // avoid compiler warning with NDEBUG
+
+    // Binary trace: header, then time stamp, type, size and data of each
+    // record. Skip this if packets are traced already.
+    if (!isTracing())
+    {
+        const std::string name =
+            file_manager->getUserConfigFile("unit-test.trace");
+        bool ok = openBinaryTrace(name);
+        assert(ok);
+        const char data[] = "0123456789";
+        trace(TRACE_PACKET_IN,  data, 10);
+        trace(TRACE_PACKET_OUT, data, 0);
+        closeBinaryTrace();
+
+        FILE *f = fopen(name.c_str(), "rb");
+        assert(f);
+        char magic[8], buffer[16];
+        uint32_t version, size[2];
+        uint64_t time[2];
+        uint16_t type[2];
+        ok = fread(magic, 8, 1, f) == 1 && memcmp(magic, "STKTRACE", 8) == 0
+          && fread(&version, sizeof(version), 1, f) == 1 && version == 1;
+        assert(ok);
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            ok = fread(&time[i], sizeof(time[i]), 1, f) == 1 &&
+                 fread(&type[i], sizeof(type[i]), 1, f) == 1 &&
+                 fread(&size[i], sizeof(size[i]), 1, f) == 1 &&
+                 size[i] <= sizeof(buffer) &&
+                 fread(buffer, 1, size[i], f) == size[i];
+            assert(ok);
+            if (i == 0)
+                assert(memcmp(buffer, data, 10) == 0);
+        }
+        assert(type[0] == TRACE_PACKET_IN  && size[0] == 10);
+        assert(type[1] == TRACE_PACKET_OUT && size[1] == 0);
+        assert(time[1] >= time[0]);
+        assert(fread(buffer, 1, 1, f) == 0);   // no more records
+        fclose(f);
+        remove(name.c_str());
+        (void)ok;   // avoid compiler warning with NDEBUG
+    }
+
+    if (was_async)
+        startAsync();
+}   // unitTesting
@@ -21,11 +21,13 @@
 #define HEADER_LOG_HPP
 
 #include <assert.h>
+#include <atomic>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
 #include "irrTypes.h"
+#include "utils/types.hpp"
 
 #ifdef __GNUC__
 #  define VALIST __gnuc_va_list
@@ -72,10 +74,40 @@ private:
     /** The file where stdout output will be written */
     static FILE* m_file_stdout;
 
+    /** The file binary trace records are written to, or NULL. */
+    static std::atomic<FILE*> m_file_trace;
+
+    /** True if messages are queued and written by a separate thread. */
+    static std::atomic<bool> m_async;
+
+    /** Number of components with a rate limit. Tested first, so that the
+     *  common case (no limits) does not look at the limits at all. */
+    static std::atomic<int> m_num_rate_limits;
+
     static void setTerminalColor(LogLevel level);
     static void resetTerminalColor();
+    static void printMessageNow(int level, const irr::fschar_t *component,
+                                const irr::fschar_t *format, VALIST va_list);
+    static void printNow(int level, const irr::fschar_t *component,
+                         const irr::fschar_t *format, ...);
+    static void outputMessage(int level, const irr::fschar_t *component,
+                              const irr::fschar_t *format, VALIST va_list);
+    static void output(int level, const irr::fschar_t *component,
+                       const irr::fschar_t *format, ...);
+    static void queueMessage(int level, const irr::fschar_t *component,
+                             const irr::fschar_t *format, VALIST va_list);
+    static bool checkRateLimit(const irr::fschar_t *component,
+                               int64_t second = -1);
+    static void writeTrace(uint64_t time, uint16_t type, const void *data,
+                           unsigned int size);
+    static void* writerThread(void *data);
+    static void  drainQueue();
 
 public:
+    /** Record types for the binary trace. */
+    enum TraceType { TRACE_PACKET_IN  = 1,
+                     TRACE_PACKET_OUT = 2
+    };
 
     static void printMessage(int level, const irr::fschar_t *component,
 		const irr::fschar_t *format, VALIST va_list);
@@ -109,6 +141,19 @@ public:
 
     static void closeOutputFiles();
 
+    static void startAsync();
+    static void stopAsync();
+    static void setRateLimit(const std::string &component, int per_second);
+    static bool openBinaryTrace(const std::string &filename);
+    static void closeBinaryTrace();
+    static void trace(uint16_t type, const void *data, unsigned int size);
+    static void getAsyncStatistics(uint64_t *queued, uint64_t *overflows,
+                                   uint64_t *suppressed);
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns if a binary trace file is open. */
+    static bool isTracing() { return m_file_trace.load() != NULL; }
+
     // ------------------------------------------------------------------------
     /** Defines the minimum log level to be displayed. */
 	static void setLogLevel(int n);
@@ -119,6 +164,11 @@ public:
      *  replacing the cleartext password in an http request). */
     static LogLevel getLogLevel() { return m_min_log_level;  }
     // ------------------------------------------------------------------------
+    /** Returns true if messages of the given level will be printed. This is
+     *  used by the log macros, so that the arguments of a message are not
+     *  even evaluated if the message would not be printed. */
+    static bool isEnabled(LogLevel level) { return level >= m_min_log_level; }
+    // ------------------------------------------------------------------------
     /** Disable coloring of log messages. */
     static void disableColor()
     {
@@ -126,11 +176,21 @@ public:
     }   // disableColor
 };   // Log
 
-#define logverbose(a,b,...) Log::verbose(TEXT(a),TEXT(b),##__VA_ARGS__)
-#define logdebug(a,b,...) Log::debug(TEXT(a),TEXT(b),##__VA_ARGS__)
-#define loginfo(a,b,...) Log::info(TEXT(a),TEXT(b),##__VA_ARGS__)
-#define logwarn(a,b,...) Log::warn(TEXT(a),TEXT(b),##__VA_ARGS__)
-#define logerror(a,b,...) Log::error(TEXT(a),TEXT(b),##__VA_ARGS__)
+/** The log macros test the log level before the arguments are evaluated, so
+ *  that expensive arguments (e.g. getLogMessage() or toString()) cost
+ *  nothing if the message would not be printed anyway. */
+#define LOG_IF_ENABLED(LEVEL, NAME, a, b, ...)                       \
+    do                                                               \
+    {                                                                \
+        if (Log::isEnabled(LEVEL))                                   \
+            Log::NAME(TEXT(a), TEXT(b), ##__VA_ARGS__);              \
+    } while (0)
+
+#define logverbose(a,b,...) LOG_IF_ENABLED(Log::LL_VERBOSE, verbose, a, b, ##__VA_ARGS__)
+#define logdebug(a,b,...)   LOG_IF_ENABLED(Log::LL_DEBUG,   debug,   a, b, ##__VA_ARGS__)
+#define loginfo(a,b,...)    LOG_IF_ENABLED(Log::LL_INFO,    info,    a, b, ##__VA_ARGS__)
+#define logwarn(a,b,...)    LOG_IF_ENABLED(Log::LL_WARN,    warn,    a, b, ##__VA_ARGS__)
+#define logerror(a,b,...)   LOG_IF_ENABLED(Log::LL_ERROR,   error,   a, b, ##__VA_ARGS__)
 #define logfatal(a,b,...) Log::fatal(TEXT(a),TEXT(b),##__VA_ARGS__)
 
 
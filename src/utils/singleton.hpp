@@ -103,6 +103,9 @@ public:
         return m_singleton;
     }
 
+    /*! \brief Returns true if the instance exists (without creating it). */
+    static bool isCreated() { return m_singleton != NULL; }
+
     /*! \brief Used to kill the singleton, if needed. */
     static void kill()
     {
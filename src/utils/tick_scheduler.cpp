@@ -0,0 +1,255 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/tick_scheduler.hpp"
+
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <string.h>
+#include <thread>
+
+/** If less than this time (in microseconds) is left till the next tick,
+ *  the scheduler spins instead of sleeping, since a sleep can take about a
+ *  millisecond longer than requested. */
+static const uint64_t SPIN_TIME = 1500;
+
+// ----------------------------------------------------------------------------
+namespace
+{
+    /** The clock used by default: the monotonic steady clock. */
+    class SteadyClock : public TickScheduler::Clock
+    {
+    public:
+        virtual uint64_t getMicroseconds()
+        {
+            return TickScheduler::getMicroseconds();
+        }
+        virtual void sleep(uint64_t microseconds)
+        {
+            std::this_thread::sleep_for(
+                                   std::chrono::microseconds(microseconds));
+        }
+        virtual void yield() { std::this_thread::yield(); }
+    };   // SteadyClock
+
+    SteadyClock g_steady_clock;
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Creates a scheduler.
+ *  \param ticks_per_second The tick rate.
+ *  \param max_catch_up Maximum number of ticks that are started without
+ *         waiting if the loop is behind.
+ *  \param report_interval Time between two reports of the statistics in
+ *         seconds, 0 to disable reports.
+ *  \param clock The time source, NULL for the steady clock. It is not
+ *         deleted by the scheduler.
+ */
+TickScheduler::TickScheduler(unsigned int ticks_per_second,
+                             unsigned int max_catch_up,
+                             float report_interval,
+                             Clock *clock)
+{
+    assert(ticks_per_second > 0);
+    m_clock           = clock ? clock : &g_steady_clock;
+    m_tick_duration   = 1000000 / ticks_per_second;
+    m_tick_dt         = 1.0f / ticks_per_second;
+    m_max_catch_up    = max_catch_up;
+    m_report_interval = (uint64_t)(report_interval * 1000000);
+    m_next_tick       = m_clock->getMicroseconds();
+    m_tick_start      = m_next_tick;
+    m_last_report     = m_next_tick;
+    m_total_skipped   = 0;
+    memset(&m_statistics, 0, sizeof(m_statistics));
+}   // TickScheduler
+
+// ----------------------------------------------------------------------------
+/** Returns a monotonic time in microseconds. */
+uint64_t TickScheduler::getMicroseconds()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now()
+                                       .time_since_epoch()).count();
+}   // getMicroseconds
+
+// ----------------------------------------------------------------------------
+/** Waits till the next tick is due, and returns the time step size to use
+ *  for this tick (which is always the tick duration).
+ */
+float TickScheduler::waitForNextTick()
+{
+    uint64_t now = m_clock->getMicroseconds();
+    if (now < m_next_tick)
+    {
+        const uint64_t wait_start = now;
+        if (m_next_tick - now > SPIN_TIME)
+            m_clock->sleep(m_next_tick - now - SPIN_TIME);
+        now = m_clock->getMicroseconds();
+        while (now < m_next_tick)
+        {
+            m_clock->yield();
+            now = m_clock->getMicroseconds();
+        }
+        m_statistics.m_idle_time += now - wait_start;
+    }
+    else if (now - m_next_tick >= m_tick_duration * (m_max_catch_up + 1))
+    {
+        // Too far behind: skip the ticks that can't be caught up. The
+        // simulation is then behind the real time, so this is logged.
+        uint64_t behind  = (now - m_next_tick) / m_tick_duration;
+        uint64_t skipped = behind - m_max_catch_up;
+        m_statistics.m_num_skipped += skipped;
+        m_total_skipped            += skipped;
+        m_next_tick += skipped * m_tick_duration;
+        logwarn("TickScheduler", "Skipped %d ticks (%d ms), %d ticks "
+                "skipped in total.", (int)skipped,
+                (int)(skipped * m_tick_duration / 1000),
+                (int)m_total_skipped);
+    }
+
+    if (m_report_interval > 0 && now - m_last_report >= m_report_interval)
+        report(now);
+
+    m_tick_start = now;
+    m_next_tick += m_tick_duration;
+    return m_tick_dt;
+}   // waitForNextTick
+
+// ----------------------------------------------------------------------------
+/** Called at the end of a tick to record its duration. */
+void TickScheduler::endTick()
+{
+    uint64_t duration = m_clock->getMicroseconds() - m_tick_start;
+    m_statistics.m_num_ticks++;
+    m_statistics.m_busy_time += duration;
+    if (duration > m_tick_duration)
+        m_statistics.m_num_overruns++;
+    m_durations.push_back((uint32_t)std::min<uint64_t>(duration, 0xffffffff));
+}   // endTick
+
+// ----------------------------------------------------------------------------
+/** Returns a percentile of a set of values. The values are reordered.
+ *  \param values The values, must not be empty.
+ *  \param percentile The percentile (0 to 100).
+ */
+uint32_t TickScheduler::getPercentile(std::vector<uint32_t> *values,
+                                      float percentile)
+{
+    assert(!values->empty());
+    size_t n = (size_t)(percentile / 100.0f * (values->size() - 1) + 0.5f);
+    if (n >= values->size()) n = values->size() - 1;
+    std::nth_element(values->begin(), values->begin() + n, values->end());
+    return (*values)[n];
+}   // getPercentile
+
+// ----------------------------------------------------------------------------
+/** Logs the statistics since the last report, and resets them. */
+void TickScheduler::report(uint64_t now)
+{
+    m_last_report = now;
+    if (m_durations.empty()) return;
+
+    uint32_t p50 = getPercentile(&m_durations, 50.0f);
+    uint32_t p90 = getPercentile(&m_durations, 90.0f);
+    uint32_t p99 = getPercentile(&m_durations, 99.0f);
+    uint32_t max = *std::max_element(m_durations.begin(), m_durations.end());
+    uint64_t total = m_statistics.m_idle_time + m_statistics.m_busy_time;
+    loginfo("TickScheduler", "%d ticks, duration p50 %d us, p90 %d us, "
+            "p99 %d us, max %d us, %d overruns, %d skipped (%d in total), "
+            "%.1f%% idle.",
+            (int)m_statistics.m_num_ticks, p50, p90, p99, max,
+            (int)m_statistics.m_num_overruns, (int)m_statistics.m_num_skipped,
+            (int)m_total_skipped,
+            total ? 100.0f * m_statistics.m_idle_time / total : 0.0f);
+
+    m_durations.clear();
+    memset(&m_statistics, 0, sizeof(m_statistics));
+}   // report
+
+// ----------------------------------------------------------------------------
+namespace
+{
+    /** A clock for the unit test, which only advances when the scheduler
+     *  sleeps or spins, or when the test simulates the work of a tick. */
+    class TestClock : public TickScheduler::Clock
+    {
+    public:
+        uint64_t m_now;
+        TestClock() : m_now(1000000) {}
+        virtual uint64_t getMicroseconds()          { return m_now;   }
+        virtual void sleep(uint64_t microseconds)   { m_now += microseconds; }
+        virtual void yield()                        { m_now++;        }
+    };   // TestClock
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Tests the percentile computation, the tick rate, and that ticks are
+ *  skipped and counted if the loop is too far behind. The scheduler uses a
+ *  test clock, so the results don't depend on the timing of the machine.
+ */
+void TickScheduler::unitTesting()
+{
+    std::vector<uint32_t> values;
+    for (uint32_t i = 100; i > 0; i--)
+        values.push_back(i);
+    assert(getPercentile(&values, 0.0f)   == 1);
+    assert(getPercentile(&values, 50.0f)  == 51);
+    assert(getPercentile(&values, 100.0f) == 100);
+
+    // 100 ticks per second, each tick takes 2 ms: the first tick starts
+    // immediately, the others exactly 10 ms after the previous one.
+    TestClock clock;
+    const uint64_t start = clock.m_now;
+    TickScheduler scheduler(100, 2, 0.0f, &clock);
+    for (unsigned int i = 0; i < 20; i++)
+    {
+        const float dt = scheduler.waitForNextTick();
+        assert(dt == 0.01f);
+        assert(clock.m_now == start + i * 10000);
+        clock.m_now += 2000;
+        scheduler.endTick();
+        (void)dt;   // avoid compiler warning with NDEBUG
+    }
+    const Statistics &statistics = scheduler.getStatistics();
+    assert(statistics.m_num_ticks    == 20);
+    assert(statistics.m_num_overruns == 0);
+    assert(statistics.m_busy_time    == 20 * 2000);
+    assert(statistics.m_idle_time    == 19 * 8000);
+
+    // A tick of 45 ms: the next tick is 35 ms late. Two ticks are caught up
+    // without waiting, one tick is skipped, and the ticks after that are
+    // due at the same times as before.
+    scheduler.waitForNextTick();
+    assert(clock.m_now == start + 200000);
+    clock.m_now += 45000;
+    scheduler.endTick();
+    assert(statistics.m_num_overruns == 1);
+    scheduler.waitForNextTick();
+    assert(statistics.m_num_skipped == 1);
+    assert(scheduler.getNumSkippedTicks() == 1);
+    scheduler.waitForNextTick();
+    scheduler.waitForNextTick();
+    assert(clock.m_now == start + 245000);
+    scheduler.waitForNextTick();
+    assert(clock.m_now == start + 250000);
+    assert(scheduler.getNumSkippedTicks() == 1);
+    (void)start; (void)statistics;   // avoid compiler warning with NDEBUG
+}   // unitTesting
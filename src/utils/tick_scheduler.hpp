@@ -0,0 +1,131 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2017 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TICK_SCHEDULER_HPP
+#define HEADER_TICK_SCHEDULER_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <stddef.h>
+#include <vector>
+
+/**
+  * \brief Runs a loop at a fixed tick rate, used by a dedicated server
+  *  without graphics.
+  *  waitForNextTick() waits till the next tick is due, measured with a
+  *  monotonic clock in microseconds. Most of the time is slept, and the
+  *  last part of the wait is spent spinning, since sleeping is not precise
+  *  enough. If the loop is behind, the next ticks start immediately to
+  *  catch up, but at most a limited number of ticks are caught up - older
+  *  ticks are skipped, which means the simulation falls behind the real
+  *  time. Skipped ticks are logged as a warning when they happen, and their
+  *  total is kept. The scheduler regularly logs the percentiles of the
+  *  tick durations, the number of overruns (ticks that took longer than
+  *  a tick) and skipped ticks, and the fraction of the time spent waiting.
+  *  The time is read from a Clock, which the unit test replaces to get
+  *  results that don't depend on the load of the machine.
+  * \ingroup utils
+  */
+class TickScheduler : public NoCopy
+{
+public:
+    /** The time source of the scheduler. */
+    class Clock
+    {
+    public:
+        virtual ~Clock() {}
+        /** Returns a monotonic time in microseconds. */
+        virtual uint64_t getMicroseconds() = 0;
+        /** Sleeps for the given number of microseconds. */
+        virtual void     sleep(uint64_t microseconds) = 0;
+        /** Gives the processor to other threads while spinning. */
+        virtual void     yield() = 0;
+    };   // Clock
+
+    /** Statistics since the last report. */
+    struct Statistics
+    {
+        /** Number of ticks. */
+        uint64_t m_num_ticks;
+        /** Number of ticks that took longer than the tick duration. */
+        uint64_t m_num_overruns;
+        /** Number of ticks skipped because the loop was too far behind. */
+        uint64_t m_num_skipped;
+        /** Time spent waiting for the next tick in microseconds. */
+        uint64_t m_idle_time;
+        /** Time spent in ticks in microseconds. */
+        uint64_t m_busy_time;
+    };   // Statistics
+
+private:
+    /** Duration of one tick in microseconds. */
+    uint64_t m_tick_duration;
+
+    /** Duration of one tick in seconds, returned as time step size. */
+    float m_tick_dt;
+
+    /** Time at which the next tick is due. */
+    uint64_t m_next_tick;
+
+    /** Time at which the current tick started. */
+    uint64_t m_tick_start;
+
+    /** Maximum number of ticks that are caught up if the loop is behind. */
+    unsigned int m_max_catch_up;
+
+    /** Time at which the statistics were last reported. */
+    uint64_t m_last_report;
+
+    /** Interval between two reports in microseconds, 0 means no reports. */
+    uint64_t m_report_interval;
+
+    /** Durations of all ticks since the last report, in microseconds. */
+    std::vector<uint32_t> m_durations;
+
+    Statistics m_statistics;
+
+    /** Number of ticks skipped since the scheduler was created. */
+    uint64_t m_total_skipped;
+
+    /** The time source. */
+    Clock *m_clock;
+
+    void report(uint64_t now);
+
+public:
+             TickScheduler(unsigned int ticks_per_second,
+                           unsigned int max_catch_up = 5,
+                           float report_interval = 60.0f,
+                           Clock *clock = NULL);
+    float    waitForNextTick();
+    void     endTick();
+    static uint64_t getMicroseconds();
+    static uint32_t getPercentile(std::vector<uint32_t> *values,
+                                  float percentile);
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns the statistics since the last report. */
+    const Statistics &getStatistics() const { return m_statistics; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of ticks skipped since the scheduler was created,
+     *  i.e. how far the simulation is behind the real time. */
+    uint64_t getNumSkippedTicks() const { return m_total_skipped; }
+};   // TickScheduler
+
+#endif
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+#
+# A small local stand-in for the stk addons server, used to test the
+# request manager (see 'supertuxkart --http-benchmark=URL'). Every request
+# is answered after a configurable delay with a fixed number of bytes. The
+# server uses HTTP/1.1 keep-alive, and prints how many requests were served
+# over how many connections, which shows if connections are reused.
+#
+# Usage: http_test_server.py [--port=8080] [--latency=MS] [--size=BYTES]
+
+import getopt
+import sys
+import threading
+import time
+
+try:
+    from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+except ImportError:
+    print("This script needs python 3.7 or later.")
+    sys.exit(1)
+
+port    = 8080
+latency = 0.1
+size    = 16*1024
+
+lock        = threading.Lock()
+connections = 0
+requests    = 0
+
+# -----------------------------------------------------------------------------
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def setup(self):
+        global connections
+        BaseHTTPRequestHandler.setup(self)
+        with lock:
+            connections += 1
+
+    def reply(self):
+        global requests
+        # Read (and ignore) any posted parameters
+        length = int(self.headers.get("Content-Length", 0))
+        if length > 0:
+            self.rfile.read(length)
+        time.sleep(latency)
+        body = b"x" * size
+        self.send_response(200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+        with lock:
+            requests += 1
+            if requests % 16 == 0:
+                print("%d requests over %d connections" % (requests,
+                                                           connections))
+
+    def do_GET(self):
+        self.reply()
+
+    def do_POST(self):
+        self.reply()
+
+    def log_message(self, format, *args):
+        pass
+
+# -----------------------------------------------------------------------------
+def usage():
+    print("Usage: %s [--port=8080] [--latency=MS] [--size=BYTES]" % sys.argv[0])
+    sys.exit(1)
+
+try:
+    opts, args = getopt.getopt(sys.argv[1:], "h",
+                               ["port=", "latency=", "size=", "help"])
+except getopt.GetoptError:
+    usage()
+
+for o, a in opts:
+    if o == "--port":
+        port = int(a)
+    elif o == "--latency":
+        latency = int(a)/1000.0
+    elif o == "--size":
+        size = int(a)
+    else:
+        usage()
+
+print("Serving %d bytes with %d ms latency on http://localhost:%d/"
+      % (size, latency*1000, port))
+ThreadingHTTPServer(("", port), Handler).serve_forever()